@@ -0,0 +1,178 @@
+/*
+ * faultbench.c: threaded anonymous page fault benchmark
+ *
+ * Every thread maps a private anonymous area, writes one word to each
+ * of its pages and unmaps it again, over and over, so that nearly all
+ * of its time goes into first-touch page faults.  With -m another
+ * thread meanwhile keeps mapping and unmapping a small area, taking
+ * mmap_sem for writing all the time.
+ *
+ * Faults that the kernel handles without mmap_sem (see
+ * handle_speculative_fault() in mm/memory.c) are counted in
+ * pgfault_speculative in /proc/vmstat.  The program prints how many of
+ * the run's faults that covers, when the counter exists.
+ *
+ * Compare the faults per second for 1, 2, 4 ... threads, with and
+ * without -m.  Faults taken under mmap_sem stop scaling as soon as the
+ * -m thread is running.
+ *
+ * Usage: faultbench [-t threads] [-s MB per thread] [-i iterations] [-m]
+ *
+ * compile-command: "gcc -Wall -O2 faultbench.c -o faultbench -lpthread"
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+static int nr_threads = 1;
+static size_t area_size = 16 << 20;
+static int iterations = 64;
+static int hammer;
+
+static long page_size;
+static volatile int stop_hammer;
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Value of @name in /proc/vmstat, or -1 if it is not there */
+static long long read_vmstat(const char *name)
+{
+	char key[64];
+	long long val;
+	FILE *f = fopen("/proc/vmstat", "r");
+
+	if (!f)
+		return -1;
+	while (fscanf(f, "%63s %lld", key, &val) == 2) {
+		if (!strcmp(key, name)) {
+			fclose(f);
+			return val;
+		}
+	}
+	fclose(f);
+	return -1;
+}
+
+static void *fault_thread(void *arg)
+{
+	int i;
+
+	for (i = 0; i < iterations; i++) {
+		char *p, *end;
+
+		p = mmap(NULL, area_size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			perror("mmap");
+			exit(1);
+		}
+		for (end = p + area_size; p < end; p += page_size)
+			*(volatile char *)p = 1;
+		munmap(end - area_size, area_size);
+	}
+	return NULL;
+}
+
+static void *hammer_thread(void *arg)
+{
+	while (!stop_hammer) {
+		void *p = mmap(NULL, 16 * page_size, PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (p == MAP_FAILED) {
+			perror("mmap");
+			exit(1);
+		}
+		munmap(p, 16 * page_size);
+	}
+	return NULL;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: faultbench [-t threads] [-s MB per thread] "
+		"[-i iterations] [-m]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *threads, hammer_tid;
+	long long faults, spec_before, spec_after, fault_before, fault_after;
+	double start, elapsed;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "t:s:i:m")) != -1) {
+		switch (c) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 's':
+			area_size = (size_t)atoi(optarg) << 20;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 'm':
+			hammer = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	page_size = sysconf(_SC_PAGESIZE);
+	if (nr_threads < 1 || area_size < (size_t)page_size || iterations < 1)
+		usage();
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	if (!threads)
+		return 1;
+
+	if (hammer && pthread_create(&hammer_tid, NULL, hammer_thread, NULL)) {
+		perror("pthread_create");
+		return 1;
+	}
+
+	fault_before = read_vmstat("pgfault");
+	spec_before = read_vmstat("pgfault_speculative");
+	start = now();
+	for (i = 0; i < nr_threads; i++)
+		if (pthread_create(threads + i, NULL, fault_thread, NULL)) {
+			perror("pthread_create");
+			return 1;
+		}
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+	elapsed = now() - start;
+	fault_after = read_vmstat("pgfault");
+	spec_after = read_vmstat("pgfault_speculative");
+
+	if (hammer) {
+		stop_hammer = 1;
+		pthread_join(hammer_tid, NULL);
+	}
+
+	faults = (long long)nr_threads * iterations * (area_size / page_size);
+	printf("%d threads%s: %lld faults in %.3fs, %.0f faults/s, "
+	       "%.0f per thread\n", nr_threads, hammer ? " + mmap" : "",
+	       faults, elapsed, faults / elapsed,
+	       faults / elapsed / nr_threads);
+	if (fault_before >= 0 && spec_before >= 0 &&
+	    fault_after > fault_before)
+		printf("%lld of %lld faults (%.1f%%) without mmap_sem\n",
+		       spec_after - spec_before, fault_after - fault_before,
+		       100.0 * (spec_after - spec_before) /
+		       (fault_after - fault_before));
+	return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * preadbench.c: threaded page cache lookup benchmark
+ *
+ * All threads pread() small blocks at random offsets from one file that
+ * is fully in the page cache.  Each read is a find_get_page() on the same
+ * mapping, so that with lookups under mapping->tree_lock the threads
+ * bounce the lock between cpus, while lockless lookups (see
+ * find_get_page() in mm/filemap.c) should scale with the number of
+ * threads.  With -p every thread reads its own file instead, which takes
+ * the shared lock out of the picture, for comparison.
+ *
+ * The file (or files) are created in the current directory, or the
+ * directory given with -d, and removed at the end.
+ *
+ * Usage: preadbench [-t threads] [-s MB] [-b block bytes] [-i reads per
+ *                   thread] [-d dir] [-p]
+ *
+ * compile-command: "gcc -Wall -O2 preadbench.c -o preadbench -lpthread"
+ */
+
+#define _XOPEN_SOURCE 500
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+static int nr_threads = 1;
+static size_t file_size = 64 << 20;
+static size_t block = 64;
+static long reads = 1000000;
+static const char *dir = ".";
+static int private_files;
+
+static int *fds;
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Create a file of file_size bytes and read it once to get it cached */
+static int make_file(int nr)
+{
+	char name[4096], buf[65536];
+	size_t done;
+	int fd;
+
+	snprintf(name, sizeof(name), "%s/preadbench.%d.%d", dir,
+		 (int)getpid(), nr);
+	fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		perror(name);
+		exit(1);
+	}
+	unlink(name);
+	memset(buf, 0x5a, sizeof(buf));
+	for (done = 0; done < file_size; done += sizeof(buf))
+		if (write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+			perror("write");
+			exit(1);
+		}
+	for (done = 0; done < file_size; done += sizeof(buf))
+		if (pread(fd, buf, sizeof(buf), done) != sizeof(buf)) {
+			perror("pread");
+			exit(1);
+		}
+	return fd;
+}
+
+static void *read_thread(void *arg)
+{
+	long nr = (long)arg;
+	int fd = fds[private_files ? nr : 0];
+	unsigned int seed = nr + 1;
+	size_t blocks = file_size / block;
+	char *buf = malloc(block);
+	long i;
+
+	if (!buf)
+		exit(1);
+	for (i = 0; i < reads; i++) {
+		off_t off = (off_t)(rand_r(&seed) % blocks) * block;
+
+		if (pread(fd, buf, block, off) != (ssize_t)block) {
+			perror("pread");
+			exit(1);
+		}
+	}
+	free(buf);
+	return NULL;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: preadbench [-t threads] [-s MB] "
+		"[-b block bytes] [-i reads per thread] [-d dir] [-p]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *threads;
+	double start, elapsed;
+	long i;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:s:b:i:d:p")) != -1) {
+		switch (c) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 's':
+			file_size = (size_t)atoi(optarg) << 20;
+			break;
+		case 'b':
+			block = atoi(optarg);
+			break;
+		case 'i':
+			reads = atol(optarg);
+			break;
+		case 'd':
+			dir = optarg;
+			break;
+		case 'p':
+			private_files = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (nr_threads < 1 || !block || file_size < block || reads < 1)
+		usage();
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	fds = calloc(nr_threads, sizeof(*fds));
+	if (!threads || !fds)
+		return 1;
+	for (i = 0; i < (private_files ? nr_threads : 1); i++)
+		fds[i] = make_file(i);
+
+	start = now();
+	for (i = 0; i < nr_threads; i++)
+		if (pthread_create(threads + i, NULL, read_thread, (void *)i)) {
+			perror("pthread_create");
+			return 1;
+		}
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+	elapsed = now() - start;
+
+	printf("%d threads, %s file%s: %.0f reads/s, %.0f per thread\n",
+	       nr_threads, private_files ? "private" : "shared",
+	       private_files ? "s" : "",
+	       nr_threads * reads / elapsed, reads / elapsed);
+	return 0;
+}
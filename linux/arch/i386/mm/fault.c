@@ -300,6 +300,20 @@ fastcall void do_page_fault(struct pt_regs *regs, unsigned long error_code)
 	if (in_atomic() || !mm)
 		goto bad_area_nosemaphore;
 
+	/*
+	 * Most faults on anonymous memory can be handled without mmap_sem,
+	 * so that they do not queue up behind an mmap() or munmap() by
+	 * another thread.  Anything unusual, including all errors and vm86
+	 * mode with its screen bitmap, is left to the code below.
+	 */
+	if (!(regs->eflags & VM_MASK) &&
+	    (!(error_code & 1) || (error_code & 2))) {
+		if (handle_speculative_fault(mm, address, error_code & 2)) {
+			tsk->min_flt++;
+			return;
+		}
+	}
+
 	/* When running in the kernel we expect faults to occur only to
 	 * addresses in user space.  All other faults represent errors in the
 	 * kernel and should generate an OOPS.  Unfortunatly, in the case of an
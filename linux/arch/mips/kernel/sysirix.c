@@ -648,21 +648,7 @@ static inline void jiffiestotv(unsigned long jiffies, struct timeval *value)
 
 static inline void getitimer_real(struct itimerval *value)
 {
-	register unsigned long val, interval;
-
-	interval = current->it_real_incr;
-	val = 0;
-	if (del_timer(&current->real_timer)) {
-		unsigned long now = jiffies;
-		val = current->real_timer.expires;
-		add_timer(&current->real_timer);
-		/* look out for negative/zero itimer.. */
-		if (val <= now)
-			val = now+1;
-		val -= now;
-	}
-	jiffiestotv(val, &value->it_value);
-	jiffiestotv(interval, &value->it_interval);
+	do_getitimer(ITIMER_REAL, value);
 }
 
 asmlinkage unsigned int irix_alarm(unsigned int seconds)
@@ -672,7 +658,7 @@ asmlinkage unsigned int irix_alarm(unsigned int seconds)
 
 	if (!seconds) {
 		getitimer_real(&it_old);
-		del_timer(&current->real_timer);
+		hrtimer_cancel(&current->real_timer);
 	} else {
 		it_new.it_interval.tv_sec = it_new.it_interval.tv_usec = 0;
 		it_new.it_value.tv_sec = seconds;
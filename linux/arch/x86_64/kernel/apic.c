@@ -26,6 +26,8 @@
 #include <linux/mc146818rtc.h>
 #include <linux/kernel_stat.h>
 #include <linux/sysdev.h>
+#include <linux/rcupdate.h>
+#include <linux/hrtimer.h>
 
 #include <asm/atomic.h>
 #include <asm/smp.h>
@@ -828,6 +830,174 @@ int setup_profiling_timer(unsigned int multiplier)
 	return 0;
 }
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+/*
+ * High resolution timer events: the local APIC timer stays the periodic
+ * tick, except when an hrtimer is due before the next tick. It is then
+ * switched to one-shot mode for the hrtimer, armed again for the rest of
+ * the tick period when that fires, and made periodic again on the tick.
+ * The hrtimer queues are run from the timer softirq the event raises.
+ */
+/* the APIC timer is in one-shot mode for an hrtimer */
+static DEFINE_PER_CPU(int, hr_oneshot);
+/* APIC counts from the pending one-shot to the tick, 0 if it is the tick */
+static DEFINE_PER_CPU(unsigned int, hr_tick_left);
+
+/*
+ * Make the local APIC timer interrupt come 'delta' from now, if that is
+ * before the one it has pending. Called with interrupts disabled.
+ */
+void hrtimer_program_event(ktime_t delta)
+{
+	int cpu = smp_processor_id();
+	unsigned long count, left;
+	s64 ns = ktime_to_ns(delta);
+
+	/* A tickless idle cpu first gets its tick back in start_hz_timer() */
+	if (!using_apic_timer || cpu_isset(cpu, nohz_cpu_mask))
+		return;
+	if (ns >= TICK_NSEC)
+		return;
+	if (ns < 0)
+		ns = 0;
+
+	count = ns * ((u64)calibration_result * HZ / APIC_DIVISOR) /
+		NSEC_PER_SEC;
+	if (!count)
+		count = 1;	/* a zero count stops the timer */
+	left = apic_read(APIC_TMCCT);
+	if (count >= left)
+		return;
+
+	per_cpu(hr_tick_left, cpu) += left - count;
+	per_cpu(hr_oneshot, cpu) = 1;
+	apic_write_around(APIC_LVTT, LOCAL_TIMER_VECTOR);
+	apic_write_around(APIC_TMICT, count);
+}
+
+/*
+ * Called from the local timer interrupt: returns 1 if it was for an
+ * hrtimer rather than the tick.
+ */
+static int hrtimer_apic_event(int cpu)
+{
+	unsigned int left = per_cpu(hr_tick_left, cpu);
+
+	if (!per_cpu(hr_oneshot, cpu))
+		return 0;
+	if (!left) {
+		per_cpu(hr_oneshot, cpu) = 0;
+		__setup_APIC_LVTT(calibration_result/
+				  per_cpu(prof_old_multiplier, cpu));
+		return 0;
+	}
+	per_cpu(hr_tick_left, cpu) = 0;
+	apic_write_around(APIC_TMICT, left);
+	raise_softirq(TIMER_SOFTIRQ);
+	return 1;
+}
+#endif
+
+#ifdef CONFIG_NO_IDLE_HZ
+/*
+ * Tickless idle: an idle cpu switches its local APIC timer to one-shot
+ * mode, armed for the next timer wheel expiry, and goes back to the
+ * periodic tick on the first interrupt that wakes it. jiffies keep
+ * being advanced by the global timer interrupt meanwhile, so all that
+ * has to be caught up are the idle ticks this cpu did not account.
+ *
+ * The HZ timer can be switched back on via /proc/sys/kernel/hz_timer.
+ */
+int sysctl_hz_timer = 0;
+
+/* jiffies when this cpu stopped its tick */
+static DEFINE_PER_CPU(unsigned long, hz_timer_stopped);
+/* apic_timer_irqs when it restarted it */
+static DEFINE_PER_CPU(unsigned int, hz_timer_irqs);
+
+/*
+ * Stop the HZ tick on the current CPU. Only the idle loop may call this,
+ * with interrupts disabled right before halting.
+ */
+void stop_hz_timer(void)
+{
+	int cpu = smp_processor_id();
+	unsigned long ticks, max_ticks;
+
+	if (sysctl_hz_timer != 0 || !using_apic_timer)
+		return;
+
+#ifdef CONFIG_HIGH_RES_TIMERS
+	/* An hrtimer is due before the next tick */
+	if (__get_cpu_var(hr_oneshot))
+		return;
+#endif
+
+	/*
+	 * Let at least one tick run after each wakeup, so that the
+	 * scheduler gets to do its idle balancing when kicked.
+	 */
+	if (read_pda(apic_timer_irqs) == __get_cpu_var(hz_timer_irqs))
+		return;
+
+	cpu_set(cpu, nohz_cpu_mask);
+
+	/*
+	 * Keep ticking if rcu still waits for this cpu, if softirqs are
+	 * pending or if a timer is due within the next tick anyway.
+	 */
+	if (rcu_pending(cpu) || local_softirq_pending())
+		goto keep_ticking;
+	ticks = next_timer_interrupt() - jiffies;
+	if ((long)ticks <= 1)
+		goto keep_ticking;
+
+	/* TMICT is 32 bits wide */
+	max_ticks = 0xffffffffUL / (calibration_result/APIC_DIVISOR);
+	if (ticks > max_ticks)
+		ticks = max_ticks;
+
+	__get_cpu_var(hz_timer_stopped) = jiffies;
+	apic_write_around(APIC_LVTT, LOCAL_TIMER_VECTOR);
+	apic_write_around(APIC_TMICT, ticks * (calibration_result/APIC_DIVISOR));
+	return;
+
+keep_ticking:
+	cpu_clear(cpu, nohz_cpu_mask);
+}
+
+/*
+ * Go back to the periodic tick and account the ticks missed meanwhile
+ * as idle time. 'accounted' is 1 when called from the local timer
+ * interrupt, which accounts the current tick itself.
+ */
+static void __start_hz_timer(int cpu, int accounted, int hardirq_offset)
+{
+	long missed;
+
+	cpu_clear(cpu, nohz_cpu_mask);
+	__setup_APIC_LVTT(calibration_result/per_cpu(prof_old_multiplier, cpu));
+	per_cpu(hz_timer_irqs, cpu) = read_pda(apic_timer_irqs);
+
+	missed = jiffies - per_cpu(hz_timer_stopped, cpu) - accounted;
+	if (missed > 0)
+		account_system_time(current, hardirq_offset,
+				    jiffies_to_cputime(missed));
+}
+
+/*
+ * Start the HZ tick on the current CPU. Only the idle loop may call this,
+ * with interrupts disabled.
+ */
+void start_hz_timer(void)
+{
+	int cpu = smp_processor_id();
+
+	if (cpu_isset(cpu, nohz_cpu_mask))
+		__start_hz_timer(cpu, 0, 0);
+}
+#endif
+
 #undef APIC_DIVISOR
 
 /*
@@ -844,6 +1014,15 @@ void smp_local_timer_interrupt(struct pt_regs *regs)
 {
 	int cpu = smp_processor_id();
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+	if (hrtimer_apic_event(cpu))
+		return;
+#endif
+#ifdef CONFIG_NO_IDLE_HZ
+	/* The one-shot timer of a tickless idle cpu has expired */
+	if (cpu_isset(cpu, nohz_cpu_mask))
+		__start_hz_timer(cpu, 1, HARDIRQ_OFFSET);
+#endif
 	profile_tick(CPU_PROFILING, regs);
 	if (--per_cpu(prof_counter, cpu) <= 0) {
 		/*
@@ -386,7 +386,8 @@ void nmi_watchdog_tick (struct pt_regs * regs, unsigned reason)
 
 	cpu = safe_smp_processor_id();
 	sum = read_pda(apic_timer_irqs);
-	if (last_irq_sums[cpu] == sum) {
+	/* A tickless idle cpu gets no timer interrupts either */
+	if (last_irq_sums[cpu] == sum && !cpu_isset(cpu, nohz_cpu_mask)) {
 		/*
 		 * Ayiee, looks like this CPU is stuck ...
 		 * wait a few IRQs (5 seconds) before doing the oops ...
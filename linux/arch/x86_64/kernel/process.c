@@ -47,6 +47,7 @@
 #include <asm/desc.h>
 #include <asm/proto.h>
 #include <asm/ia32.h>
+#include <asm/apic.h>
 
 asmlinkage extern void ret_from_fork(void);
 
@@ -85,10 +86,18 @@ void default_idle(void)
 {
 	if (!atomic_read(&hlt_counter)) {
 		local_irq_disable();
-		if (!need_resched())
+		if (!need_resched()) {
+			/*
+			 * The tick has to be stopped with interrupts off
+			 * right up to the hlt, or a timer added by an
+			 * interrupt in between would be missed.
+			 */
+			stop_hz_timer();
 			safe_halt();
-		else
-			local_irq_enable();
+			local_irq_disable();
+			start_hz_timer();
+		}
+		local_irq_enable();
 	}
 }
 
@@ -178,6 +178,22 @@ static void flush_tlb_others(cpumask_t cpumask, struct mm_struct *mm,
 	spin_unlock(&tlbstate_lock);
 }
 	
+/*
+ * Flush the other cpus in @cpu_mask, if any, and account the flush in
+ * the mm's shootdown statistics.  The counters are only statistics and
+ * are updated without locking.
+ */
+static inline void shootdown_tlb_others(cpumask_t cpu_mask,
+				struct mm_struct *mm, unsigned long va)
+{
+	if (cpus_empty(cpu_mask)) {
+		mm->tlb_shootdowns_avoided++;
+		return;
+	}
+	mm->tlb_shootdowns++;
+	flush_tlb_others(cpu_mask, mm, va);
+}
+
 void flush_tlb_current_task(void)
 {
 	struct mm_struct *mm = current->mm;
@@ -188,8 +204,7 @@ void flush_tlb_current_task(void)
 	cpu_clear(smp_processor_id(), cpu_mask);
 
 	local_flush_tlb();
-	if (!cpus_empty(cpu_mask))
-		flush_tlb_others(cpu_mask, mm, FLUSH_ALL);
+	shootdown_tlb_others(cpu_mask, mm, FLUSH_ALL);
 	preempt_enable();
 }
 
@@ -207,8 +222,7 @@ void flush_tlb_mm (struct mm_struct * mm)
 		else
 			leave_mm(smp_processor_id());
 	}
-	if (!cpus_empty(cpu_mask))
-		flush_tlb_others(cpu_mask, mm, FLUSH_ALL);
+	shootdown_tlb_others(cpu_mask, mm, FLUSH_ALL);
 
 	preempt_enable();
 }
@@ -229,8 +243,7 @@ void flush_tlb_page(struct vm_area_struct * vma, unsigned long va)
 		 	leave_mm(smp_processor_id());
 	}
 
-	if (!cpus_empty(cpu_mask))
-		flush_tlb_others(cpu_mask, mm, va);
+	shootdown_tlb_others(cpu_mask, mm, va);
 
 	preempt_enable();
 }
@@ -220,6 +220,11 @@ void add_disk(struct gendisk *disk)
 	 * עǶkobjectṹ
 	 */
 	blk_register_queue(disk);
+	/**
+	 * Ϊ̵д̣߳豸ϵڵ㡣
+	 */
+	if (disk->queue)
+		bdi_register(&disk->queue->backing_dev_info, disk->disk_name);
 }
 
 EXPORT_SYMBOL(add_disk);
@@ -227,6 +232,8 @@ EXPORT_SYMBOL(del_gendisk);	/* in partitions/check.c */
 
 void unlink_gendisk(struct gendisk *disk)
 {
+	if (disk->queue)
+		bdi_unregister(&disk->queue->backing_dev_info);
 	blk_unregister_queue(disk);
 	blk_unregister_region(MKDEV(disk->major, disk->first_minor),
 			      disk->minors);
@@ -282,13 +282,13 @@ void thaw_bdev(struct block_device *bdev, struct super_block *sb)
 EXPORT_SYMBOL(thaw_bdev);
 
 /*
- * sync everything.  Start out by waking pdflush, because that writes back
- * all queues in parallel.
+ * sync everything.  Start out by waking the flusher threads, because they
+ * write back all queues in parallel.
  */
 static void do_sync(unsigned long wait)
 {
 	/**
-	 * pdflushں̡߳ҳд뵽̡
+	 * Ѹ豸Ļд̡߳ҳд뵽̡
 	 */
 	wakeup_bdflush(0);
 	/**
@@ -970,8 +970,10 @@ int __set_page_dirty_buffers(struct page *page)
 	if (!TestSetPageDirty(page)) {
 		spin_lock_irq(&mapping->tree_lock);
 		if (page->mapping) {	/* Race with truncate? */
-			if (!mapping->backing_dev_info->memory_backed)
+			if (!mapping->backing_dev_info->memory_backed) {
 				inc_page_state(nr_dirty);
+				atomic_inc(&mapping->backing_dev_info->nr_dirty);
+			}
 			radix_tree_tag_set(&mapping->page_tree,
 						page_index(page),
 						PAGECACHE_TAG_DIRTY);
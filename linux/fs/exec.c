@@ -327,6 +327,7 @@ void install_arg_page(struct vm_area_struct *vma,
 		goto out;
 	}
 	mm->rss++;
+	SetPageSwapBacked(page);
 	lru_cache_add_active(page);
 	set_pte(pte, pte_mkdirty(pte_mkwrite(mk_pte(
 					page, vma->vm_page_prot))));
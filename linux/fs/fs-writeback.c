@@ -23,7 +23,16 @@
 #include <linux/backing-dev.h>
 #include <linux/buffer_head.h>
 
-extern struct super_block *blockdev_superblock;
+/*
+ * The dirty inode list of the device which writes back @inode.  A block
+ * special inode's i_mapping follows the device it was opened against, so
+ * this can change while the inode sits on a list; it is only consulted when
+ * the inode is (re)queued.  Called under inode_lock.
+ */
+static inline struct list_head *inode_dirty_list(struct inode *inode)
+{
+	return &writeback_bdi(inode->i_mapping->backing_dev_info)->b_dirty;
+}
 
 /**
  *	__mark_inode_dirty -	internal function
@@ -32,7 +41,7 @@ extern struct super_block *blockdev_superblock;
  *	Mark an inode as dirty. Callers should use mark_inode_dirty or
  *  	mark_inode_dirty_sync.
  *
- * Put the inode on the super block's dirty list.
+ * Put the inode on its backing device's dirty list.
  *
  * CAREFUL! We mark it dirty unconditionally, but move it onto the
  * dirty list only if it is hashed or if it refers to a blockdev.
@@ -102,13 +111,13 @@ void __mark_inode_dirty(struct inode *inode, int flags)
 		/*
 		 * If the inode is locked, just update its dirty state. 
 		 * The unlocker will place the inode on the appropriate
-		 * superblock list, based upon its state.
+		 * list, based upon its state.
 		 */
 		if (inode->i_state & I_LOCK)
 			goto out;
 
 		/*
-		 * Only add valid (hashed) inodes to the superblock's
+		 * Only add valid (hashed) inodes to the device's
 		 * dirty list.  Add blockdev inodes as well.
 		 */
 		if (!S_ISBLK(inode->i_mode)) {
@@ -119,12 +128,12 @@ void __mark_inode_dirty(struct inode *inode, int flags)
 			goto out;
 
 		/*
-		 * If the inode was already on s_dirty or s_io, don't
-		 * reposition it (that would break s_dirty time-ordering).
+		 * If the inode was already on b_dirty or b_io, don't
+		 * reposition it (that would break b_dirty time-ordering).
 		 */
 		if (!was_dirty) {
 			inode->dirtied_when = jiffies;
-			list_move(&inode->i_list, &sb->s_dirty);
+			list_move(&inode->i_list, inode_dirty_list(inode));
 		}
 	}
 out:
@@ -155,7 +164,6 @@ __sync_single_inode(struct inode *inode, struct writeback_control *wbc)
 {
 	unsigned dirty;
 	struct address_space *mapping = inode->i_mapping;
-	struct super_block *sb = inode->i_sb;
 	int wait = wbc->sync_mode == WB_SYNC_ALL;
 	int ret;
 
@@ -195,42 +203,43 @@ __sync_single_inode(struct inode *inode, struct writeback_control *wbc)
 	inode->i_state &= ~I_LOCK;
 	if (!(inode->i_state & I_FREEING)) {
 		/*
-		 * ڵ״̬ڵ㻹ҳͰڵƻsb->s_dirty
+		 * ڵ״̬ڵ㻹ҳͰڵƻb_dirty
 		 */
 		if (!(inode->i_state & I_DIRTY) &&
 		    mapping_tagged(mapping, PAGECACHE_TAG_DIRTY)) {
 			/*
 			 * We didn't write back all the pages.  nfs_writepages()
 			 * sometimes bales out without doing anything. Redirty
-			 * the inode.  It is still on sb->s_io.
+			 * the inode.  It is still on bdi->b_io.
 			 */
 			if (wbc->for_kupdate) {
 				/*
 				 * For the kupdate function we leave the inode
-				 * at the head of sb_dirty so it will get more
+				 * at the head of b_dirty so it will get more
 				 * writeout as soon as the queue becomes
 				 * uncongested.
 				 */
 				inode->i_state |= I_DIRTY_PAGES;
-				list_move_tail(&inode->i_list, &sb->s_dirty);
+				list_move_tail(&inode->i_list,
+						inode_dirty_list(inode));
 			} else {
 				/*
 				 * Otherwise fully redirty the inode so that
-				 * other inodes on this superblock will get some
+				 * other inodes on this device will get some
 				 * writeout.  Otherwise heavy writing to one
 				 * file would indefinitely suspend writeout of
 				 * all the other files.
 				 */
 				inode->i_state |= I_DIRTY_PAGES;
 				inode->dirtied_when = jiffies;
-				list_move(&inode->i_list, &sb->s_dirty);
+				list_move(&inode->i_list, inode_dirty_list(inode));
 			}
 		} else if (inode->i_state & I_DIRTY) {
 			/*
 			 * Someone redirtied the inode while were writing back
 			 * the pages.
 			 */
-			list_move(&inode->i_list, &sb->s_dirty);
+			list_move(&inode->i_list, inode_dirty_list(inode));
 		} else if (atomic_read(&inode->i_count)) {/* ڵüΪ0ͰڵƵinode_in_use */
 			/*
 			 * The inode is clean, inuse
@@ -264,7 +273,7 @@ __writeback_single_inode(struct inode *inode,
 	 * ڵ㱻ͰƵڵУ0.
 	 */
 	if ((wbc->sync_mode != WB_SYNC_ALL) && (inode->i_state & I_LOCK)) {
-		list_move(&inode->i_list, &inode->i_sb->s_dirty);
+		list_move(&inode->i_list, inode_dirty_list(inode));
 		return 0;
 	}
 
@@ -291,175 +300,173 @@ __writeback_single_inode(struct inode *inode,
 }
 
 /*
- * Write out a superblock's list of dirty inodes.  A wait will be performed
+ * Pin the superblock of an inode found on a device's dirty list, so that it
+ * cannot be unmounted while we write the inode.  Fails if the filesystem is
+ * being mounted or unmounted, in which case the inode is left alone.
+ *
+ * Called under inode_lock.
+ */
+static int pin_sb_for_writeback(struct super_block *sb)
+{
+	spin_lock(&sb_lock);
+	sb->s_count++;
+	if (down_read_trylock(&sb->s_umount)) {
+		if (sb->s_root) {
+			spin_unlock(&sb_lock);
+			return 1;
+		}
+		up_read(&sb->s_umount);
+	}
+	sb->s_count--;
+	spin_unlock(&sb_lock);
+	return 0;
+}
+
+/*
+ * Write out a device's list of dirty inodes.  A wait will be performed
  * upon no inodes, all inodes or the final one, depending upon sync_mode.
  *
+ * If `sb' is non-NULL then only inodes of that filesystem are written, and
+ * the caller holds its s_umount.  Otherwise each inode's superblock is pinned
+ * while the inode is written.
+ *
  * If older_than_this is non-NULL, then only write out inodes which
  * had their first dirtying at a time earlier than *older_than_this.
  *
- * If we're a pdlfush thread, then implement pdflush collision avoidance
- * against the entire list.
+ * If wbc->bdi is non-NULL then only inodes whose mapping is backed by that
+ * device are written.  This matters for the default device, whose lists
+ * hold the inodes of every device which never registered.
  *
- * WB_SYNC_HOLD is a hack for sys_sync(): reattach the inode to sb->s_dirty so
+ * WB_SYNC_HOLD is a hack for sys_sync(): reattach the inode to b_dirty so
  * that it can be located for waiting on in __writeback_single_inode().
  *
- * Called under inode_lock.
- *
- * If `bdi' is non-zero then we're being asked to writeback a specific queue.
- * This function assumes that the blockdev superblock's inodes are backed by
- * a variety of queues, so all inodes are searched.  For other superblocks,
- * assume that all inodes are backed by the same queue.
+ * Called under inode_lock, with bdi_list_sem held for reading.
  *
- * FIXME: this linear search could get expensive with many fileystems.  But
- * how to fix?  We need to go from an address_space to all inodes which share
- * a queue with that address_space.  (Easy: have a global "dirty superblocks"
- * list).
- *
- * The inodes to be written are parked on sb->s_io.  They are moved back onto
- * sb->s_dirty as they are selected for writing.  This way, none can be missed
+ * The inodes to be written are parked on bdi->b_io.  They are moved back onto
+ * bdi->b_dirty as they are selected for writing.  This way, none can be missed
  * on the writer throttling path, and we get decent balancing between many
  * throttled threads: we don't want them all piling up on __wait_on_inode.
+ * Inodes which are stepped over go straight back onto bdi->b_dirty, where
+ * a concurrent sync or bdi_unregister() can still find them.
  */
 /**
- * еҳдص̡
+ * 豸ڵϵҳдص̡
  */
 static void
-sync_sb_inodes(struct super_block *sb, struct writeback_control *wbc)
+sync_bdi_inodes(struct backing_dev_info *bdi, struct super_block *sb,
+		struct writeback_control *wbc)
 {
 	const unsigned long start = jiffies;	/* livelock avoidance */
 
 	/**
-	 * s_dirtyеڵsb->s_ioָڵ
+	 * b_dirtyеڵb_ioָڵ
 	 */
-	if (!wbc->for_kupdate || list_empty(&sb->s_io))
-		list_splice_init(&sb->s_dirty, &sb->s_io);
+	if (!wbc->for_kupdate || list_empty(&bdi->b_io))
+		list_splice_init(&bdi->b_dirty, &bdi->b_io);
 
-	while (!list_empty(&sb->s_io)) {/* s_ioֱΪ */
-		struct inode *inode = list_entry(sb->s_io.prev,
+	while (!list_empty(&bdi->b_io)) {/* b_ioֱΪ */
+		struct inode *inode = list_entry(bdi->b_io.prev,
 						struct inode, i_list);
-		struct address_space *mapping = inode->i_mapping;
-		struct backing_dev_info *bdi = mapping->backing_dev_info;
+		struct super_block *isb = inode->i_sb;
+		struct backing_dev_info *ibdi =
+					inode->i_mapping->backing_dev_info;
 		long pages_skipped;
 
-		if (bdi->memory_backed) {
-			list_move(&inode->i_list, &sb->s_dirty);
-			if (sb == blockdev_superblock) {
-				/*
-				 * Dirty memory-backed blockdev: the ramdisk
-				 * driver does this.  Skip just this inode
-				 */
-				continue;
-			}
+		if ((sb && isb != sb) || (wbc->bdi && ibdi != wbc->bdi)) {
+			list_move(&inode->i_list, &bdi->b_dirty);
+			continue;		/* Not one of ours */
+		}
+
+		if (ibdi->memory_backed) {
 			/*
-			 * Dirty memory-backed inode against a filesystem other
-			 * than the kernel-internal bdev filesystem.  Skip the
-			 * entire superblock.
+			 * Dirty memory-backed inode: the ramdisk driver and
+			 * ram-based filesystems do this.  Skip just this inode
 			 */
-			break;
+			list_move(&inode->i_list, &bdi->b_dirty);
+			continue;
 		}
 
-		if (wbc->nonblocking && bdi_write_congested(bdi)) {
+		if (wbc->nonblocking && bdi_write_congested(ibdi)) {
 			wbc->encountered_congestion = 1;
-			if (sb != blockdev_superblock)
-				break;		/* Skip a congested fs */
-			list_move(&inode->i_list, &sb->s_dirty);
-			continue;		/* Skip a congested blockdev */
+			if (bdi != &default_backing_dev_info)
+				break;		/* Skip a congested device */
+			list_move(&inode->i_list, &bdi->b_dirty);
+			continue;		/* Skip just this inode */
 		}
 
-		if (wbc->bdi && bdi != wbc->bdi) {
-			if (sb != blockdev_superblock)
-				break;		/* fs has the wrong queue */
-			list_move(&inode->i_list, &sb->s_dirty);
-			continue;		/* blockdev has wrong queue */
-		}
-
-		/* Was this inode dirtied after sync_sb_inodes was called? */
-		/**
-		 * ҳsync_sb_inodesִк󣬲űҳģԹ
-		 * sb->s_ioпܲһЩ㡣
-		 */
+		/* Was this inode dirtied after sync_bdi_inodes was called? */
 		if (time_after(inode->dirtied_when, start))
 			break;
 
 		/* Was this inode dirtied too recently? */
-		/**
-		 * ҳҳʱڿƲ趨ʱ䣬Թ
-		 */
 		if (wbc->older_than_this && time_after(inode->dirtied_when,
 						*wbc->older_than_this))
 			break;
 
-		/* Is another pdflush already flushing this queue? */
-		/**
-		 * ǰpdflusḥ߳ͼǷһCPUϵpdflush߳ǷѾͼˢ豸ҳ
-		 */
-		if (current_is_pdflush() && !writeback_acquire(bdi))
-			break;
+		if (!sb && !pin_sb_for_writeback(isb)) {
+			list_move(&inode->i_list, &bdi->b_dirty);
+			continue;		/* fs is going away */
+		}
 
 		BUG_ON(inode->i_state & I_FREEING);
-		/**
-		 * е˵ҳҪдص̡
-		 * Ƚڵü1.
-		 */
 		__iget(inode);
 		pages_skipped = wbc->pages_skipped;
 		/**
-		 *__writeback_single_inodeдѡڵص໺
+		 *__writeback_single_inodeдѡڵص໺
 		 */
 		__writeback_single_inode(inode, wbc);
 		if (wbc->sync_mode == WB_SYNC_HOLD) {
 			inode->dirtied_when = jiffies;
-			list_move(&inode->i_list, &sb->s_dirty);
+			list_move(&inode->i_list, inode_dirty_list(inode));
 		}
-		/**
-		 * ǰpdflushں̣߳ͽBDI_pdflush־
-		 */
-		if (current_is_pdflush())
-			writeback_release(bdi);
-		/**
-		 * ԹڵеĳЩҳͽЩҳƵs_dirtyС
-		 */
 		if (wbc->pages_skipped != pages_skipped) {
 			/*
 			 * writeback is not making progress due to locked
 			 * buffers.  Skip this inode for now.
 			 */
-			list_move(&inode->i_list, &sb->s_dirty);
+			list_move(&inode->i_list, inode_dirty_list(inode));
 		}
 		spin_unlock(&inode_lock);
 		cond_resched();
-		/**
-		 * ü1.
-		 */
 		iput(inode);
+		/* Only now: the final iput may still need the superblock */
+		if (!sb)
+			drop_super(isb);
 		spin_lock(&inode_lock);
-		/**
-		 * дҳwbcֵָ˳
-		 */
 		if (wbc->nr_to_write <= 0)
 			break;
 	}
-	return;		/* Leave any unwritten inodes on s_io */
+	return;		/* Leave any unwritten inodes on b_io */
+}
+
+/**
+ * writeback_bdi_inodes - write back the dirty inodes of one device
+ * @bdi: the device
+ * @wbc: what to write
+ *
+ * This is how a flusher thread writes back its device.  An unregistered
+ * device is written through the default device's lists.
+ */
+void writeback_bdi_inodes(struct backing_dev_info *bdi,
+			  struct writeback_control *wbc)
+{
+	might_sleep();
+	down_read(&bdi_list_sem);
+	spin_lock(&inode_lock);
+	sync_bdi_inodes(writeback_bdi(bdi), NULL, wbc);
+	spin_unlock(&inode_lock);
+	up_read(&bdi_list_sem);
 }
 
 /*
  * Start writeback of dirty pagecache data against all unlocked inodes.
  *
- * Note:
- * We don't need to grab a reference to superblock here. If it has non-empty
- * ->s_dirty it's hadn't been killed yet and kill_super() won't proceed
- * past sync_inodes_sb() until both the ->s_dirty and ->s_io lists are
- * empty. Since __sync_single_inode() regains inode_lock before it finally moves
- * inode from superblock lists we are OK.
- *
  * If `older_than_this' is non-zero then only flush inodes which have a
  * flushtime older than *older_than_this.
  *
- * If `bdi' is non-zero then we will scan the first inode against each
- * superblock until we find the matching ones.  One group will be the dirty
- * inodes against a filesystem.  Then when we hit the dummy blockdev superblock,
- * sync_sb_inodes will seekout the blockdev which matches `bdi'.  Maybe not
- * super-efficient but we're about to do a ton of I/O...
+ * If `bdi' is non-zero then only that device's inodes are written, which
+ * is what the writer throttling in balance_dirty_pages() wants.  Otherwise
+ * every device is walked in turn.
  */
 /**
  * wbcҪ󽫻еҳдش̣浽wbcС
@@ -467,67 +474,46 @@ sync_sb_inodes(struct super_block *sb, struct writeback_control *wbc)
 void
 writeback_inodes(struct writeback_control *wbc)
 {
-	struct super_block *sb;
+	struct backing_dev_info *bdi;
+
+	if (wbc->bdi) {
+		writeback_bdi_inodes(wbc->bdi, wbc);
+		return;
+	}
 
 	might_sleep();
-	spin_lock(&sb_lock);
-restart:
-	sb = sb_entry(super_blocks.prev);
-	/**
-	 * ɨsuper_blockеĳֱɨߵԤ
-	 */
-	for (; sb != sb_entry(&super_blocks); sb = sb_entry(sb->s_list.prev)) {
-		/**
-		 * sb->s_dirtysb->s_ioǷΪա
-		 * һǼ鳬ڵ㡣
-		 * ڶǼȴ䵽̵ڵ㡣
-		 */
-		if (!list_empty(&sb->s_dirty) || !list_empty(&sb->s_io)) {
-			/* we're making our own get_super here */
-			sb->s_count++;
-			spin_unlock(&sb_lock);
-			/*
-			 * If we can't get the readlock, there's no sense in
-			 * waiting around, most of the time the FS is going to
-			 * be unmounted by the time it is released.
-			 */
-			if (down_read_trylock(&sb->s_umount)) {
-				if (sb->s_root) {
-					spin_lock(&inode_lock);
-					/**
-					 * 㡣Գsync_sb_inodes
-					 */
-					sync_sb_inodes(sb, wbc);
-					spin_unlock(&inode_lock);
-				}
-				up_read(&sb->s_umount);
-			}
-			spin_lock(&sb_lock);
-			if (__put_super_and_need_restart(sb))
-				goto restart;
-		}
+	down_read(&bdi_list_sem);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		spin_lock(&inode_lock);
+		sync_bdi_inodes(bdi, NULL, wbc);
+		spin_unlock(&inode_lock);
 		/**
 		 * Ԥֹͣɨ衣
 		 */
 		if (wbc->nr_to_write <= 0)
 			break;
 	}
-	spin_unlock(&sb_lock);
+	up_read(&bdi_list_sem);
 }
 
 /*
  * writeback and wait upon the filesystem's dirty inodes.  The caller will
  * do this in two passes - one to write, and one to wait.  WB_SYNC_HOLD is
- * used to park the written inodes on sb->s_dirty for the wait pass.
+ * used to park the written inodes on bdi->b_dirty for the wait pass.
  *
  * A finite limit is set on the number of pages which will be written.
  * To prevent infinite livelock of sys_sync().
  *
  * We add in the number of potentially dirty inodes, because each inode write
  * can dirty pagecache in the underlying blockdev.
+ *
+ * The filesystem's inodes may sit on any device's lists (a block special
+ * inode follows the device it was opened against), so all are searched.
+ * The caller holds sb->s_umount.
  */
 void sync_inodes_sb(struct super_block *sb, int wait)
 {
+	struct backing_dev_info *bdi;
 	struct writeback_control wbc = {
 		.sync_mode	= wait ? WB_SYNC_ALL : WB_SYNC_HOLD,
 	};
@@ -538,10 +524,43 @@ void sync_inodes_sb(struct super_block *sb, int wait)
 			(inodes_stat.nr_inodes - inodes_stat.nr_unused) +
 			nr_dirty + nr_unstable;
 	wbc.nr_to_write += wbc.nr_to_write / 2;		/* Bit more for luck */
+	down_read(&bdi_list_sem);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		spin_lock(&inode_lock);
+		sync_bdi_inodes(bdi, sb, &wbc);
+		spin_unlock(&inode_lock);
+	}
+	up_read(&bdi_list_sem);
+}
+
+/*
+ * Does the filesystem still have dirty inodes on any device's lists?
+ */
+int sb_has_dirty_inodes(struct super_block *sb)
+{
+	struct backing_dev_info *bdi;
+	struct inode *inode;
+	int ret = 0;
+
+	down_read(&bdi_list_sem);
 	spin_lock(&inode_lock);
-	sync_sb_inodes(sb, &wbc);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		list_for_each_entry(inode, &bdi->b_dirty, i_list)
+			if (inode->i_sb == sb)
+				goto found;
+		list_for_each_entry(inode, &bdi->b_io, i_list)
+			if (inode->i_sb == sb)
+				goto found;
+	}
+	goto out;
+found:
+	ret = 1;
+out:
 	spin_unlock(&inode_lock);
+	up_read(&bdi_list_sem);
+	return ret;
 }
+EXPORT_SYMBOL(sb_has_dirty_inodes);
 
 /*
  * Rather lame livelock avoidance.
@@ -735,13 +754,11 @@ EXPORT_SYMBOL(generic_osync_inode);
  * writeback_acquire: attempt to get exclusive writeback access to a device
  * @bdi: the device's backing_dev_info structure
  *
- * It is a waste of resources to have more than one pdflush thread blocked on
- * a single request queue.  Exclusion at the request_queue level is obtained
- * via a flag in the request_queue's backing_dev_info.state.
+ * The device's flusher thread holds this while it works, so that writers
+ * over the dirty threshold do not keep waking it up.
  *
  * Non-request_queue-backed address_spaces will share default_backing_dev_info,
- * unless they implement their own.  Which is somewhat inefficient, as this
- * may prevent concurrent writeback against multiple devices.
+ * unless they implement and register their own.
  */
 int writeback_acquire(struct backing_dev_info *bdi)
 {
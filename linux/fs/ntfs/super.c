@@ -30,6 +30,7 @@
 #include <linux/vfs.h>
 #include <linux/moduleparam.h>
 #include <linux/smp_lock.h>
+#include <linux/writeback.h>	/* For sb_has_dirty_inodes(). */
 
 #include "sysctl.h"
 #include "logfile.h"
@@ -1867,14 +1868,14 @@ static void ntfs_put_super(struct super_block *sb)
 	 */
 	ntfs_commit_inode(vol->mft_ino);
 	write_inode_now(vol->mft_ino, 1);
-	if (!list_empty(&sb->s_dirty)) {
+	if (sb_has_dirty_inodes(sb)) {
 		const char *s1, *s2;
 
 		down(&vol->mft_ino->i_sem);
 		truncate_inode_pages(vol->mft_ino->i_mapping, 0);
 		up(&vol->mft_ino->i_sem);
 		write_inode_now(vol->mft_ino, 1);
-		if (!list_empty(&sb->s_dirty)) {
+		if (sb_has_dirty_inodes(sb)) {
 			static const char *_s1 = "inodes";
 			static const char *_s2 = "";
 			s1 = _s1;
@@ -123,12 +123,14 @@ static int meminfo_read_proc(char *page, char **start, off_t off,
 	unsigned long inactive;
 	unsigned long active;
 	unsigned long free;
+	unsigned long nr_lru[NR_LRU_LISTS];
 	unsigned long committed;
 	unsigned long allowed;
 	struct vmalloc_info vmi;
 
 	get_page_state(&ps);
 	get_zone_counts(&active, &inactive, &free);
+	get_lru_counts(nr_lru);
 
 /*
  * display in kilobytes.
@@ -153,6 +155,11 @@ static int meminfo_read_proc(char *page, char **start, off_t off,
 		"SwapCached:   %8lu kB\n"
 		"Active:       %8lu kB\n"
 		"Inactive:     %8lu kB\n"
+		"Active(anon): %8lu kB\n"
+		"Inactive(anon): %6lu kB\n"
+		"Active(file): %8lu kB\n"
+		"Inactive(file): %6lu kB\n"
+		"Unevictable:  %8lu kB\n"
 		"HighTotal:    %8lu kB\n"
 		"HighFree:     %8lu kB\n"
 		"LowTotal:     %8lu kB\n"
@@ -176,6 +183,11 @@ static int meminfo_read_proc(char *page, char **start, off_t off,
 		K(total_swapcache_pages),
 		K(active),
 		K(inactive),
+		K(nr_lru[LRU_ACTIVE_ANON]),
+		K(nr_lru[LRU_INACTIVE_ANON]),
+		K(nr_lru[LRU_ACTIVE_FILE]),
+		K(nr_lru[LRU_INACTIVE_FILE]),
+		K(nr_lru[LRU_UNEVICTABLE]),
 		K(i.totalhigh),
 		K(i.freehigh),
 		K(i.totalram-i.totalhigh),
@@ -589,8 +601,9 @@ void __init proc_misc_init(void)
 	create_seq_entry("modules", 0, &proc_modules_operations);
 #endif
 #ifdef CONFIG_SCHEDSTATS
-	create_seq_entry("schedstat", 0, &proc_schedstat_operations);
+	create_seq_entry("schedstat", S_IWUSR|S_IRUGO, &proc_schedstat_operations);
 #endif
+	create_seq_entry("timerstat", S_IWUSR|S_IRUGO, &proc_timerstat_operations);
 #ifdef CONFIG_PROC_KCORE
 	proc_root_kcore = create_proc_entry("kcore", S_IRUSR, NULL);
 	if (proc_root_kcore) {
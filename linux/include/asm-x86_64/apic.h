@@ -97,6 +97,13 @@ extern void nmi_watchdog_tick (struct pt_regs * regs, unsigned reason);
 extern int APIC_init_uniprocessor (void);
 extern void disable_APIC_timer(void);
 extern void enable_APIC_timer(void);
+#ifdef CONFIG_NO_IDLE_HZ
+extern void stop_hz_timer(void);
+extern void start_hz_timer(void);
+#else
+static inline void stop_hz_timer(void) { }
+static inline void start_hz_timer(void) { }
+#endif
 extern void clustered_apic_check(void);
 
 extern int check_nmi_watchdog(void);
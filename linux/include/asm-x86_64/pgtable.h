@@ -144,6 +144,7 @@ extern inline void pgd_clear (pgd_t * pgd)
 #define _PAGE_PSE	0x080	/* 2MB page */
 #define _PAGE_FILE	0x040	/* set:pagecache, unset:swap */
 #define _PAGE_GLOBAL	0x100	/* Global TLB entry */
+#define _PAGE_TRANS_HUGE 0x200	/* software: anonymous huge pmd */
 
 #define _PAGE_PROTNONE	0x080	/* If not present */
 #define _PAGE_NX        (1UL<<_PAGE_BIT_NX)
@@ -334,6 +335,31 @@ static inline pud_t *__pud_offset_k(pud_t *pud, unsigned long address)
 #define pfn_pmd(nr,prot) (__pmd(((nr) << PAGE_SHIFT) | pgprot_val(prot)))
 #define pmd_pfn(x)  ((pmd_val(x) >> PAGE_SHIFT) & __PHYSICAL_MASK)
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+/*
+ * Transparent huge pmds are PSE pmds tagged with a software bit so
+ * that they can't be confused with hugetlbfs mappings.  The pte
+ * helpers work on them once the PSE bits are stripped.
+ */
+#define __HAVE_ARCH_PMD_TRANS_HUGE
+#define __TRANS_HUGE_PMD	(_PAGE_PRESENT | _PAGE_PSE | _PAGE_TRANS_HUGE)
+#define pmd_trans_huge(x) \
+	((pmd_val(x) & __TRANS_HUGE_PMD) == __TRANS_HUGE_PMD)
+#define pmd_trans_pte(x) \
+	(__pte(pmd_val(x) & ~(_PAGE_PSE | _PAGE_TRANS_HUGE)))
+#define pmd_trans_pgprot(x) \
+	(__pgprot(pmd_val(x) & ~(PTE_MASK | _PAGE_PSE | _PAGE_TRANS_HUGE)))
+#define pte_trans_pmd(pte) \
+	(__pmd(pte_val(pte) | _PAGE_PSE | _PAGE_TRANS_HUGE))
+
+static inline int pmdp_test_and_clear_young(pmd_t *pmdp)
+{
+	if (!(pmd_val(*pmdp) & _PAGE_ACCESSED))
+		return 0;
+	return test_and_clear_bit(_PAGE_BIT_ACCESSED, pmdp);
+}
+#endif
+
 #define pte_to_pgoff(pte) ((pte_val(pte) & PHYSICAL_PAGE_MASK) >> PAGE_SHIFT)
 #define pgoff_to_pte(off) ((pte_t) { ((off) << PAGE_SHIFT) | _PAGE_FILE })
 #define PTE_FILE_MAX_BITS __PHYSICAL_MASK_SHIFT
@@ -8,6 +8,8 @@
 #ifndef _LINUX_BACKING_DEV_H
 #define _LINUX_BACKING_DEV_H
 
+#include <linux/list.h>
+#include <linux/spinlock.h>
 #include <asm/atomic.h>
 
 /*
@@ -19,9 +21,11 @@ enum bdi_state {
 	 * Ƕҳмʱpdflash߳ҪȷǷCPUϵpdflash߳Ҳڴĳһҳ
 	 * ҪͬͬͨһԭӲԺͶbacking_dev_infoBDI_pdflush־òɵġ
 	 */
-	BDI_pdflush,		/* A pdflush thread is working this device */
+	BDI_pdflush,		/* A flusher thread is working this device */
 	BDI_write_congested,	/* The write queue is getting full */
 	BDI_read_congested,	/* The read queue is getting full */
+	BDI_registered,		/* Has its own dirty inode lists and flusher */
+	BDI_background,		/* Background writeout was requested */
 	BDI_unused,		/* Available bits start here */
 };
 
@@ -38,15 +42,89 @@ struct backing_dev_info {
 	void *congested_data;	/* Pointer to aux data for congested func */
 	void (*unplug_io_fn)(struct backing_dev_info *, struct page *);
 	void *unplug_io_data;
+
+	/*
+	 * Writeback state.  The lists, the flusher and wb_lock are only
+	 * valid while BDI_registered is set; see bdi_register().
+	 */
+	/**
+	 * ȫֵbdi_list
+	 */
+	struct list_head bdi_list;
+	/**
+	 * 豸ڵԼȴдڵinode_lock
+	 */
+	struct list_head b_dirty;	/* dirty inodes */
+	struct list_head b_io;		/* parked for writeback */
+	/**
+	 * 豸Ļд̡߳
+	 */
+	struct task_struct *wb_task;	/* The flusher thread */
+	int wb_refs;			/* bdi_register() count */
+	spinlock_t wb_lock;		/* Bandwidth estimate */
+	long wb_nr_pages;		/* Pages asked for, under bdi_lock */
+	unsigned long wb_last_old_flush; /* Last kupdate-style writeback */
+
+	/*
+	 * Dirty throttling.  balance_dirty_pages() gives each registered
+	 * device a share of the dirty threshold in proportion to
+	 * write_bandwidth.
+	 */
+	/**
+	 * 豸ϵҳڻдҳ
+	 */
+	atomic_t nr_dirty;		/* Dirty pages against this device */
+	atomic_t nr_writeback;		/* Pages under writeback */
+	atomic_t nr_written;		/* Pages which completed writeback */
+	/**
+	 * 豸дҳ/Ϊλ
+	 */
+	unsigned long write_bandwidth;	/* Pages per second */
+	unsigned long written_stamp;	/* nr_written at bw_time_stamp */
+	unsigned long bw_time_stamp;	/* Last bandwidth sample */
 };
 
 extern struct backing_dev_info default_backing_dev_info;
 void default_unplug_io_fn(struct backing_dev_info *bdi, struct page *page);
 
+/*
+ * mm/backing-dev.c
+ */
+extern struct list_head bdi_list;
+extern spinlock_t bdi_lock;
+extern struct rw_semaphore bdi_list_sem;
+
+int bdi_register(struct backing_dev_info *bdi, const char *name);
+void bdi_unregister(struct backing_dev_info *bdi);
+void __bdi_start_writeback(struct backing_dev_info *bdi, long nr_pages);
+void bdi_start_writeback(struct backing_dev_info *bdi, long nr_pages);
+void bdi_start_background_writeback(struct backing_dev_info *bdi);
+
 int writeback_acquire(struct backing_dev_info *bdi);
 int writeback_in_progress(struct backing_dev_info *bdi);
 void writeback_release(struct backing_dev_info *bdi);
 
+/*
+ * The device whose dirty inode lists and flusher thread look after inodes
+ * against @bdi.  Devices which never registered share the default one.
+ */
+static inline struct backing_dev_info *writeback_bdi(struct backing_dev_info *bdi)
+{
+	if (test_bit(BDI_registered, &bdi->state))
+		return bdi;
+	return &default_backing_dev_info;
+}
+
+/*
+ * Whether @bdi is throttled against its own share of the dirty threshold.
+ * The default device stands in for a mix of devices, so it is not.
+ */
+static inline int bdi_cap_proportional(struct backing_dev_info *bdi)
+{
+	return bdi != &default_backing_dev_info &&
+		test_bit(BDI_registered, &bdi->state);
+}
+
 static inline int bdi_congested(struct backing_dev_info *bdi, int bdi_bits)
 {
 	if (bdi->congested_fn)
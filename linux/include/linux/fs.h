@@ -490,6 +490,15 @@ struct address_space {
 	 * ߵҳ
 	 */
 	unsigned long		nrpages;	/* number of total pages */
+	/**
+	 * м¼ҳӰĿ
+	 */
+	unsigned long		nrshadows;	/* number of shadow entries */
+	/**
+	 * ֶͨ뺬Ӱĵַռshadow_cursorӰʱʼ
+	 */
+	struct list_head	shadow_list;	/* on shadow_mappings if nrshadows */
+	pgoff_t			shadow_cursor;	/* next index for the shrinker */
 	/**
 	 * һλдõҳ
 	 */
@@ -1396,14 +1405,6 @@ struct super_block {
 	 * ڵ
 	 */
 	struct list_head	s_inodes;	/* all inodes */
-	/**
-	 * ڵ
-	 */
-	struct list_head	s_dirty;	/* dirty inodes */
-	/**
-	 * ȵд̵ڵ
-	 */
-	struct list_head	s_io;		/* parked for writeback */
 	/**
 	 * Ŀ¼NFS
 	 */
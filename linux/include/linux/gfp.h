@@ -80,10 +80,24 @@ struct vm_area_struct;
  * κηصҳ뱻0
  */
 #define __GFP_ZERO	0x8000	/* Return zeroed page on success */
+/**
+ * ҳԱ(ɻյslabٻ)
+ */
+#define __GFP_RECLAIMABLE 0x10000 /* Page is reclaimable */
+/**
+ * ҳԱջƶ(ûҳ)
+ */
+#define __GFP_MOVABLE	0x20000	/* Page is movable */
 
-#define __GFP_BITS_SHIFT 16	/* Room for 16 __GFP_FOO bits */
+#define __GFP_BITS_SHIFT 18	/* Room for 18 __GFP_FOO bits */
 #define __GFP_BITS_MASK ((1 << __GFP_BITS_SHIFT) - 1)
 
+/*
+ * The mobility bits only steer the page allocator; the slab allocators
+ * strip them and pick the type of their own pages.
+ */
+#define GFP_MOVABLE_MASK (__GFP_RECLAIMABLE|__GFP_MOVABLE)
+
 /* if you forget to add the bitmask here kernel will crash, period */
 #define GFP_LEVEL_MASK (__GFP_WAIT|__GFP_HIGH|__GFP_IO|__GFP_FS| \
 			__GFP_COLD|__GFP_NOWARN|__GFP_REPEAT| \
@@ -95,6 +109,7 @@ struct vm_area_struct;
 #define GFP_KERNEL	(__GFP_WAIT | __GFP_IO | __GFP_FS)
 #define GFP_USER	(__GFP_WAIT | __GFP_IO | __GFP_FS)
 #define GFP_HIGHUSER	(__GFP_WAIT | __GFP_IO | __GFP_FS | __GFP_HIGHMEM)
+#define GFP_HIGHUSER_MOVABLE	(GFP_HIGHUSER | __GFP_MOVABLE)
 
 /* Flag - indicates that the buffer will be suitable for DMA.  Ignored on some
    platforms, used as appropriate on others */
@@ -117,6 +132,16 @@ struct vm_area_struct;
  * optimized to &contig_page_data at compile-time.
  */
 
+/* Convert GFP flags to their corresponding mobility type */
+static inline int allocflags_to_migratetype(unsigned int gfp_flags)
+{
+	if (gfp_flags & __GFP_MOVABLE)
+		return MIGRATE_MOVABLE;
+	if (gfp_flags & __GFP_RECLAIMABLE)
+		return MIGRATE_RECLAIMABLE;
+	return MIGRATE_UNMOVABLE;
+}
+
 #ifndef HAVE_ARCH_FREE_PAGE
 static inline void arch_free_page(struct page *page, int order) { }
 #endif
@@ -147,7 +172,7 @@ alloc_pages(unsigned int gfp_mask, unsigned int order)
 
 	return alloc_pages_current(gfp_mask, order);
 }
-extern struct page *alloc_page_vma(unsigned gfp_mask,
+extern struct page *alloc_pages_vma(unsigned gfp_mask, unsigned int order,
 			struct vm_area_struct *vma, unsigned long addr);
 #else
 /**
@@ -155,14 +180,21 @@ extern struct page *alloc_page_vma(unsigned gfp_mask,
  */
 #define alloc_pages(gfp_mask, order) \
 		alloc_pages_node(numa_node_id(), gfp_mask, order)
-#define alloc_page_vma(gfp_mask, vma, addr) alloc_pages(gfp_mask, 0)
+#define alloc_pages_vma(gfp_mask, order, vma, addr) alloc_pages(gfp_mask, order)
 #endif
+#define alloc_page_vma(gfp_mask, vma, addr) alloc_pages_vma(gfp_mask, 0, vma, addr)
 /**
  * ڻһҳĺ
  * ҳĵַʧܣ򷵻NULL
  */
 #define alloc_page(gfp_mask) alloc_pages(gfp_mask, 0)
 
+/**
+ * һηһҳ򣬷ŵlistУʵʷҳ
+ */
+extern unsigned int alloc_pages_bulk(unsigned int gfp_mask,
+			unsigned int nr_pages, struct list_head *list);
+
 extern unsigned long FASTCALL(__get_free_pages(unsigned int gfp_mask, unsigned int order));
 extern unsigned long FASTCALL(get_zeroed_page(unsigned int gfp_mask));
 
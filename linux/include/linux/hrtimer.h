@@ -0,0 +1,159 @@
+/*
+ *  include/linux/hrtimer.h
+ *
+ *  hrtimers - nanosecond-keyed kernel timers
+ *
+ *  The timer wheel in kernel/timer.c hashes timers by jiffies, which is
+ *  the right thing for the mass of timeouts that almost never expire,
+ *  but rounds every expiry up to the next tick.  hrtimers keep their
+ *  expiry as a ktime_t in a per-cpu, per-clock rbtree instead, so
+ *  posix timers, nanosleep and itimers are not rounded and do not
+ *  drift.  They are run from the timer softirq; with
+ *  CONFIG_HIGH_RES_TIMERS the architecture raises it for the first
+ *  expiry in between ticks, see kernel/hrtimer.c.
+ */
+#ifndef _LINUX_HRTIMER_H
+#define _LINUX_HRTIMER_H
+
+#include <linux/rbtree.h>
+#include <linux/ktime.h>
+#include <linux/init.h>
+#include <linux/spinlock.h>
+
+/*
+ * Mode arguments of xxx_hrtimer functions:
+ */
+enum hrtimer_mode {
+	HRTIMER_ABS,	/* Time value is absolute */
+	HRTIMER_REL,	/* Time value is relative to now */
+};
+
+/*
+ * Return values of the timer callback function:
+ */
+enum hrtimer_restart {
+	HRTIMER_NORESTART,	/* Timer is not restarted */
+	HRTIMER_RESTART,	/* Timer must be restarted, expires was updated */
+};
+
+#define HRTIMER_INACTIVE	((void *)1UL)
+
+struct hrtimer_base;
+struct restart_block;
+struct task_struct;
+
+/**
+ * struct hrtimer - the basic hrtimer structure
+ * @node:	red black tree node for time ordered insertion
+ * @expires:	the absolute expiry time in the hrtimers internal
+ *		representation. The time is related to the clock on
+ *		which the timer is based.
+ * @function:	timer expiry callback function
+ * @base:	pointer to the timer base (per cpu and per clock)
+ *
+ * The hrtimer structure must be initialized by hrtimer_init()
+ */
+struct hrtimer {
+	struct rb_node		node;
+	ktime_t			expires;
+	int			(*function)(struct hrtimer *);
+	struct hrtimer_base	*base;
+};
+
+/**
+ * struct hrtimer_sleeper - simple sleeper structure
+ * @timer:	embedded timer structure
+ * @task:	task to wake up
+ *
+ * task is set to NULL, when the timer expires.
+ */
+struct hrtimer_sleeper {
+	struct hrtimer timer;
+	struct task_struct *task;
+};
+
+/**
+ * struct hrtimer_base - the timer base for a specific clock
+ * @index:	clock type index for per_cpu support when moving a timer
+ *		to a base on another cpu.
+ * @lock:	lock protecting the base and associated timers
+ * @active:	red black tree root node for the active timers
+ * @first:	pointer to the timer node which expires first
+ * @get_time:	function to retrieve the current time of the clock
+ * @curr_timer:	the timer which is executing a callback right now
+ */
+struct hrtimer_base {
+	clockid_t		index;
+	spinlock_t		lock;
+	struct rb_root		active;
+	/**
+	 * 絽ڵĶʱÿζںвڵ㡣
+	 */
+	struct rb_node		*first;
+	ktime_t			(*get_time)(void);
+	struct hrtimer		*curr_timer;
+};
+
+#define MAX_HRTIMER_BASES	2
+
+/* Exported timer functions: */
+
+/* Initialize timers: */
+extern void hrtimer_init(struct hrtimer *timer, clockid_t which_clock,
+			 enum hrtimer_mode mode);
+
+/* Basic timer operations: */
+extern int hrtimer_start(struct hrtimer *timer, ktime_t tim,
+			 const enum hrtimer_mode mode);
+extern int hrtimer_cancel(struct hrtimer *timer);
+extern int hrtimer_try_to_cancel(struct hrtimer *timer);
+
+#define hrtimer_restart(timer) hrtimer_start((timer), (timer)->expires, HRTIMER_ABS)
+
+/* Query timers: */
+extern ktime_t hrtimer_get_remaining(const struct hrtimer *timer);
+
+#if defined(CONFIG_NO_IDLE_HZ) || defined(CONFIG_HIGH_RES_TIMERS)
+extern ktime_t hrtimer_get_next_event(void);
+#endif
+
+#ifdef CONFIG_HIGH_RES_TIMERS
+/*
+ * Provided by the architecture: get this cpu's timer interrupt 'delta'
+ * from now if that is before the next one.  Interrupts disabled.
+ */
+extern void hrtimer_program_event(ktime_t delta);
+#endif
+
+static inline int hrtimer_active(const struct hrtimer *timer)
+{
+	return timer->node.rb_parent != HRTIMER_INACTIVE;
+}
+
+/* Forward a hrtimer so it expires after now: */
+extern unsigned long hrtimer_forward(struct hrtimer *timer, ktime_t interval);
+
+/* Precise sleep: */
+extern long hrtimer_nanosleep(struct timespec *rqtp,
+			      struct timespec __user *rmtp,
+			      const enum hrtimer_mode mode,
+			      const clockid_t clockid);
+extern long hrtimer_nanosleep_restart(struct restart_block *restart_block);
+
+extern void hrtimer_init_sleeper(struct hrtimer_sleeper *sl,
+				 struct task_struct *tsk);
+
+/* Soft interrupt function to run the hrtimer queues: */
+extern void hrtimer_run_queues(void);
+
+/* Bootup initialization: */
+extern void __init hrtimers_init(void);
+
+/* Current time of the clocks the bases are keyed on: */
+extern ktime_t ktime_get(void);
+extern ktime_t ktime_get_real(void);
+
+/* ITIMER_REAL expiry callback, see kernel/itimer.c: */
+extern int it_real_fn(struct hrtimer *timer);
+
+#endif
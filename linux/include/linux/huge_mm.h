@@ -0,0 +1,113 @@
+#ifndef _LINUX_HUGE_MM_H
+#define _LINUX_HUGE_MM_H
+
+/*
+ * Transparent huge pages: anonymous memory backed by pmd-sized pages
+ * without any help from the application.
+ */
+
+#include <linux/mm.h>
+
+struct mmu_gather;
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+
+#define HPAGE_PMD_SHIFT		PMD_SHIFT
+#define HPAGE_PMD_SIZE		(1UL << HPAGE_PMD_SHIFT)
+#define HPAGE_PMD_MASK		(~(HPAGE_PMD_SIZE - 1))
+#define HPAGE_PMD_ORDER		(HPAGE_PMD_SHIFT - PAGE_SHIFT)
+#define HPAGE_PMD_NR		(1 << HPAGE_PMD_ORDER)
+
+/**
+ * /proc/sys/vm/transparent_hugepageΪ0ʱֹȱҳʱҳͺ̨ϲ
+ */
+extern int sysctl_transparent_hugepage;
+/**
+ * khugepagedÿɨҳԼ֮˯ʱ䡣
+ */
+extern int khugepaged_pages_to_scan;
+extern int khugepaged_scan_sleep_millisecs;
+
+/*
+ * Only private anonymous memory that can grow a whole pmd at a time
+ * is eligible: no file, no driver, no stack that grows page by page.
+ */
+static inline int transparent_hugepage_vma(struct vm_area_struct *vma)
+{
+	if (!sysctl_transparent_hugepage)
+		return 0;
+	if (vma->vm_file || vma->vm_ops)
+		return 0;
+	if (vma->vm_flags & (VM_HUGETLB | VM_IO | VM_RESERVED | VM_SHARED |
+			     VM_GROWSDOWN | VM_GROWSUP))
+		return 0;
+	return 1;
+}
+
+/*
+ * Does the aligned huge page around @address fit inside @vma?
+ */
+static inline int transparent_hugepage_range(struct vm_area_struct *vma,
+					     unsigned long address)
+{
+	unsigned long haddr = address & HPAGE_PMD_MASK;
+
+	return haddr >= vma->vm_start && haddr + HPAGE_PMD_SIZE <= vma->vm_end;
+}
+
+/*
+ * The small page backing @address inside a huge pmd.
+ */
+static inline struct page *trans_huge_pmd_page(pmd_t pmd,
+					       unsigned long address)
+{
+	return pfn_to_page(pte_pfn(pmd_trans_pte(pmd)) +
+			   ((address & ~HPAGE_PMD_MASK) >> PAGE_SHIFT));
+}
+
+extern int huge_pmd_fault(struct mm_struct *mm, struct vm_area_struct *vma,
+			  unsigned long address, pmd_t *pmd, int write_access);
+extern void split_huge_pmd(struct mm_struct *mm, pmd_t *pmd);
+extern void zap_huge_pmd(struct mmu_gather *tlb, pmd_t *pmd);
+extern struct page *follow_trans_huge_pmd(pmd_t *pmd, unsigned long address,
+					  int read, int write);
+extern int huge_pmd_referenced(struct vm_area_struct *vma, pmd_t *pmd,
+			       unsigned long address, struct page *page);
+extern void khugepaged_enter(struct mm_struct *mm);
+extern void khugepaged_exit(struct mm_struct *mm);
+
+#else /* !CONFIG_TRANSPARENT_HUGEPAGE */
+
+#define transparent_hugepage_vma(vma)		(0)
+#define transparent_hugepage_range(vma, addr)	(0)
+#define trans_huge_pmd_page(pmd, addr)		(NULL)
+
+static inline int huge_pmd_fault(struct mm_struct *mm,
+		struct vm_area_struct *vma, unsigned long address,
+		pmd_t *pmd, int write_access)
+{
+	return 0;
+}
+static inline void split_huge_pmd(struct mm_struct *mm, pmd_t *pmd)
+{
+}
+static inline void zap_huge_pmd(struct mmu_gather *tlb, pmd_t *pmd)
+{
+}
+static inline struct page *follow_trans_huge_pmd(pmd_t *pmd,
+		unsigned long address, int read, int write)
+{
+	return NULL;
+}
+static inline int huge_pmd_referenced(struct vm_area_struct *vma,
+		pmd_t *pmd, unsigned long address, struct page *page)
+{
+	return 0;
+}
+static inline void khugepaged_exit(struct mm_struct *mm)
+{
+}
+
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
+#endif /* _LINUX_HUGE_MM_H */
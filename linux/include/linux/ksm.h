@@ -0,0 +1,63 @@
+#ifndef _LINUX_KSM_H
+#define _LINUX_KSM_H
+
+/*
+ * Kernel same-page merging: ksmd looks for anonymous pages with identical
+ * contents in the areas applications registered with MADV_MERGEABLE, and
+ * maps all of them to a single write-protected copy.  A write fault gives
+ * the writer a private copy again through do_wp_page().
+ */
+
+#include <linux/mm.h>
+
+#ifdef CONFIG_KSM
+
+/**
+ * /proc/sys/vm/ksm_runΪ0ʱksmdֹͣɨ裻ksmdÿɨҳԼ֮˯ʱ䡣
+ */
+extern int sysctl_ksm_run;
+extern int ksm_pages_to_scan;
+extern int ksm_sleep_millisecs;
+/**
+ * ʹõĺϲҳԼϲʡµҳ
+ */
+extern unsigned long ksm_pages_shared;
+extern unsigned long ksm_pages_sharing;
+
+/*
+ * Only private anonymous memory is merged: no file, no driver, nothing
+ * shared with another mm by design.
+ */
+static inline int ksm_vma_eligible(struct vm_area_struct *vma)
+{
+	if (vma->vm_file || vma->vm_ops)
+		return 0;
+	if (vma->vm_flags & (VM_SHARED | VM_MAYSHARE | VM_IO | VM_RESERVED |
+			     VM_HUGETLB | VM_NONLINEAR))
+		return 0;
+	return 1;
+}
+
+extern int ksm_unmerge(struct vm_area_struct *vma, unsigned long start,
+		       unsigned long end);
+extern void ksm_enter(struct mm_struct *mm);
+extern void ksm_exit(struct mm_struct *mm);
+
+static inline void ksm_fork(struct mm_struct *mm, struct mm_struct *oldmm)
+{
+	if (!list_empty(&oldmm->ksm_list))
+		ksm_enter(mm);
+}
+
+#else /* !CONFIG_KSM */
+
+static inline void ksm_fork(struct mm_struct *mm, struct mm_struct *oldmm)
+{
+}
+static inline void ksm_exit(struct mm_struct *mm)
+{
+}
+
+#endif /* CONFIG_KSM */
+
+#endif /* _LINUX_KSM_H */
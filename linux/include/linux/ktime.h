@@ -0,0 +1,112 @@
+/*
+ *  include/linux/ktime.h
+ *
+ *  ktime_t - nanosecond-resolution time format.
+ *
+ *  ktime_t is a signed 64bit nanosecond value. It is used by the high
+ *  resolution timer code so that expiry times can be compared and
+ *  added without going through jiffies or struct timespec arithmetic.
+ *
+ *  The value is wrapped in a union so that it can not be mixed up with
+ *  plain integers by accident; all accesses go through the helpers
+ *  below.
+ */
+#ifndef _LINUX_KTIME_H
+#define _LINUX_KTIME_H
+
+#include <linux/time.h>
+#include <linux/jiffies.h>
+#include <asm/div64.h>
+
+/**
+ * Ϊλʱֵ64λзԼɱʾ292ꡣ
+ */
+typedef union {
+	s64	tv64;
+} ktime_t;
+
+#define KTIME_MAX			((s64)~((u64)1 << 63))
+#define KTIME_SEC_MAX			(KTIME_MAX / NSEC_PER_SEC)
+
+/**
+ * ktime_set - set a ktime_t variable from a seconds/nanoseconds value
+ * @secs:	seconds to set
+ * @nsecs:	nanoseconds to set
+ *
+ * Return the ktime_t representation of the value. Values which do not
+ * fit are clamped to KTIME_MAX.
+ */
+static inline ktime_t ktime_set(const long secs, const unsigned long nsecs)
+{
+	ktime_t kt;
+
+	if (unlikely(secs >= KTIME_SEC_MAX))
+		kt.tv64 = KTIME_MAX;
+	else
+		kt.tv64 = (s64)secs * NSEC_PER_SEC + (s64)nsecs;
+	return kt;
+}
+
+static inline ktime_t ktime_add(const ktime_t lhs, const ktime_t rhs)
+{
+	ktime_t kt;
+
+	kt.tv64 = lhs.tv64 + rhs.tv64;
+	return kt;
+}
+
+static inline ktime_t ktime_sub(const ktime_t lhs, const ktime_t rhs)
+{
+	ktime_t kt;
+
+	kt.tv64 = lhs.tv64 - rhs.tv64;
+	return kt;
+}
+
+static inline ktime_t ktime_add_ns(const ktime_t kt, u64 nsec)
+{
+	ktime_t res;
+
+	res.tv64 = kt.tv64 + nsec;
+	return res;
+}
+
+#define ktime_to_ns(kt)			((kt).tv64)
+
+static inline ktime_t timespec_to_ktime(const struct timespec ts)
+{
+	return ktime_set(ts.tv_sec, ts.tv_nsec);
+}
+
+static inline ktime_t timeval_to_ktime(const struct timeval tv)
+{
+	return ktime_set(tv.tv_sec, tv.tv_usec * NSEC_PER_USEC);
+}
+
+/*
+ * The conversions back go through do_div() so that 32bit machines do
+ * not need a 64bit division helper.
+ */
+static inline struct timespec ktime_to_timespec(const ktime_t kt)
+{
+	struct timespec ts;
+	u64 nsec = kt.tv64 < 0 ? -kt.tv64 : kt.tv64;
+
+	ts.tv_nsec = do_div(nsec, NSEC_PER_SEC);
+	ts.tv_sec = nsec;
+	if (kt.tv64 < 0)
+		set_normalized_timespec(&ts, -ts.tv_sec, -ts.tv_nsec);
+	return ts;
+}
+
+static inline struct timeval ktime_to_timeval(const ktime_t kt)
+{
+	struct timespec ts = ktime_to_timespec(kt);
+	struct timeval tv;
+
+	tv.tv_sec = ts.tv_sec;
+	tv.tv_usec = ts.tv_nsec / NSEC_PER_USEC;
+	return tv;
+}
+
+#endif
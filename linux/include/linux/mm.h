@@ -12,6 +12,7 @@
 #include <linux/mmzone.h>
 #include <linux/rbtree.h>
 #include <linux/prio_tree.h>
+#include <linux/rcupdate.h>
 #include <linux/fs.h>
 
 struct mempolicy;
@@ -163,6 +164,16 @@ struct vm_area_struct {
 	 */
 	unsigned long vm_truncate_count;/* truncate_count or restart_addr */
 
+	/**
+	 * ޸ķΧ־򱣻ԣӺժʱ
+	 * mmap_semȱҳȷûиı䡣
+	 */
+	seqcount_t vm_sequence;		/* writers hold mmap_sem */
+	/**
+	 * RCUںͷš
+	 */
+	struct rcu_head vm_rcu_head;
+
 #ifndef CONFIG_MMU
 	atomic_t vm_usage;		/* refcount (VMAs shared if !MMU) */
 #endif
@@ -288,6 +299,10 @@ extern unsigned int kobjsize(const void *objp);
  * ʵַļӳ䡣
  */
 #define VM_NONLINEAR	0x00800000	/* Is non-linear (remap_file_pages) */
+/**
+ * ͨmadvise(MADV_MERGEABLE)ksmdϲͬҳ
+ */
+#define VM_MERGEABLE	0x01000000	/* KSM may merge identical pages */
 
 #ifndef VM_STACK_DEFAULT_FLAGS		/* arch can override this */
 #define VM_STACK_DEFAULT_FLAGS VM_DATA_DEFAULT_FLAGS
@@ -337,6 +352,12 @@ struct vm_operations_struct {
 	 * Եַ(Ԥȱҳ)ӦҳʱáҪڷļڴӳ䡣
 	 */
 	int (*populate)(struct vm_area_struct * area, unsigned long address, unsigned long len, pgprot_t prot, unsigned long pgoff, int nonblock);
+	/**
+	 * ȱҳʱdo_no_pageãӳ[start, end)ڻеҳ
+	 * ʱpage_table_lockpteӦstart˯ߡ
+	 */
+	void (*map_pages)(struct vm_area_struct *area, unsigned long start,
+			  unsigned long end, pte_t *pte);
 #ifdef CONFIG_NUMA
 	int (*set_policy)(struct vm_area_struct *vma, struct mempolicy *new);
 	struct mempolicy *(*get_policy)(struct vm_area_struct *vma,
@@ -802,6 +823,8 @@ extern pte_t *FASTCALL(pte_alloc_map(struct mm_struct *mm, pmd_t *pmd, unsigned
 extern int install_page(struct mm_struct *mm, struct vm_area_struct *vma, unsigned long addr, struct page *page, pgprot_t prot);
 extern int install_file_pte(struct mm_struct *mm, struct vm_area_struct *vma, unsigned long addr, unsigned long pgoff, pgprot_t prot);
 extern int handle_mm_fault(struct mm_struct *mm,struct vm_area_struct *vma, unsigned long address, int write_access);
+extern int handle_speculative_fault(struct mm_struct *mm, unsigned long address, int write_access);
+extern int sysctl_fault_around_pages;
 extern int make_pages_present(unsigned long addr, unsigned long end);
 extern int access_process_vm(struct task_struct *tsk, unsigned long addr, void *buf, int len, int write);
 void install_arg_page(struct vm_area_struct *, struct page *, unsigned long);
@@ -964,6 +987,8 @@ extern void truncate_inode_pages(struct address_space *, loff_t);
 
 /* generic vm_area_ops exported for stackable file systems */
 extern struct page *filemap_nopage(struct vm_area_struct *, unsigned long, int *);
+extern void filemap_map_pages(struct vm_area_struct *, unsigned long,
+		unsigned long, pte_t *);
 extern int filemap_populate(struct vm_area_struct *, unsigned long,
 		unsigned long, pgprot_t, unsigned long, int);
 
@@ -996,6 +1021,26 @@ extern int expand_stack(struct vm_area_struct * vma, unsigned long address);
 extern struct vm_area_struct * find_vma(struct mm_struct * mm, unsigned long addr);
 extern struct vm_area_struct * find_vma_prev(struct mm_struct * mm, unsigned long addr,
 					     struct vm_area_struct **pprev);
+/* Same without mmap_sem, under rcu_read_lock(); *seq samples vm_sequence */
+extern struct vm_area_struct * find_vma_speculative(struct mm_struct * mm,
+					unsigned long addr, unsigned *seq);
+
+/*
+ * Changes to a vma which a fault running without mmap_sem must not miss
+ * are bracketed by these, with mmap_sem held for writing (or, for
+ * expand_stack, for reading with the anon_vma lock).  Page tables are
+ * only changed afterwards, under page_table_lock, which is where the
+ * speculative fault revalidates.
+ */
+static inline void vma_write_begin(struct vm_area_struct *vma)
+{
+	write_seqcount_begin(&vma->vm_sequence);
+}
+
+static inline void vma_write_end(struct vm_area_struct *vma)
+{
+	write_seqcount_end(&vma->vm_sequence);
+}
 
 /* Look up the first VMA which intersects the interval start_addr..end_addr-1,
    NULL if none.  Assume start_addr < end_addr. */
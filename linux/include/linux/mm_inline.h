@@ -1,56 +1,82 @@
 /**
- * ҳĻͷnr_activeֶ
+ * PG_swapbacked־ҳķǻҳ(Լshmemҳ)
+ * LRU_INACTIVE_ANONҳҳLRU_INACTIVE_FILE
  */
-static inline void
-add_page_to_active_list(struct zone *zone, struct page *page)
+static inline int page_lru_base_type(struct page *page)
+{
+	if (PageSwapBacked(page))
+		return LRU_INACTIVE_ANON;
+	return LRU_INACTIVE_FILE;
+}
+
+/**
+ * ҳı־ҳǰӦλڵLRU
+ */
+static inline int page_lru(struct page *page)
 {
-	list_add(&page->lru, &zone->active_list);
-	zone->nr_active++;
+	if (PageUnevictable(page))
+		return LRU_UNEVICTABLE;
+	if (PageActive(page))
+		return page_lru_base_type(page) + LRU_ACTIVE;
+	return page_lru_base_type(page);
 }
 
 /**
- * ҳķǻͷnr_inactiveֶ
+ * ҳĵlLRUͷļ
  */
 static inline void
-add_page_to_inactive_list(struct zone *zone, struct page *page)
+add_page_to_lru_list(struct zone *zone, struct page *page, int l)
 {
-	list_add(&page->lru, &zone->inactive_list);
-	zone->nr_inactive++;
+	list_add(&page->lru, &zone->lru[l]);
+	zone->nr_lru[l]++;
 }
 
 /**
- * ӹĻɾҳݼnr_active
+ * ӹĵlLRUɾҳݼļ
  */
 static inline void
-del_page_from_active_list(struct zone *zone, struct page *page)
+del_page_from_lru_list(struct zone *zone, struct page *page, int l)
 {
 	list_del(&page->lru);
-	zone->nr_active--;
+	zone->nr_lru[l]--;
 }
 
 /**
- * ӹķǻɾҳݼnr_active
+ * ҳӦ͵Ļͷ
  */
 static inline void
-del_page_from_inactive_list(struct zone *zone, struct page *page)
+add_page_to_active_list(struct zone *zone, struct page *page)
 {
-	list_del(&page->lru);
-	zone->nr_inactive--;
+	add_page_to_lru_list(zone, page, page_lru_base_type(page) + LRU_ACTIVE);
 }
 
 /**
- * ҳPG_active־ݼӦı־
- * ҳlruɾ
- * 
+ * ҳӦ͵ķǻͷ
+ */
+static inline void
+add_page_to_inactive_list(struct zone *zone, struct page *page)
+{
+	add_page_to_lru_list(zone, page, page_lru_base_type(page));
+}
+
+/**
+ * ҳPG_activePG_unevictable־ҳڵlruɾ
+ * ־
  */
 static inline void
 del_page_from_lru(struct zone *zone, struct page *page)
 {
-	list_del(&page->lru);
-	if (PageActive(page)) {
-		ClearPageActive(page);
-		zone->nr_active--;
+	int l;
+
+	if (PageUnevictable(page)) {
+		ClearPageUnevictable(page);
+		l = LRU_UNEVICTABLE;
 	} else {
-		zone->nr_inactive--;
+		l = page_lru_base_type(page);
+		if (PageActive(page)) {
+			ClearPageActive(page);
+			l += LRU_ACTIVE;
+		}
 	}
+	del_page_from_lru_list(zone, page, l);
 }
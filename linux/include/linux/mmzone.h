@@ -20,8 +20,63 @@
 #define MAX_ORDER CONFIG_FORCE_MAX_ZONEORDER
 #endif
 
+/*
+ * Mobility types.  Free blocks are kept on one list per type so that
+ * pages the kernel can never give back don't get scattered over every
+ * large block: unmovable allocations are grouped with each other,
+ * reclaimable slab caches with each other, and user pages (which can be
+ * reclaimed or moved) with each other.
+ */
+#define MIGRATE_UNMOVABLE     0
+#define MIGRATE_RECLAIMABLE   1
+#define MIGRATE_MOVABLE       2
+#define MIGRATE_TYPES         3
+
+#define for_each_migratetype_order(order, type) \
+	for (order = 0; order < MAX_ORDER; order++) \
+		for (type = 0; type < MIGRATE_TYPES; type++)
+
+/*
+ * The mobility type is tracked per pageblock, the largest buddy block,
+ * in NR_PAGEBLOCK_BITS bits of zone->pageblock_flags.
+ */
+#define pageblock_order		(MAX_ORDER-1)
+#define pageblock_nr_pages	(1UL << pageblock_order)
+#define NR_PAGEBLOCK_BITS	2
+
+/*
+ * Pages in use are kept on per-zone LRU lists.  Anonymous and shmem pages
+ * (PG_swapbacked) age separately from page cache so that reclaim can scan
+ * each at its own rate, and pages that can't be evicted at all, such as
+ * mlocked ones, are kept off to the side where reclaim doesn't see them.
+ * The list a page is on follows from its PG_swapbacked, PG_active and
+ * PG_unevictable bits, which only change under zone->lru_lock or while
+ * the page is off the LRU.
+ */
+#define LRU_BASE		0
+#define LRU_ACTIVE		1
+#define LRU_FILE		2
+
+#define LRU_INACTIVE_ANON	LRU_BASE
+#define LRU_ACTIVE_ANON		(LRU_BASE + LRU_ACTIVE)
+#define LRU_INACTIVE_FILE	(LRU_BASE + LRU_FILE)
+#define LRU_ACTIVE_FILE		(LRU_BASE + LRU_FILE + LRU_ACTIVE)
+#define LRU_UNEVICTABLE		4
+#define NR_LRU_LISTS		5
+
+#define for_each_lru(l) for (l = 0; l < NR_LRU_LISTS; l++)
+#define for_each_evictable_lru(l) for (l = 0; l <= LRU_ACTIVE_FILE; l++)
+
+#define is_file_lru(l)		((l) == LRU_INACTIVE_FILE || \
+				 (l) == LRU_ACTIVE_FILE)
+#define is_active_lru(l)	((l) == LRU_ACTIVE_ANON || \
+				 (l) == LRU_ACTIVE_FILE)
+
 struct free_area {
-	struct list_head	free_list;
+	/**
+	 * ÿǨһп
+	 */
+	struct list_head	free_list[MIGRATE_TYPES];
 	unsigned long		nr_free;
 };
 
@@ -187,6 +242,10 @@ struct zone {
 	 */
 	struct free_area	free_area[MAX_ORDER];
 
+	/**
+	 * ÿpageblockǨͣÿռNR_PAGEBLOCK_BITSλlock
+	 */
+	unsigned long		*pageblock_flags;
 
 	ZONE_PADDING(_pad1_)
 
@@ -196,29 +255,29 @@ struct zone {
 	 */
 	spinlock_t		lru_lock;	
 	/**
-	 * еĻҳ
-	 */
-	struct list_head	active_list;
-	/**
-	 * еķǻҳ
+	 * ĸLRUҳļҳлǻвɻ
 	 */
-	struct list_head	inactive_list;
+	struct list_head	lru[NR_LRU_LISTS];
 	/**
-	 * ڴʱҪɨĻҳ
+	 * LRUϵҳĿ
 	 */
-	unsigned long		nr_scan_active;
+	unsigned long		nr_lru[NR_LRU_LISTS];
 	/**
-	 * ڴʱҪɨķǻҳĿ
+	 * ڴʱۼƴɨҳ
 	 */
-	unsigned long		nr_scan_inactive;
+	unsigned long		nr_scan[NR_LRU_LISTS];
 	/**
-	 * ĻϵҳĿ
+	 * ɨҳ[0]ļҳ[1]ĿԼֱŻػĿ
+	 * ֮Ⱥ˻ոҳĴۣɨlru_lock
+	 * ļҳٴȱҳʹӷǻϱҲrecent_rotated[1]
 	 */
-	unsigned long		nr_active;
+	unsigned long		recent_scanned[2];
+	unsigned long		recent_rotated[2];
 	/**
-	 * ķǻϵҳĿ
+	 * ļҳӷǻϱջ򱻼ۼƴ൱ڷǻ"ʱ"
+	 * ʱӰٴȱҳʱ֮Ϊҳڴеʱڷǻƶ롣
 	 */
-	unsigned long		nr_inactive;
+	atomic_t		inactive_age;
 	/**
 	 * ڻҳʱʹõļ
 	 */
@@ -423,6 +482,14 @@ typedef struct pglist_data {
 	 * KswapdҪĿпСȡֵ
 	 */
 	int kswapd_max_order;
+#ifdef CONFIG_COMPACTION
+	/**
+	 * kcompactdȴС̼߳ס
+	 */
+	wait_queue_head_t kcompactd_wait;
+	struct task_struct *kcompactd;
+	int kcompactd_max_order;
+#endif
 } pg_data_t;
 
 #define node_present_pages(nid)	(NODE_DATA(nid)->node_present_pages)
@@ -432,18 +499,46 @@ extern struct pglist_data *pgdat_list;
 
 void __get_zone_counts(unsigned long *active, unsigned long *inactive,
 			unsigned long *free, struct pglist_data *pgdat);
+void get_lru_counts(unsigned long *nr_lru);
 void get_zone_counts(unsigned long *active, unsigned long *inactive,
 			unsigned long *free);
 void build_all_zonelists(void);
 void wakeup_kswapd(struct zone *zone, int order);
 int zone_watermark_ok(struct zone *z, int order, unsigned long mark,
 		int alloc_type, int can_try_harder, int gfp_high);
+int split_free_page(struct zone *zone, struct page *page,
+		struct list_head *list);
+int get_pageblock_migratetype(struct zone *zone, struct page *page);
+
+/* Return values of try_to_compact_pages() */
+#define COMPACT_SKIPPED		0	/* too little free memory to try */
+#define COMPACT_COMPLETE	1	/* whole zones scanned, no luck */
+#define COMPACT_PARTIAL		2	/* a block of the wanted order is free */
+
+#ifdef CONFIG_COMPACTION
+int try_to_compact_pages(struct zone **zones, int order);
+void wakeup_kcompactd(struct zone *zone, int order);
+#else
+static inline int try_to_compact_pages(struct zone **zones, int order)
+{
+	return COMPACT_SKIPPED;
+}
+static inline void wakeup_kcompactd(struct zone *zone, int order)
+{
+}
+#endif
 
 /*
  * zone_idx() returns 0 for the ZONE_DMA zone, 1 for the ZONE_NORMAL zone, etc.
  */
 #define zone_idx(zone)		((zone) - (zone)->zone_pgdat->node_zones)
 
+/* Pages on the zone's active and inactive lists, of either kind */
+#define zone_nr_active(zone)	((zone)->nr_lru[LRU_ACTIVE_ANON] + \
+				 (zone)->nr_lru[LRU_ACTIVE_FILE])
+#define zone_nr_inactive(zone)	((zone)->nr_lru[LRU_INACTIVE_ANON] + \
+				 (zone)->nr_lru[LRU_INACTIVE_FILE])
+
 /**
  * for_each_pgdat - helper macro to iterate over all nodes
  * @pgdat - pointer to a pg_data_t variable
@@ -528,6 +623,12 @@ int min_free_kbytes_sysctl_handler(struct ctl_table *, int, struct file *,
 extern int sysctl_lowmem_reserve_ratio[MAX_NR_ZONES-1];
 int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int, struct file *,
 					void __user *, size_t *, loff_t *);
+extern int percpu_pagelist_fraction;
+int percpu_pagelist_fraction_sysctl_handler(struct ctl_table *, int,
+			struct file *, void __user *, size_t *, loff_t *);
+extern int sysctl_compact_memory;
+int sysctl_compaction_handler(struct ctl_table *, int, struct file *,
+					void __user *, size_t *, loff_t *);
 
 #include <linux/topology.h>
 /* Returns the number of the current Node. */
@@ -141,6 +141,22 @@
  * ϵͳ𡢻ָʱʹá
  */
 #define PG_nosave_free		19	/* Free, should not be written */
+/**
+ * ҳн󱸴洢(ҳshmemҳ)ҳLRUС
+ */
+#define PG_swapbacked		20	/* Page is backed by RAM/swap */
+/**
+ * ҳڲɻյLRUС
+ */
+#define PG_unevictable		21	/* Page is on the unevictable list */
+/**
+ * ҳӳ䵽VM_LOCKEDС
+ */
+#define PG_mlocked		22	/* Page is mapped in a VM_LOCKED vma */
+/**
+ * ksmdϲֻҳLRUС
+ */
+#define PG_ksm			23	/* Merged by ksmd, write-protected */
 
 
 /*
@@ -154,7 +170,8 @@ struct page_state {
 	unsigned long nr_page_table_pages;/* Pages used for pagetables */
 	unsigned long nr_mapped;	/* mapped into pagetables */
 	unsigned long nr_slab;		/* In slab */
-#define GET_PAGE_STATE_LAST nr_slab
+	unsigned long nr_shadows;	/* page cache shadow entries */
+#define GET_PAGE_STATE_LAST nr_shadows
 
 	/*
 	 * The below are zeroed by get_page_state().  Use get_full_page_state()
@@ -174,6 +191,7 @@ struct page_state {
 
 	unsigned long pgfault;		/* faults (major+minor) */
 	unsigned long pgmajfault;	/* faults (major only) */
+	unsigned long pgfault_speculative;/* faults handled without mmap_sem */
 	unsigned long pgrefill_high;	/* inspected in refill_inactive_zone */
 	unsigned long pgrefill_normal;
 	unsigned long pgrefill_dma;
@@ -197,6 +215,30 @@ struct page_state {
 	unsigned long allocstall;	/* direct reclaim calls */
 
 	unsigned long pgrotated;	/* pages rotated to tail of the LRU */
+
+	unsigned long compact_pages_moved;	/* pages moved by compaction */
+	unsigned long compact_pagemigrate_failed;/* pages it failed to move */
+	unsigned long compact_stall;	/* direct compaction runs */
+	unsigned long compact_fail;	/* runs which freed no big block */
+	unsigned long compact_success;	/* runs which did */
+
+	unsigned long thp_fault_alloc;	/* huge pages mapped at fault */
+	unsigned long thp_fault_fallback;/* faults that had to use small pages */
+	unsigned long thp_collapse_alloc;/* huge pages assembled by khugepaged */
+	unsigned long thp_split;	/* huge pmds split into page tables */
+
+	unsigned long unevictable_pgs_culled;	/* moved to unevictable list */
+	unsigned long unevictable_pgs_rescued;	/* moved back from it */
+
+	unsigned long workingset_refault;	/* evicted file pages read again */
+	unsigned long workingset_activate;	/* refaults activated at once */
+	unsigned long workingset_shadow_reclaim;/* shadows trimmed by shrinker */
+
+	unsigned long zswpout;		/* pages stored compressed */
+	unsigned long zswpin;		/* pages read back from the pool */
+	unsigned long zswpmiss;		/* swap reads not found in the pool */
+	unsigned long zswpreject;	/* pages the pool did not take */
+	unsigned long zswpwriteback;	/* pool pages written to the device */
 };
 
 extern void get_page_state(struct page_state *ret);
@@ -359,6 +401,28 @@ extern void __mod_page_state(unsigned offset, unsigned long delta);
 #define SetPageCompound(page)	set_bit(PG_compound, &(page)->flags)
 #define ClearPageCompound(page)	clear_bit(PG_compound, &(page)->flags)
 
+#define PageSwapBacked(page)	test_bit(PG_swapbacked, &(page)->flags)
+#define SetPageSwapBacked(page)	set_bit(PG_swapbacked, &(page)->flags)
+#define ClearPageSwapBacked(page) clear_bit(PG_swapbacked, &(page)->flags)
+
+#define PageUnevictable(page)	test_bit(PG_unevictable, &(page)->flags)
+#define SetPageUnevictable(page) set_bit(PG_unevictable, &(page)->flags)
+#define ClearPageUnevictable(page) clear_bit(PG_unevictable, &(page)->flags)
+#define TestClearPageUnevictable(page) \
+		test_and_clear_bit(PG_unevictable, &(page)->flags)
+
+#define PageMlocked(page)	test_bit(PG_mlocked, &(page)->flags)
+#define SetPageMlocked(page)	set_bit(PG_mlocked, &(page)->flags)
+#define TestClearPageMlocked(page) test_and_clear_bit(PG_mlocked, &(page)->flags)
+
+#ifdef CONFIG_KSM
+#define PageKsm(page)		test_bit(PG_ksm, &(page)->flags)
+#define SetPageKsm(page)	set_bit(PG_ksm, &(page)->flags)
+#define ClearPageKsm(page)	clear_bit(PG_ksm, &(page)->flags)
+#else
+#define PageKsm(page)		0
+#endif
+
 #ifdef CONFIG_SWAP
 #define PageSwapCache(page)	test_bit(PG_swapcache, &(page)->flags)
 #define SetPageSwapCache(page)	set_bit(PG_swapcache, &(page)->flags)
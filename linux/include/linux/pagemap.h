@@ -18,6 +18,22 @@
  */
 #define	AS_EIO		(__GFP_BITS_SHIFT + 0)	/* IO error on async write */
 #define AS_ENOSPC	(__GFP_BITS_SHIFT + 1)	/* ENOSPC on async write */
+#define AS_UNEVICTABLE	(__GFP_BITS_SHIFT + 2)	/* e.g., ramfs */
+
+/**
+ * ӳеҳܱ(ramfs)Щҳֱӷ벻ɻ
+ */
+static inline void mapping_set_unevictable(struct address_space *mapping)
+{
+	set_bit(AS_UNEVICTABLE, &mapping->flags);
+}
+
+static inline int mapping_unevictable(struct address_space *mapping)
+{
+	if (likely(mapping))
+		return test_bit(AS_UNEVICTABLE, &mapping->flags);
+	return 0;
+}
 
 static inline int mapping_gfp_mask(struct address_space * mapping)
 {
@@ -50,6 +66,76 @@ static inline void mapping_set_gfp_mask(struct address_space *m, int mask)
 #define page_cache_release(page)	put_page(page)
 void release_pages(struct page **pages, int nr, int cold);
 
+/*
+ * Lockless page cache lookups.  find_get_page() and find_get_pages() walk
+ * the radix tree under rcu_read_lock() only, so the page they find may be
+ * freed, and even reused, before they manage to take a reference on it:
+ *
+ *  - page_cache_get_speculative() takes the reference only if the page is
+ *    not free (_count == -1), and the caller then checks that the slot
+ *    still points to the page, dropping the reference and retrying if not.
+ *
+ *  - Whoever takes a page out of the page cache while the reference count
+ *    must not change (reclaim, migration) uses page_freeze_refs() under
+ *    tree_lock: it atomically turns the expected count into "free", which
+ *    makes speculative lookups back off until page_unfreeze_refs().
+ *
+ * This needs cmpxchg().  Architectures without it keep taking tree_lock
+ * for lookups, under which the page cannot go away and the plain
+ * reference count operations suffice.
+ */
+#ifdef __HAVE_ARCH_CMPXCHG
+#define PAGECACHE_LOCKLESS_LOOKUP
+
+/**
+ * лҳáҳѾͷ(_countΪ-1)ʱʧܡ
+ */
+static inline int page_cache_get_speculative(struct page *page)
+{
+	int count = atomic_read(&page->_count);
+
+	for (;;) {
+		int old;
+
+		if (unlikely(count == -1))
+			return 0;
+		old = cmpxchg(&page->_count.counter, count, count + 1);
+		if (likely(old == count))
+			return 1;
+		count = old;
+	}
+}
+
+/**
+ * ҳüΪcountͽ䶳Ϊ0ʹ޷ٻ
+ */
+static inline int page_freeze_refs(struct page *page, int count)
+{
+	return likely(cmpxchg(&page->_count.counter, count - 1, -1) ==
+								count - 1);
+}
+#else
+static inline int page_cache_get_speculative(struct page *page)
+{
+	get_page(page);
+	return 1;
+}
+
+static inline int page_freeze_refs(struct page *page, int count)
+{
+	return page_count(page) == count;
+}
+#endif
+
+/**
+ * ⶳҳüΪcount
+ */
+static inline void page_unfreeze_refs(struct page *page, int count)
+{
+	smp_wmb();
+	set_page_count(page, count);
+}
+
 static inline struct page *page_cache_alloc(struct address_space *x)
 {
 	return alloc_pages(mapping_gfp_mask(x), 0);
@@ -97,6 +183,7 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 				unsigned long index, int gfp_mask);
 extern void remove_from_page_cache(struct page *page);
 extern void __remove_from_page_cache(struct page *page);
+extern void __remove_from_page_cache_shadow(struct page *page, void *shadow);
 
 extern atomic_t nr_pagecache;
 
@@ -3,6 +3,7 @@
 
 #include <linux/spinlock.h>
 #include <linux/list.h>
+#include <linux/hrtimer.h>
 
 /* POSIX.1b interval timer structure. */
 struct k_itimer {
@@ -16,26 +17,23 @@ struct k_itimer {
 	int it_sigev_notify;		/* notify word of sigevent struct */
 	int it_sigev_signo;		/* signo word of sigevent struct */
 	sigval_t it_sigev_value;	/* value word of sigevent struct */
-	unsigned long it_incr;		/* interval specified in jiffies */
 	struct task_struct *it_process;	/* process to send signal to */
-	struct timer_list it_timer;
 	struct sigqueue *sigq;		/* signal queue entry. */
-	struct list_head abs_timer_entry; /* clock abs_timer_list */
-	struct timespec wall_to_prev;   /* wall_to_monotonic used when set */
+	/* CLOCK_REALTIME and CLOCK_MONOTONIC timers: */
+	struct hrtimer it_real_timer;	/* expiry, on the clock's hrtimer base */
+	ktime_t it_interval;		/* interval in nanoseconds */
+	/* clocks with their own timer_* methods (e.g. mmtimer): */
+	unsigned long it_incr;		/* interval in clock specific units */
+	struct timer_list it_timer;
 };
 
-struct k_clock_abs {
-	struct list_head list;
-	spinlock_t lock;
-};
 struct k_clock {
 	int res;		/* in nano seconds */
-	struct k_clock_abs *abs_struct;
 	int (*clock_set) (struct timespec * tp);
 	int (*clock_get) (struct timespec * tp);
 	int (*timer_create) (struct k_itimer *timer);
-	int (*nsleep) (int which_clock, int flags,
-		       struct timespec * t);
+	int (*nsleep) (int which_clock, int flags, struct timespec * t,
+		       struct timespec __user *rmtp);
 	int (*timer_set) (struct k_itimer * timr, int flags,
 			  struct itimerspec * new_setting,
 			  struct itimerspec * old_setting);
@@ -48,29 +46,12 @@ void register_posix_clock(int clock_id, struct k_clock *new_clock);
 
 /* Error handlers for timer_create, nanosleep and settime */
 int do_posix_clock_notimer_create(struct k_itimer *timer);
-int do_posix_clock_nonanosleep(int which_clock, int flags, struct timespec * t);
+int do_posix_clock_nonanosleep(int which_clock, int flags, struct timespec * t,
+			       struct timespec __user *rmtp);
 int do_posix_clock_nosettime(struct timespec *tp);
 
 /* function to call to trigger timer event */
 int posix_timer_event(struct k_itimer *timr, int si_private);
 
-struct now_struct {
-	unsigned long jiffies;
-};
-
-#define posix_get_now(now) (now)->jiffies = jiffies;
-#define posix_time_before(timer, now) \
-                      time_before((timer)->expires, (now)->jiffies)
-
-#define posix_bump_timer(timr, now)					\
-         do {								\
-              long delta, orun;						\
-	      delta = now.jiffies - (timr)->it_timer.expires;		\
-              if (delta >= 0) {						\
-	           orun = 1 + (delta / (timr)->it_incr);		\
-	          (timr)->it_timer.expires += orun * (timr)->it_incr;	\
-                  (timr)->it_overrun += orun;				\
-              }								\
-            }while (0)
 #endif
 
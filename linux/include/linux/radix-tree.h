@@ -56,12 +56,45 @@ do {									\
 	(root)->rnode = NULL;						\
 } while (0)
 
+/*
+ * Lookups (radix_tree_lookup, radix_tree_lookup_slot and the untagged gang
+ * lookups) may run under rcu_read_lock() instead of the lock the caller
+ * uses to serialise insertions and deletions.  Nodes are freed only after
+ * an RCU grace period, and items are published with rcu_assign_pointer(),
+ * so such a reader finds either the old or the new item at a given index;
+ * it must still make sure that the item it got is still there once it has
+ * pinned it.  Tag operations always need the lock.
+ */
+
+/*
+ * Items are normally pointers to word-aligned structures.  A slot may
+ * instead hold an "exceptional" entry, a value with bit 1 set, which the
+ * page cache uses to remember evicted pages.  Such entries are returned by
+ * radix_tree_lookup() and radix_tree_gang_lookup_index(), but skipped by
+ * radix_tree_gang_lookup().
+ */
+#define RADIX_TREE_EXCEPTIONAL_ENTRY	2
+#define RADIX_TREE_EXCEPTIONAL_SHIFT	2
+
+static inline int radix_tree_exceptional_entry(void *arg)
+{
+	return (unsigned long)arg & RADIX_TREE_EXCEPTIONAL_ENTRY;
+}
+
 int radix_tree_insert(struct radix_tree_root *, unsigned long, void *);
 void *radix_tree_lookup(struct radix_tree_root *, unsigned long);
+void **radix_tree_lookup_slot(struct radix_tree_root *, unsigned long);
 void *radix_tree_delete(struct radix_tree_root *, unsigned long);
 unsigned int
 radix_tree_gang_lookup(struct radix_tree_root *root, void **results,
 			unsigned long first_index, unsigned int max_items);
+unsigned int
+radix_tree_gang_lookup_slot(struct radix_tree_root *root, void ***results,
+			unsigned long first_index, unsigned int max_items);
+unsigned int
+radix_tree_gang_lookup_index(struct radix_tree_root *root, void **results,
+			unsigned long *indices, unsigned long first_index,
+			unsigned int max_items);
 int radix_tree_preload(int gfp_mask);
 void radix_tree_init(void);
 void *radix_tree_tag_set(struct radix_tree_root *root,
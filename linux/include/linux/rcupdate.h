@@ -41,6 +41,7 @@
 #include <linux/percpu.h>
 #include <linux/cpumask.h>
 #include <linux/seqlock.h>
+#include <asm/atomic.h>
 
 /**
  * struct rcu_head - callback structure for use with RCU
@@ -79,6 +80,8 @@ static inline int rcu_batch_after(long a, long b)
         return (a - b) > 0;
 }
 
+struct rcu_node;
+
 /*
  * Per-CPU data for Read-Copy UPdate.
  * nxtlist - new callbacks are added here
@@ -89,6 +92,8 @@ struct rcu_data {
 	long		quiescbatch;     /* Batch # for grace period */
 	int		passed_quiesc;	 /* User-mode/idle loop etc. */
 	int		qs_pending;	 /* core waits for quiesc state */
+	struct rcu_node	*mynode;	 /* leaf rcu_node we report to */
+	unsigned long	grpmask;	 /* our bit in mynode->qsmask */
 
 	/* 2) batch handling */
 	long  	       	batch;           /* Batch # for current RCU batch */
@@ -98,6 +103,12 @@ struct rcu_data {
 	struct rcu_head **curtail;
 	struct rcu_head *donelist;
 	struct rcu_head **donetail;
+	long		qlen;		 /* # of queued callbacks */
+	long		blimit;		 /* upper limit on a processed batch */
+	/**
+	 * ٿλ󣬱cpuһֹ״̬Ҫȴߡ
+	 */
+	int		expedite;	 /* report next QS to expedited waiter */
 	int cpu;
 };
 
@@ -105,6 +116,7 @@ DECLARE_PER_CPU(struct rcu_data, rcu_data);
 DECLARE_PER_CPU(struct rcu_data, rcu_bh_data);
 extern struct rcu_ctrlblk rcu_ctrlblk;
 extern struct rcu_ctrlblk rcu_bh_ctrlblk;
+extern atomic_t rcu_expedite_pending;
 
 /*
  * Increment the quiescent state counter.
@@ -116,6 +128,12 @@ static inline void rcu_qsctr_inc(int cpu)
 {
 	struct rcu_data *rdp = &per_cpu(rcu_data, cpu);
 	rdp->passed_quiesc = 1;
+	if (unlikely(rdp->expedite)) {
+		/* An expedited grace period waits for this cpu. */
+		rdp->expedite = 0;
+		smp_mb__before_atomic_dec();
+		atomic_dec(&rcu_expedite_pending);
+	}
 }
 static inline void rcu_bh_qsctr_inc(int cpu)
 {
@@ -272,6 +290,7 @@ extern void FASTCALL(call_rcu(struct rcu_head *head,
 extern void FASTCALL(call_rcu_bh(struct rcu_head *head,
 				void (*func)(struct rcu_head *head)));
 extern void synchronize_kernel(void);
+extern void synchronize_kernel_expedited(void);
 
 #endif /* __KERNEL__ */
 #endif /* __LINUX_RCUPDATE_H */
@@ -84,6 +84,7 @@ void __anon_vma_link(struct vm_area_struct *);
  */
 void page_add_anon_rmap(struct page *, struct vm_area_struct *, unsigned long);
 void page_add_file_rmap(struct page *);
+void page_add_ksm_rmap(struct page *);
 void page_remove_rmap(struct page *);
 
 /**
@@ -102,7 +103,12 @@ static inline void page_dup_rmap(struct page *page)
  * Called from mm/vmscan.c to handle paging out
  */
 int page_referenced(struct page *, int is_locked, int ignore_token);
-int try_to_unmap(struct page *);
+int try_to_unmap(struct page *, int ignore_refs);
+
+/*
+ * Called from mm/compaction.c to move an anonymous page
+ */
+int try_to_remap_anon(struct page *, struct page *newpage);
 
 /*
  * Used by swapoff to help locate where page is expected in vma.
@@ -116,7 +122,8 @@ unsigned long page_address_in_vma(struct page *, struct vm_area_struct *);
 #define anon_vma_link(vma)	do {} while (0)
 
 #define page_referenced(page,l,i) TestClearPageReferenced(page)
-#define try_to_unmap(page)	SWAP_FAIL
+#define try_to_unmap(page, i)	SWAP_FAIL
+#define try_to_remap_anon(page, n)	SWAP_FAIL
 
 #endif	/* CONFIG_MMU */
 
@@ -126,5 +133,6 @@ unsigned long page_address_in_vma(struct page *, struct vm_area_struct *);
 #define SWAP_SUCCESS	0
 #define SWAP_AGAIN	1
 #define SWAP_FAIL	2
+#define SWAP_MLOCK	3
 
 #endif	/* _LINUX_RMAP_H */
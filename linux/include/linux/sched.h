@@ -155,6 +155,7 @@ extern unsigned long nr_iowait(void);
 #include <linux/param.h>
 #include <linux/resource.h>
 #include <linux/timer.h>
+#include <linux/hrtimer.h>
 
 #include <asm/processor.h>
 
@@ -216,6 +217,7 @@ extern unsigned long nr_iowait(void);
 #define SCHED_NORMAL		0
 #define SCHED_FIFO		1
 #define SCHED_RR		2
+#define SCHED_FAIR		3
 
 struct sched_param {
 	int sched_priority;
@@ -306,6 +308,10 @@ struct mm_struct {
 	 * ָĺ-ĸ
 	 */
 	struct rb_root mm_rb;
+	/**
+	 * ṹıʱmmap_semȱҳʱⲢ޸ġ
+	 */
+	seqcount_t mm_rb_seq;		/* writers hold mmap_sem */
 	/**
 	 * ָһõ
 	 */
@@ -399,6 +405,26 @@ struct mm_struct {
 	 */
 	unsigned long exec_vm, stack_vm, reserved_vm, def_flags, nr_ptes;
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	/**
+	 * Ϊÿ͸ҳpmdԤҳҳִҳʱȡápage_table_lock
+	 */
+	struct list_head huge_pte_deposit;
+	/**
+	 * khugepagedɨԼһɨʼַ
+	 */
+	struct list_head khugepaged_list;
+	unsigned long khugepaged_scan_address;
+#endif
+#ifdef CONFIG_KSM
+	/**
+	 * ksmdɨַrmap_itemһɨʼַ
+	 */
+	struct list_head ksm_list;
+	struct list_head ksm_rmap_list;	/* under ksm_sem */
+	unsigned long ksm_scan_address;
+#endif
+
 	/**
 	 * ʼִelfʱʹá
 	 */
@@ -464,6 +490,12 @@ struct mm_struct {
 	 * еҳ
 	 */
 	unsigned long hiwater_vm;	/* High-water virtual memory usage */
+
+	/**
+	 * CPUIPITLBˢ´ԼIPI򱻺ϲˢ´
+	 */
+	unsigned long tlb_shootdowns;		/* flushes that sent IPIs */
+	unsigned long tlb_shootdowns_avoided;	/* local-only or batched away */
 };
 
 /**
@@ -624,6 +656,7 @@ struct signal_struct {
 #define MAX_PRIO		(MAX_RT_PRIO + 40)
 
 #define rt_task(p)		(unlikely((p)->prio < MAX_RT_PRIO))
+#define fair_task(p)		((p)->policy == SCHED_FAIR)
 
 /*
  * Some day this will be a full-fledged user tracking system..
@@ -655,6 +688,7 @@ extern struct user_struct root_user;
 typedef struct prio_array prio_array_t;
 struct backing_dev_info;
 struct reclaim_state;
+struct wq_worker;
 
 #ifdef CONFIG_SCHEDSTATS
 struct sched_info {
@@ -666,6 +700,10 @@ struct sched_info {
 	/* timestamps */
 	unsigned long	last_arrival,	/* when we last ran on a cpu */
 			last_queued;	/* when we were last queued to run */
+
+	/* sched_clock() timestamps for the latency histograms */
+	unsigned long long last_wakeup,	/* when we were last woken, 0 once run */
+			last_arrival_ns; /* when we last ran on a cpu */
 };
 
 extern struct file_operations proc_schedstat_operations;
@@ -727,6 +765,10 @@ struct sched_domain {
 	unsigned int imbalance_pct;	/* No balance until over watermark */
 	unsigned long long cache_hot_time; /* Task considered cache hot (ns) */
 	unsigned int cache_nice_tries;	/* Leave cache hot tasks for # tries */
+	/**
+	 * ʱõġڱǨƽ̺ٻĿ0ʾδ
+	 */
+	unsigned long long migration_cost; /* Measured cache refill cost (ns) */
 	unsigned int per_cpu_gain;	/* CPU % gained by adding domain cpus */
 	int flags;			/* See SD_* */
 
@@ -865,6 +907,19 @@ struct task_struct {
 	 */
 	unsigned int time_slice, first_time_slice;
 
+	/**
+	 * SCHED_FAIRжкеĽڵ㡣
+	 */
+	struct rb_node fair_node;
+	/**
+	 * vruntime-niceȨʱ()ںʱΪֵ
+	 *          ʱΪжmin_vruntimeֵ
+	 * sum_exec_runtime-ۼʵʱ䡣
+	 * prev_sum_exec_runtime-αѡʱsum_exec_runtimeڼ㱾еʱ䡣
+	 */
+	unsigned long long vruntime;
+	unsigned long long sum_exec_runtime, prev_sum_exec_runtime;
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_info sched_info;
 #endif
@@ -965,15 +1020,17 @@ struct task_struct {
 	/**
 	 * ֵû̬Ķʱʱʱû̷̬źš
 	 * ÿһֱֵź֮ԽΪλļʱĵǰֵ
+	 * ITIMER_REALļΪλit_real_value/procʾ
 	 */
-	unsigned long it_real_value, it_real_incr;
+	unsigned long it_real_value;
+	ktime_t it_real_incr;
 	cputime_t it_virt_value, it_virt_incr;
 	cputime_t it_prof_value, it_prof_incr;
 	/**
-	 * ÿ̵Ķ̬ʱʵITIMER_REAL͵ļʱ
+	 * ÿ̵ĸ߾ȶʱʵITIMER_REAL͵ļʱ
 	 * settimerϵͳóʼ
 	 */
-	struct timer_list real_timer;
+	struct hrtimer real_timer;
 	/**
 	 * û̬ں̬¾Ľ
 	 */
@@ -1084,6 +1141,11 @@ struct task_struct {
 
 	struct io_context *io_context;
 
+	/**
+	 * ǰǹеḶָ́߳
+	 */
+	struct wq_worker *wq_worker;
+
 	unsigned long ptrace_message;
 	siginfo_t *last_siginfo; /* For ptrace use.  */
 /*
@@ -1166,6 +1228,7 @@ do { if (atomic_dec_and_test(&(tsk)->usage)) __put_task_struct(tsk); } while(0)
 #define PF_LESS_THROTTLE 0x00100000	/* Throttle me less: I clean memory */
 #define PF_SYNCWRITE	0x00200000	/* I am doing a sync write */
 #define PF_BORROWED_MM	0x00400000	/* I am a kthread doing use_mm */
+#define PF_WQ_WORKER	0x00800000	/* I am a shared workqueue worker */
 
 /*
  * Only the _current_ task can read/write to tsk->flags, but other
@@ -1280,6 +1343,28 @@ extern int FASTCALL(wake_up_state(struct task_struct * tsk, unsigned int state))
 extern int FASTCALL(wake_up_process(struct task_struct * tsk));
 extern void FASTCALL(wake_up_new_task(struct task_struct * tsk,
 						unsigned long clone_flags));
+
+/*
+ * Batched wakeups, see kernel/sched.c.  Tasks added with
+ * wake_batch_add_task() are woken from TASK_INTERRUPTIBLE by
+ * wake_up_batch(), a runqueue at a time.
+ */
+#define WAKE_BATCH	16
+
+struct wake_batch {
+	int nr;
+	wait_queue_t *waits[WAKE_BATCH];
+	struct task_struct *tasks[WAKE_BATCH];
+};
+
+static inline void wake_batch_init(struct wake_batch *wb)
+{
+	wb->nr = 0;
+}
+
+extern void wake_batch_add_task(struct wake_batch *wb, struct task_struct *p);
+extern void wake_up_batch(struct wake_batch *wb);
+
 #ifdef CONFIG_SMP
  extern void kick_process(struct task_struct *tsk);
 #else
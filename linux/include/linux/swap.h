@@ -290,6 +290,16 @@ extern void swap_setup(void);
 extern int try_to_free_pages(struct zone **, unsigned int, unsigned int);
 extern int shrink_all_memory(int);
 extern int vm_swappiness;
+extern int page_evictable(struct page *page);
+extern void check_move_unevictable_page(struct page *page);
+
+/* linux/mm/workingset.c */
+extern void *workingset_eviction(struct address_space *mapping,
+				 struct page *page);
+extern int workingset_refault(void *shadow);
+extern void workingset_activation(struct page *page);
+extern void workingset_add_shadow(struct address_space *mapping);
+extern void workingset_del_shadow(struct address_space *mapping);
 
 #ifdef CONFIG_MMU
 /* linux/mm/shmem.c */
@@ -302,6 +312,7 @@ extern void swap_unplug_io_fn(struct backing_dev_info *, struct page *);
 /* linux/mm/page_io.c */
 extern int swap_readpage(struct file *, struct page *);
 extern int swap_writepage(struct page *page, struct writeback_control *wbc);
+extern int __swap_writepage(struct page *page, struct writeback_control *wbc);
 extern int rw_swap_page_sync(int, swp_entry_t, struct page *);
 
 /* linux/mm/swap_state.c */
@@ -309,6 +320,7 @@ extern struct address_space swapper_space;
 #define total_swapcache_pages  swapper_space.nrpages
 extern void show_swap_cache_info(void);
 extern int add_to_swap(struct page *);
+extern int add_to_swap_cache(struct page *, swp_entry_t, int);
 extern void __delete_from_swap_cache(struct page *);
 extern void delete_from_swap_cache(struct page *);
 extern int move_to_swap_cache(struct page *, swp_entry_t);
@@ -135,6 +135,8 @@ enum
 	KERN_HZ_TIMER=65,	/* int: hz timer on or off */
 	KERN_UNKNOWN_NMI_PANIC=66, /* int: unknown nmi panic flag */
 	KERN_BOOTLOADER_TYPE=67, /* int: boot loader type */
+	KERN_SCHED_FAIR_LATENCY=68, /* int: SCHED_FAIR target latency (ns) */
+	KERN_SCHED_FAIR_MIN_GRAN=69, /* int: SCHED_FAIR minimum slice (ns) */
 };
 
 
@@ -169,6 +171,21 @@ enum
 	VM_VFS_CACHE_PRESSURE=26, /* dcache/icache reclaim pressure */
 	VM_LEGACY_VA_LAYOUT=27, /* legacy/compatibility virtual address space layout */
 	VM_SWAP_TOKEN_TIMEOUT=28, /* default time for token time out */
+	VM_PERCPU_PAGELIST_FRACTION=29,/* int: fraction of pages in each percpu_pagelist */
+	VM_COMPACT_MEMORY=30,	/* compact all of memory on write */
+	VM_TRANSPARENT_HUGEPAGE=31,	/* map anonymous memory with huge pages */
+	VM_KHUGEPAGED_PAGES_TO_SCAN=32,	/* ptes khugepaged looks at per pass */
+	VM_KHUGEPAGED_SCAN_SLEEP=33,	/* msecs between khugepaged passes */
+	VM_FAULT_AROUND_PAGES=34,	/* pages mapped around a file read fault */
+	VM_KSM_RUN=35,		/* ksmd merges identical anonymous pages */
+	VM_KSM_PAGES_TO_SCAN=36,	/* pages ksmd looks at per pass */
+	VM_KSM_SLEEP=37,	/* msecs between ksmd passes */
+	VM_KSM_PAGES_SHARED=38,	/* KSM pages in use */
+	VM_KSM_PAGES_SHARING=39,	/* pages saved by merging */
+	VM_ZSWAP=40,		/* keep swapped pages compressed in memory */
+	VM_ZSWAP_MAX_POOL_PERCENT=41,	/* limit of the compressed pool */
+	VM_ZSWAP_STORED_PAGES=42,	/* pages in the compressed pool */
+	VM_ZSWAP_POOL_PAGES=43,	/* memory the compressed pool takes */
 };
 
 
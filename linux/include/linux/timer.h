@@ -7,6 +7,7 @@
 #include <linux/stddef.h>
 
 struct tvec_t_base_s;
+struct file_operations;
 
 /**
  * ̬ʱṹ
@@ -122,6 +123,7 @@ static inline void add_timer(struct timer_list * timer)
 
 extern void init_timers(void);
 extern void run_local_timers(void);
-extern void it_real_fn(unsigned long);
+
+extern struct file_operations proc_timerstat_operations;
 
 #endif
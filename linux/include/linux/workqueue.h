@@ -16,7 +16,8 @@ struct workqueue_struct;
  */
 struct work_struct {
 	/**
-	 * ѾڹУֵֶΪ1Ϊ0
+	 * 0λѾڹУΪ1Ϊ0
+	 * 1λͨschedule_delayed_work_onŶӣֻŶӵCPUִУᱻCPUȡ
 	 */
 	unsigned long pending;
 	/**
@@ -100,6 +101,11 @@ extern int keventd_up(void);
 
 extern void init_workqueues(void);
 
+/* for the scheduler: a shared pool worker blocks or runs again */
+struct task_struct;
+extern void wq_worker_sleeping(struct task_struct *task);
+extern void wq_worker_running(struct task_struct *task);
+
 /*
  * Kill off a pending schedule_delayed_work().  Note that the work callback
  * function may still be running on return from cancel_delayed_work().  Run
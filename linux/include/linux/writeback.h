@@ -19,6 +19,9 @@ extern struct list_head inode_unused;
 /*
  * Yes, writeback.h requires sched.h
  * No, sched.h is not included from here.
+ *
+ * PF_FLUSHER is set on both the pdflush threads and the per-device flusher
+ * threads.
  */
 static inline int current_is_pdflush(void)
 {
@@ -31,7 +34,7 @@ static inline int current_is_pdflush(void)
 enum writeback_sync_modes {
 	WB_SYNC_NONE,	/* Don't wait on anything */
 	WB_SYNC_ALL,	/* Wait on every mapping */
-	WB_SYNC_HOLD,	/* Hold the inode on sb_dirty for sys_sync() */
+	WB_SYNC_HOLD,	/* Hold the inode on b_dirty for sys_sync() */
 };
 
 /*
@@ -94,10 +97,13 @@ struct writeback_control {
  * fs/fs-writeback.c
  */	
 void writeback_inodes(struct writeback_control *wbc);
+void writeback_bdi_inodes(struct backing_dev_info *bdi,
+			  struct writeback_control *wbc);
 void wake_up_inode(struct inode *inode);
 int inode_wait(void *);
 void sync_inodes_sb(struct super_block *, int wait);
 void sync_inodes(int wait);
+int sb_has_dirty_inodes(struct super_block *sb);
 
 /* writeback.h requires fs.h; it, too, is not included from here. */
 static inline void wait_on_inode(struct inode *inode)
@@ -111,6 +117,7 @@ static inline void wait_on_inode(struct inode *inode)
  * mm/page-writeback.c
  */
 int wakeup_bdflush(long nr_pages);
+void bdi_writeback_work(struct backing_dev_info *bdi);
 void laptop_io_completion(void);
 void laptop_sync_completion(void);
 
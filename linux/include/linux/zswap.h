@@ -0,0 +1,50 @@
+#ifndef _LINUX_ZSWAP_H
+#define _LINUX_ZSWAP_H
+
+/*
+ * Compressed cache in front of the swap devices: swap_writepage() keeps
+ * pages deflated in memory, and only the oldest of them go out to the
+ * device once the pool has reached its size limit.
+ */
+
+#include <linux/mm.h>
+#include <linux/errno.h>
+
+#ifdef CONFIG_ZSWAP
+
+/**
+ * /proc/sys/vm/zswapΪ0ʱѹдҳѹռڴİٷֱȡ
+ */
+extern int sysctl_zswap;
+extern int zswap_max_pool_percent;
+/**
+ * ѹеҳԼѹռõҳ
+ */
+extern unsigned long zswap_stored_pages;
+extern unsigned long zswap_pool_pages;
+
+extern int zswap_store(struct page *page);
+extern int zswap_load(struct page *page);
+extern void zswap_invalidate(int type, unsigned long offset);
+extern void zswap_invalidate_area(int type);
+
+#else /* !CONFIG_ZSWAP */
+
+static inline int zswap_store(struct page *page)
+{
+	return -ENODEV;
+}
+static inline int zswap_load(struct page *page)
+{
+	return -ENODEV;
+}
+static inline void zswap_invalidate(int type, unsigned long offset)
+{
+}
+static inline void zswap_invalidate_area(int type)
+{
+}
+
+#endif /* CONFIG_ZSWAP */
+
+#endif /* _LINUX_ZSWAP_H */
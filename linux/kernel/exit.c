@@ -916,7 +916,7 @@ fastcall NORET_TYPE void do_exit(long code)
 	/**
 	 * Ӷ̬ʱɾ
 	 */
-	del_timer_sync(&tsk->real_timer);
+	hrtimer_cancel(&tsk->real_timer);
 
 	if (unlikely(in_atomic()))
 		printk(KERN_INFO "note: %s[%d] exited with preempt_count %d\n",
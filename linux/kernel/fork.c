@@ -39,6 +39,8 @@
 #include <linux/audit.h>
 #include <linux/profile.h>
 #include <linux/rmap.h>
+#include <linux/huge_mm.h>
+#include <linux/ksm.h>
 #include <linux/acct.h>
 
 #include <asm/pgtable.h>
@@ -277,8 +279,12 @@ static inline int dup_mmap(struct mm_struct * mm, struct mm_struct * oldmm)
 		 * copy_page_rangeҪҳӳһҳҳʼҳı
 		 * ˽СдҳVM_SHARED־VM_MAYWRITE־Ըӽ̶Ϊֻġ
 		 * Ϊдʱƽд
+		 * copy_page_rangemmap_semֹеȱҳ
+		 * ڼ䲻mmap_semȱҳҲҪ˻صͨ·
 		 */
+		vma_write_begin(mpnt);
 		retval = copy_page_range(mm, current->mm, tmp);
+		vma_write_end(mpnt);
 		spin_unlock(&mm->page_table_lock);
 
 		if (tmp->vm_ops && tmp->vm_ops->open)
@@ -287,6 +293,8 @@ static inline int dup_mmap(struct mm_struct * mm, struct mm_struct * oldmm)
 		if (retval)
 			goto out;
 	}
+	/* The child inherits the parent's mergeable areas */
+	ksm_fork(mm, oldmm);
 	retval = 0;
 
 out:
@@ -331,9 +339,21 @@ static struct mm_struct * mm_init(struct mm_struct * mm)
 	atomic_set(&mm->mm_users, 1);
 	atomic_set(&mm->mm_count, 1);
 	init_rwsem(&mm->mmap_sem);
+	seqcount_init(&mm->mm_rb_seq);
 	INIT_LIST_HEAD(&mm->mmlist);
 	mm->core_waiters = 0;
 	mm->nr_ptes = 0;
+	mm->tlb_shootdowns = mm->tlb_shootdowns_avoided = 0;
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	INIT_LIST_HEAD(&mm->huge_pte_deposit);
+	INIT_LIST_HEAD(&mm->khugepaged_list);
+	mm->khugepaged_scan_address = 0;
+#endif
+#ifdef CONFIG_KSM
+	INIT_LIST_HEAD(&mm->ksm_list);
+	INIT_LIST_HEAD(&mm->ksm_rmap_list);
+	mm->ksm_scan_address = 0;
+#endif
 	spin_lock_init(&mm->page_table_lock);
 	rwlock_init(&mm->ioctx_list_lock);
 	mm->ioctx_list = NULL;
@@ -386,6 +406,8 @@ void mmput(struct mm_struct *mm)
 {
 	if (atomic_dec_and_test(&mm->mm_users)) {
 		exit_aio(mm);
+		khugepaged_exit(mm);
+		ksm_exit(mm);
 		exit_mmap(mm);
 		if (!list_empty(&mm->mmlist)) {
 			spin_lock(&mmlist_lock);
@@ -851,7 +873,7 @@ static inline void copy_flags(unsigned long clone_flags, struct task_struct *p)
 {
 	unsigned long new_flags = p->flags;
 
-	new_flags &= ~PF_SUPERPRIV;
+	new_flags &= ~(PF_SUPERPRIV | PF_WQ_WORKER);
 	new_flags |= PF_FORKNOEXEC;
 	if (!(clone_flags & CLONE_PTRACE))
 		p->ptrace = 0;
@@ -1030,13 +1052,13 @@ static task_t *copy_process(unsigned long clone_flags,
 	init_sigpending(&p->pending);
 
 	p->it_real_value = 0;
-	p->it_real_incr = 0;
+	p->it_real_incr.tv64 = 0;
 	p->it_virt_value = cputime_zero;
 	p->it_virt_incr = cputime_zero;
 	p->it_prof_value = cputime_zero;
 	p->it_prof_incr = cputime_zero;
-	init_timer(&p->real_timer);
-	p->real_timer.data = (unsigned long) p;
+	hrtimer_init(&p->real_timer, CLOCK_MONOTONIC, HRTIMER_REL);
+	p->real_timer.function = it_real_fn;
 
 	p->utime = cputime_zero;
 	p->stime = cputime_zero;
@@ -1053,6 +1075,7 @@ static task_t *copy_process(unsigned long clone_flags,
 	do_posix_clock_monotonic_gettime(&p->start_time);
 	p->security = NULL;
 	p->io_context = NULL;
+	p->wq_worker = NULL;
 	p->io_wait = NULL;
 	p->audit_context = NULL;
 #ifdef CONFIG_NUMA
@@ -75,7 +75,9 @@ union futex_key {
  * A futex_q has a woken state, just like tasks have TASK_RUNNING.
  * It is considered woken when list_empty(&q->list) || q->lock_ptr == 0.
  * The order of wakup is always to make the first condition true, then
- * wake up q->waiters, then make the second condition true.
+ * wake up q->waiters, then make the second condition true.  The task in
+ * futex_wait() is only put on a wake_batch at the second step, and
+ * woken when the hash bucket lock has been dropped.
  */
 struct futex_q {
 	struct list_head list;
@@ -274,16 +276,31 @@ static inline int get_futex_value_locked(int *dest, int __user *from)
  * The hash bucket lock must be held when this is called.
  * Afterwards, the futex_q must not be accessed.
  */
-static void wake_futex(struct futex_q *q)
+static void wake_futex(struct futex_q *q, struct wake_batch *wb)
 {
 	list_del_init(&q->list);
 	if (q->filp)
 		send_sigio(&q->filp->f_owner, q->fd, POLL_IN);
 	/*
-	 * The lock in wake_up_all() is a crucial memory barrier after the
+	 * The lock of q->waiters is a crucial memory barrier after the
 	 * list_del_init() and also before assigning to q->lock_ptr.
+	 *
+	 * A task in futex_wait() is queued on wb, which holds a reference
+	 * to it: the caller wakes it after dropping the hash bucket lock,
+	 * together with the other waiters it woke.  Poll waiters of a
+	 * futex fd are woken right here.
 	 */
-	wake_up_all(&q->waiters);
+	if (q->filp)
+		wake_up_all(&q->waiters);
+	else {
+		wait_queue_t *curr;
+		unsigned long flags;
+
+		spin_lock_irqsave(&q->waiters.lock, flags);
+		list_for_each_entry(curr, &q->waiters.task_list, task_list)
+			wake_batch_add_task(wb, curr->task);
+		spin_unlock_irqrestore(&q->waiters.lock, flags);
+	}
 	/*
 	 * The waiting task can free the futex_q as soon as this is written,
 	 * without taking any locks.  This must come last.
@@ -301,6 +318,7 @@ static int futex_wake(unsigned long uaddr, int nr_wake)
 	struct futex_hash_bucket *bh;
 	struct list_head *head;
 	struct futex_q *this, *next;
+	struct wake_batch wb;
 	int ret;
 
 	down_read(&current->mm->mmap_sem);
@@ -310,18 +328,20 @@ static int futex_wake(unsigned long uaddr, int nr_wake)
 		goto out;
 
 	bh = hash_futex(&key);
+	wake_batch_init(&wb);
 	spin_lock(&bh->lock);
 	head = &bh->chain;
 
 	list_for_each_entry_safe(this, next, head, list) {
 		if (match_futex (&this->key, &key)) {
-			wake_futex(this);
+			wake_futex(this, &wb);
 			if (++ret >= nr_wake)
 				break;
 		}
 	}
 
 	spin_unlock(&bh->lock);
+	wake_up_batch(&wb);
 out:
 	up_read(&current->mm->mmap_sem);
 	return ret;
@@ -338,6 +358,7 @@ static int futex_requeue(unsigned long uaddr1, unsigned long uaddr2,
 	struct futex_hash_bucket *bh1, *bh2;
 	struct list_head *head1;
 	struct futex_q *this, *next;
+	struct wake_batch wb;
 	int ret, drop_count = 0;
 	unsigned int nqueued;
 
@@ -389,6 +410,7 @@ static int futex_requeue(unsigned long uaddr1, unsigned long uaddr2,
 		}
 	}
 
+	wake_batch_init(&wb);
 	if (bh1 < bh2)
 		spin_lock(&bh1->lock);
 	spin_lock(&bh2->lock);
@@ -405,7 +427,7 @@ static int futex_requeue(unsigned long uaddr1, unsigned long uaddr2,
 		if (!match_futex (&this->key, &key1))
 			continue;
 		if (++ret <= nr_wake) {
-			wake_futex(this);
+			wake_futex(this, &wb);
 		} else {
 			list_move_tail(&this->list, &bh2->chain);
 			this->lock_ptr = &bh2->lock;
@@ -425,6 +447,7 @@ out_unlock:
 	spin_unlock(&bh1->lock);
 	if (bh1 != bh2)
 		spin_unlock(&bh2->lock);
+	wake_up_batch(&wb);
 
 	/* drop_key_refs() must be called outside the spinlocks. */
 	while (--drop_count >= 0)
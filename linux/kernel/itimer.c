@@ -11,28 +11,42 @@
 #include <linux/interrupt.h>
 #include <linux/syscalls.h>
 #include <linux/time.h>
+#include <linux/hrtimer.h>
 
 #include <asm/uaccess.h>
 
-int do_getitimer(int which, struct itimerval *value)
+/**
+ * itimer_get_remtime - get remaining time for the timer
+ *
+ * @timer: the timer to read
+ *
+ * Returns the delta between the expiry time and now, which can be
+ * less than zero or 1usec for an pending expired timer
+ */
+static struct timeval itimer_get_remtime(struct hrtimer *timer)
 {
-	register unsigned long val;
+	ktime_t rem = hrtimer_get_remaining(timer);
+
+	/*
+	 * Racy but safe: if the itimer expires after the above
+	 * hrtimer_get_remaining() call but before this condition
+	 * then we return 0 - which is correct.
+	 */
+	if (hrtimer_active(timer)) {
+		if (rem.tv64 <= 0)
+			rem.tv64 = NSEC_PER_USEC;
+	} else
+		rem.tv64 = 0;
 
+	return ktime_to_timeval(rem);
+}
+
+int do_getitimer(int which, struct itimerval *value)
+{
 	switch (which) {
 	case ITIMER_REAL:
-		val = 0;
-		/* 
-		 * FIXME! This needs to be atomic, in case the kernel timer happens!
-		 */
-		if (timer_pending(&current->real_timer)) {
-			val = current->real_timer.expires - jiffies;
-
-			/* look out for negative/zero itimer.. */
-			if ((long) val <= 0)
-				val = 1;
-		}
-		jiffies_to_timeval(val, &value->it_value);
-		jiffies_to_timeval(current->it_real_incr, &value->it_interval);
+		value->it_value = itimer_get_remtime(&current->real_timer);
+		value->it_interval = ktime_to_timeval(current->it_real_incr);
 		break;
 	case ITIMER_VIRTUAL:
 		cputime_to_timeval(current->it_virt_value, &value->it_value);
@@ -64,27 +78,30 @@ asmlinkage long sys_getitimer(int which, struct itimerval __user *value)
 }
 
 /**
- * صĶ̬ʱû̬һITEMER_REAL͵ļʱ
+ * صĸ߾ȶʱû̬һITEMER_REAL͵ļʱ
  * ôʱû̷̬źš
  */
-void it_real_fn(unsigned long __data)
+int it_real_fn(struct hrtimer *timer)
 {
-	struct task_struct * p = (struct task_struct *) __data;
-	unsigned long interval;
+	struct task_struct *p =
+		container_of(timer, struct task_struct, real_timer);
 
 	send_group_sig_info(SIGALRM, SEND_SIG_PRIV, p);
-	interval = p->it_real_incr;
-	if (interval) {
-		if (interval > (unsigned long) LONG_MAX)
-			interval = LONG_MAX;
-		p->real_timer.expires = jiffies + interval;
-		add_timer(&p->real_timer);
+
+	/**
+	 * ڶʱϴεʱƽۻ
+	 */
+	if (p->it_real_incr.tv64 != 0) {
+		hrtimer_forward(timer, p->it_real_incr);
+		return HRTIMER_RESTART;
 	}
+	return HRTIMER_NORESTART;
 }
 
 int do_setitimer(int which, struct itimerval *value, struct itimerval *ovalue)
 {
-	unsigned long expire;
+	struct hrtimer *timer;
+	ktime_t expires;
 	cputime_t cputime;
 	int k;
 
@@ -92,17 +109,13 @@ int do_setitimer(int which, struct itimerval *value, struct itimerval *ovalue)
 		return k;
 	switch (which) {
 		case ITIMER_REAL:
-			del_timer_sync(&current->real_timer);
-			expire = timeval_to_jiffies(&value->it_value);
-			current->it_real_value = expire;
-			current->it_real_incr =
-				timeval_to_jiffies(&value->it_interval);
-			if (!expire)
-				break;
-			if (expire > (unsigned long) LONG_MAX)
-				expire = LONG_MAX;
-			current->real_timer.expires = jiffies + expire;
-			add_timer(&current->real_timer);
+			timer = &current->real_timer;
+			hrtimer_cancel(timer);
+			current->it_real_value = timeval_to_jiffies(&value->it_value);
+			current->it_real_incr = timeval_to_ktime(value->it_interval);
+			expires = timeval_to_ktime(value->it_value);
+			if (expires.tv64 != 0)
+				hrtimer_start(timer, expires, HRTIMER_REL);
 			break;
 		case ITIMER_VIRTUAL:
 			cputime = timeval_to_cputime(&value->it_value);
@@ -0,0 +1,132 @@
+/*
+ * kernel/rcubench.c
+ * Measure the latency of normal and expedited RCU grace periods.
+ *
+ * Loading the module runs nruns synchronize_kernel() and nruns
+ * synchronize_kernel_expedited() calls back to back and prints
+ * min/avg/max in microseconds.  nreaders kernel threads keep the
+ * other cpus busy inside rcu_read_lock() meanwhile, so that the
+ * numbers are not just those of an idle machine.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <linux/config.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/slab.h>
+#include <linux/rcupdate.h>
+#include <linux/hrtimer.h>
+#include <asm/div64.h>
+
+static int nruns = 100;		/* grace periods per flavour */
+static int nreaders = 0;	/* busy reader threads, 0: one per other cpu */
+static int readdelay = 5;	/* usecs spent in each read-side section */
+module_param(nruns, int, 0);
+module_param(nreaders, int, 0);
+module_param(readdelay, int, 0);
+MODULE_PARM_DESC(nruns, "Number of grace periods to time per flavour");
+MODULE_PARM_DESC(nreaders, "Number of busy RCU reader threads");
+MODULE_PARM_DESC(readdelay, "Microseconds spent in each read-side section");
+
+static task_t **readers;
+
+static int rcubench_reader(void *unused)
+{
+	set_user_nice(current, 19);
+	while (!kthread_should_stop()) {
+		rcu_read_lock();
+		udelay(readdelay);
+		rcu_read_unlock();
+		cond_resched();
+	}
+	return 0;
+}
+
+static void rcubench_run(const char *name, void (*sync)(void))
+{
+	u64 min = ~0ULL, max = 0, total = 0, delta;
+	ktime_t start;
+	int i;
+
+	for (i = 0; i < nruns; i++) {
+		start = ktime_get();
+		sync();
+		delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (delta < min)
+			min = delta;
+		if (delta > max)
+			max = delta;
+		total += delta;
+	}
+	do_div(total, nruns);
+	do_div(min, 1000);
+	do_div(max, 1000);
+	do_div(total, 1000);
+	printk(KERN_INFO "rcubench: %-10s %d runs, usecs min %llu avg %llu "
+	       "max %llu\n", name, nruns, (unsigned long long)min,
+	       (unsigned long long)total, (unsigned long long)max);
+}
+
+static void rcubench_stop_readers(void)
+{
+	int i;
+
+	if (!readers)
+		return;
+	for (i = 0; i < nreaders; i++)
+		if (readers[i])
+			kthread_stop(readers[i]);
+	kfree(readers);
+	readers = NULL;
+}
+
+static int __init rcubench_init(void)
+{
+	int i;
+
+	if (nruns <= 0)
+		return -EINVAL;
+	if (nreaders <= 0)
+		nreaders = num_online_cpus() - 1;
+
+	if (nreaders) {
+		readers = kmalloc(nreaders * sizeof(task_t *), GFP_KERNEL);
+		if (!readers)
+			return -ENOMEM;
+		memset(readers, 0, nreaders * sizeof(task_t *));
+		for (i = 0; i < nreaders; i++) {
+			readers[i] = kthread_run(rcubench_reader, NULL,
+						 "rcubench/%d", i);
+			if (IS_ERR(readers[i])) {
+				readers[i] = NULL;
+				rcubench_stop_readers();
+				return -ENOMEM;
+			}
+		}
+	}
+
+	printk(KERN_INFO "rcubench: %d cpus online, %d readers\n",
+	       num_online_cpus(), nreaders);
+	rcubench_run("normal", synchronize_kernel);
+	rcubench_run("expedited", synchronize_kernel_expedited);
+
+	rcubench_stop_readers();
+	return 0;
+}
+
+static void __exit rcubench_exit(void)
+{
+}
+
+module_init(rcubench_init);
+module_exit(rcubench_exit);
+MODULE_LICENSE("GPL");
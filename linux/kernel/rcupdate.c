@@ -53,24 +53,68 @@ struct rcu_ctrlblk rcu_ctrlblk =
 struct rcu_ctrlblk rcu_bh_ctrlblk =
 	{ .cur = -300, .completed = -300 };
 
+/*
+ * The cpus that still have to pass through a quiescent state are
+ * tracked in a tree of rcu_nodes, so that they do not all hammer one
+ * lock and one cpumask.  A leaf covers RCU_FANOUT cpus, an inner node
+ * RCU_FANOUT children.  A cpu clears its bit in its leaf; the last one
+ * to do so clears the leaf's bit in its parent, and so on up to the
+ * root, whose lock also guards writes to rcu_ctrlblk.
+ */
+#define RCU_FANOUT	16
+#define RCU_MAX_LVLS	3
+#define RCU_DIV(n)	(((n) + RCU_FANOUT - 1) / RCU_FANOUT)
+#define NUM_RCU_NODES	(RCU_DIV(NR_CPUS) + RCU_DIV(RCU_DIV(NR_CPUS)) + 1)
+
+#if NR_CPUS > RCU_FANOUT * RCU_FANOUT * RCU_FANOUT
+#error "NR_CPUS too large for RCU_MAX_LVLS levels of rcu_nodes"
+#endif
+
+struct rcu_node {
+	spinlock_t	lock;
+	long		gpnum;	 /* grace period the masks belong to */
+	unsigned long	qsmask;	 /* children that still need to report */
+	unsigned long	grpmask; /* our bit in the parent's qsmask */
+	int		grplo;	 /* lowest cpu covered by this node */
+	int		grphi;	 /* highest cpu covered by this node */
+	struct rcu_node	*parent;
+	struct rcu_node	*child;	 /* first child, NULL for a leaf */
+	int		nchild;
+} ____cacheline_maxaligned_in_smp;
+
 /* Bookkeeping of the progress of the grace period */
+/**
+ * ¼ڽչrcu_nodelevel[0]Ǹڵ㣬level[levels-1]Ҷӽڵ㡣
+ */
 struct rcu_state {
-	spinlock_t	lock; /* Guard this struct and writes to rcu_ctrlblk */
-	cpumask_t	cpumask; /* CPUs that need to switch in order    */
-	                              /* for current batch to proceed.        */
+	struct rcu_node	node[NUM_RCU_NODES];
+	struct rcu_node	*level[RCU_MAX_LVLS];
+	int		levelcnt[RCU_MAX_LVLS];
+	int		levels;
 };
 
-static struct rcu_state rcu_state ____cacheline_maxaligned_in_smp =
-	  {.lock = SPIN_LOCK_UNLOCKED, .cpumask = CPU_MASK_NONE };
-static struct rcu_state rcu_bh_state ____cacheline_maxaligned_in_smp =
-	  {.lock = SPIN_LOCK_UNLOCKED, .cpumask = CPU_MASK_NONE };
+static struct rcu_state rcu_state;
+static struct rcu_state rcu_bh_state;
+
+/* The root lock guards the rcu_ctrlblk and the start of a grace period. */
+static inline spinlock_t *rcu_root_lock(struct rcu_state *rsp)
+{
+	return &rsp->level[0]->lock;
+}
 
 DEFINE_PER_CPU(struct rcu_data, rcu_data) = { 0L };
 DEFINE_PER_CPU(struct rcu_data, rcu_bh_data) = { 0L };
 
 /* Fake initialization required by compiler */
 static DEFINE_PER_CPU(struct tasklet_struct, rcu_tasklet) = {NULL};
+/*
+ * Callbacks are invoked maxbatch at a time, to bound the time spent
+ * in the tasklet.  When more than qhimark are queued on a cpu the
+ * limit is lifted, until the queue is down to qlowmark again.
+ */
 static int maxbatch = 10;
+static int qhimark = 10000;
+static int qlowmark = 100;
 
 /**
  * call_rcu - Queue an RCU callback for invocation after a grace period.
@@ -104,6 +148,8 @@ void fastcall call_rcu(struct rcu_head *head,
 	rdp = &__get_cpu_var(rcu_data);
 	*rdp->nxttail = head;
 	rdp->nxttail = &head->next;
+	if (unlikely(++rdp->qlen > qhimark))
+		rdp->blimit = LONG_MAX;
 	local_irq_restore(flags);
 }
 
@@ -135,6 +181,8 @@ void fastcall call_rcu_bh(struct rcu_head *head,
 	rdp = &__get_cpu_var(rcu_bh_data);
 	*rdp->nxttail = head;
 	rdp->nxttail = &head->next;
+	if (unlikely(++rdp->qlen > qhimark))
+		rdp->blimit = LONG_MAX;
 	local_irq_restore(flags);
 }
 
@@ -152,9 +200,16 @@ static void rcu_do_batch(struct rcu_data *rdp)
 		next = rdp->donelist = list->next;
 		list->func(list);
 		list = next;
-		if (++count >= maxbatch)
+		if (++count >= rdp->blimit)
 			break;
 	}
+
+	local_irq_disable();
+	rdp->qlen -= count;
+	local_irq_enable();
+	if (rdp->blimit == LONG_MAX && rdp->qlen <= qlowmark)
+		rdp->blimit = maxbatch;
+
 	if (!rdp->donelist)
 		rdp->donetail = &rdp->donelist;
 	else
@@ -168,21 +223,61 @@ static void rcu_do_batch(struct rcu_data *rdp)
  *   This is done by rcu_start_batch. The start is not broadcasted to
  *   all cpus, they must pick this up by comparing rcp->cur with
  *   rdp->quiescbatch. All cpus are recorded  in the
- *   rcu_state.cpumask bitmap.
+ *   leaves of the rcu_state tree, and every node with a cpu below it in
+ *   its parent.
  * - All cpus must go through a quiescent state.
  *   Since the start of the grace period is not broadcasted, at least two
  *   calls to rcu_check_quiescent_state are required:
  *   The first call just notices that a new grace period is running. The
  *   following calls check if there was a quiescent state since the beginning
- *   of the grace period. If so, it updates rcu_state.cpumask. If
- *   the bitmap is empty, then the grace period is completed.
+ *   of the grace period. If so, it clears the cpu in its leaf, and the
+ *   leaf in its parent if it was the last one, and so on.  If the root
+ *   becomes empty, then the grace period is completed.
  *   rcu_check_quiescent_state calls rcu_start_batch(0) to start the next grace
  *   period (if necessary).
  */
+/*
+ * Set up the masks of every node for grace period @gpnum, leaves first
+ * so that each parent only waits for children with a cpu to wait for.
+ * The node's gpnum is set along with its mask, under its lock: a late
+ * report for the previous grace period is then simply ignored.
+ * Caller holds the root lock.
+ */
+static void rcu_init_qsmasks(struct rcu_state *rsp, cpumask_t *active,
+				long gpnum)
+{
+	struct rcu_node *rnp, *child;
+	unsigned long mask;
+	int lvl, cpu, i;
+
+	for (lvl = rsp->levels - 1; lvl >= 0; lvl--) {
+		for (rnp = rsp->level[lvl];
+		     rnp < rsp->level[lvl] + rsp->levelcnt[lvl]; rnp++) {
+			mask = 0;
+			if (!rnp->child) {
+				for (cpu = rnp->grplo; cpu <= rnp->grphi; cpu++)
+					if (cpu_isset(cpu, *active))
+						mask |= 1UL << (cpu - rnp->grplo);
+			} else {
+				child = rnp->child;
+				for (i = 0; i < rnp->nchild; i++, child++)
+					if (child->qsmask)
+						mask |= child->grpmask;
+			}
+			if (rnp->parent)
+				spin_lock(&rnp->lock);
+			rnp->qsmask = mask;
+			rnp->gpnum = gpnum;
+			if (rnp->parent)
+				spin_unlock(&rnp->lock);
+		}
+	}
+}
+
 /*
  * Register a new batch of callbacks, and start it up if there is currently no
  * active batch and the batch to be registered has not already occurred.
- * Caller must hold rcu_state.lock.
+ * Caller must hold the root lock.
  */
 static void rcu_start_batch(struct rcu_ctrlblk *rcp, struct rcu_state *rsp,
 				int next_pending)
@@ -192,8 +287,10 @@ static void rcu_start_batch(struct rcu_ctrlblk *rcp, struct rcu_state *rsp,
 
 	if (rcp->next_pending &&
 			rcp->completed == rcp->cur) {
-		/* Can't change, since spin lock held. */
-		cpus_andnot(rsp->cpumask, cpu_online_map, nohz_cpu_mask);
+		cpumask_t active;
+
+		cpus_andnot(active, cpu_online_map, nohz_cpu_mask);
+		rcu_init_qsmasks(rsp, &active, rcp->cur + 1);
 
 		rcp->next_pending = 0;
 		/* next_pending == 0 must be visible in __rcu_process_callbacks()
@@ -201,22 +298,59 @@ static void rcu_start_batch(struct rcu_ctrlblk *rcp, struct rcu_state *rsp,
 		 */
 		smp_wmb();
 		rcp->cur++;
+
+		/*
+		 * Every online cpu was in nohz_cpu_mask: nobody is left to
+		 * report a quiescent state, and the root would never empty.
+		 * Those cpus are idle, so the grace period is over already.
+		 * next_pending was consumed above, so nothing else is due.
+		 */
+		if (!rsp->level[0]->qsmask)
+			rcp->completed = rcp->cur;
 	}
 }
 
 /*
- * cpu went through a quiescent state since the beginning of the grace period.
- * Clear it from the cpu mask and complete the grace period if it was the last
- * cpu. Start another grace period if someone has further entries pending
+ * cpu went through a quiescent state since the beginning of grace period
+ * @batch.  Clear it from its leaf, walking up while a node empties, and
+ * complete the grace period if the root empties.  Start another grace
+ * period if someone has further entries pending.  Only one node lock is
+ * held at a time; called with bottom halves disabled.
+ */
+/**
+ * 汾CPU˾ֹ״ֻ̬һӽڵŻϻȡڵ
  */
-static void cpu_quiet(int cpu, struct rcu_ctrlblk *rcp, struct rcu_state *rsp)
+static void cpu_quiet(struct rcu_data *rdp, struct rcu_ctrlblk *rcp,
+			struct rcu_state *rsp, long batch)
 {
-	cpu_clear(cpu, rsp->cpumask);
-	if (cpus_empty(rsp->cpumask)) {
+	struct rcu_node *rnp = rdp->mynode;
+	unsigned long mask = rdp->grpmask;
+
+	for (;;) {
+		spin_lock(&rnp->lock);
+		/*
+		 * The masks can belong to another grace period during cpu
+		 * startup, or the cpu was already reported by the hotplug
+		 * code.  Ignore the quiescent state.
+		 */
+		if (rnp->gpnum != batch || !(rnp->qsmask & mask)) {
+			spin_unlock(&rnp->lock);
+			return;
+		}
+		rnp->qsmask &= ~mask;
+		if (rnp->qsmask || !rnp->parent)
+			break;
+		mask = rnp->grpmask;
+		spin_unlock(&rnp->lock);
+		rnp = rnp->parent;
+	}
+
+	if (!rnp->parent && !rnp->qsmask) {
 		/* batch completed ! */
 		rcp->completed = rcp->cur;
 		rcu_start_batch(rcp, rsp, 0);
 	}
+	spin_unlock(&rnp->lock);
 }
 
 /*
@@ -250,15 +384,7 @@ static void rcu_check_quiescent_state(struct rcu_ctrlblk *rcp,
 		return;
 	rdp->qs_pending = 0;
 
-	spin_lock(&rsp->lock);
-	/*
-	 * rdp->quiescbatch/rcp->cur and the cpu bitmap can come out of sync
-	 * during cpu startup. Ignore the quiescent state.
-	 */
-	if (likely(rdp->quiescbatch == rcp->cur))
-		cpu_quiet(rdp->cpu, rcp, rsp);
-
-	spin_unlock(&rsp->lock);
+	cpu_quiet(rdp, rcp, rsp, rdp->quiescbatch);
 }
 
 
@@ -269,12 +395,13 @@ static void rcu_check_quiescent_state(struct rcu_ctrlblk *rcp,
  * which is dead and hence not processing interrupts.
  */
 static void rcu_move_batch(struct rcu_data *this_rdp, struct rcu_head *list,
-				struct rcu_head **tail)
+				struct rcu_head **tail, long qlen)
 {
 	local_irq_disable();
 	*this_rdp->nxttail = list;
 	if (list)
 		this_rdp->nxttail = tail;
+	this_rdp->qlen += qlen;
 	local_irq_enable();
 }
 
@@ -285,12 +412,13 @@ static void __rcu_offline_cpu(struct rcu_data *this_rdp,
 	 * we can block indefinitely waiting for it, so flush
 	 * it here
 	 */
-	spin_lock_bh(&rsp->lock);
+	local_bh_disable();
 	if (rcp->cur != rcp->completed)
-		cpu_quiet(rdp->cpu, rcp, rsp);
-	spin_unlock_bh(&rsp->lock);
-	rcu_move_batch(this_rdp, rdp->curlist, rdp->curtail);
-	rcu_move_batch(this_rdp, rdp->nxtlist, rdp->nxttail);
+		cpu_quiet(rdp, rcp, rsp, rcp->cur);
+	local_bh_enable();
+	rcu_move_batch(this_rdp, rdp->donelist, rdp->donetail, 0);
+	rcu_move_batch(this_rdp, rdp->curlist, rdp->curtail, 0);
+	rcu_move_batch(this_rdp, rdp->nxtlist, rdp->nxttail, rdp->qlen);
 
 }
 static void rcu_offline_cpu(int cpu)
@@ -349,9 +477,9 @@ static void __rcu_process_callbacks(struct rcu_ctrlblk *rcp,
 
 		if (!rcp->next_pending) {
 			/* and start it/schedule start if it's a new batch */
-			spin_lock(&rsp->lock);
+			spin_lock(rcu_root_lock(rsp));
 			rcu_start_batch(rcp, rsp, 1);
-			spin_unlock(&rsp->lock);
+			spin_unlock(rcu_root_lock(rsp));
 		}
 	} else {
 		local_irq_enable();
@@ -382,7 +510,7 @@ void rcu_check_callbacks(int cpu, int user)
 }
 
 static void rcu_init_percpu_data(int cpu, struct rcu_ctrlblk *rcp,
-						struct rcu_data *rdp)
+				struct rcu_state *rsp, struct rcu_data *rdp)
 {
 	memset(rdp, 0, sizeof(*rdp));
 	rdp->curtail = &rdp->curlist;
@@ -390,6 +518,9 @@ static void rcu_init_percpu_data(int cpu, struct rcu_ctrlblk *rcp,
 	rdp->donetail = &rdp->donelist;
 	rdp->quiescbatch = rcp->completed;
 	rdp->qs_pending = 0;
+	rdp->mynode = rsp->level[rsp->levels - 1] + cpu / RCU_FANOUT;
+	rdp->grpmask = 1UL << (cpu % RCU_FANOUT);
+	rdp->blimit = maxbatch;
 	rdp->cpu = cpu;
 }
 
@@ -398,8 +529,8 @@ static void __devinit rcu_online_cpu(int cpu)
 	struct rcu_data *rdp = &per_cpu(rcu_data, cpu);
 	struct rcu_data *bh_rdp = &per_cpu(rcu_bh_data, cpu);
 
-	rcu_init_percpu_data(cpu, &rcu_ctrlblk, rdp);
-	rcu_init_percpu_data(cpu, &rcu_bh_ctrlblk, bh_rdp);
+	rcu_init_percpu_data(cpu, &rcu_ctrlblk, &rcu_state, rdp);
+	rcu_init_percpu_data(cpu, &rcu_bh_ctrlblk, &rcu_bh_state, bh_rdp);
 	tasklet_init(&per_cpu(rcu_tasklet, cpu), rcu_process_callbacks, 0UL);
 }
 
@@ -424,6 +555,58 @@ static struct notifier_block __devinitdata rcu_nb = {
 	.notifier_call	= rcu_cpu_notify,
 };
 
+/*
+ * Lay out the rcu_node tree: just enough levels of RCU_FANOUT to cover
+ * NR_CPUS, root first.  With up to RCU_FANOUT cpus the root is the only
+ * leaf and everything stays under one lock, as it always was.
+ */
+static void __init rcu_init_tree(struct rcu_ctrlblk *rcp, struct rcu_state *rsp)
+{
+	int cnt[RCU_MAX_LVLS];
+	int nlvls, lvl, span, i;
+	struct rcu_node *rnp;
+
+	/* cnt[] counts nodes per level from the root down */
+	nlvls = 1;
+	for (span = RCU_FANOUT; span < NR_CPUS; span *= RCU_FANOUT)
+		nlvls++;
+	for (lvl = nlvls - 1, span = RCU_FANOUT; lvl >= 0;
+	     lvl--, span *= RCU_FANOUT)
+		cnt[lvl] = (NR_CPUS + span - 1) / span;
+
+	rnp = rsp->node;
+	for (lvl = 0; lvl < nlvls; lvl++) {
+		rsp->level[lvl] = rnp;
+		rsp->levelcnt[lvl] = cnt[lvl];
+		rnp += cnt[lvl];
+	}
+	rsp->levels = nlvls;
+
+	/* span is the number of cpus covered by one node of the level */
+	for (lvl = 0, span = 1; lvl < nlvls; lvl++)
+		span *= RCU_FANOUT;
+	for (lvl = 0; lvl < nlvls; lvl++, span /= RCU_FANOUT) {
+		for (i = 0; i < cnt[lvl]; i++) {
+			rnp = rsp->level[lvl] + i;
+			spin_lock_init(&rnp->lock);
+			rnp->gpnum = rcp->completed;
+			rnp->qsmask = 0;
+			rnp->grplo = i * span;
+			rnp->grphi = min(NR_CPUS, (i + 1) * span) - 1;
+			rnp->grpmask = 1UL << (i % RCU_FANOUT);
+			rnp->parent = lvl ? rsp->level[lvl - 1] + i / RCU_FANOUT : NULL;
+			if (lvl < nlvls - 1) {
+				rnp->child = rsp->level[lvl + 1] + i * RCU_FANOUT;
+				rnp->nchild = min(RCU_FANOUT,
+					cnt[lvl + 1] - i * RCU_FANOUT);
+			} else {
+				rnp->child = NULL;
+				rnp->nchild = 0;
+			}
+		}
+	}
+}
+
 /*
  * Initializes rcu mechanism.  Assumed to be called early.
  * That is before local timer(SMP) or jiffie timer (uniproc) is setup.
@@ -432,6 +615,8 @@ static struct notifier_block __devinitdata rcu_nb = {
  */
 void __init rcu_init(void)
 {
+	rcu_init_tree(&rcu_ctrlblk, &rcu_state);
+	rcu_init_tree(&rcu_bh_ctrlblk, &rcu_bh_state);
 	rcu_cpu_notify(&rcu_nb, CPU_UP_PREPARE,
 			(void *)(long)smp_processor_id());
 	/* Register notifier for non-boot CPUs */
@@ -473,7 +658,81 @@ void synchronize_kernel(void)
 	wait_for_completion(&rcu.completion);
 }
 
+/*
+ * Expedited grace periods.  Instead of waiting for every cpu to pass
+ * through a quiescent state on its own (several ticks at best), the
+ * other cpus are IPIed: an idle cpu reports at once, a busy one is
+ * forced through schedule() and reports from rcu_qsctr_inc().  The
+ * normal grace period machinery is not involved at all.
+ */
+atomic_t rcu_expedite_pending = ATOMIC_INIT(0);
+static DECLARE_MUTEX(rcu_expedite_sem);
+
+static void rcu_expedite_ipi(void *unused)
+{
+	int cpu = smp_processor_id();
+
+	/*
+	 * Same test as rcu_check_callbacks(): the idle loop outside of
+	 * softirq context holds no rcu read lock.
+	 */
+	if (idle_cpu(cpu) && !in_softirq() &&
+				hardirq_count() <= (1 << HARDIRQ_SHIFT)) {
+		smp_mb__before_atomic_dec();
+		atomic_dec(&rcu_expedite_pending);
+		return;
+	}
+	per_cpu(rcu_data, cpu).expedite = 1;
+	set_need_resched();
+}
+
+/**
+ * synchronize_kernel_expedited - wait for a grace period, quickly.
+ *
+ * Same guarantee as synchronize_kernel(), but the other cpus are
+ * kicked into a quiescent state with an IPI, so the caller usually
+ * returns within microseconds.  This disturbs every online cpu; use
+ * it only on paths where an updater's latency matters (unregistering
+ * hooks, unloading modules) and not for bulk freeing.
+ */
+void synchronize_kernel_expedited(void)
+{
+	unsigned long start;
+
+	might_sleep();
+	if (num_online_cpus() == 1)
+		return;
+
+	down(&rcu_expedite_sem);
+	lock_cpu_hotplug();
+
+	/* Order the caller's updates before the readers' quiescent states. */
+	smp_mb();
+	preempt_disable();
+	atomic_set(&rcu_expedite_pending, num_online_cpus() - 1);
+	smp_call_function(rcu_expedite_ipi, NULL, 0, 0);
+	preempt_enable();
+
+	/* Spin for at most a tick, then give the cpu up a tick at a time. */
+	start = jiffies;
+	while (atomic_read(&rcu_expedite_pending) > 0) {
+		if (jiffies == start) {
+			cpu_relax();
+			continue;
+		}
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_timeout(1);
+	}
+	smp_mb();
+
+	unlock_cpu_hotplug();
+	up(&rcu_expedite_sem);
+}
+
 module_param(maxbatch, int, 0);
+module_param(qhimark, int, 0);
+module_param(qlowmark, int, 0);
 EXPORT_SYMBOL(call_rcu);
 EXPORT_SYMBOL(call_rcu_bh);
 EXPORT_SYMBOL(synchronize_kernel);
+EXPORT_SYMBOL_GPL(synchronize_kernel_expedited);
@@ -42,10 +42,13 @@
 #include <linux/cpu.h>
 #include <linux/percpu.h>
 #include <linux/kthread.h>
+#include <linux/workqueue.h>
 #include <linux/seq_file.h>
 #include <linux/syscalls.h>
 #include <linux/times.h>
+#include <linux/vmalloc.h>
 #include <asm/tlb.h>
+#include <asm/div64.h>
 
 #include <asm/unistd.h>
 
@@ -153,7 +156,8 @@
 		(MAX_BONUS / 2 + DELTA((p)) + 1) / MAX_BONUS - 1))
 
 #define TASK_PREEMPTS_CURR(p, rq) \
-	((p)->prio < (rq)->curr->prio)
+	((fair_task(p) || fair_task((rq)->curr)) ? \
+		fair_preempts_curr((p), (rq)) : ((p)->prio < (rq)->curr->prio))
 
 /*
  * task_timeslice() scales user-nice values [ -20 ... 0 ... 19 ]
@@ -177,6 +181,18 @@ static unsigned int task_timeslice(task_t *p)
 #define task_hot(p, now, sd) ((long long) ((now) - (p)->last_ran)	\
 				< (long long) (sd)->cache_hot_time)
 
+/*
+ * SCHED_FAIR tunables, in nanoseconds. Every runnable fair task gets to
+ * run once per sysctl_sched_fair_latency, but never for less than
+ * sysctl_sched_fair_min_granularity at a time: with many runnable tasks
+ * the period stretches to nr_running * min_granularity instead.
+ */
+int sysctl_sched_fair_latency = 20000000;
+int sysctl_sched_fair_min_granularity = 4000000;
+
+#define SCHED_FAIR_WAKEUP_GRANULARITY \
+	((long long)sysctl_sched_fair_min_granularity / 2)
+
 /*
  * These are the runqueue data structures:
  */
@@ -185,6 +201,52 @@ static unsigned int task_timeslice(task_t *p)
 
 typedef struct runqueue runqueue_t;
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * Latency histograms: bucket 0 counts samples below 2^SCHED_HIST_SHIFT ns,
+ * bucket n samples in [2^(n-1+SCHED_HIST_SHIFT), 2^(n+SCHED_HIST_SHIFT)) ns
+ * and the last bucket everything longer.
+ */
+#define SCHED_HIST_BUCKETS	24
+#define SCHED_HIST_SHIFT	10
+
+enum sched_hist_type {
+	SCHED_HIST_WAKEUP,	/* wakeup to first run */
+	SCHED_HIST_SLICE,	/* length of each stint on the cpu */
+	SCHED_HIST_MOVE_TASKS,	/* move_tasks() latency, when it moved any */
+	SCHED_HIST_MIGRATE_MOVE, /* per moved task: time to pull it over */
+	SCHED_HIST_MIGRATE_REFILL, /* per cache-hot moved task: refill cost */
+	MAX_SCHED_HIST
+};
+#endif
+
+/**
+ * SCHED_FAIR̵жСÿCPUжаһ
+ */
+struct fair_rq {
+	/**
+	 * vruntimeĿSCHED_FAIR(еĽ)
+	 */
+	struct rb_root tasks;
+	/**
+	 * vruntimeСĽڵ㣬һҪеĽ̡
+	 */
+	struct rb_node *leftmost;
+	/**
+	 * н̵niceȨ֮͡
+	 */
+	unsigned long nr_running;
+	unsigned long load;
+	/**
+	 * Сvruntime̳ʱvruntimeתΪֵ
+	 */
+	unsigned long long min_vruntime;
+	/**
+	 * SCHED_FAIRʱӣrunqueue->normal_clockȽϾһС
+	 */
+	unsigned long long clock;
+};
+
 /**
  * ȼ顣ÿCPUӦһ˽ṹ
  */
@@ -281,6 +343,19 @@ struct runqueue {
 	 */
 	atomic_t nr_iowait;
 
+	/**
+	 * SCHED_FAIR̵жС
+	 */
+	struct fair_rq fair;
+	/**
+	 * ȼзʵʱʱӡ
+	 */
+	unsigned long long normal_clock;
+	/**
+	 * ǰ̵ʱӺʱʼ(sched_clock)
+	 */
+	unsigned long long exec_start;
+
 #ifdef CONFIG_SMP
 	/**
 	 * ǰCPUĻ
@@ -339,6 +414,10 @@ struct runqueue {
 	unsigned long ttwu_attempts;
 	unsigned long ttwu_moved;
 
+	/* batched wakeup stats */
+	unsigned long wb_cnt;
+	unsigned long wb_locked;
+
 	/* wake_up_new_task() stats */
 	unsigned long wunt_cnt;
 	unsigned long wunt_moved;
@@ -348,6 +427,11 @@ struct runqueue {
 
 	/* sched_balance_exec() stats */
 	unsigned long sbe_cnt;
+
+	/**
+	 * 2ݷͰӳֱͼ()ѵеӳ١ÿеʱmove_tasksĺʱ
+	 */
+	unsigned long hist[MAX_SCHED_HIST][SCHED_HIST_BUCKETS];
 #endif
 };
 
@@ -417,11 +501,19 @@ static inline void task_rq_unlock(runqueue_t *rq, unsigned long *flags)
  * bump this up when changing the output format or the meaning of an existing
  * format, so that tools can adapt (or abort)
  */
-#define SCHEDSTAT_VERSION 10
+#define SCHEDSTAT_VERSION 14
+
+static const char *sched_hist_names[MAX_SCHED_HIST] = {
+	[SCHED_HIST_WAKEUP]	= "wakeup",
+	[SCHED_HIST_SLICE]	= "slice",
+	[SCHED_HIST_MOVE_TASKS]	= "move_tasks",
+	[SCHED_HIST_MIGRATE_MOVE] = "migrate_move",
+	[SCHED_HIST_MIGRATE_REFILL] = "migrate_refill",
+};
 
 static int show_schedstat(struct seq_file *seq, void *v)
 {
-	int cpu;
+	int cpu, type, i;
 	enum idle_type itype;
 
 	seq_printf(seq, "version %d\n", SCHEDSTAT_VERSION);
@@ -451,7 +543,15 @@ static int show_schedstat(struct seq_file *seq, void *v)
 		for (itype = SCHED_IDLE; itype < MAX_IDLE_TYPES; itype++)
 			seq_printf(seq, " %lu %lu", rq->pt_gained[itype],
 						    rq->pt_lost[itype]);
-		seq_printf(seq, "\n");
+		seq_printf(seq, " %lu %lu\n", rq->wb_cnt, rq->wb_locked);
+
+		/* latency histograms */
+		for (type = 0; type < MAX_SCHED_HIST; type++) {
+			seq_printf(seq, "hist_%s", sched_hist_names[type]);
+			for (i = 0; i < SCHED_HIST_BUCKETS; i++)
+				seq_printf(seq, " %lu", rq->hist[type][i]);
+			seq_printf(seq, "\n");
+		}
 
 #ifdef CONFIG_SMP
 		/* domain-specific stats */
@@ -497,18 +597,55 @@ static int schedstat_open(struct inode *inode, struct file *file)
 	return res;
 }
 
+/*
+ * Any write to /proc/schedstat clears the latency histograms of all
+ * cpus. The other counters only ever increment.
+ */
+static ssize_t schedstat_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+	int cpu;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	for_each_online_cpu(cpu) {
+		runqueue_t *rq = cpu_rq(cpu);
+
+		spin_lock_irqsave(&rq->lock, flags);
+		memset(rq->hist, 0, sizeof(rq->hist));
+		spin_unlock_irqrestore(&rq->lock, flags);
+	}
+	return count;
+}
+
 struct file_operations proc_schedstat_operations = {
 	.open    = schedstat_open,
 	.read    = seq_read,
+	.write   = schedstat_write,
 	.llseek  = seq_lseek,
 	.release = single_release,
 };
 
+static inline void schedstat_hist(runqueue_t *rq, int type,
+				  unsigned long long ns)
+{
+	int bucket = SCHED_HIST_BUCKETS - 1;
+
+	if (!(ns >> (SCHED_HIST_SHIFT + SCHED_HIST_BUCKETS - 1)))
+		bucket = fls((unsigned int)(ns >> SCHED_HIST_SHIFT));
+	rq->hist[type][bucket]++;
+}
+
 # define schedstat_inc(rq, field)	do { (rq)->field++; } while (0)
 # define schedstat_add(rq, field, amt)	do { (rq)->field += (amt); } while (0)
+# define schedstat_clock()		sched_clock()
 #else /* !CONFIG_SCHEDSTATS */
 # define schedstat_inc(rq, field)	do { } while (0)
 # define schedstat_add(rq, field, amt)	do { } while (0)
+# define schedstat_hist(rq, type, ns)	do { (void)(ns); } while (0)
+# define schedstat_clock()		0ULL
 #endif
 
 /*
@@ -568,7 +705,7 @@ static inline void sched_info_dequeued(task_t *t)
  * long it was waiting to run.  We also note when it began so that we
  * can keep stats on how long its timeslice is.
  */
-static inline void sched_info_arrive(task_t *t)
+static inline void sched_info_arrive(task_t *t, unsigned long long clock)
 {
 	unsigned long now = jiffies, diff = 0;
 	struct runqueue *rq = task_rq(t);
@@ -578,6 +715,7 @@ static inline void sched_info_arrive(task_t *t)
 	sched_info_dequeued(t);
 	t->sched_info.run_delay += diff;
 	t->sched_info.last_arrival = now;
+	t->sched_info.last_arrival_ns = clock;
 	t->sched_info.pcnt++;
 
 	if (!rq)
@@ -585,6 +723,22 @@ static inline void sched_info_arrive(task_t *t)
 
 	rq->rq_sched_info.run_delay += diff;
 	rq->rq_sched_info.pcnt++;
+
+	if (t->sched_info.last_wakeup) {
+		if ((long long)(clock - t->sched_info.last_wakeup) >= 0)
+			schedstat_hist(rq, SCHED_HIST_WAKEUP,
+				       clock - t->sched_info.last_wakeup);
+		t->sched_info.last_wakeup = 0;
+	}
+}
+
+/*
+ * Called by try_to_wake_up() once the task is queued, ->timestamp then
+ * holds the wakeup time in the clock of the target runqueue.
+ */
+static inline void sched_info_woken(task_t *t)
+{
+	t->sched_info.last_wakeup = t->timestamp;
 }
 
 /*
@@ -612,15 +766,21 @@ static inline void sched_info_queued(task_t *t)
  * Called when a process ceases being the active-running process, either
  * voluntarily or involuntarily.  Now we can calculate how long we ran.
  */
-static inline void sched_info_depart(task_t *t)
+static inline void sched_info_depart(task_t *t, unsigned long long clock)
 {
 	struct runqueue *rq = task_rq(t);
 	unsigned long diff = jiffies - t->sched_info.last_arrival;
 
 	t->sched_info.cpu_time += diff;
 
-	if (rq)
-		rq->rq_sched_info.cpu_time += diff;
+	if (!rq)
+		return;
+
+	rq->rq_sched_info.cpu_time += diff;
+	if (t->sched_info.last_arrival_ns &&
+	    (long long)(clock - t->sched_info.last_arrival_ns) >= 0)
+		schedstat_hist(rq, SCHED_HIST_SLICE,
+			       clock - t->sched_info.last_arrival_ns);
 }
 
 /*
@@ -628,7 +788,8 @@ static inline void sched_info_depart(task_t *t)
  * their time slice.  (This may also be called when switching to or from
  * the idle task.)  We are only called when prev != next.
  */
-static inline void sched_info_switch(task_t *prev, task_t *next)
+static inline void sched_info_switch(task_t *prev, task_t *next,
+				     unsigned long long clock)
 {
 	struct runqueue *rq = task_rq(prev);
 
@@ -638,14 +799,15 @@ static inline void sched_info_switch(task_t *prev, task_t *next)
 	 * process, however.
 	 */
 	if (prev != rq->idle)
-		sched_info_depart(prev);
+		sched_info_depart(prev, clock);
 
 	if (next != rq->idle)
-		sched_info_arrive(next);
+		sched_info_arrive(next, clock);
 }
 #else
 #define sched_info_queued(t)		do { } while (0)
-#define sched_info_switch(t, next)	do { } while (0)
+#define sched_info_woken(t)		do { } while (0)
+#define sched_info_switch(t, next, clock)	do { } while (0)
 #endif /* CONFIG_SCHEDSTATS */
 
 /*
@@ -714,6 +876,11 @@ static int effective_prio(task_t *p)
 
 	if (rt_task(p))
 		return p->prio;
+	/*
+	 * The fair class does not use sleep_avg at all:
+	 */
+	if (fair_task(p))
+		return p->static_prio;
 
 	bonus = CURRENT_BONUS(p) - MAX_BONUS / 2;
 
@@ -725,12 +892,307 @@ static int effective_prio(task_t *p)
 	return prio;
 }
 
+/*
+ * SCHED_FAIR - the fair-share scheduling class.
+ *
+ * Fair tasks are not kept on the priority arrays. Each runqueue has a
+ * red-black tree of its runnable fair tasks ordered by virtual runtime:
+ * the nanoseconds a task has run, scaled by the inverse of its nice
+ * weight. The leftmost task always runs next, so there is no sleep_avg
+ * guesswork and a runnable task waits at most one scheduling period.
+ *
+ * The fair class as a whole shares the non-RT CPU time with SCHED_NORMAL
+ * tasks: each class has a virtual clock that advances by the time it ran
+ * divided by its (weighted) number of runnable tasks, and the class that
+ * is behind runs next. RT tasks preempt both.
+ */
+
+/*
+ * Queued fair tasks point ->array here, so the "p->array != NULL means
+ * queued" tests all over this file work for them unchanged. Nothing is
+ * ever linked into it.
+ */
+static prio_array_t fair_array;
+
+#define NICE_0_LOAD		1024
+#define WMULT_SHIFT		22
+
+/*
+ * Nice levels are multiplicative, with a gentle 10% change for every
+ * nice level changed: a nice 0 task vs. a nice 1 task gets ~55%/45%.
+ */
+static const int prio_to_weight[40] = {
+ /* -20 */     88761,     71755,     56483,     46273,     36291,
+ /* -15 */     29154,     23254,     18705,     14949,     11916,
+ /* -10 */      9548,      7620,      6100,      4904,      3906,
+ /*  -5 */      3121,      2501,      1991,      1586,      1277,
+ /*   0 */      1024,       820,       655,       526,       423,
+ /*   5 */       335,       272,       215,       172,       137,
+ /*  10 */       110,        87,        70,        56,        45,
+ /*  15 */        36,        29,        23,        18,        15,
+};
+
+/*
+ * 2^32 / prio_to_weight[], so that scaling by NICE_0_LOAD / weight is a
+ * multiply and a shift.
+ */
+static const u32 prio_to_wmult[40] = {
+ /* -20 */     48388,     59856,     76040,     92818,    118348,
+ /* -15 */    147320,    184698,    229616,    287308,    360437,
+ /* -10 */    449829,    563644,    704093,    875809,   1099582,
+ /*  -5 */   1376151,   1717300,   2157191,   2708050,   3363326,
+ /*   0 */   4194304,   5237765,   6557202,   8165337,  10153587,
+ /*   5 */  12820798,  15790321,  19976592,  24970740,  31350126,
+ /*  10 */  39045157,  49367440,  61356676,  76695844,  95443717,
+ /*  15 */ 119304647, 148102320, 186737708, 238609294, 286331153,
+};
+
+#define task_weight(p)		prio_to_weight[TASK_USER_PRIO(p)]
+#define fair_entry(node)	rb_entry((node), task_t, fair_node)
+
+/* Longest period charged in one go; keeps the scaling below from overflowing */
+#define FAIR_MAX_DELTA		(1ULL << 34)
+
+static inline unsigned long long calc_delta_fair(unsigned long long delta,
+						 task_t *p)
+{
+	return (delta * prio_to_wmult[TASK_USER_PRIO(p)]) >> WMULT_SHIFT;
+}
+
+static inline unsigned long long div_clock(unsigned long long x,
+					   unsigned long div)
+{
+	do_div(x, div);
+	return x;
+}
+
+static inline task_t *fair_first(runqueue_t *rq)
+{
+	return rq->fair.leftmost ? fair_entry(rq->fair.leftmost) : NULL;
+}
+
+static void update_min_vruntime(struct fair_rq *fair)
+{
+	unsigned long long vruntime;
+
+	if (!fair->leftmost)
+		return;
+	vruntime = fair_entry(fair->leftmost)->vruntime;
+	if ((long long)(vruntime - fair->min_vruntime) > 0)
+		fair->min_vruntime = vruntime;
+}
+
+static void __enqueue_fair(struct fair_rq *fair, task_t *p)
+{
+	struct rb_node **link = &fair->tasks.rb_node, *parent = NULL;
+	int leftmost = 1;
+
+	while (*link) {
+		parent = *link;
+		if ((long long)(p->vruntime - fair_entry(parent)->vruntime) < 0)
+			link = &parent->rb_left;
+		else {
+			link = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+	if (leftmost)
+		fair->leftmost = &p->fair_node;
+	rb_link_node(&p->fair_node, parent, link);
+	rb_insert_color(&p->fair_node, &fair->tasks);
+}
+
+static void __dequeue_fair(struct fair_rq *fair, task_t *p)
+{
+	if (fair->leftmost == &p->fair_node)
+		fair->leftmost = rb_next(&p->fair_node);
+	rb_erase(&p->fair_node, &fair->tasks);
+}
+
+/*
+ * Off the tree, p->vruntime is kept relative to the min_vruntime of the
+ * runqueue it was taken off (sched_fork() and __setscheduler() start it
+ * out at a small debit), which makes moving a task between runqueues
+ * free. A task never gets more than half a period of credit back, so a
+ * long sleeper cannot monopolise the CPU after waking.
+ */
+static void enqueue_task_fair(runqueue_t *rq, task_t *p)
+{
+	struct fair_rq *fair = &rq->fair;
+	long long credit = sysctl_sched_fair_latency / 2;
+
+	sched_info_queued(p);
+	if ((long long)p->vruntime < -credit)
+		p->vruntime = -credit;
+	p->vruntime += fair->min_vruntime;
+	/*
+	 * An idle class must not have banked time against the other one:
+	 */
+	if (!fair->nr_running &&
+			(long long)(rq->normal_clock - fair->clock) > 0)
+		fair->clock = rq->normal_clock;
+	__enqueue_fair(fair, p);
+	fair->nr_running++;
+	fair->load += task_weight(p);
+	p->array = &fair_array;
+}
+
+static void dequeue_task_fair(runqueue_t *rq, task_t *p)
+{
+	struct fair_rq *fair = &rq->fair;
+
+	__dequeue_fair(fair, p);
+	fair->nr_running--;
+	fair->load -= task_weight(p);
+	p->vruntime -= fair->min_vruntime;
+	update_min_vruntime(fair);
+}
+
+static inline unsigned long nr_normal_running(runqueue_t *rq)
+{
+	return rq->active->nr_active + rq->expired->nr_active;
+}
+
+/*
+ * Charge the time rq->curr ran since rq->exec_start to the task and to
+ * its class clock. Must be called with the (local) rq->lock held.
+ */
+static void update_curr_fair(runqueue_t *rq, unsigned long long now)
+{
+	task_t *curr = rq->curr;
+	unsigned long long delta = now - rq->exec_start;
+	unsigned long nr;
+
+	/* sched_clock() may drift backwards a little */
+	if ((long long)delta <= 0)
+		return;
+	rq->exec_start = now;
+	if (delta > FAIR_MAX_DELTA)
+		delta = FAIR_MAX_DELTA;
+
+	if (curr == rq->idle || rt_task(curr))
+		return;
+
+	if (!fair_task(curr)) {
+		nr = nr_normal_running(rq);
+		if (nr)
+			rq->normal_clock += div_clock(delta, nr);
+		return;
+	}
+
+	curr->sum_exec_runtime += delta;
+	if (!curr->array)
+		return;
+	__dequeue_fair(&rq->fair, curr);
+	curr->vruntime += calc_delta_fair(delta, curr);
+	__enqueue_fair(&rq->fair, curr);
+	update_min_vruntime(&rq->fair);
+	rq->fair.clock += div_clock(delta * NICE_0_LOAD, rq->fair.load);
+}
+
+/*
+ * The share of the scheduling period p should get on rq, in nanoseconds.
+ */
+static unsigned long long sched_fair_slice(runqueue_t *rq, task_t *p)
+{
+	unsigned long nr = rq->fair.nr_running;
+	unsigned long long period = sysctl_sched_fair_latency;
+
+	if (nr > sysctl_sched_fair_latency / sysctl_sched_fair_min_granularity)
+		period = (unsigned long long)sysctl_sched_fair_min_granularity * nr;
+
+	return div_clock(period * task_weight(p), rq->fair.load);
+}
+
+/*
+ * Timer tick for a running fair task: preempt it once it used up its
+ * slice, or when the SCHED_NORMAL tasks are owed CPU time.
+ */
+static void task_tick_fair(runqueue_t *rq, task_t *p)
+{
+	unsigned long long ran = p->sum_exec_runtime - p->prev_sum_exec_runtime;
+
+	if (nr_normal_running(rq) && (long long)(rq->fair.clock -
+			rq->normal_clock) > sysctl_sched_fair_min_granularity) {
+		set_tsk_need_resched(p);
+		return;
+	}
+	if (rq->fair.nr_running > 1 && ran > sched_fair_slice(rq, p))
+		set_tsk_need_resched(p);
+}
+
+/*
+ * Should the fair class run next, given idx is the first set bit of the
+ * active priority array?
+ */
+static inline int fair_class_due(runqueue_t *rq, int idx)
+{
+	if (!rq->fair.nr_running)
+		return 0;
+	if (idx >= MAX_PRIO)
+		return 1;
+	if (idx < MAX_RT_PRIO)
+		return 0;
+	return (long long)(rq->fair.clock - rq->normal_clock) <= 0;
+}
+
+/*
+ * Move current behind every other fair task on its runqueue.
+ */
+static void yield_task_fair(runqueue_t *rq, task_t *p)
+{
+	struct rb_node *last = rb_last(&rq->fair.tasks);
+	task_t *rightmost;
+
+	if (!last)
+		return;
+	rightmost = fair_entry(last);
+	if ((long long)(rightmost->vruntime - p->vruntime) <= 0)
+		return;
+	__dequeue_fair(&rq->fair, p);
+	p->vruntime = rightmost->vruntime + 1;
+	__enqueue_fair(&rq->fair, p);
+	update_min_vruntime(&rq->fair);
+}
+
+/*
+ * TASK_PREEMPTS_CURR() for when p or rq->curr is a fair task.
+ */
+static int fair_preempts_curr(task_t *p, runqueue_t *rq)
+{
+	task_t *curr = rq->curr;
+
+	if (rt_task(p) || curr == rq->idle)
+		return 1;
+	if (rt_task(curr))
+		return 0;
+	if (fair_task(p) && fair_task(curr))
+		return (long long)(curr->vruntime - p->vruntime) >
+			SCHED_FAIR_WAKEUP_GRANULARITY;
+	if (fair_task(p))
+		return (long long)(rq->normal_clock - rq->fair.clock) >
+			SCHED_FAIR_WAKEUP_GRANULARITY;
+	return (long long)(rq->fair.clock - rq->normal_clock) >
+		SCHED_FAIR_WAKEUP_GRANULARITY;
+}
+
 /*
  * __activate_task - move a task to the runqueue.
  */
 static inline void __activate_task(task_t *p, runqueue_t *rq)
 {
-	enqueue_task(p, rq->active);
+	if (fair_task(p))
+		enqueue_task_fair(rq, p);
+	else {
+		/*
+		 * Same as for the fair class: no banked time when the
+		 * SCHED_NORMAL class becomes busy again.
+		 */
+		if (!rt_task(p) && !nr_normal_running(rq) &&
+				(long long)(rq->fair.clock - rq->normal_clock) > 0)
+			rq->normal_clock = rq->fair.clock;
+		enqueue_task(p, rq->active);
+	}
 	rq->nr_running++;
 }
 
@@ -898,7 +1360,10 @@ static void activate_task(task_t *p, runqueue_t *rq, int local)
 static void deactivate_task(struct task_struct *p, runqueue_t *rq)
 {
 	rq->nr_running--;
-	dequeue_task(p, p->array);
+	if (fair_task(p))
+		dequeue_task_fair(rq, p);
+	else
+		dequeue_task(p, p->array);
 	p->array = NULL;
 }
 
@@ -1289,6 +1754,7 @@ out_activate:
 	 *     5:̲̼ϡ
 	 */
 	activate_task(p, rq, cpu == this_cpu);
+	sched_info_woken(p);
 	/**
 	 * ĿCPUǱCPUûSYNC־ͼ½̵Ķ̬ȼǷжеǰ̵ȼߡ
 	 */
@@ -1384,6 +1850,12 @@ void fastcall sched_fork(task_t *p)
 	p->first_time_slice = 1;
 	current->time_slice >>= 1;
 	p->timestamp = sched_clock();
+	/*
+	 * A new fair task starts one minimum slice behind the runqueue,
+	 * so that fork loops cannot starve the tasks already running:
+	 */
+	p->vruntime = sysctl_sched_fair_min_granularity;
+	p->sum_exec_runtime = p->prev_sum_exec_runtime = 0;
 	/**
 	 * ǰ̵ʱƬΪ1,ôһtickָӽ̣ǰ̵ʱƬ1.
 	 */
@@ -1443,7 +1915,8 @@ void fastcall wake_up_new_task(task_t * p, unsigned long clone_flags)
 			 * do child-runs-first in anticipation of an exec. This
 			 * usually avoids a lot of COW overhead.
 			 */
-			if (unlikely(!current->array))
+			if (unlikely(!current->array) ||
+					fair_task(p) || fair_task(current))
 				__activate_task(p, rq);
 			else {
 				p->prio = current->prio;
@@ -1887,6 +2360,47 @@ void pull_task(runqueue_t *src_rq, prio_array_t *src_array, task_t *p,
 		resched_task(this_rq->curr);
 }
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * Account the migration of p, pulled from busiest since start: the time
+ * the move itself took, and for a task that was still cache-hot over
+ * there the cache refill it now pays, as measured for sd at boot.
+ */
+static inline void schedstat_migrated(runqueue_t *this_rq, runqueue_t *busiest,
+				      task_t *p, struct sched_domain *sd,
+				      unsigned long long start)
+{
+	schedstat_hist(this_rq, SCHED_HIST_MIGRATE_MOVE,
+		       schedstat_clock() - start);
+	if (task_hot(p, busiest->timestamp_last_tick, sd))
+		schedstat_hist(this_rq, SCHED_HIST_MIGRATE_REFILL,
+			       sd->migration_cost);
+}
+#else
+# define schedstat_migrated(this_rq, busiest, p, sd, start) \
+	do { (void)(start); } while (0)
+#endif
+
+/*
+ * Does pulling 'load' (SCHED_LOAD_SCALE per task) over to this cpu gain
+ * more cpu time before the next balancing attempt in sd than the cache
+ * refill measured for sd costs? Domains without a measured cost always
+ * say yes.
+ */
+static inline int migration_worthwhile(struct sched_domain *sd,
+				       unsigned long load, enum idle_type idle)
+{
+	unsigned long long gain;
+	unsigned long interval = sd->balance_interval;
+
+	if (!sd->migration_cost)
+		return 1;
+	if (idle == NOT_IDLE)
+		interval *= sd->busy_factor;
+	gain = (unsigned long long)load * interval * 1000000 / SCHED_LOAD_SCALE;
+	return gain > sd->migration_cost;
+}
+
 /*
  * can_migrate_task - may task p from runqueue rq be migrated to this_cpu?
  */
@@ -1903,7 +2417,7 @@ void pull_task(runqueue_t *src_rq, prio_array_t *src_array, task_t *p,
  */
 static inline
 int can_migrate_task(task_t *p, runqueue_t *rq, int this_cpu,
-		     struct sched_domain *sd, enum idle_type idle)
+		     struct sched_domain *sd, enum idle_type idle, int hot_ok)
 {
 	/*
 	 * We do not migrate tasks that are:
@@ -1916,19 +2430,71 @@ int can_migrate_task(task_t *p, runqueue_t *rq, int this_cpu,
 	if (!cpu_isset(this_cpu, p->cpus_allowed))
 		return 0;
 
+	if (!task_hot(p, rq->timestamp_last_tick, sd))
+		return 1;
+
 	/*
-	 * Aggressive migration if:
+	 * Cache-hot tasks are only taken on the second pass of
+	 * move_tasks(), and then only for aggressive migration:
 	 * 1) the [whole] cpu is idle, or
-	 * 2) too many balance attempts have failed.
+	 * 2) too many balance attempts have failed,
+	 * and only if migration_worthwhile().
+	 */
+	/**
+	 * ̵ĸٻ滹ȵġֻmove_tasksĵڶɨвſǨ
 	 */
+	if (!hot_ok)
+		return 0;
+	if (!cpu_and_siblings_are_idle(this_cpu) &&
+			sd->nr_balance_failed <= sd->cache_nice_tries)
+		return 0;
 
-	if (cpu_and_siblings_are_idle(this_cpu) || \
-			sd->nr_balance_failed > sd->cache_nice_tries)
-		return 1;
+	/*
+	 * A cache-hot task has to refill its cache over there: only take
+	 * it if the load it brings gains more than that costs.
+	 */
+	return migration_worthwhile(sd, SCHED_LOAD_SCALE, idle);
+}
 
-	if (task_hot(p, rq->timestamp_last_tick, sd))
-			return 0;
-	return 1;
+/*
+ * move_tasks_fair - pull up to max_nr_move fair tasks from busiest.
+ * We start at the right end of its tree: those tasks are the furthest
+ * from getting to run there. Both runqueues must be locked.
+ */
+static int move_tasks_fair(runqueue_t *this_rq, int this_cpu,
+			   runqueue_t *busiest, unsigned long max_nr_move,
+			   struct sched_domain *sd, enum idle_type idle,
+			   int hot_ok)
+{
+	struct rb_node *node = rb_last(&busiest->fair.tasks);
+	unsigned long long start;
+	int pulled = 0;
+	task_t *p;
+
+	while (node && pulled < max_nr_move) {
+		p = fair_entry(node);
+		node = rb_prev(node);
+
+		if (!can_migrate_task(p, busiest, this_cpu, sd, idle, hot_ok))
+			continue;
+
+		schedstat_inc(this_rq, pt_gained[idle]);
+		schedstat_inc(busiest, pt_lost[idle]);
+
+		start = schedstat_clock();
+		dequeue_task_fair(busiest, p);
+		busiest->nr_running--;
+		set_task_cpu(p, this_cpu);
+		this_rq->nr_running++;
+		enqueue_task_fair(this_rq, p);
+		p->timestamp = (p->timestamp - busiest->timestamp_last_tick)
+					+ this_rq->timestamp_last_tick;
+		if (TASK_PREEMPTS_CURR(p, this_rq))
+			resched_task(this_rq->curr);
+		schedstat_migrated(this_rq, busiest, p, sd, start);
+		pulled++;
+	}
+	return pulled;
 }
 
 /*
@@ -1947,12 +2513,13 @@ int can_migrate_task(task_t *p, runqueue_t *rq, int this_cpu,
  * sd:ִƽĵַ
  * idle:IDLE־ΪSCHED_IDLENOT_IDLEidle_balanceӵʱNEWLY_IDLE
  */
-static int move_tasks(runqueue_t *this_rq, int this_cpu, runqueue_t *busiest,
-		      unsigned long max_nr_move, struct sched_domain *sd,
-		      enum idle_type idle)
+static int __move_tasks(runqueue_t *this_rq, int this_cpu, runqueue_t *busiest,
+			unsigned long max_nr_move, struct sched_domain *sd,
+			enum idle_type idle, int hot_ok)
 {
 	prio_array_t *array, *dst_array;
 	struct list_head *head, *curr;
+	unsigned long long start;
 	int idx, pulled = 0;
 	task_t *tmp;
 
@@ -2001,9 +2568,9 @@ skip_bitmap:
 			goto new_array;
 		}
 		/**
-		 * жˣ˳
+		 * жˣٿSCHED_FAIR̡
 		 */
-		goto out;
+		goto fair;
 	}
 
 	/**
@@ -2019,7 +2586,7 @@ skip_queue:
 	/**
 	 * еỵ̈߳can_migrate_taskжǷʺǨƵCPU
 	 */
-	if (!can_migrate_task(tmp, busiest, this_cpu, sd, idle)) {
+	if (!can_migrate_task(tmp, busiest, this_cpu, sd, idle, hot_ok)) {
 		if (curr != head)
 			goto skip_queue;
 		idx++;
@@ -2040,7 +2607,9 @@ skip_queue:
 	 * Ȼִenqueue_taskѽ̲뱾жСձǨƵḺ̌ȵǰӵиߵȼ
 	 * ͵resched_taskռCPUĵǰ̡
 	 */
+	start = schedstat_clock();
 	pull_task(busiest, array, tmp, this_rq, dst_array, this_cpu);
+	schedstat_migrated(this_rq, busiest, tmp, sd, start);
 	pulled++;
 
 	/* We only want to steal up to the prescribed number of tasks. */
@@ -2050,14 +2619,47 @@ skip_queue:
 		idx++;
 		goto skip_bitmap;
 	}
+	goto out;
+fair:
+	pulled += move_tasks_fair(this_rq, this_cpu, busiest,
+				  max_nr_move - pulled, sd, idle, hot_ok);
 out:
 	return pulled;
 }
 
+/*
+ * move_tasks makes two passes over busiest: the first only takes tasks
+ * that are cache-cold, wherever they sit in the arrays, so that a
+ * cache-hot task is only pulled when no cold one can restore balance.
+ */
+static int move_tasks(runqueue_t *this_rq, int this_cpu, runqueue_t *busiest,
+		      unsigned long max_nr_move, struct sched_domain *sd,
+		      enum idle_type idle)
+{
+	unsigned long long start = schedstat_clock();
+	int pulled;
+
+	pulled = __move_tasks(this_rq, this_cpu, busiest, max_nr_move,
+			      sd, idle, 0);
+	if (pulled < max_nr_move)
+		pulled += __move_tasks(this_rq, this_cpu, busiest,
+				       max_nr_move - pulled, sd, idle, 1);
+	if (pulled)
+		schedstat_hist(this_rq, SCHED_HIST_MOVE_TASKS,
+			       schedstat_clock() - start);
+	return pulled;
+}
+
 /*
  * find_busiest_group finds and returns the busiest CPU group within the
  * domain. It calculates and returns the number of tasks which should be
  * moved to restore balance via the imbalance parameter.
+ *
+ * A full task worth of imbalance is always acted upon, though
+ * can_migrate_task() still leaves cache-hot tasks whose refill would
+ * not pay. The marginal pulls below that (for throughput, or by an
+ * idle cpu) are only made if migration_worthwhile() says they pay for
+ * the cache refill.
  */
 static struct sched_group *
 find_busiest_group(struct sched_domain *sd, int this_cpu,
@@ -2172,6 +2774,9 @@ nextgroup:
 		if (pwr_move < pwr_now + SCHED_LOAD_SCALE / 8)
 			goto out_balanced;
 
+		if (!migration_worthwhile(sd, max_load - this_load, idle))
+			goto out_balanced;
+
 		*imbalance = 1;
 		return busiest;
 	}
@@ -2183,7 +2788,9 @@ nextgroup:
 
 out_balanced:
 	if (busiest && (idle == NEWLY_IDLE ||
-			(idle == SCHED_IDLE && max_load > SCHED_LOAD_SCALE)) ) {
+			(idle == SCHED_IDLE && max_load > SCHED_LOAD_SCALE)) &&
+			migration_worthwhile(sd, max_load > this_load ?
+					max_load - this_load : 0, idle)) {
 		*imbalance = 1;
 		return busiest;
 	}
@@ -2509,6 +3116,22 @@ static void active_load_balance(runqueue_t *busiest_rq, int busiest_cpu)
  * idle-Ƿidle̡SCHED_IDLE:ǰCPUУcurrentswapper̡
  *                    NOT_IDLE:ǰCPUСcurrentswapper̡
  */
+#ifdef CONFIG_NO_IDLE_HZ
+/*
+ * Idle cpus whose tick is stopped do not balance. When a busy cpu has
+ * tasks to spare, it wakes one of those in sd: the restarted tick then
+ * gets it to pull.
+ */
+static void nohz_kick_idle(struct sched_domain *sd)
+{
+	cpumask_t mask;
+
+	cpus_and(mask, sd->span, nohz_cpu_mask);
+	if (!cpus_empty(mask))
+		smp_send_reschedule(first_cpu(mask));
+}
+#endif
+
 static void rebalance_tick(int this_cpu, runqueue_t *this_rq,
 			   enum idle_type idle)
 {
@@ -2566,6 +3189,10 @@ static void rebalance_tick(int this_cpu, runqueue_t *this_rq,
 				idle = NOT_IDLE;
 			}
 			sd->last_balance += interval;
+#ifdef CONFIG_NO_IDLE_HZ
+			if (idle == NOT_IDLE && this_rq->nr_running > 1)
+				nohz_kick_idle(sd);
+#endif
 		}
 	}
 }
@@ -2841,6 +3468,18 @@ void scheduler_tick(void)
 		return;
 	}
 
+	/**
+	 * SCHED_FAIR̲ȼУûʱƬtask_tick_fairǷռ
+	 */
+	if (fair_task(p)) {
+		spin_lock(&rq->lock);
+		update_curr_fair(rq, rq->timestamp_last_tick);
+		if (p->array)
+			task_tick_fair(rq, p);
+		spin_unlock(&rq->lock);
+		goto out;
+	}
+
 	/* Task might have expired already, but not scheduled off yet */
 	/**
 	 * current->arrayǷָ򱾵жеĻ
@@ -2854,6 +3493,7 @@ void scheduler_tick(void)
 	 * же
 	 */
 	spin_lock(&rq->lock);
+	update_curr_fair(rq, rq->timestamp_last_tick);
 	/*
 	 * The task was running during this tick - update the
 	 * time slice counter. Note: we do not update a thread's
@@ -2979,6 +3619,13 @@ void scheduler_tick(void)
 			set_tsk_need_resched(p);
 		}
 	}
+	/*
+	 * Let the fair class run once the SCHED_NORMAL tasks got ahead
+	 * of it:
+	 */
+	if (rq->fair.nr_running && (long long)(rq->normal_clock -
+			rq->fair.clock) > sysctl_sched_fair_min_granularity)
+		set_tsk_need_resched(p);
 out_unlock:
 	/**
 	 * ͷ
@@ -3076,7 +3723,12 @@ static inline int dependent_sleeper(int this_cpu, runqueue_t *this_rq)
 	array = this_rq->active;
 	if (!array->nr_active)
 		array = this_rq->expired;
-	BUG_ON(!array->nr_active);
+	/*
+	 * Only SCHED_FAIR tasks are queued; they are not subject to the
+	 * timeslice based sibling heuristics below.
+	 */
+	if (!array->nr_active)
+		goto out_unlock;
 
 	p = list_entry(array->queue[sched_find_first_bit(array->bitmap)].next,
 		task_t, run_list);
@@ -3200,6 +3852,13 @@ need_resched:
 	 */
 	preempt_disable();
 	prev = current;
+	/*
+	 * A shared workqueue worker about to block lets its pool start
+	 * another worker, so the work queued behind it keeps moving.
+	 */
+	if (unlikely(prev->flags & PF_WQ_WORKER) && prev->state &&
+	    !(preempt_count() & PREEMPT_ACTIVE))
+		wq_worker_sleeping(prev);
 	/**
 	 * ͷŴںںռʱҵǰжռǰ̣ôὫlock_depthΪ-1.
 	 * ͷںֻе̻˴ںȳʱŻͷ
@@ -3241,6 +3900,7 @@ need_resched_nonpreemptible:
 	 * ڿʼѰҿн֮ǰҪжϲñже
 	 */
 	spin_lock_irq(&rq->lock);
+	update_curr_fair(rq, now);
 
 	/**
 	 * ǰ̿һ׼ֹĽ̡ͨdo_exitschedule
@@ -3335,6 +3995,15 @@ go_idle:
 	 * һ0λҵӦ
 	 */
 	idx = sched_find_first_bit(array->bitmap);
+	/**
+	 * ûʵʱ̣SCHED_FAIRͨʱvruntimeСSCHED_FAIR̡
+	 */
+	if (fair_class_due(rq, idx)) {
+		next = fair_first(rq);
+		next->prev_sum_exec_runtime = next->sum_exec_runtime;
+		next->activated = 0;
+		goto switch_tasks;
+	}
 	queue = array->queue + idx;
 	/**
 	 * һнŵnext
@@ -3391,8 +4060,9 @@ switch_tasks:
 	 * ½̵ʱ
 	 */
 	prev->timestamp = prev->last_ran = now;
+	rq->exec_start = now;
 
-	sched_info_switch(prev, next);
+	sched_info_switch(prev, next, now);
 	if (likely(prev != next)) {/* prevnextͬҪл */
 		next->timestamp = now;
 		rq->nr_switches++;
@@ -3424,6 +4094,8 @@ switch_tasks:
 	 * ڼе֮ǰ(context_switchпжϣܸлر̾жϣҪµ)prevóɵǰ̡
 	 */
 	prev = current;
+	if (unlikely(prev->flags & PF_WQ_WORKER))
+		wq_worker_running(prev);
 	/**
 	 * »ôں
 	 */
@@ -3546,6 +4218,149 @@ int default_wake_function(wait_queue_t *curr, unsigned mode, int sync, void *key
 
 EXPORT_SYMBOL(default_wake_function);
 
+/*
+ * Batched wakeups. When __wake_up_common() has several waiters to wake
+ * that use the default wake functions, it queues them here rather than
+ * calling try_to_wake_up() on each. They are then woken a runqueue at a
+ * time: each runqueue lock is taken once and its current task is asked
+ * to reschedule (at most one IPI) once.
+ *
+ * Callers outside the waitqueue code, such as futex_wake(), queue bare
+ * tasks with wake_batch_add_task() and wake them with wake_up_batch().
+ *
+ * Batched tasks are woken on the cpu they last ran on; the wakeup
+ * balancing of try_to_wake_up() is left to the load balancer.
+ */
+/**
+ * ѡжз飬ÿжֻһ෢һIPI
+ */
+
+/*
+ * try_to_wake_up() minus the cpu selection, with rq already locked.
+ * Returns 1 if p was woken; *preempt is set if it should preempt rq->curr.
+ */
+static int wake_batch_one(task_t *p, runqueue_t *rq, unsigned int state,
+			  int sync, int *preempt)
+{
+	int cpu = task_cpu(p), this_cpu = smp_processor_id();
+	long old_state = p->state;
+
+	schedstat_inc(rq, ttwu_cnt);
+	schedstat_inc(rq, wb_cnt);
+	if (!(old_state & state))
+		return 0;
+	if (p->array) {
+		p->state = TASK_RUNNING;
+		return 0;
+	}
+
+	if (old_state == TASK_UNINTERRUPTIBLE) {
+		rq->nr_uninterruptible--;
+		p->activated = -1;
+	}
+	activate_task(p, rq, cpu == this_cpu);
+	sched_info_woken(p);
+	if ((!sync || cpu != this_cpu) && TASK_PREEMPTS_CURR(p, rq))
+		*preempt = 1;
+	p->state = TASK_RUNNING;
+	return 1;
+}
+
+static void wake_batch_flush(struct wake_batch *wb, unsigned int state,
+			     int sync)
+{
+	unsigned long woken = 0, done = 0, flags;
+	int i, j;
+
+	for (i = 0; i < wb->nr; i++) {
+		/*
+		 * Take every queued task of the runqueue wb->tasks[i] is
+		 * on. If it migrated before we got the lock, go again.
+		 */
+		while (!(done & (1UL << i))) {
+			int cpu = task_cpu(wb->tasks[i]), preempt = 0;
+			runqueue_t *rq = cpu_rq(cpu);
+
+			spin_lock_irqsave(&rq->lock, flags);
+			schedstat_inc(rq, wb_locked);
+			for (j = i; j < wb->nr; j++) {
+				task_t *p = wb->tasks[j];
+
+				if ((done & (1UL << j)) || task_cpu(p) != cpu)
+					continue;
+				done |= 1UL << j;
+				if (wake_batch_one(p, rq, state, sync, &preempt))
+					woken |= 1UL << j;
+			}
+			if (preempt)
+				resched_task(rq->curr);
+			spin_unlock_irqrestore(&rq->lock, flags);
+		}
+	}
+
+	/*
+	 * What autoremove_wake_function() does after a successful wakeup.
+	 * The waiter may be gone once its entry is off the list.  Bare
+	 * tasks drop the reference wake_batch_add_task() took.
+	 */
+	for (i = 0; i < wb->nr; i++) {
+		if (!wb->waits[i])
+			put_task_struct(wb->tasks[i]);
+		else if ((woken & (1UL << i)) &&
+			 wb->waits[i]->func == autoremove_wake_function)
+			list_del_init(&wb->waits[i]->task_list);
+	}
+	wb->nr = 0;
+}
+
+static inline void wake_batch_add(struct wake_batch *wb, wait_queue_t *curr,
+				  unsigned int state, int sync)
+{
+	if (wb->nr == WAKE_BATCH)
+		wake_batch_flush(wb, state, sync);
+	wb->waits[wb->nr] = curr;
+	wb->tasks[wb->nr] = curr->task;
+	wb->nr++;
+}
+
+/**
+ * wake_batch_add_task - queue a task for wake_up_batch()
+ * @wb: the batch, set up with wake_batch_init()
+ * @p: task sleeping in TASK_INTERRUPTIBLE
+ *
+ * The batch holds a reference to @p, so the caller may let it go (e.g.
+ * by releasing the object it sleeps on) before the wakeup is done.  @p
+ * has to put up with a spurious wakeup if it wakes up by itself in the
+ * meantime and goes back to sleep on something else, as with a signal.
+ * A full batch is woken straight away.
+ */
+void wake_batch_add_task(struct wake_batch *wb, task_t *p)
+{
+	if (wb->nr == WAKE_BATCH)
+		wake_batch_flush(wb, TASK_INTERRUPTIBLE, 0);
+	get_task_struct(p);
+	wb->waits[wb->nr] = NULL;
+	wb->tasks[wb->nr] = p;
+	wb->nr++;
+}
+
+EXPORT_SYMBOL_GPL(wake_batch_add_task);
+
+/**
+ * wake_up_batch - wake the tasks queued with wake_batch_add_task()
+ * @wb: the batch
+ *
+ * Takes each runqueue lock once and sends at most one reschedule IPI per
+ * cpu.  May be called with spinlocks held, but not with a runqueue lock.
+ */
+void wake_up_batch(struct wake_batch *wb)
+{
+	if (wb->nr)
+		wake_batch_flush(wb, TASK_INTERRUPTIBLE, 0);
+}
+
+EXPORT_SYMBOL_GPL(wake_up_batch);
+
 /*
  * The core wakeup function.  Non-exclusive wakeups (nr_exclusive == 0) just
  * wake everything up.  If it's an exclusive wakeup (nr_exclusive == small +ve
@@ -3554,22 +4369,37 @@ EXPORT_SYMBOL(default_wake_function);
  * There are circumstances in which we can try to wake a task which has already
  * started to run but is not in state TASK_RUNNING.  try_to_wake_up() returns
  * zero in this (rare) case, and we handle it by continuing to scan the queue.
+ *
+ * Waiters whose wakeup need not be counted (non-exclusive ones, or all of
+ * them when nr_exclusive is 0) and which use the default wake functions
+ * are woken through a wake_batch, unless they are alone on the queue.
  */
 static void __wake_up_common(wait_queue_head_t *q, unsigned int mode,
 			     int nr_exclusive, int sync, void *key)
 {
 	struct list_head *tmp, *next;
+	struct wake_batch wb;
 
+	wb.nr = 0;
 	list_for_each_safe(tmp, next, &q->task_list) {
 		wait_queue_t *curr;
 		unsigned flags;
 		curr = list_entry(tmp, wait_queue_t, task_list);
 		flags = curr->flags;
+		if ((curr->func == default_wake_function ||
+		     curr->func == autoremove_wake_function) &&
+		    (!(flags & WQ_FLAG_EXCLUSIVE) || !nr_exclusive) &&
+		    (wb.nr || next != &q->task_list)) {
+			wake_batch_add(&wb, curr, mode, sync);
+			continue;
+		}
 		if (curr->func(curr, mode, sync, key) &&
 		    (flags & WQ_FLAG_EXCLUSIVE) &&
 		    !--nr_exclusive)
 			break;
 	}
+	if (wb.nr)
+		wake_batch_flush(&wb, mode, sync);
 }
 
 /**
@@ -3904,8 +4734,12 @@ void set_user_nice(task_t *p, long nice)
 		goto out_unlock;
 	}
 	array = p->array;
-	if (array)
-		dequeue_task(p, array);
+	if (array) {
+		if (fair_task(p))
+			dequeue_task_fair(rq, p);
+		else
+			dequeue_task(p, array);
+	}
 
 	old_prio = p->prio;
 	new_prio = NICE_TO_PRIO(nice);
@@ -3914,7 +4748,10 @@ void set_user_nice(task_t *p, long nice)
 	p->prio += delta;
 
 	if (array) {
-		enqueue_task(p, array);
+		if (fair_task(p))
+			enqueue_task_fair(rq, p);
+		else
+			enqueue_task(p, array);
 		/*
 		 * If the task increased its priority or is running and
 		 * lowered its priority, then reschedule its CPU:
@@ -4058,9 +4895,12 @@ static inline task_t *find_process_by_pid(pid_t pid)
 static void __setscheduler(struct task_struct *p, int policy, int prio)
 {
 	BUG_ON(p->array);
+	/* Joining the fair class: start level with the runqueue */
+	if (policy == SCHED_FAIR && p->policy != SCHED_FAIR)
+		p->vruntime = 0;
 	p->policy = policy;
 	p->rt_priority = prio;
-	if (policy != SCHED_NORMAL)
+	if (policy == SCHED_FIFO || policy == SCHED_RR)
 		p->prio = MAX_USER_RT_PRIO-1 - p->rt_priority;
 	else
 		p->prio = p->static_prio;
@@ -4086,16 +4926,18 @@ recheck:
 	if (policy < 0)
 		policy = oldpolicy = p->policy;
 	else if (policy != SCHED_FIFO && policy != SCHED_RR &&
-				policy != SCHED_NORMAL)
+				policy != SCHED_NORMAL && policy != SCHED_FAIR)
 			return -EINVAL;
 	/*
 	 * Valid priorities for SCHED_FIFO and SCHED_RR are
-	 * 1..MAX_USER_RT_PRIO-1, valid priority for SCHED_NORMAL is 0.
+	 * 1..MAX_USER_RT_PRIO-1, valid priority for SCHED_NORMAL and
+	 * SCHED_FAIR is 0.
 	 */
 	if (param->sched_priority < 0 ||
 	    param->sched_priority > MAX_USER_RT_PRIO-1)
 		return -EINVAL;
-	if ((policy == SCHED_NORMAL) != (param->sched_priority == 0))
+	if ((policy == SCHED_NORMAL || policy == SCHED_FAIR) !=
+			(param->sched_priority == 0))
 		return -EINVAL;
 
 	if ((policy == SCHED_FIFO || policy == SCHED_RR) &&
@@ -4403,6 +5245,10 @@ asmlinkage long sys_sched_yield(void)
 	prio_array_t *target = rq->expired;
 
 	schedstat_inc(rq, yld_cnt);
+	if (fair_task(current)) {
+		yield_task_fair(rq, current);
+		goto out_unlock;
+	}
 	/*
 	 * We implement yielding by moving the task into the expired
 	 * queue.
@@ -4429,6 +5275,7 @@ asmlinkage long sys_sched_yield(void)
 		 */
 		requeue_task(current, array);
 
+out_unlock:
 	/*
 	 * Since we are going to call schedule() anyway, there's
 	 * no need to preempt or enable interrupts:
@@ -4571,6 +5418,7 @@ asmlinkage long sys_sched_get_priority_max(int policy)
 		ret = MAX_USER_RT_PRIO-1;
 		break;
 	case SCHED_NORMAL:
+	case SCHED_FAIR:
 		ret = 0;
 		break;
 	}
@@ -4594,6 +5442,7 @@ asmlinkage long sys_sched_get_priority_min(int policy)
 		ret = 1;
 		break;
 	case SCHED_NORMAL:
+	case SCHED_FAIR:
 		ret = 0;
 	}
 	return ret;
@@ -4627,8 +5476,12 @@ long sys_sched_rr_get_interval(pid_t pid, struct timespec __user *interval)
 	if (retval)
 		goto out_unlock;
 
-	jiffies_to_timespec(p->policy & SCHED_FIFO ?
-				0 : task_timeslice(p), &t);
+	if (p->policy == SCHED_FIFO)
+		jiffies_to_timespec(0, &t);
+	else if (fair_task(p))
+		jiffies_to_timespec(NS_TO_JIFFIES(sysctl_sched_fair_latency), &t);
+	else
+		jiffies_to_timespec(task_timeslice(p), &t);
 	read_unlock(&tasklist_lock);
 	retval = copy_to_user(interval, &t, sizeof(t)) ? -EFAULT : 0;
 out_nounlock:
@@ -5098,6 +5951,8 @@ static void migrate_dead_tasks(unsigned int dead_cpu)
 							run_list));
 		}
 	}
+	while (rq->fair.leftmost)
+		migrate_dead(dead_cpu, fair_entry(rq->fair.leftmost));
 }
 #endif /* CONFIG_HOTPLUG_CPU */
 
@@ -5580,6 +6435,154 @@ static void __devinit arch_destroy_sched_domains(void)
  */
 static struct sched_domain sched_domain_dummy;
 
+/*
+ * Cache refill cost of migrating a task between the cpus of a domain,
+ * by domain level counting from the bottom (ns, -1 if unknown). Measured
+ * once at boot; "migration_cost=<usecs>,<usecs>,..." overrides it.
+ */
+#define MAX_DOMAIN_DISTANCE	8
+
+static long long migration_cost[MAX_DOMAIN_DISTANCE] = {
+	[0 ... MAX_DOMAIN_DISTANCE-1] = -1LL
+};
+
+/* Size of the buffer whose refill is timed, should cover the largest cache */
+static unsigned long migration_cache_size = 4*1024*1024;
+
+static int __init setup_migration_cost(char *str)
+{
+	int ints[MAX_DOMAIN_DISTANCE+1], i;
+
+	get_options(str, ARRAY_SIZE(ints), ints);
+	for (i = 0; i < ints[0]; i++)
+		migration_cost[i] = (long long)ints[i+1] * 1000;
+	return 1;
+}
+__setup("migration_cost=", setup_migration_cost);
+
+static int __init setup_migration_cache_size(char *str)
+{
+	migration_cache_size = memparse(str, &str);
+	return 1;
+}
+__setup("migration_cache_size=", setup_migration_cache_size);
+
+static void __init touch_cache(unsigned long *cache, unsigned long size)
+{
+	unsigned long i;
+
+	for (i = 0; i < size / sizeof(long); i += L1_CACHE_BYTES / sizeof(long))
+		cache[i]++;
+}
+
+/*
+ * Dirty the buffer on source, then time touching it on target once
+ * cold and once hot. The difference is what target paid for the refill.
+ */
+static unsigned long long __init measure_one(unsigned long *cache,
+					     unsigned long size,
+					     int source, int target)
+{
+	unsigned long long t0, t1, t2;
+
+	set_cpus_allowed(current, cpumask_of_cpu(source));
+	touch_cache(cache, size);
+
+	set_cpus_allowed(current, cpumask_of_cpu(target));
+	t0 = sched_clock();
+	touch_cache(cache, size);
+	t1 = sched_clock();
+	touch_cache(cache, size);
+	t2 = sched_clock();
+
+	if (t1 - t0 <= t2 - t1)
+		return 0;
+	return (t1 - t0) - (t2 - t1);
+}
+
+/*
+ * For each level of this cpu's domains, time the migration to a cpu that
+ * is in the domain but not in its child. The best of a few runs in each
+ * direction is taken so that interrupts do not inflate the result.
+ */
+/**
+ * ʱÿһǨƿ
+ */
+static void __init calibrate_migration_costs(void)
+{
+	cpumask_t saved_mask = current->cpus_allowed;
+	int cpu = smp_processor_id(), level = 0;
+	struct sched_domain *sd;
+	unsigned long *cache;
+	cpumask_t child;
+
+	cache = vmalloc(migration_cache_size);
+	if (!cache) {
+		printk(KERN_WARNING "migration_cost: no memory to calibrate\n");
+		return;
+	}
+
+	child = cpumask_of_cpu(cpu);
+	for (sd = cpu_rq(cpu)->sd; sd && level < MAX_DOMAIN_DISTANCE;
+					sd = sd->parent, level++) {
+		unsigned long long cost, best = ~0ULL;
+		cpumask_t others;
+		int target, i;
+
+		cpus_andnot(others, sd->span, child);
+		child = sd->span;
+		if (migration_cost[level] >= 0 || cpus_empty(others))
+			continue;
+
+		target = first_cpu(others);
+		for (i = 0; i < 3; i++) {
+			cost = measure_one(cache, migration_cache_size,
+					   cpu, target);
+			best = min(best, cost);
+			cost = measure_one(cache, migration_cache_size,
+					   target, cpu);
+			best = min(best, cost);
+		}
+		migration_cost[level] = best;
+	}
+
+	set_cpus_allowed(current, saved_mask);
+	vfree(cache);
+
+	printk(KERN_INFO "migration_cost=");
+	for (level = 0; level < MAX_DOMAIN_DISTANCE; level++) {
+		if (migration_cost[level] < 0)
+			break;
+		printk("%s%ld", level ? "," : "",
+		       (long)migration_cost[level] / 1000);
+	}
+	printk("\n");
+}
+
+/*
+ * Hand the measured costs to the domains currently attached. Domains
+ * are rebuilt from SD_*_INIT on cpu hotplug, so this is redone then.
+ * A task that last ran more recently than the refill would take is
+ * also treated as cache hot.
+ */
+static void apply_migration_costs(void)
+{
+	struct sched_domain *sd;
+	int cpu, level;
+
+	for_each_online_cpu(cpu) {
+		level = 0;
+		for (sd = cpu_rq(cpu)->sd; sd && level < MAX_DOMAIN_DISTANCE;
+						sd = sd->parent, level++) {
+			if (sd == &sched_domain_dummy || migration_cost[level] < 0)
+				continue;
+			sd->migration_cost = migration_cost[level];
+			if (sd->cache_hot_time < sd->migration_cost)
+				sd->cache_hot_time = sd->migration_cost;
+		}
+	}
+}
+
 #ifdef CONFIG_HOTPLUG_CPU
 /*
  * Force a reinitialization of the sched domains hierarchy.  The domains
@@ -5614,6 +6617,7 @@ static int update_sched_domains(struct notifier_block *nfb,
 
 	/* The hotplug lock is already held by cpu_up/cpu_down */
 	arch_init_sched_domains();
+	apply_migration_costs();
 
 	return NOTIFY_OK;
 }
@@ -5623,6 +6627,8 @@ void __init sched_init_smp(void)
 {
 	lock_cpu_hotplug();
 	arch_init_sched_domains();
+	calibrate_migration_costs();
+	apply_migration_costs();
 	unlock_cpu_hotplug();
 	/* XXX: Theoretical race here - CPU may be hotplugged now */
 	hotcpu_notifier(update_sched_domains, 0);
@@ -5655,6 +6661,7 @@ void __init sched_init(void)
 		rq->active = rq->arrays;
 		rq->expired = rq->arrays + 1;
 		rq->best_expired_prio = MAX_PRIO;
+		rq->fair.tasks = RB_ROOT;
 
 #ifdef CONFIG_SMP
 		rq->sd = &sched_domain_dummy;
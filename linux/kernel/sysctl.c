@@ -35,6 +35,9 @@
 #include <linux/highuid.h>
 #include <linux/writeback.h>
 #include <linux/hugetlb.h>
+#include <linux/huge_mm.h>
+#include <linux/ksm.h>
+#include <linux/zswap.h>
 #include <linux/security.h>
 #include <linux/initrd.h>
 #include <linux/times.h>
@@ -65,6 +68,8 @@ extern int min_free_kbytes;
 extern int printk_ratelimit_jiffies;
 extern int printk_ratelimit_burst;
 extern int pid_max_min, pid_max_max;
+extern int sysctl_sched_fair_latency;
+extern int sysctl_sched_fair_min_granularity;
 
 #if defined(CONFIG_X86_LOCAL_APIC) && defined(CONFIG_X86)
 int unknown_nmi_panic;
@@ -78,6 +83,10 @@ static int minolduid;
 
 static int ngroups_max = NGROUPS_MAX;
 
+/* SCHED_FAIR tunables are in nanoseconds: 0.1ms ... 1s */
+static int sched_fair_ns_min = 100000;
+static int sched_fair_ns_max = 1000000000;
+
 #ifdef CONFIG_KMOD
 extern char modprobe_path[];
 #endif
@@ -612,6 +621,28 @@ static ctl_table kern_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_dointvec,
 	},
+	{
+		.ctl_name	= KERN_SCHED_FAIR_LATENCY,
+		.procname	= "sched_fair_latency_ns",
+		.data		= &sysctl_sched_fair_latency,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &sched_fair_ns_min,
+		.extra2		= &sched_fair_ns_max,
+	},
+	{
+		.ctl_name	= KERN_SCHED_FAIR_MIN_GRAN,
+		.procname	= "sched_fair_min_granularity_ns",
+		.data		= &sysctl_sched_fair_min_granularity,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &sched_fair_ns_min,
+		.extra2		= &sched_fair_ns_max,
+	},
 #if defined(CONFIG_X86_LOCAL_APIC) && defined(CONFIG_X86)
 	{
 		.ctl_name       = KERN_UNKNOWN_NMI_PANIC,
@@ -638,7 +669,11 @@ static ctl_table kern_table[] = {
 /* Constants for minimum and maximum testing in vm_table.
    We use these as one-element integer vectors. */
 static int zero;
+static int one = 1;
 static int one_hundred = 100;
+#ifdef CONFIG_MMU
+static int ptrs_per_pte = PTRS_PER_PTE;
+#endif
 
 
 static ctl_table vm_table[] = {
@@ -762,6 +797,137 @@ static ctl_table vm_table[] = {
 		.strategy	= &sysctl_intvec,
 		.extra1		= &zero,
 	},
+	{
+		.ctl_name	= VM_PERCPU_PAGELIST_FRACTION,
+		.procname	= "percpu_pagelist_fraction",
+		.data		= &percpu_pagelist_fraction,
+		.maxlen		= sizeof(percpu_pagelist_fraction),
+		.mode		= 0644,
+		.proc_handler	= &percpu_pagelist_fraction_sysctl_handler,
+	},
+#ifdef CONFIG_COMPACTION
+	{
+		.ctl_name	= VM_COMPACT_MEMORY,
+		.procname	= "compact_memory",
+		.data		= &sysctl_compact_memory,
+		.maxlen		= sizeof(sysctl_compact_memory),
+		.mode		= 0200,
+		.proc_handler	= &sysctl_compaction_handler,
+	},
+#endif
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	{
+		.ctl_name	= VM_TRANSPARENT_HUGEPAGE,
+		.procname	= "transparent_hugepage",
+		.data		= &sysctl_transparent_hugepage,
+		.maxlen		= sizeof(sysctl_transparent_hugepage),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec,
+	},
+	{
+		.ctl_name	= VM_KHUGEPAGED_PAGES_TO_SCAN,
+		.procname	= "khugepaged_pages_to_scan",
+		.data		= &khugepaged_pages_to_scan,
+		.maxlen		= sizeof(khugepaged_pages_to_scan),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &zero,
+	},
+	{
+		.ctl_name	= VM_KHUGEPAGED_SCAN_SLEEP,
+		.procname	= "khugepaged_scan_sleep_millisecs",
+		.data		= &khugepaged_scan_sleep_millisecs,
+		.maxlen		= sizeof(khugepaged_scan_sleep_millisecs),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &zero,
+	},
+#endif
+#ifdef CONFIG_KSM
+	{
+		.ctl_name	= VM_KSM_RUN,
+		.procname	= "ksm_run",
+		.data		= &sysctl_ksm_run,
+		.maxlen		= sizeof(sysctl_ksm_run),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec,
+	},
+	{
+		.ctl_name	= VM_KSM_PAGES_TO_SCAN,
+		.procname	= "ksm_pages_to_scan",
+		.data		= &ksm_pages_to_scan,
+		.maxlen		= sizeof(ksm_pages_to_scan),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &zero,
+	},
+	{
+		.ctl_name	= VM_KSM_SLEEP,
+		.procname	= "ksm_sleep_millisecs",
+		.data		= &ksm_sleep_millisecs,
+		.maxlen		= sizeof(ksm_sleep_millisecs),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &zero,
+	},
+	{
+		.ctl_name	= VM_KSM_PAGES_SHARED,
+		.procname	= "ksm_pages_shared",
+		.data		= &ksm_pages_shared,
+		.maxlen		= sizeof(ksm_pages_shared),
+		.mode		= 0444,
+		.proc_handler	= &proc_doulongvec_minmax,
+	},
+	{
+		.ctl_name	= VM_KSM_PAGES_SHARING,
+		.procname	= "ksm_pages_sharing",
+		.data		= &ksm_pages_sharing,
+		.maxlen		= sizeof(ksm_pages_sharing),
+		.mode		= 0444,
+		.proc_handler	= &proc_doulongvec_minmax,
+	},
+#endif
+#ifdef CONFIG_ZSWAP
+	{
+		.ctl_name	= VM_ZSWAP,
+		.procname	= "zswap",
+		.data		= &sysctl_zswap,
+		.maxlen		= sizeof(sysctl_zswap),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec,
+	},
+	{
+		.ctl_name	= VM_ZSWAP_MAX_POOL_PERCENT,
+		.procname	= "zswap_max_pool_percent",
+		.data		= &zswap_max_pool_percent,
+		.maxlen		= sizeof(zswap_max_pool_percent),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &zero,
+		.extra2		= &one_hundred,
+	},
+	{
+		.ctl_name	= VM_ZSWAP_STORED_PAGES,
+		.procname	= "zswap_stored_pages",
+		.data		= &zswap_stored_pages,
+		.maxlen		= sizeof(zswap_stored_pages),
+		.mode		= 0444,
+		.proc_handler	= &proc_doulongvec_minmax,
+	},
+	{
+		.ctl_name	= VM_ZSWAP_POOL_PAGES,
+		.procname	= "zswap_pool_pages",
+		.data		= &zswap_pool_pages,
+		.maxlen		= sizeof(zswap_pool_pages),
+		.mode		= 0444,
+		.proc_handler	= &proc_doulongvec_minmax,
+	},
+#endif
 #ifdef CONFIG_MMU
 	{
 		.ctl_name	= VM_MAX_MAP_COUNT,
@@ -771,6 +937,17 @@ static ctl_table vm_table[] = {
 		.mode		= 0644,
 		.proc_handler	= &proc_dointvec
 	},
+	{
+		.ctl_name	= VM_FAULT_AROUND_PAGES,
+		.procname	= "fault_around_pages",
+		.data		= &sysctl_fault_around_pages,
+		.maxlen		= sizeof(sysctl_fault_around_pages),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &one,
+		.extra2		= &ptrs_per_pte,
+	},
 #endif
 	{
 		.ctl_name	= VM_LAPTOP_MODE,
@@ -32,6 +32,8 @@
 #include <linux/jiffies.h>
 #include <linux/cpu.h>
 #include <linux/syscalls.h>
+#include <linux/hrtimer.h>
+#include <linux/seq_file.h>
 
 #include <asm/uaccess.h>
 #include <asm/unistd.h>
@@ -55,12 +57,35 @@ static void time_interpolator_update(long delta_nsec);
 #define TVN_MASK (TVN_SIZE - 1)
 #define TVR_MASK (TVR_SIZE - 1)
 
+/*
+ * Every wheel covers twice the span of one slot of the wheel above it.
+ * That way the outer slot which becomes current next can be cascaded
+ * a few timers per tick over a whole slot period, instead of all at
+ * once when the inner wheel wraps.  The outermost wheel is only ever
+ * cascaded from, so it keeps TVN_SIZE slots.
+ */
+#define TV1_SIZE (TVR_SIZE << 1)
+#define TV1_MASK (TV1_SIZE - 1)
+#define TVX_SIZE (TVN_SIZE << 1)
+#define TVX_MASK (TVX_SIZE - 1)
+#define TVN_LEVELS 4
+
+/* slot granularity, span and index mask of outer wheel n (tv2 is n == 0) */
+#define LVL_SHIFT(n)	(TVR_BITS + (n) * TVN_BITS)
+#define LVL_SPAN(n)	(1UL << (LVL_SHIFT(n) + TVN_BITS + 1))
+#define LVL_MASK(n)	((n) < TVN_LEVELS - 1 ? TVX_MASK : TVN_MASK)
+
+/* lower bound of timers cascaded per tick, per wheel */
+#define CASCADE_BATCH_MIN 4UL
+
 typedef struct tvec_s {
-	struct list_head vec[TVN_SIZE];
+	struct list_head vec[TVX_SIZE];
+	/* timers added to each slot since it was last cascaded */
+	unsigned int nr[TVX_SIZE];
 } tvec_t;
 
 typedef struct tvec_root_s {
-	struct list_head vec[TVR_SIZE];
+	struct list_head vec[TV1_SIZE];
 } tvec_root_t;
 
 /**
@@ -81,25 +106,26 @@ struct tvec_t_base_s {
 	 */
 	struct timer_list *running_timer;
 	/**
-	 * һ飬ڽŵ255ڽҪڵж̬ʱ
+	 * һ飬ڽŵ511ڽҪڵж̬ʱ
 	 */
 	tvec_root_t tv1;
 	/**
-	 * һ飬ڽŵ2^14-1ڽҪڵж̬ʱ
+	 * ʱ֡tvn[0]tvn[3]ĲȷֱΪ2^8,2^14,2^20,2^26ġ
 	 */
-	tvec_t tv2;
+	tvec_t tvn[TVN_LEVELS];
 	/**
-	 * һ飬ڽŵ2^20-1ڽҪڵж̬ʱ
+	 * ÿʱһΪǰĲۡÿĴǨcascade_batchʱڲ㡣
 	 */
-	tvec_t tv3;
+	struct list_head cascade[TVN_LEVELS];
+	unsigned long cascade_batch[TVN_LEVELS];
 	/**
-	 * һ飬ڽŵ2^26-1ڽҪڵж̬ʱ
+	 * ͳϢ/proc/timerstat
 	 */
-	tvec_t tv4;
-	/**
-	 * һ飬һexpiresڵڵĶ̬ʱ
-	 */
-	tvec_t tv5;
+	unsigned long nr_added;
+	unsigned long nr_expired;
+	unsigned long nr_cascaded;
+	unsigned long nr_flushed;
+	unsigned long max_tick_cascade;
 } ____cacheline_aligned_in_smp;
 
 typedef struct tvec_t_base_s tvec_base_t;
@@ -149,37 +175,41 @@ static void internal_add_timer(tvec_base_t *base, struct timer_list *timer)
 	unsigned long expires = timer->expires;
 	unsigned long idx = expires - base->timer_jiffies;
 	struct list_head *vec;
+	unsigned long slot;
+	int n;
 
-	if (idx < TVR_SIZE) {
-		int i = expires & TVR_MASK;
-		vec = base->tv1.vec + i;
-	} else if (idx < 1 << (TVR_BITS + TVN_BITS)) {
-		int i = (expires >> TVR_BITS) & TVN_MASK;
-		vec = base->tv2.vec + i;
-	} else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS)) {
-		int i = (expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK;
-		vec = base->tv3.vec + i;
-	} else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS)) {
-		int i = (expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK;
-		vec = base->tv4.vec + i;
-	} else if ((signed long) idx < 0) {
+	if ((signed long) idx < 0) {
 		/*
 		 * Can happen if you add a timer with expires == jiffies,
 		 * or you set a timer to go off in the past
 		 */
-		vec = base->tv1.vec + (base->timer_jiffies & TVR_MASK);
+		vec = base->tv1.vec + (base->timer_jiffies & TV1_MASK);
+		goto add;
+	} else if (idx < TV1_SIZE) {
+		vec = base->tv1.vec + (expires & TV1_MASK);
+		goto add;
+	} else if (idx < LVL_SPAN(0)) {
+		n = 0;
+	} else if (idx < LVL_SPAN(1)) {
+		n = 1;
+	} else if (idx < LVL_SPAN(2)) {
+		n = 2;
 	} else {
-		int i;
-		/* If the timeout is larger than 0xffffffff on 64-bit
-		 * architectures then we use the maximum timeout:
+		/*
+		 * If the timeout is larger than the outermost wheel can
+		 * hold without wrapping onto its current slot (a bit less
+		 * than 0xffffffff) then we use the maximum timeout:
 		 */
-		if (idx > 0xffffffffUL) {
-			idx = 0xffffffffUL;
+		if (idx >= ((unsigned long)TVN_MASK << LVL_SHIFT(3))) {
+			idx = ((unsigned long)TVN_MASK << LVL_SHIFT(3)) - 1;
 			expires = idx + base->timer_jiffies;
 		}
-		i = (expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK;
-		vec = base->tv5.vec + i;
+		n = 3;
 	}
+	slot = (expires >> LVL_SHIFT(n)) & LVL_MASK(n);
+	vec = base->tvn[n].vec + slot;
+	base->tvn[n].nr[slot]++;
+add:
 	/*
 	 * Timers are FIFO:
 	 */
@@ -240,6 +270,7 @@ repeat:
 	timer->expires = expires;
 	internal_add_timer(new_base, timer);
 	timer->base = new_base;
+	new_base->nr_added++;
 
 	if (old_base && (new_base != old_base))
 		spin_unlock(&old_base->lock);
@@ -270,7 +301,16 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	spin_lock_irqsave(&base->lock, flags);
 	internal_add_timer(base, timer);
 	timer->base = base;
+	base->nr_added++;
 	spin_unlock_irqrestore(&base->lock, flags);
+#if defined(CONFIG_NO_IDLE_HZ) && defined(CONFIG_SMP)
+	/*
+	 * The target cpu may be idle with its tick programmed for a later
+	 * timer. Kick it so that it looks at the wheel again.
+	 */
+	if (cpu_isset(cpu, nohz_cpu_mask))
+		smp_send_reschedule(cpu);
+#endif
 }
 
 
@@ -433,43 +473,98 @@ int del_singleshot_timer_sync(struct timer_list *timer)
 EXPORT_SYMBOL(del_singleshot_timer_sync);
 #endif
 
+/*
+ * Move up to @budget timers from the slot being cascaded on outer wheel
+ * @n to where they belong now.  They all expire less than two slots of
+ * wheel @n away, so they land on an inner wheel.
+ */
 /**
- * ̬ʱֱСtv1tv5,ֱ𱣴2^8,2^14,2^20,2^26,2^32tickڵĶʱ
- * tv1Ϊʱcascadetv5->tv4->tv3->tv2->tv1
- * ǰѺһеĶ̬ʱƶ
+ * ̬ʱֱtv1ĲʱС
+ * ʱֵĲڳΪǰ֮ǰһڣĵǨƵڲ㣬
+ * ڲʱֻʱһǨۡ
  */
-static int cascade(tvec_base_t *base, tvec_t *tv, int index)
+static unsigned long cascade(tvec_base_t *base, int n, unsigned long budget)
 {
-	/* cascade all the timers from tv up one level */
-	struct list_head *head, *curr;
+	struct list_head *head = base->cascade + n;
+	unsigned long moved = 0;
 
-	head = tv->vec + index;
-	curr = head->next;
-	/*
-	 * We are removing _all_ timers from the list, so we don't  have to
-	 * detach them individually, just clear the list afterwards.
-	 */
-	while (curr != head) {
+	while (moved < budget && !list_empty(head)) {
 		struct timer_list *tmp;
 
-		tmp = list_entry(curr, struct timer_list, entry);
+		tmp = list_entry(head->next, struct timer_list, entry);
 		BUG_ON(tmp->base != base);
-		curr = curr->next;
+		list_del(&tmp->entry);
 		internal_add_timer(base, tmp);
+		moved++;
+	}
+
+	return moved;
+}
+
+/*
+ * A slot of outer wheel @n becomes current at this tick.  Whatever of
+ * it has not been cascaded yet has to go now, before its first timers
+ * are due.  Then start on the following slot, spreading it over the
+ * next slot period.  No timer is added to a slot once it is being
+ * cascaded, and the slot's count includes every timer added to it
+ * (deleted ones too), so the batch always gets through it in time and
+ * nothing is left over for the flush: nr_flushed stays zero.
+ */
+static void cascade_start(tvec_base_t *base, int n)
+{
+	unsigned long total, next, slot;
+
+	base->nr_flushed += cascade(base, n, ~0UL);
+
+	next = base->timer_jiffies + (1UL << LVL_SHIFT(n));
+	slot = (next >> LVL_SHIFT(n)) & LVL_MASK(n);
+	total = base->tvn[n].nr[slot];
+	base->tvn[n].nr[slot] = 0;
+	base->cascade_batch[n] = max(CASCADE_BATCH_MIN,
+		(total + (1UL << LVL_SHIFT(n)) - 1) >> LVL_SHIFT(n));
+
+	list_splice_init(base->tvn[n].vec + slot, base->cascade + n);
+}
+
+/*
+ * Per tick cascade work: start new slots where a slot boundary is
+ * crossed (outermost first, so flushed timers can still be picked
+ * up by the inner wheels), then advance every slot being cascaded
+ * by its batch.
+ */
+static void cascade_tick(tvec_base_t *base)
+{
+	unsigned long moved = 0, nr_flushed = base->nr_flushed;
+	int n;
+
+	if (!(base->timer_jiffies & TVR_MASK)) {
+		for (n = TVN_LEVELS - 1; n >= 0; n--)
+			if (!(base->timer_jiffies & ((1UL << LVL_SHIFT(n)) - 1)))
+				cascade_start(base, n);
+		moved = base->nr_flushed - nr_flushed;
+	}
+
+	for (n = 0; n < TVN_LEVELS; n++) {
+		unsigned long nr;
+
+		if (list_empty(base->cascade + n))
+			continue;
+		nr = cascade(base, n, base->cascade_batch[n]);
+		base->nr_cascaded += nr;
+		moved += nr;
 	}
-	INIT_LIST_HEAD(head);
 
-	return index;
+	if (moved > base->max_tick_cascade)
+		base->max_tick_cascade = moved;
 }
 
 /***
  * __run_timers - run all expired timers (if any) on this CPU.
  * @base: the timer vector to be processed.
  *
- * This function cascades all vectors and executes all expired timer
+ * This function advances the cascades and executes all expired timer
  * vectors.
  */
-#define INDEX(N) (base->timer_jiffies >> (TVR_BITS + N * TVN_BITS)) & TVN_MASK
 
 /**
  * CPUĶ̬ʱжִС
@@ -497,20 +592,15 @@ static inline void __run_timers(tvec_base_t *base)
 		/**
 		 * indexbase->tv1ֵһνҪĶʱ
 		 */
- 		int index = base->timer_jiffies & TVR_MASK;
+ 		int index = base->timer_jiffies & TV1_MASK;
  
 		/*
 		 * Cascade timers:
 		 */
 		/**
-		 * index == 0˵tv1Ѿˡͨcascade˶̬ʱ
-		 * cascadetv5->tv4->tv3->tv2->tv1
+		 * ÿֻǨĶʱһǨɵӳټ塣
 		 */
-		if (!index &&
-			(!cascade(base, &base->tv2, INDEX(0))) &&
-				(!cascade(base, &base->tv3, INDEX(1))) &&
-					!cascade(base, &base->tv4, INDEX(2)))
-			cascade(base, &base->tv5, INDEX(3));
+		cascade_tick(base);
 		/**
 		 * һѭͽtimer_jiffies
 		 */
@@ -539,6 +629,7 @@ repeat:
 			 * ɾʱ
 			 */
 			list_del(&timer->entry);
+			base->nr_expired++;
 			/**
 			 * õǰCPUڴĶʱ
 			 */
@@ -571,7 +662,8 @@ repeat:
 #ifdef CONFIG_NO_IDLE_HZ
 /*
  * Find out when the next timer event is due to happen. This
- * is used on S/390 to stop all activity when a cpus is idle.
+ * is used to stop the tick of an idle cpu (on S/390 to stop all
+ * its activity) until then.
  * This functions needs to be called disabled.
  */
 unsigned long next_timer_interrupt(void)
@@ -580,63 +672,164 @@ unsigned long next_timer_interrupt(void)
 	struct list_head *list;
 	struct timer_list *nte;
 	unsigned long expires;
-	tvec_t *varray[4];
-	int i, j;
+	int i, n;
+	ktime_t hr_delta;
+	unsigned long hr_expires = 0;
+	int hr_pending = 0;
+
+	/*
+	 * hrtimers are not in the wheel, so bound the sleep by the first
+	 * of them as well.  Convert the delta to jiffies, rounding up.
+	 */
+	hr_delta = hrtimer_get_next_event();
+	if (hr_delta.tv64 != KTIME_MAX) {
+		struct timespec tsdelta;
+
+		if (hr_delta.tv64 < 0)
+			hr_delta.tv64 = 0;
+		tsdelta = ktime_to_timespec(hr_delta);
+		hr_expires = timespec_to_jiffies(&tsdelta);
+		if (hr_expires < 3)
+			return hr_expires + jiffies;
+		hr_expires += jiffies;
+		hr_pending = 1;
+	}
 
 	base = &__get_cpu_var(tvec_bases);
 	spin_lock(&base->lock);
 	expires = base->timer_jiffies + (LONG_MAX >> 1);
-	list = 0;
 
-	/* Look for timer events in tv1. */
-	j = base->timer_jiffies & TVR_MASK;
-	do {
-		list_for_each_entry(nte, base->tv1.vec + j, entry) {
-			expires = nte->expires;
-			if (j < (base->timer_jiffies & TVR_MASK))
-				list = base->tv2.vec + (INDEX(0));
-			goto found;
-		}
-		j = (j + 1) & TVR_MASK;
-	} while (j != (base->timer_jiffies & TVR_MASK));
-
-	/* Check tv2-tv5. */
-	varray[0] = &base->tv2;
-	varray[1] = &base->tv3;
-	varray[2] = &base->tv4;
-	varray[3] = &base->tv5;
-	for (i = 0; i < 4; i++) {
-		j = INDEX(i);
-		do {
-			if (list_empty(varray[i]->vec + j)) {
-				j = (j + 1) & TVN_MASK;
-				continue;
-			}
-			list_for_each_entry(nte, varray[i]->vec + j, entry)
-				if (time_before(nte->expires, expires))
-					expires = nte->expires;
-			if (j < (INDEX(i)) && i < 3)
-				list = varray[i + 1]->vec + (INDEX(i + 1));
-			goto found;
-		} while (j != (INDEX(i)));
+	/*
+	 * Look for timer events in tv1: slots are in expiry order from
+	 * the current one, so the first occupied one holds the earliest.
+	 */
+	for (i = 0; i < TV1_SIZE; i++) {
+		list = base->tv1.vec + ((base->timer_jiffies + i) & TV1_MASK);
+		if (list_empty(list))
+			continue;
+		list_for_each_entry(nte, list, entry)
+			if (time_before(nte->expires, expires))
+				expires = nte->expires;
+		break;
 	}
-found:
-	if (list) {
-		/*
-		 * The search wrapped. We need to look at the next list
-		 * from next tv element that would cascade into tv element
-		 * where we found the timer element.
-		 */
-		list_for_each_entry(nte, list, entry) {
+
+	/*
+	 * Check the slots being cascaded, and on each outer wheel the
+	 * first occupied slot after them.  Outer wheels never hold a timer
+	 * for the current or the next slot, and never wrap onto an
+	 * occupied slot, so that slot holds the wheel's earliest timers.
+	 */
+	for (n = 0; n < TVN_LEVELS; n++) {
+		unsigned long idx = base->timer_jiffies >> LVL_SHIFT(n);
+
+		list_for_each_entry(nte, base->cascade + n, entry)
 			if (time_before(nte->expires, expires))
 				expires = nte->expires;
+
+		for (i = 2; i <= LVL_MASK(n) + 1; i++) {
+			list = base->tvn[n].vec + ((idx + i) & LVL_MASK(n));
+			if (list_empty(list))
+				continue;
+			list_for_each_entry(nte, list, entry)
+				if (time_before(nte->expires, expires))
+					expires = nte->expires;
+			break;
 		}
 	}
 	spin_unlock(&base->lock);
+
+	if (hr_pending && time_before(hr_expires, expires))
+		return hr_expires;
+
 	return expires;
 }
 #endif
 
+#ifdef CONFIG_PROC_FS
+/*
+ * bump this up when changing the output format or the meaning of an
+ * existing field, so that tools can adapt (or abort)
+ */
+#define TIMERSTAT_VERSION 1
+
+/**
+ * /proc/timerstat: ÿCPU϶ʱӡڡǨƴ
+ * ǨƵԼʱֵǰǨ
+ */
+static int show_timerstat(struct seq_file *seq, void *v)
+{
+	int cpu, n;
+
+	seq_printf(seq, "version %d\n", TIMERSTAT_VERSION);
+	for_each_online_cpu(cpu) {
+		tvec_base_t *base = &per_cpu(tvec_bases, cpu);
+
+		seq_printf(seq, "cpu%d %lu %lu %lu %lu %lu",
+			   cpu, base->nr_added, base->nr_expired,
+			   base->nr_cascaded, base->nr_flushed,
+			   base->max_tick_cascade);
+		for (n = 0; n < TVN_LEVELS; n++)
+			seq_printf(seq, " %lu", base->cascade_batch[n]);
+		seq_putc(seq, '\n');
+	}
+	return 0;
+}
+
+static int timerstat_open(struct inode *inode, struct file *file)
+{
+	unsigned int size = PAGE_SIZE * (1 + num_online_cpus() / 32);
+	char *buf = kmalloc(size, GFP_KERNEL);
+	struct seq_file *m;
+	int res;
+
+	if (!buf)
+		return -ENOMEM;
+	res = single_open(file, show_timerstat, NULL);
+	if (!res) {
+		m = file->private_data;
+		m->buf = buf;
+		m->size = size;
+	} else
+		kfree(buf);
+	return res;
+}
+
+/*
+ * Any write to /proc/timerstat clears the counters of all cpus.
+ * The batch sizes are state, not statistics, and are left alone.
+ */
+static ssize_t timerstat_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+	int cpu;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	for_each_online_cpu(cpu) {
+		tvec_base_t *base = &per_cpu(tvec_bases, cpu);
+
+		spin_lock_irqsave(&base->lock, flags);
+		base->nr_added = 0;
+		base->nr_expired = 0;
+		base->nr_cascaded = 0;
+		base->nr_flushed = 0;
+		base->max_tick_cascade = 0;
+		spin_unlock_irqrestore(&base->lock, flags);
+	}
+	return count;
+}
+
+struct file_operations proc_timerstat_operations = {
+	.open    = timerstat_open,
+	.read    = seq_read,
+	.write   = timerstat_write,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+#endif /* CONFIG_PROC_FS */
+
 /******************************************************************/
 
 /*
@@ -1009,6 +1202,11 @@ static void run_timer_softirq(struct softirq_action *h)
 	 */
 	tvec_base_t *base = &__get_cpu_var(tvec_bases);
 
+	/**
+	 * ȴ߾ȶʱǲʱ֡
+	 */
+	hrtimer_run_queues();
+
 	if (time_after_eq(jiffies, base->timer_jiffies))
 		__run_timers(base);
 }
@@ -1282,93 +1480,6 @@ asmlinkage long sys_gettid(void)
 	return current->pid;
 }
 
-static long __sched nanosleep_restart(struct restart_block *restart)
-{
-	unsigned long expire = restart->arg0, now = jiffies;
-	struct timespec __user *rmtp = (struct timespec __user *) restart->arg1;
-	long ret;
-
-	/* Did it expire while we handled signals? */
-	if (!time_after(expire, now))
-		return 0;
-
-	current->state = TASK_INTERRUPTIBLE;
-	expire = schedule_timeout(expire - now);
-
-	ret = 0;
-	if (expire) {
-		struct timespec t;
-		jiffies_to_timespec(expire, &t);
-
-		ret = -ERESTART_RESTARTBLOCK;
-		if (rmtp && copy_to_user(rmtp, &t, sizeof(t)))
-			ret = -EFAULT;
-		/* The 'restart' block is already filled in */
-	}
-	return ret;
-}
-
-/**
- * nanosleepϵͳõķ̡
- * ֱָ̹ʱꡣ
- */
-asmlinkage long sys_nanosleep(struct timespec __user *rqtp, struct timespec __user *rmtp)
-{
-	struct timespec t;
-	unsigned long expire;
-	long ret;
-
-	/**
-	 * ȵcopy_frome_userʳtimerspecṹеֵƵֲtС
-	 */
-	if (copy_from_user(&t, rqtp, sizeof(t)))
-		return -EFAULT;
-
-	/**
-	 * ٶһЧӳ١
-	 */
-	if ((t.tv_nsec >= 1000000000L) || (t.tv_nsec < 0) || (t.tv_sec < 0))
-		return -EINVAL;
-
-	/**
-	 * timespec_to_jiffiestеʱתɽ
-	 * ټt.tv_sec || t.tv_nsecΪ˱
-	 * Ľʼջᱻһ
-	 */
-	expire = timespec_to_jiffies(&t) + (t.tv_sec || t.tv_nsec);
-	/**
-	 * schedule_timeoutö̬ʱʵ̵ֽʱ
-	 */
-	current->state = TASK_INTERRUPTIBLE;
-	/**
-	 * ܻ᷵һʣ
-	 */
-	expire = schedule_timeout(expire);
-
-	ret = 0;
-	/**
-	 * schedule_timeoutһʣϵͳñźŴˡ
-	 * ڴԶϵͳá
-	 */
-	if (expire) {
-		struct restart_block *restart;
-		jiffies_to_timespec(expire, &t);
-		if (rmtp && copy_to_user(rmtp, &t, sizeof(t)))
-			return -EFAULT;
-
-		restart = &current_thread_info()->restart_block;
-		restart->fn = nanosleep_restart;
-		restart->arg0 = jiffies + expire;
-		restart->arg1 = (unsigned long) rmtp;
-		/**
-		 * ERESTART_RESTARTBLOCKʾϵͳҪķʽǼ򵥵ִϵͳá
-		 * ִһָĺrestart_blockϵͳ˯һʱ䡣
-		 */
-		ret = -ERESTART_RESTARTBLOCK;
-	}
-	return ret;
-}
-
 /*
  * sys_sysinfo - fill in sysinfo struct
  */ 
@@ -1460,18 +1571,20 @@ asmlinkage long sys_sysinfo(struct sysinfo __user *info)
 
 static void __devinit init_timers_cpu(int cpu)
 {
-	int j;
+	int j, n;
 	tvec_base_t *base;
        
 	base = &per_cpu(tvec_bases, cpu);
 	spin_lock_init(&base->lock);
-	for (j = 0; j < TVN_SIZE; j++) {
-		INIT_LIST_HEAD(base->tv5.vec + j);
-		INIT_LIST_HEAD(base->tv4.vec + j);
-		INIT_LIST_HEAD(base->tv3.vec + j);
-		INIT_LIST_HEAD(base->tv2.vec + j);
+	for (n = 0; n < TVN_LEVELS; n++) {
+		for (j = 0; j < TVX_SIZE; j++) {
+			INIT_LIST_HEAD(base->tvn[n].vec + j);
+			base->tvn[n].nr[j] = 0;
+		}
+		INIT_LIST_HEAD(base->cascade + n);
+		base->cascade_batch[n] = CASCADE_BATCH_MIN;
 	}
-	for (j = 0; j < TVR_SIZE; j++)
+	for (j = 0; j < TV1_SIZE; j++)
 		INIT_LIST_HEAD(base->tv1.vec + j);
 
 	base->timer_jiffies = jiffies;
@@ -1500,7 +1613,7 @@ static void __devinit migrate_timers(int cpu)
 {
 	tvec_base_t *old_base;
 	tvec_base_t *new_base;
-	int i;
+	int i, n;
 
 	BUG_ON(cpu_online(cpu));
 	old_base = &per_cpu(tvec_bases, cpu);
@@ -1519,15 +1632,16 @@ again:
 
 	if (old_base->running_timer)
 		BUG();
-	for (i = 0; i < TVR_SIZE; i++)
+	for (i = 0; i < TV1_SIZE; i++)
 		if (!migrate_timer_list(new_base, old_base->tv1.vec + i))
 			goto unlock_again;
-	for (i = 0; i < TVN_SIZE; i++)
-		if (!migrate_timer_list(new_base, old_base->tv2.vec + i)
-		    || !migrate_timer_list(new_base, old_base->tv3.vec + i)
-		    || !migrate_timer_list(new_base, old_base->tv4.vec + i)
-		    || !migrate_timer_list(new_base, old_base->tv5.vec + i))
+	for (n = 0; n < TVN_LEVELS; n++) {
+		if (!migrate_timer_list(new_base, old_base->cascade + n))
 			goto unlock_again;
+		for (i = 0; i < TVX_SIZE; i++)
+			if (!migrate_timer_list(new_base, old_base->tvn[n].vec + i))
+				goto unlock_again;
+	}
 	spin_unlock(&old_base->lock);
 	spin_unlock(&new_base->lock);
 	local_irq_enable();
@@ -1572,6 +1686,7 @@ void __init init_timers(void)
 	timer_cpu_notify(&timers_nb, (unsigned long)CPU_UP_PREPARE,
 				(void *)(long)smp_processor_id());
 	register_cpu_notifier(&timers_nb);
+	hrtimers_init();
 	open_softirq(TIMER_SOFTIRQ, run_timer_softirq, NULL);
 }
 
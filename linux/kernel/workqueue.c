@@ -12,6 +12,19 @@
  *   Andrew Morton <andrewm@uow.edu.au>
  *   Kai Petzke <wpp@marie.physik.tu-berlin.de>
  *   Theodore Ts'o <tytso@mit.edu>
+ *
+ * Multithreaded workqueues no longer own threads.  Their work is run by
+ * a pool of workers per cpu shared by all of them.  A pool keeps one
+ * worker running at a time; when that worker blocks, the scheduler tells
+ * us and another one is woken (or created), so a sleeping work item does
+ * not hold up everything queued behind it.  When a pool makes no
+ * progress for a tick while work is waiting, an idle worker of another
+ * cpu is kicked to steal from it.
+ *
+ * Creating a worker allocates memory, so it cannot be what reclaim ends
+ * up waiting for.  Every multithreaded workqueue has a rescuer thread of
+ * its own: when a pool has work waiting and no idle worker, the rescuers
+ * of the workqueues with work there are called in to run it.
  */
 
 #include <linux/module.h>
@@ -25,6 +38,111 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/kthread.h>
+#include <linux/timer.h>
+
+/*
+ * Bit 1 of work->pending: the work was queued to a specific cpu and has
+ * to run there, every time it is queued.  Such works are never stolen.
+ */
+#define WORK_PINNED		1
+
+/* worker_pool->flags */
+#define POOL_PRIVATE		0x1	/* one worker, for a single thread wq */
+#define POOL_MANAGING		0x2	/* a worker is creating another one */
+#define POOL_DISASSOCIATED	0x4	/* cpu is gone, workers exit when idle */
+
+/* wq_worker->flags */
+#define WORKER_IDLE		0x1	/* on the idle list */
+#define WORKER_STEALING		0x2	/* running work of another cpu's pool */
+#define WORKER_SLEEPING		0x4	/* blocked in schedule() */
+
+#define WORKER_NOT_RUNNING	(WORKER_IDLE | WORKER_STEALING)
+
+/* idle workers above this number exit after IDLE_WORKER_TIMEOUT */
+#define MIN_IDLE_WORKERS	2
+#define IDLE_WORKER_TIMEOUT	(300 * HZ)
+
+/**
+ * ̳߳ءÿCPUһж̹߳й
+ * ̹߳иӵһֻһ̵߳˽̳߳ء
+ */
+struct worker_pool {
+	spinlock_t lock;
+	unsigned int flags;
+	/**
+	 * CPU˽̳߳Ϊ-1
+	 */
+	int cpu;
+
+	/**
+	 * йڱйĹ
+	 */
+	struct list_head worklist;
+	int nr_queued;
+	/**
+	 * һйʼִеʱ䣬жϱǷͣ
+	 */
+	unsigned long last_progress;
+
+	/**
+	 * УûпУҲûĹ߳
+	 * ٵ0һйĹʱһеĹ̡߳
+	 */
+	atomic_t nr_running;
+	int nr_workers;
+	int nr_idle;
+	int next_id;
+	/**
+	 * еĹ߳
+	 */
+	struct list_head idle_list;
+	/**
+	 * ִбйĹ߳CPUȡ̣߳
+	 */
+	struct list_head busy_list;
+
+	/**
+	 * ͣʱCPUϵĿй߳ȡ
+	 */
+	struct timer_list steal_timer;
+	unsigned long nr_stolen;
+
+	/**
+	 * CPUʱ1ϾɵĹ߳ѾٰڱCPUϣ
+	 * ǲִбصĹк˳
+	 */
+	unsigned int gen;
+} ____cacheline_aligned_in_smp;
+
+/**
+ * ߳
+ */
+struct wq_worker {
+	/**
+	 * ʱ̳߳صidle_list
+	 */
+	struct list_head entry;
+	/**
+	 * ִйʱù̳߳صbusy_list
+	 */
+	struct list_head busy_entry;
+	/**
+	 * ִеĹͻͬһwork_structٴŶӣĹڵǰɺִ
+	 */
+	struct list_head scheduled;
+	struct worker_pool *pool;
+	struct worker_pool *current_pool;
+	struct work_struct *current_work;
+	struct cpu_workqueue_struct *current_cwq;
+	struct task_struct *task;
+	unsigned int flags;
+	unsigned long last_active;
+	unsigned int gen;	/* pool->gen when created */
+	int id;
+	int run_depth;		/* Detect run_workqueue() recursion depth */
+};
+
+static DEFINE_PER_CPU(struct worker_pool, worker_pools);
 
 /*
  * The per-CPU workqueue (if single thread, we always use cpu 0's).
@@ -34,18 +152,19 @@
  * want to be livelocked by new, incoming ones.  So it waits until
  * remove_sequence is >= the insert_sequence which pertained when
  * flush_scheduled_work() was called.
+ *
+ * Everything in here is protected by pool->lock.
  */
 /**
  * ÿCPUĹ
  * ӳٺҪڣڽģӳٺжġ
+ * ӵй̣߳Ĺpoolָ̳߳С
  */
 struct cpu_workqueue_struct {
 	/**
-	 * ùе
-	 * ȻÿCPUԼĹУʱҲҪCPUĹ
-	 * ҲҪ	 
+	 * ִбй̳߳أ
 	 */
-	spinlock_t lock;
+	struct worker_pool *pool;
 
 	/**
 	 * flush_workqueueʹõļ
@@ -53,14 +172,6 @@ struct cpu_workqueue_struct {
 	long remove_sequence;	/* Least-recently added (next to run) */
 	long insert_sequence;	/* Next to add */
 
-	/**
-	 * ͷ
-	 */
-	struct list_head worklist;
-	/**
-	 * ȴУеĹ߳ΪȴĹ˯״̬
-	 */
-	wait_queue_head_t more_work;
 	/**
 	 * ȴУеĽڵȴбˢ¶˯״̬
 	 */
@@ -70,15 +181,6 @@ struct cpu_workqueue_struct {
 	 * ָworkqueue_structָ룬workqueue_structа˱
 	 */
 	struct workqueue_struct *wq;
-	/**
-	 * ̵ָ߳Ľָ
-	 */
-	task_t *thread;
-
-	/**
-	 * ǰִȣеĺʱֶεֵ1
-	 */
-	int run_depth;		/* Detect run_workqueue() recursion depth */
 } ____cacheline_aligned;
 
 /*
@@ -93,31 +195,154 @@ struct workqueue_struct {
 	struct cpu_workqueue_struct cpu_wq[NR_CPUS];
 	const char *name;
 	struct list_head list; 	/* Empty if single thread */
+	/**
+	 * ̹߳е˽̳߳ؼ乤߳
+	 */
+	struct worker_pool *single_pool;
+	task_t *thread;
+	/**
+	 * ̹߳еľԮ̡̳߳߳йĹȴûпеĹ߳ʱ
+	 * óڵCPUִбеĹ
+	 */
+	struct wq_worker *rescuer;
+	cpumask_t mayday_mask;	/* pools calling the rescuer, wq_mayday_lock */
 };
 
-/* All the per-cpu workqueues on the system, for hotplug cpu to add/remove
-   threads to each one as cpus come/go. */
+/* All the multithreaded workqueues on the system. */
 static DEFINE_SPINLOCK(workqueue_lock);
 static LIST_HEAD(workqueues);
 
+/* Nests inside pool->lock. */
+static DEFINE_SPINLOCK(wq_mayday_lock);
+
 /* If it's single threaded, it isn't in the list of workqueues. */
 static inline int is_single_threaded(struct workqueue_struct *wq)
 {
 	return list_empty(&wq->list);
 }
 
+/*
+ * The worker's cpu went down after it was created, so it no longer runs
+ * there; pool->lock must be held.
+ */
+static inline int worker_stale(struct wq_worker *worker)
+{
+	return worker->gen != worker->pool->gen;
+}
+
+/*
+ * A pool is stalled when work is waiting, a worker is busy on this cpu
+ * and nothing has been started or finished since the last tick.  Read
+ * without the lock: it is only a hint for stealing.
+ */
+static inline int pool_stalled(struct worker_pool *pool)
+{
+	return pool->nr_queued && atomic_read(&pool->nr_running) &&
+		time_after(jiffies, pool->last_progress);
+}
+
+/*
+ * @pool has work waiting but no idle worker to run it, and creating one
+ * may be just what is stuck.  Call in the rescuers of the workqueues
+ * with work there.  pool->lock must be held.
+ */
+static void send_mayday(struct worker_pool *pool)
+{
+	struct work_struct *work;
+
+	if (pool->flags & (POOL_PRIVATE | POOL_DISASSOCIATED))
+		return;
+
+	spin_lock(&wq_mayday_lock);
+	list_for_each_entry(work, &pool->worklist, entry) {
+		struct workqueue_struct *wq =
+			((struct cpu_workqueue_struct *)work->wq_data)->wq;
+
+		if (wq->rescuer && !cpu_isset(pool->cpu, wq->mayday_mask)) {
+			cpu_set(pool->cpu, wq->mayday_mask);
+			wake_up_process(wq->rescuer->task);
+		}
+	}
+	spin_unlock(&wq_mayday_lock);
+}
+
+/*
+ * Wake up the first idle worker, or the rescuers if there is none;
+ * pool->lock must be held.
+ */
+static void wake_up_worker(struct worker_pool *pool)
+{
+	struct wq_worker *worker;
+
+	if (list_empty(&pool->idle_list)) {
+		send_mayday(pool);
+		return;
+	}
+	worker = list_entry(pool->idle_list.next, struct wq_worker, entry);
+	wake_up_process(worker->task);
+}
+
+/*
+ * Kick an idle worker of some other cpu with nothing to run, so that it
+ * comes and steals from @pool.  Returns non-zero if one was woken.
+ */
+static int kick_thief(struct worker_pool *pool)
+{
+	unsigned long flags;
+	int i, cpu, ret = 0;
+
+	for (i = 1; i < NR_CPUS && !ret; i++) {
+		struct worker_pool *thief;
+
+		cpu = (pool->cpu + i) % NR_CPUS;
+		if (!cpu_online(cpu))
+			continue;
+		thief = &per_cpu(worker_pools, cpu);
+		if (atomic_read(&thief->nr_running) || !thief->nr_idle)
+			continue;
+
+		spin_lock_irqsave(&thief->lock, flags);
+		if (!atomic_read(&thief->nr_running) && thief->nr_idle &&
+		    !(thief->flags & POOL_DISASSOCIATED)) {
+			wake_up_worker(thief);
+			ret = 1;
+		}
+		spin_unlock_irqrestore(&thief->lock, flags);
+	}
+	return ret;
+}
+
+static void steal_timer_fn(unsigned long data)
+{
+	struct worker_pool *pool = (struct worker_pool *)data;
+
+	/* keep kicking every tick for as long as the backlog stays */
+	if (pool_stalled(pool) && kick_thief(pool))
+		mod_timer(&pool->steal_timer, jiffies + 1);
+}
+
 /* Preempt must be disabled. */
 static void __queue_work(struct cpu_workqueue_struct *cwq,
 			 struct work_struct *work)
 {
+	struct worker_pool *pool = cwq->pool;
 	unsigned long flags;
 
-	spin_lock_irqsave(&cwq->lock, flags);
+	spin_lock_irqsave(&pool->lock, flags);
 	work->wq_data = cwq;
-	list_add_tail(&work->entry, &cwq->worklist);
+	list_add_tail(&work->entry, &pool->worklist);
+	pool->nr_queued++;
 	cwq->insert_sequence++;
-	wake_up(&cwq->more_work);
-	spin_unlock_irqrestore(&cwq->lock, flags);
+	/**
+	 * ûеḶ́߳һе̡߳
+	 * ¹ҪȴǰɡһʱȻûнչCPUȡ
+	 */
+	if (!atomic_read(&pool->nr_running))
+		wake_up_worker(pool);
+	else if (!(pool->flags & POOL_PRIVATE) &&
+		 !timer_pending(&pool->steal_timer))
+		mod_timer(&pool->steal_timer, jiffies + 1);
+	spin_unlock_irqrestore(&pool->lock, flags);
 }
 
 /*
@@ -147,7 +372,7 @@ int fastcall queue_work(struct workqueue_struct *wq, struct work_struct *work)
 		BUG_ON(!list_empty(&work->entry));
 		/**
 		 * __queue_work뵽С
-		 * ߳ڱCPUcpu_workqueue_structmore_work˯ߣ̡߳
+		 * ̳߳ûеḶ́߳һе̡߳
 		 */
 		__queue_work(wq->cpu_wq + cpu, work);
 		ret = 1;
@@ -189,49 +414,294 @@ int fastcall queue_delayed_work(struct workqueue_struct *wq,
 	return ret;
 }
 
-static inline void run_workqueue(struct cpu_workqueue_struct *cwq)
+static struct wq_worker *find_worker_executing_work(struct worker_pool *pool,
+						    struct work_struct *work)
 {
-	unsigned long flags;
+	struct wq_worker *worker;
+
+	list_for_each_entry(worker, &pool->busy_list, busy_entry)
+		if (worker->current_work == work)
+			return worker;
+	return NULL;
+}
+
+/*
+ * Run @work, which has been taken off @pool's worklist, and then any
+ * works that collided with it.  Called and returns with pool->lock held,
+ * drops it around the work functions.
+ */
+static void process_one_work(struct wq_worker *worker,
+			     struct worker_pool *pool,
+			     struct work_struct *work)
+{
+	struct work_struct *prev_work = worker->current_work;
+	struct cpu_workqueue_struct *prev_cwq = worker->current_cwq;
+	struct worker_pool *prev_pool = worker->current_pool;
+	struct wq_worker *collision;
 
 	/*
-	 * Keep taking off work from the queue until
-	 * done.
+	 * The work was requeued while another worker is still running it.
+	 * Leave it to that worker, so that one work never runs twice at
+	 * the same time on a cpu, as with the old per-cpu threads.
 	 */
-	spin_lock_irqsave(&cwq->lock, flags);
-	cwq->run_depth++;
-	if (cwq->run_depth > 3) {
-		/* morton gets to eat his hat */
-		printk("%s: recursion depth exceeded: %d\n",
-			__FUNCTION__, cwq->run_depth);
-		dump_stack();
+	collision = find_worker_executing_work(pool, work);
+	if (unlikely(collision) && collision != worker) {
+		list_add_tail(&work->entry, &collision->scheduled);
+		return;
 	}
-	while (!list_empty(&cwq->worklist)) {
-		struct work_struct *work = list_entry(cwq->worklist.next,
-						struct work_struct, entry);
+
+	if (!prev_work)
+		list_add(&worker->busy_entry, &pool->busy_list);
+	worker->current_pool = pool;
+	for (;;) {
+		struct cpu_workqueue_struct *cwq = work->wq_data;
 		void (*f) (void *) = work->func;
 		void *data = work->data;
 
-		list_del_init(cwq->worklist.next);
-		spin_unlock_irqrestore(&cwq->lock, flags);
+		worker->current_work = work;
+		worker->current_cwq = cwq;
+		pool->last_progress = jiffies;
+		spin_unlock_irq(&pool->lock);
 
-		BUG_ON(work->wq_data != cwq);
+		BUG_ON(cwq->pool != pool);
 		clear_bit(0, &work->pending);
 		f(data);
 
-		spin_lock_irqsave(&cwq->lock, flags);
+		spin_lock_irq(&pool->lock);
+		pool->last_progress = jiffies;
 		cwq->remove_sequence++;
 		wake_up(&cwq->work_done);
+
+		if (list_empty(&worker->scheduled))
+			break;
+		if (worker->pool == pool && worker_stale(worker)) {
+			/*
+			 * We run off-cpu now: hand the works that collided
+			 * with ours back to the pool's fresh workers.
+			 */
+			list_for_each_entry(work, &worker->scheduled, entry)
+				pool->nr_queued++;
+			list_splice_init(&worker->scheduled, &pool->worklist);
+			break;
+		}
+		work = list_entry(worker->scheduled.next,
+				  struct work_struct, entry);
+		list_del_init(&work->entry);
+	}
+	worker->current_work = prev_work;
+	worker->current_cwq = prev_cwq;
+	worker->current_pool = prev_pool;
+	if (!prev_work)
+		list_del_init(&worker->busy_entry);
+}
+
+static inline struct work_struct *dequeue_work(struct worker_pool *pool)
+{
+	struct work_struct *work = list_entry(pool->worklist.next,
+					      struct work_struct, entry);
+
+	list_del_init(&work->entry);
+	pool->nr_queued--;
+	return work;
+}
+
+/* Run everything queued on @pool by hand; pool->lock held. */
+static void run_workqueue(struct wq_worker *worker, struct worker_pool *pool)
+{
+	worker->run_depth++;
+	if (worker->run_depth > 3) {
+		/* morton gets to eat his hat */
+		printk("%s: recursion depth exceeded: %d\n",
+			__FUNCTION__, worker->run_depth);
+		dump_stack();
+	}
+	while (!list_empty(&pool->worklist))
+		process_one_work(worker, pool, dequeue_work(pool));
+	worker->run_depth--;
+}
+
+/*
+ * Worker state changes, all under pool->lock.  A worker counts in
+ * nr_running while it is neither idle, nor stealing, nor blocked.
+ */
+static void worker_enter_idle(struct wq_worker *worker)
+{
+	struct worker_pool *pool = worker->pool;
+
+	if (worker->flags & WORKER_STEALING)
+		worker->flags &= ~WORKER_STEALING;
+	else
+		atomic_dec(&pool->nr_running);
+	worker->flags |= WORKER_IDLE;
+	worker->last_active = jiffies;
+	pool->nr_idle++;
+	list_add(&worker->entry, &pool->idle_list);
+}
+
+static void worker_leave_idle(struct wq_worker *worker, int stealing)
+{
+	struct worker_pool *pool = worker->pool;
+
+	list_del_init(&worker->entry);
+	pool->nr_idle--;
+	worker->flags &= ~WORKER_IDLE;
+	if (stealing)
+		worker->flags |= WORKER_STEALING;
+	else
+		atomic_inc(&pool->nr_running);
+}
+
+static int worker_thread(void *__worker);
+
+static struct wq_worker *create_worker(struct worker_pool *pool,
+				       const char *name)
+{
+	struct wq_worker *worker;
+	struct task_struct *p;
+
+	worker = kmalloc(sizeof(*worker), GFP_KERNEL);
+	if (!worker)
+		return NULL;
+	memset(worker, 0, sizeof(*worker));
+	INIT_LIST_HEAD(&worker->entry);
+	INIT_LIST_HEAD(&worker->busy_entry);
+	INIT_LIST_HEAD(&worker->scheduled);
+	worker->pool = pool;
+	worker->flags = WORKER_IDLE;
+
+	spin_lock_irq(&pool->lock);
+	worker->id = pool->next_id++;
+	worker->gen = pool->gen;
+	spin_unlock_irq(&pool->lock);
+
+	if (pool->flags & POOL_PRIVATE)
+		p = kthread_create(worker_thread, worker, "%s", name);
+	else
+		p = kthread_create(worker_thread, worker, "kworker/%d:%d",
+				   pool->cpu, worker->id);
+	if (IS_ERR(p)) {
+		kfree(worker);
+		return NULL;
 	}
-	cwq->run_depth--;
-	spin_unlock_irqrestore(&cwq->lock, flags);
+	worker->task = p;
+	if (!(pool->flags & POOL_PRIVATE))
+		kthread_bind(p, pool->cpu);
+	return worker;
 }
 
-static int worker_thread(void *__cwq)
+/* Put a new worker on the idle list and let it run; pool->lock held. */
+static void start_worker(struct wq_worker *worker)
 {
-	struct cpu_workqueue_struct *cwq = __cwq;
-	DECLARE_WAITQUEUE(wait, current);
+	struct worker_pool *pool = worker->pool;
+
+	pool->nr_workers++;
+	pool->nr_idle++;
+	worker->last_active = jiffies;
+	list_add(&worker->entry, &pool->idle_list);
+	wake_up_process(worker->task);
+}
+
+/*
+ * The last idle worker of a shared pool is about to start working:
+ * create another one first, so that there is always someone to wake
+ * when a running worker blocks.  Drops pool->lock while creating.
+ */
+static void maybe_create_worker(struct worker_pool *pool)
+{
+	struct wq_worker *worker;
+
+	if (pool->nr_idle > 1 ||
+	    (pool->flags & (POOL_PRIVATE | POOL_MANAGING | POOL_DISASSOCIATED)))
+		return;
+
+	pool->flags |= POOL_MANAGING;
+	spin_unlock_irq(&pool->lock);
+	worker = create_worker(pool, NULL);
+	spin_lock_irq(&pool->lock);
+	if (worker)
+		start_worker(worker);
+	pool->flags &= ~POOL_MANAGING;
+}
+
+/*
+ * Nothing to do on our cpu: look for a stalled pool elsewhere and run
+ * one of its works.  Pinned works and works already running there are
+ * left alone.  Called and returns with our pool->lock held.  Returns 0
+ * if there was nothing to try (the lock was kept), 1 if a work was
+ * stolen and -1 if the attempt came back empty-handed.
+ */
+static int steal_work(struct wq_worker *worker)
+{
+	struct worker_pool *pool = worker->pool, *victim = NULL;
+	struct work_struct *work = NULL, *pos;
+	int i, cpu;
+
+	if (pool->flags & (POOL_PRIVATE | POOL_DISASSOCIATED))
+		return 0;
+
+	for (i = 1; i < NR_CPUS; i++) {
+		cpu = (pool->cpu + i) % NR_CPUS;
+		if (cpu_online(cpu) && pool_stalled(&per_cpu(worker_pools, cpu))) {
+			victim = &per_cpu(worker_pools, cpu);
+			break;
+		}
+	}
+	if (!victim)
+		return 0;
+
+	maybe_create_worker(pool);
+	worker_leave_idle(worker, 1);
+	spin_unlock_irq(&pool->lock);
+
+	spin_lock_irq(&victim->lock);
+	if (pool_stalled(victim)) {
+		list_for_each_entry(pos, &victim->worklist, entry) {
+			if (test_bit(WORK_PINNED, &pos->pending) ||
+			    find_worker_executing_work(victim, pos))
+				continue;
+			work = pos;
+			break;
+		}
+	}
+	if (work) {
+		list_del_init(&work->entry);
+		victim->nr_queued--;
+		victim->nr_stolen++;
+		process_one_work(worker, victim, work);
+	}
+	spin_unlock_irq(&victim->lock);
+
+	spin_lock_irq(&pool->lock);
+	worker_enter_idle(worker);
+	return work ? 1 : -1;
+}
+
+/* pool->lock held */
+static int worker_should_exit(struct wq_worker *worker)
+{
+	struct worker_pool *pool = worker->pool;
+
+	if (pool->flags & POOL_PRIVATE)
+		return 0;
+	if (worker_stale(worker))
+		return 1;
+	return pool->nr_idle > MIN_IDLE_WORKERS &&
+		time_after_eq(jiffies, worker->last_active + IDLE_WORKER_TIMEOUT);
+}
+
+/**
+ * ̡߳
+ * ̳߳ͬһʱֻһ߳У̷߳nr_runningΪ0ʱ˯ߡ
+ * е߳ʱȳwq_worker_sleepingһе̡߳
+ */
+static int worker_thread(void *__worker)
+{
+	struct wq_worker *worker = __worker;
+	struct worker_pool *pool = worker->pool;
+	long timeout = MAX_SCHEDULE_TIMEOUT;
 	struct k_sigaction sa;
 	sigset_t blocked;
+	int tried = 0;
 
 	current->flags |= PF_NOFREEZE;
 
@@ -248,47 +718,200 @@ static int worker_thread(void *__cwq)
 	siginitset(&sa.sa.sa_mask, sigmask(SIGCHLD));
 	do_sigaction(SIGCHLD, &sa, (struct k_sigaction *)0);
 
-	set_current_state(TASK_INTERRUPTIBLE);
-	while (!kthread_should_stop()) {
-		add_wait_queue(&cwq->more_work, &wait);
-		if (list_empty(&cwq->worklist))
-			schedule();
-		else
-			__set_current_state(TASK_RUNNING);
-		remove_wait_queue(&cwq->more_work, &wait);
+	current->wq_worker = worker;
+	if (!(pool->flags & POOL_PRIVATE)) {
+		current->flags |= PF_WQ_WORKER;
+		timeout = IDLE_WORKER_TIMEOUT;
+	}
 
-		if (!list_empty(&cwq->worklist))
-			run_workqueue(cwq);
+	spin_lock_irq(&pool->lock);
+	for (;;) {
+		int ret;
+
+		/* the cpu went down under us: leave to fresh workers */
+		if (worker_stale(worker))
+			break;
+
+		if (!list_empty(&pool->worklist) &&
+		    ((pool->flags & POOL_PRIVATE) ||
+		     !atomic_read(&pool->nr_running))) {
+			maybe_create_worker(pool);
+			worker_leave_idle(worker, 0);
+			/* stop when another worker came back from sleep */
+			while (!list_empty(&pool->worklist) &&
+			       !worker_stale(worker) &&
+			       ((pool->flags & POOL_PRIVATE) ||
+				atomic_read(&pool->nr_running) <= 1))
+				process_one_work(worker, pool,
+						 dequeue_work(pool));
+			worker_enter_idle(worker);
+			tried = 0;
+			continue;
+		}
+
+		ret = tried ? 0 : steal_work(worker);
+		if (ret) {
+			tried = ret < 0;
+			continue;
+		}
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop() || worker_should_exit(worker))
+			break;
+		spin_unlock_irq(&pool->lock);
+		schedule_timeout(timeout);
+		spin_lock_irq(&pool->lock);
+		tried = 0;
+	}
+	__set_current_state(TASK_RUNNING);
+	list_del(&worker->entry);
+	pool->nr_idle--;
+	pool->nr_workers--;
+	/* we may have been the worker woken for what is queued */
+	if (!list_empty(&pool->worklist) && !atomic_read(&pool->nr_running))
+		wake_up_worker(pool);
+	spin_unlock_irq(&pool->lock);
+
+	current->flags &= ~PF_WQ_WORKER;
+	current->wq_worker = NULL;
+	kfree(worker);
+	return 0;
+}
+
+/*
+ * Run the works of @wq waiting in @cpu's pool, on that cpu: pinned works
+ * have to run there.  A pool whose cpu is gone has had its works moved
+ * by take_over_work().
+ */
+static void rescue_pool(struct wq_worker *rescuer,
+			struct workqueue_struct *wq, int cpu)
+{
+	struct worker_pool *pool = &per_cpu(worker_pools, cpu);
+	struct work_struct *work, *pos;
+
+	if (set_cpus_allowed(current, cpumask_of_cpu(cpu)) < 0)
+		return;
+
+	spin_lock_irq(&pool->lock);
+	for (;;) {
+		work = NULL;
+		list_for_each_entry(pos, &pool->worklist, entry) {
+			if (((struct cpu_workqueue_struct *)pos->wq_data)->wq
+			    == wq) {
+				work = pos;
+				break;
+			}
+		}
+		if (!work || (pool->flags & POOL_DISASSOCIATED))
+			break;
+		list_del_init(&work->entry);
+		pool->nr_queued--;
+		process_one_work(rescuer, pool, work);
+	}
+	spin_unlock_irq(&pool->lock);
+}
+
+/**
+ * Ԯ̡߳send_maydayñеmayday_mask
+ * εȵCPUִбйĹ
+ */
+static int rescuer_thread(void *__wq)
+{
+	struct workqueue_struct *wq = __wq;
+	struct wq_worker *rescuer = wq->rescuer;
+	int cpu;
+
+	current->flags |= PF_NOFREEZE;
+	set_user_nice(current, -5);
+	current->wq_worker = rescuer;
+
+	for (;;) {
 		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop())
+			break;
+
+		spin_lock_irq(&wq_mayday_lock);
+		if (cpus_empty(wq->mayday_mask)) {
+			spin_unlock_irq(&wq_mayday_lock);
+			schedule();
+			continue;
+		}
+		cpu = first_cpu(wq->mayday_mask);
+		cpu_clear(cpu, wq->mayday_mask);
+		spin_unlock_irq(&wq_mayday_lock);
+		__set_current_state(TASK_RUNNING);
+
+		rescue_pool(rescuer, wq, cpu);
 	}
 	__set_current_state(TASK_RUNNING);
+	current->wq_worker = NULL;
 	return 0;
 }
 
+/*
+ * Called from schedule() when a shared pool worker is about to block,
+ * with preemption disabled.  If it was the last one running and work
+ * is waiting, wake an idle worker to take over.
+ */
+void wq_worker_sleeping(struct task_struct *task)
+{
+	struct wq_worker *worker = task->wq_worker;
+	struct worker_pool *pool = worker->pool;
+	unsigned long flags;
+
+	if (worker->flags & (WORKER_NOT_RUNNING | WORKER_SLEEPING))
+		return;
+	worker->flags |= WORKER_SLEEPING;
+	if (!atomic_dec_and_test(&pool->nr_running))
+		return;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (!list_empty(&pool->worklist))
+		wake_up_worker(pool);
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+/* Called from schedule() when a shared pool worker runs again. */
+void wq_worker_running(struct task_struct *task)
+{
+	struct wq_worker *worker = task->wq_worker;
+
+	if (worker->flags & WORKER_SLEEPING) {
+		worker->flags &= ~WORKER_SLEEPING;
+		atomic_inc(&worker->pool->nr_running);
+	}
+}
+
 static void flush_cpu_workqueue(struct cpu_workqueue_struct *cwq)
 {
-	if (cwq->thread == current) {
+	struct worker_pool *pool = cwq->pool;
+	struct wq_worker *worker = current->wq_worker;
+
+	if (worker && (worker->current_cwq == cwq ||
+		       (worker->pool == pool && (pool->flags & POOL_PRIVATE)))) {
 		/*
 		 * Probably keventd trying to flush its own queue. So simply run
 		 * it by hand rather than deadlocking.
 		 */
-		run_workqueue(cwq);
+		spin_lock_irq(&pool->lock);
+		run_workqueue(worker, pool);
+		spin_unlock_irq(&pool->lock);
 	} else {
 		DEFINE_WAIT(wait);
 		long sequence_needed;
 
-		spin_lock_irq(&cwq->lock);
+		spin_lock_irq(&pool->lock);
 		sequence_needed = cwq->insert_sequence;
 
 		while (sequence_needed - cwq->remove_sequence > 0) {
 			prepare_to_wait(&cwq->work_done, &wait,
 					TASK_UNINTERRUPTIBLE);
-			spin_unlock_irq(&cwq->lock);
+			spin_unlock_irq(&pool->lock);
 			schedule();
-			spin_lock_irq(&cwq->lock);
+			spin_lock_irq(&pool->lock);
 		}
 		finish_wait(&cwq->work_done, &wait);
-		spin_unlock_irq(&cwq->lock);
+		spin_unlock_irq(&pool->lock);
 	}
 }
 
@@ -316,44 +939,94 @@ void fastcall flush_workqueue(struct workqueue_struct *wq)
 	} else {
 		int cpu;
 
+		/*
+		 * Offline cpus too: the workers of a dead cpu's pool finish
+		 * what they were running before they exit.
+		 */
 		lock_cpu_hotplug();
-		for_each_online_cpu(cpu)
+		for_each_cpu(cpu)
 			flush_cpu_workqueue(wq->cpu_wq + cpu);
 		unlock_cpu_hotplug();
 	}
 }
 
-static struct task_struct *create_workqueue_thread(struct workqueue_struct *wq,
-						   int cpu)
+static void init_worker_pool(struct worker_pool *pool, int cpu)
+{
+	memset(pool, 0, sizeof(*pool));
+	spin_lock_init(&pool->lock);
+	pool->cpu = cpu;
+	INIT_LIST_HEAD(&pool->worklist);
+	INIT_LIST_HEAD(&pool->idle_list);
+	INIT_LIST_HEAD(&pool->busy_list);
+	atomic_set(&pool->nr_running, 0);
+	pool->last_progress = jiffies;
+	init_timer(&pool->steal_timer);
+	pool->steal_timer.function = steal_timer_fn;
+	pool->steal_timer.data = (unsigned long)pool;
+}
+
+static void init_cpu_workqueue(struct workqueue_struct *wq, int cpu,
+			       struct worker_pool *pool)
 {
 	struct cpu_workqueue_struct *cwq = wq->cpu_wq + cpu;
-	struct task_struct *p;
 
-	spin_lock_init(&cwq->lock);
+	cwq->pool = pool;
 	cwq->wq = wq;
-	cwq->thread = NULL;
 	cwq->insert_sequence = 0;
 	cwq->remove_sequence = 0;
-	INIT_LIST_HEAD(&cwq->worklist);
-	init_waitqueue_head(&cwq->more_work);
 	init_waitqueue_head(&cwq->work_done);
+}
 
-	if (is_single_threaded(wq))
-		p = kthread_create(worker_thread, cwq, "%s", wq->name);
-	else
-		p = kthread_create(worker_thread, cwq, "%s/%d", wq->name, cpu);
-	if (IS_ERR(p))
+/* Start the first worker of a cpu's shared pool. */
+static int start_first_worker(struct worker_pool *pool)
+{
+	struct wq_worker *worker = create_worker(pool, NULL);
+
+	if (!worker)
+		return -ENOMEM;
+	spin_lock_irq(&pool->lock);
+	start_worker(worker);
+	spin_unlock_irq(&pool->lock);
+	return 0;
+}
+
+static struct wq_worker *create_rescuer(struct workqueue_struct *wq)
+{
+	struct wq_worker *rescuer;
+	struct task_struct *p;
+
+	rescuer = kmalloc(sizeof(*rescuer), GFP_KERNEL);
+	if (!rescuer)
 		return NULL;
-	cwq->thread = p;
-	return p;
+	memset(rescuer, 0, sizeof(*rescuer));
+	INIT_LIST_HEAD(&rescuer->entry);
+	INIT_LIST_HEAD(&rescuer->busy_entry);
+	INIT_LIST_HEAD(&rescuer->scheduled);
+	wq->rescuer = rescuer;
+
+	p = kthread_create(rescuer_thread, wq, "%s", wq->name);
+	if (IS_ERR(p)) {
+		wq->rescuer = NULL;
+		kfree(rescuer);
+		return NULL;
+	}
+	rescuer->task = p;
+	wake_up_process(p);
+	return rescuer;
 }
 
+/**
+ * С
+ * ̹߳гʼÿCPUʹù̳߳أԼľԮ̣߳
+ * ̹߳дһ˽̳߳ؼ乤̡߳
+ */
 struct workqueue_struct *__create_workqueue(const char *name,
 					    int singlethread)
 {
-	int cpu, destroy = 0;
+	int cpu;
 	struct workqueue_struct *wq;
-	struct task_struct *p;
+	struct worker_pool *pool;
+	struct wq_worker *worker;
 
 	BUG_ON(strlen(name) > 10);
 
@@ -363,53 +1036,37 @@ struct workqueue_struct *__create_workqueue(const char *name,
 	memset(wq, 0, sizeof(*wq));
 
 	wq->name = name;
-	/* We don't need the distraction of CPUs appearing and vanishing. */
-	lock_cpu_hotplug();
 	if (singlethread) {
 		INIT_LIST_HEAD(&wq->list);
-		p = create_workqueue_thread(wq, 0);
-		if (!p)
-			destroy = 1;
-		else
-			wake_up_process(p);
+		pool = kmalloc(sizeof(*pool), GFP_KERNEL);
+		if (!pool)
+			goto fail;
+		init_worker_pool(pool, -1);
+		pool->flags = POOL_PRIVATE;
+		wq->single_pool = pool;
+		init_cpu_workqueue(wq, 0, pool);
+		worker = create_worker(pool, name);
+		if (!worker)
+			goto fail;
+		wq->thread = worker->task;
+		spin_lock_irq(&pool->lock);
+		start_worker(worker);
+		spin_unlock_irq(&pool->lock);
 	} else {
+		for_each_cpu(cpu)
+			init_cpu_workqueue(wq, cpu, &per_cpu(worker_pools, cpu));
+		if (!create_rescuer(wq))
+			goto fail;
 		spin_lock(&workqueue_lock);
 		list_add(&wq->list, &workqueues);
 		spin_unlock(&workqueue_lock);
-		for_each_online_cpu(cpu) {
-			p = create_workqueue_thread(wq, cpu);
-			if (p) {
-				kthread_bind(p, cpu);
-				wake_up_process(p);
-			} else
-				destroy = 1;
-		}
-	}
-	unlock_cpu_hotplug();
-
-	/*
-	 * Was there any error during startup? If yes then clean up:
-	 */
-	if (destroy) {
-		destroy_workqueue(wq);
-		wq = NULL;
 	}
 	return wq;
-}
 
-static void cleanup_workqueue_thread(struct workqueue_struct *wq, int cpu)
-{
-	struct cpu_workqueue_struct *cwq;
-	unsigned long flags;
-	struct task_struct *p;
-
-	cwq = wq->cpu_wq + cpu;
-	spin_lock_irqsave(&cwq->lock, flags);
-	p = cwq->thread;
-	cwq->thread = NULL;
-	spin_unlock_irqrestore(&cwq->lock, flags);
-	if (p)
-		kthread_stop(p);
+fail:
+	kfree(wq->single_pool);
+	kfree(wq);
+	return NULL;
 }
 
 /**
@@ -417,22 +1074,18 @@ static void cleanup_workqueue_thread(struct workqueue_struct *wq, int cpu)
  */
 void destroy_workqueue(struct workqueue_struct *wq)
 {
-	int cpu;
-
 	flush_workqueue(wq);
 
-	/* We don't need the distraction of CPUs appearing and vanishing. */
-	lock_cpu_hotplug();
-	if (is_single_threaded(wq))
-		cleanup_workqueue_thread(wq, 0);
-	else {
-		for_each_online_cpu(cpu)
-			cleanup_workqueue_thread(wq, cpu);
+	if (is_single_threaded(wq)) {
+		kthread_stop(wq->thread);
+		kfree(wq->single_pool);
+	} else {
 		spin_lock(&workqueue_lock);
 		list_del(&wq->list);
 		spin_unlock(&workqueue_lock);
+		kthread_stop(wq->rescuer->task);
+		kfree(wq->rescuer);
 	}
-	unlock_cpu_hotplug();
 	kfree(wq);
 }
 
@@ -448,6 +1101,10 @@ int fastcall schedule_delayed_work(struct work_struct *work, unsigned long delay
 	return queue_delayed_work(keventd_wq, work, delay);
 }
 
+/*
+ * The work is pinned: from now on it always runs on the cpu it is
+ * queued on, and the timer puts it on @cpu.
+ */
 int schedule_delayed_work_on(int cpu,
 			struct work_struct *work, unsigned long delay)
 {
@@ -457,6 +1114,7 @@ int schedule_delayed_work_on(int cpu,
 	if (!test_and_set_bit(0, &work->pending)) {
 		BUG_ON(timer_pending(timer));
 		BUG_ON(!list_empty(&work->entry));
+		set_bit(WORK_PINNED, &work->pending);
 		/* This stores keventd_wq for the moment, for the timer_fn */
 		work->wq_data = keventd_wq;
 		timer->expires = jiffies + delay;
@@ -478,40 +1136,67 @@ int keventd_up(void)
 	return keventd_wq != NULL;
 }
 
+/*
+ * keventd work runs in the shared pools, along with other workqueues',
+ * or in a rescuer, which has no pool of its own.
+ */
 int current_is_keventd(void)
 {
-	struct cpu_workqueue_struct *cwq;
-	int cpu = smp_processor_id();	/* preempt-safe: keventd is per-cpu */
-	int ret = 0;
+	struct wq_worker *worker = current->wq_worker;
 
 	BUG_ON(!keventd_wq);
 
-	cwq = keventd_wq->cpu_wq + cpu;
-	if (current == cwq->thread)
-		ret = 1;
-
-	return ret;
-
+	return worker && (!worker->pool ||
+			  !(worker->pool->flags & POOL_PRIVATE));
 }
 
 #ifdef CONFIG_HOTPLUG_CPU
 /* Take the work from this (downed) CPU. */
-static void take_over_work(struct workqueue_struct *wq, unsigned int cpu)
+static void take_over_work(unsigned int cpu)
 {
-	struct cpu_workqueue_struct *cwq = wq->cpu_wq + cpu;
+	struct worker_pool *pool = &per_cpu(worker_pools, cpu);
+	struct wq_worker *worker;
 	LIST_HEAD(list);
 	struct work_struct *work;
+	int nr = 0;
 
-	spin_lock_irq(&cwq->lock);
-	list_splice_init(&cwq->worklist, &list);
+	/*
+	 * Idle workers exit now, busy ones once they are done.  The queued
+	 * works are counted again where they are requeued, so take them off
+	 * their old cwq's insert_sequence: that then only covers what the
+	 * busy workers still have, and stays right when the cpu comes back.
+	 * Bumping the generation makes all the current workers stale, so
+	 * that they never run work of this pool again, even after the cpu
+	 * is back.
+	 */
+	spin_lock_irq(&pool->lock);
+	pool->flags |= POOL_DISASSOCIATED;
+	pool->gen++;
+	list_for_each_entry(work, &pool->worklist, entry) {
+		struct cpu_workqueue_struct *cwq = work->wq_data;
+
+		cwq->insert_sequence--;
+	}
+	list_splice_init(&pool->worklist, &list);
+	pool->nr_queued = 0;
+	list_for_each_entry(worker, &pool->idle_list, entry)
+		wake_up_process(worker->task);
+	spin_unlock_irq(&pool->lock);
+	del_timer_sync(&pool->steal_timer);
 
 	while (!list_empty(&list)) {
-		printk("Taking work for %s\n", wq->name);
+		struct workqueue_struct *wq;
+
 		work = list_entry(list.next,struct work_struct,entry);
-		list_del(&work->entry);
-		__queue_work(wq->cpu_wq + smp_processor_id(), work);
+		list_del_init(&work->entry);
+		wq = ((struct cpu_workqueue_struct *)work->wq_data)->wq;
+		__queue_work(wq->cpu_wq + get_cpu(), work);
+		put_cpu();
+		nr++;
 	}
-	spin_unlock_irq(&cwq->lock);
+	if (nr)
+		printk(KERN_DEBUG "workqueue: moved %d works off cpu %u\n",
+		       nr, cpu);
 }
 
 /* We're holding the cpucontrol mutex here */
@@ -520,41 +1205,30 @@ static int __devinit workqueue_cpu_callback(struct notifier_block *nfb,
 				  void *hcpu)
 {
 	unsigned int hotcpu = (unsigned long)hcpu;
-	struct workqueue_struct *wq;
+	struct worker_pool *pool = &per_cpu(worker_pools, hotcpu);
+	struct wq_worker *worker;
 
 	switch (action) {
-	case CPU_UP_PREPARE:
-		/* Create a new workqueue thread for it. */
-		list_for_each_entry(wq, &workqueues, list) {
-			if (create_workqueue_thread(wq, hotcpu) < 0) {
-				printk("workqueue for %i failed\n", hotcpu);
-				return NOTIFY_BAD;
-			}
-		}
-		break;
-
 	case CPU_ONLINE:
-		/* Kick off worker threads. */
-		list_for_each_entry(wq, &workqueues, list) {
-			kthread_bind(wq->cpu_wq[hotcpu].thread, hotcpu);
-			wake_up_process(wq->cpu_wq[hotcpu].thread);
-		}
-		break;
-
-	case CPU_UP_CANCELED:
-		list_for_each_entry(wq, &workqueues, list) {
-			/* Unbind so it can run. */
-			kthread_bind(wq->cpu_wq[hotcpu].thread,
-				     smp_processor_id());
-			cleanup_workqueue_thread(wq, hotcpu);
+		/*
+		 * Workers from before the cpu went down may still be around
+		 * on other cpus.  They are stale: kick the idle ones out,
+		 * busy ones exit when done.  Always start a fresh worker,
+		 * bound to the cpu by create_worker().
+		 */
+		spin_lock_irq(&pool->lock);
+		pool->flags &= ~POOL_DISASSOCIATED;
+		list_for_each_entry(worker, &pool->idle_list, entry)
+			wake_up_process(worker->task);
+		spin_unlock_irq(&pool->lock);
+		if (start_first_worker(pool) < 0) {
+			printk("workqueue for %i failed\n", hotcpu);
+			return NOTIFY_BAD;
 		}
 		break;
 
 	case CPU_DEAD:
-		list_for_each_entry(wq, &workqueues, list)
-			cleanup_workqueue_thread(wq, hotcpu);
-		list_for_each_entry(wq, &workqueues, list)
-			take_over_work(wq, hotcpu);
+		take_over_work(hotcpu);
 		break;
 	}
 
@@ -564,6 +1238,13 @@ static int __devinit workqueue_cpu_callback(struct notifier_block *nfb,
 
 void init_workqueues(void)
 {
+	int cpu;
+
+	for_each_cpu(cpu)
+		init_worker_pool(&per_cpu(worker_pools, cpu), cpu);
+	for_each_online_cpu(cpu)
+		BUG_ON(start_first_worker(&per_cpu(worker_pools, cpu)));
+
 	hotcpu_notifier(workqueue_cpu_callback, 0);
 	keventd_wq = create_workqueue("events");
 	BUG_ON(!keventd_wq);
@@ -29,6 +29,7 @@
 #include <linux/gfp.h>
 #include <linux/string.h>
 #include <linux/bitops.h>
+#include <linux/rcupdate.h>
 
 
 #ifdef __KERNEL__
@@ -48,10 +49,18 @@
  * ҳٻĽڵ
  */
 struct radix_tree_node {
+	/**
+	 * ӱڵ㵽ҶӵĲҴǴӸȡߡ
+	 */
+	unsigned int	height;
 	/**
 	 * ڵзǿָļ
 	 */
 	unsigned int	count;
+	/**
+	 * ڵ㾭RCUںͷţĶ߿ܻڷ
+	 */
+	struct rcu_head	rcu_head;
 	/**
 	 * 64ָ飬ЩָָҳҲָڵָ롣
 	 */
@@ -111,10 +120,23 @@ radix_tree_node_alloc(struct radix_tree_root *root)
 	return ret;
 }
 
+static void radix_tree_node_rcu_free(struct rcu_head *head)
+{
+	struct radix_tree_node *node =
+			container_of(head, struct radix_tree_node, rcu_head);
+
+	kmem_cache_free(radix_tree_node_cachep, node);
+}
+
+/*
+ * Lookups may run under rcu_read_lock() only, so a node which has just
+ * been unlinked can still be walked by a reader.  It is empty by now, and
+ * is returned to the slab once all those readers are done.
+ */
 static inline void
 radix_tree_node_free(struct radix_tree_node *node)
 {
-	kmem_cache_free(radix_tree_node_cachep, node);
+	call_rcu(&node->rcu_head, radix_tree_node_rcu_free);
 }
 
 /*
@@ -223,7 +245,8 @@ static int radix_tree_extend(struct radix_tree_root *root, unsigned long index)
 		}
 
 		node->count = 1;
-		root->rnode = node;
+		node->height = root->height + 1;
+		rcu_assign_pointer(root->rnode, node);
 		root->height++;
 	} while (height > root->height);
 out:
@@ -274,7 +297,8 @@ int radix_tree_insert(struct radix_tree_root *root,
 			 */
 			if (!(tmp = radix_tree_node_alloc(root)))
 				return -ENOMEM;
-			*slot = tmp;
+			tmp->height = height;
+			rcu_assign_pointer(*slot, tmp);
 			if (node)
 				node->count++;
 		}
@@ -298,42 +322,77 @@ int radix_tree_insert(struct radix_tree_root *root,
 		BUG_ON(tag_get(node, 1, offset));
 	}
 
-	*slot = item;
+	rcu_assign_pointer(*slot, item);
 	return 0;
 }
 EXPORT_SYMBOL(radix_tree_insert);
 
 /**
- *	radix_tree_lookup    -    perform lookup operation on a radix tree
+ *	radix_tree_lookup_slot    -    lookup a slot in a radix tree
  *	@root:		radix tree root
  *	@index:		index key
  *
- *	Lookup the item at the position @index in the radix tree @root.
+ *	Lookup the slot corresponding to the position @index in the radix tree
+ *	@root.  This is useful for replacing the item stored at @index in
+ *	place: the tags of @index are left untouched.  Returns NULL if there
+ *	is no item at @index.
+ *
+ *	Like radix_tree_lookup(), this may run under rcu_read_lock() alone,
+ *	but then the slot may be emptied or reused at any time, and the item
+ *	has to be read from it with rcu_dereference().
  */
-void *radix_tree_lookup(struct radix_tree_root *root, unsigned long index)
+void **radix_tree_lookup_slot(struct radix_tree_root *root,
+			      unsigned long index)
 {
 	unsigned int height, shift;
-	struct radix_tree_node **slot;
+	struct radix_tree_node *node, **slot;
 
-	height = root->height;
+	node = rcu_dereference(root->rnode);
+	if (node == NULL)
+		return NULL;
+
+	/*
+	 * root->height is not updated together with root->rnode, so take
+	 * the height of the node we actually found.
+	 */
+	height = node->height;
 	if (index > radix_tree_maxindex(height))
 		return NULL;
 
 	shift = (height-1) * RADIX_TREE_MAP_SHIFT;
-	slot = &root->rnode;
 
-	while (height > 0) {
-		if (*slot == NULL)
+	do {
+		slot = (struct radix_tree_node **)
+			(node->slots + ((index >> shift) & RADIX_TREE_MAP_MASK));
+		node = rcu_dereference(*slot);
+		if (node == NULL)
 			return NULL;
 
-		slot = (struct radix_tree_node **)
-			((*slot)->slots +
-				((index >> shift) & RADIX_TREE_MAP_MASK));
 		shift -= RADIX_TREE_MAP_SHIFT;
 		height--;
-	}
+	} while (height > 0);
 
-	return *slot;
+	return (void **)slot;
+}
+EXPORT_SYMBOL(radix_tree_lookup_slot);
+
+/**
+ *	radix_tree_lookup    -    perform lookup operation on a radix tree
+ *	@root:		radix tree root
+ *	@index:		index key
+ *
+ *	Lookup the item at the position @index in the radix tree @root.
+ *
+ *	The caller either holds the lock that serialises modifications of
+ *	the tree, or is inside rcu_read_lock().  In the latter case the item
+ *	may be removed from the tree as soon as it has been returned.
+ */
+void *radix_tree_lookup(struct radix_tree_root *root, unsigned long index)
+{
+	void **slot;
+
+	slot = radix_tree_lookup_slot(root, index);
+	return slot != NULL ? rcu_dereference(*slot) : NULL;
 }
 EXPORT_SYMBOL(radix_tree_lookup);
 
@@ -525,17 +584,25 @@ int radix_tree_tag_get(struct radix_tree_root *root,
 EXPORT_SYMBOL(radix_tree_tag_get);
 #endif
 
+/*
+ * With @indices == NULL exceptional entries are skipped, otherwise they
+ * are returned along with everything else and the index of each item is
+ * stored in @indices.  With @want_slots the address of the slot is
+ * returned instead of the item itself.
+ *
+ * The walk starts from @node, which is the root node as it was when the
+ * caller sampled it: under rcu_read_lock() root->height cannot be trusted.
+ */
 static unsigned int
-__lookup(struct radix_tree_root *root, void **results, unsigned long index,
-	unsigned int max_items, unsigned long *next_index)
+__lookup(struct radix_tree_node *slot, void **results, unsigned long *indices,
+	unsigned long index, unsigned int max_items, unsigned long *next_index,
+	int want_slots)
 {
 	unsigned int nr_found = 0;
 	unsigned int shift;
-	unsigned int height = root->height;
-	struct radix_tree_node *slot;
+	unsigned int height = slot->height;
 
 	shift = (height-1) * RADIX_TREE_MAP_SHIFT;
-	slot = root->rnode;
 
 	while (height > 0) {
 		unsigned long i = (index >> shift) & RADIX_TREE_MAP_MASK;
@@ -555,22 +622,65 @@ __lookup(struct radix_tree_root *root, void **results, unsigned long index,
 			unsigned long j = index & RADIX_TREE_MAP_MASK;
 
 			for ( ; j < RADIX_TREE_MAP_SIZE; j++) {
+				void *item = rcu_dereference(slot->slots[j]);
+
 				index++;
-				if (slot->slots[j]) {
-					results[nr_found++] = slot->slots[j];
-					if (nr_found == max_items)
-						goto out;
-				}
+				if (!item)
+					continue;
+				if (indices)
+					indices[nr_found] = index - 1;
+				else if (radix_tree_exceptional_entry(item))
+					continue;
+				if (want_slots)
+					item = &slot->slots[j];
+				results[nr_found++] = item;
+				if (nr_found == max_items)
+					goto out;
 			}
+			break;
 		}
 		shift -= RADIX_TREE_MAP_SHIFT;
-		slot = slot->slots[i];
+		slot = rcu_dereference(slot->slots[i]);
+		if (slot == NULL)
+			break;
 	}
 out:
 	*next_index = index;
 	return nr_found;
 }
 
+static unsigned int
+__gang_lookup(struct radix_tree_root *root, void **results,
+	unsigned long *indices, unsigned long first_index,
+	unsigned int max_items, int want_slots)
+{
+	struct radix_tree_node *node;
+	unsigned long max_index;
+	unsigned long cur_index = first_index;
+	unsigned int ret = 0;
+
+	node = rcu_dereference(root->rnode);
+	if (!node)
+		return 0;
+	max_index = radix_tree_maxindex(node->height);
+
+	while (ret < max_items) {
+		unsigned int nr_found;
+		unsigned long next_index;	/* Index of next search */
+
+		if (cur_index > max_index)
+			break;
+		nr_found = __lookup(node, results + ret,
+				indices ? indices + ret : NULL, cur_index,
+				max_items - ret, &next_index, want_slots);
+		ret += nr_found;
+		if (next_index == 0)
+			break;
+		cur_index = next_index;
+	}
+	return ret;
+}
+
 /**
  *	radix_tree_gang_lookup - perform multiple lookup on a radix tree
  *	@root:		radix tree root
@@ -580,7 +690,7 @@ out:
  *
  *	Performs an index-ascending scan of the tree for present items.  Places
  *	them at *@results and returns the number of items which were placed at
- *	*@results.
+ *	*@results.  Exceptional entries are not returned.
  *
  *	The implementation is naive.
  */
@@ -588,26 +698,52 @@ unsigned int
 radix_tree_gang_lookup(struct radix_tree_root *root, void **results,
 			unsigned long first_index, unsigned int max_items)
 {
-	const unsigned long max_index = radix_tree_maxindex(root->height);
-	unsigned long cur_index = first_index;
-	unsigned int ret = 0;
+	return __gang_lookup(root, results, NULL, first_index, max_items, 0);
+}
+EXPORT_SYMBOL(radix_tree_gang_lookup);
 
-	while (ret < max_items) {
-		unsigned int nr_found;
-		unsigned long next_index;	/* Index of next search */
+/**
+ *	radix_tree_gang_lookup_slot - perform multiple slot lookup on a tree
+ *	@root:		radix tree root
+ *	@results:	where the slots of the lookup are placed
+ *	@first_index:	start the lookup from this key
+ *	@max_items:	place up to this many slots at *results
+ *
+ *	Like radix_tree_gang_lookup(), but returns the slots holding the items.
+ *	This is meant for callers inside rcu_read_lock(): they must read each
+ *	item with rcu_dereference(), and cope with finding it changed, NULL,
+ *	or an exceptional entry by then.
+ */
+unsigned int
+radix_tree_gang_lookup_slot(struct radix_tree_root *root, void ***results,
+			unsigned long first_index, unsigned int max_items)
+{
+	return __gang_lookup(root, (void **)results, NULL, first_index,
+			max_items, 1);
+}
+EXPORT_SYMBOL(radix_tree_gang_lookup_slot);
 
-		if (cur_index > max_index)
-			break;
-		nr_found = __lookup(root, results + ret, cur_index,
-					max_items - ret, &next_index);
-		ret += nr_found;
-		if (next_index == 0)
-			break;
-		cur_index = next_index;
-	}
-	return ret;
+/**
+ *	radix_tree_gang_lookup_index - multiple lookup returning indices
+ *	@root:		radix tree root
+ *	@results:	where the results of the lookup are placed
+ *	@indices:	where the index of each result is placed
+ *	@first_index:	start the lookup from this key
+ *	@max_items:	place up to this many items at *results
+ *
+ *	Like radix_tree_gang_lookup(), but exceptional entries are returned
+ *	too, and since those do not say where they live, the index of every
+ *	item is stored at the same position in *@indices.
+ */
+unsigned int
+radix_tree_gang_lookup_index(struct radix_tree_root *root, void **results,
+			unsigned long *indices, unsigned long first_index,
+			unsigned int max_items)
+{
+	return __gang_lookup(root, results, indices, first_index,
+			max_items, 0);
 }
-EXPORT_SYMBOL(radix_tree_gang_lookup);
+EXPORT_SYMBOL(radix_tree_gang_lookup_index);
 
 /*
  * FIXME: the two tag_get()s here should use find_next_bit() instead of
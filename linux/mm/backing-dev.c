@@ -0,0 +1,236 @@
+/*
+ * mm/backing-dev.c - per-device writeback state and flusher threads
+ *
+ * Each registered backing device owns the list of dirty inodes which are
+ * written back against it, and a flusher thread which does that writeback.
+ * A device with a slow queue then only holds up its own writers.  Devices
+ * which never register (NFS, memory-backed filesystems and the like) have
+ * their inodes looked after by default_backing_dev_info.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/writeback.h>
+#include <linux/backing-dev.h>
+#include <linux/kthread.h>
+#include <linux/rwsem.h>
+#include <linux/init.h>
+
+/*
+ * All devices with their own dirty inode lists.  Modifications take both
+ * bdi_list_sem and bdi_lock; walkers which may sleep take bdi_list_sem for
+ * reading, quick scans take bdi_lock.
+ */
+/**
+ * ע豸default_backing_dev_infoС
+ */
+struct list_head bdi_list = LIST_HEAD_INIT(default_backing_dev_info.bdi_list);
+DEFINE_SPINLOCK(bdi_lock);
+DECLARE_RWSEM(bdi_list_sem);
+
+struct backing_dev_info default_backing_dev_info = {
+	.ra_pages	= (VM_MAX_READAHEAD * 1024) / PAGE_CACHE_SIZE,
+	.state		= 1 << BDI_registered,
+	.unplug_io_fn	= default_unplug_io_fn,
+	.bdi_list	= LIST_HEAD_INIT(bdi_list),
+	.b_dirty	= LIST_HEAD_INIT(default_backing_dev_info.b_dirty),
+	.b_io		= LIST_HEAD_INIT(default_backing_dev_info.b_io),
+	.wb_refs	= 1,
+	.wb_lock	= SPIN_LOCK_UNLOCKED,
+};
+EXPORT_SYMBOL_GPL(default_backing_dev_info);
+
+/* A first guess at a new device's writeback bandwidth: 100MB/s */
+#define INIT_BW		((100 << 20) >> PAGE_CACHE_SHIFT)
+
+static int bdi_has_work(struct backing_dev_info *bdi)
+{
+	return bdi->wb_nr_pages || test_bit(BDI_background, &bdi->state);
+}
+
+/*
+ * The flusher thread.  It performs writeback which was asked for by
+ * bdi_start_writeback() and bdi_start_background_writeback(), and wakes up
+ * every dirty_writeback_centisecs to write back inodes which have been dirty
+ * for longer than dirty_expire_centisecs.
+ */
+/**
+ * ÿ豸Ļд̣߳ȡԭpdflushִеbackground_writeoutwb_kupdate
+ */
+static int bdi_flusher(void *data)
+{
+	struct backing_dev_info *bdi = data;
+
+	current->flags |= PF_FLUSHER;
+	/*
+	 * Like pdflush, we can spend a lot of time doing encryption via
+	 * dm-crypt.  Don't do that at keventd's priority.
+	 */
+	set_user_nice(current, 0);
+
+	while (!kthread_should_stop()) {
+		try_to_freeze(PF_FREEZE);
+
+		bdi_writeback_work(bdi);
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!bdi_has_work(bdi) && !kthread_should_stop()) {
+			if (dirty_writeback_centisecs)
+				schedule_timeout((dirty_writeback_centisecs *
+							HZ) / 100);
+			else
+				schedule();
+		}
+		__set_current_state(TASK_RUNNING);
+	}
+	return 0;
+}
+
+/**
+ * bdi_register - give a device its own dirty inode lists and flusher
+ * @bdi: the device's backing_dev_info
+ * @name: used to name the flusher thread
+ *
+ * A queue shared by several disks is registered once per disk; the flusher
+ * goes away with the last bdi_unregister().
+ */
+int bdi_register(struct backing_dev_info *bdi, const char *name)
+{
+	struct task_struct *task;
+
+	down_write(&bdi_list_sem);
+	if (bdi->wb_refs++) {
+		up_write(&bdi_list_sem);
+		return 0;
+	}
+
+	INIT_LIST_HEAD(&bdi->b_dirty);
+	INIT_LIST_HEAD(&bdi->b_io);
+	spin_lock_init(&bdi->wb_lock);
+	bdi->wb_nr_pages = 0;
+	bdi->wb_last_old_flush = jiffies;
+	bdi->write_bandwidth = INIT_BW;
+	bdi->written_stamp = atomic_read(&bdi->nr_written);
+	bdi->bw_time_stamp = jiffies;
+
+	task = kthread_run(bdi_flusher, bdi, "flush-%s", name);
+	if (IS_ERR(task)) {
+		bdi->wb_refs = 0;
+		up_write(&bdi_list_sem);
+		return PTR_ERR(task);
+	}
+	bdi->wb_task = task;
+
+	spin_lock(&inode_lock);
+	spin_lock_irq(&bdi_lock);
+	list_add_tail(&bdi->bdi_list, &bdi_list);
+	set_bit(BDI_registered, &bdi->state);
+	spin_unlock_irq(&bdi_lock);
+	spin_unlock(&inode_lock);
+	up_write(&bdi_list_sem);
+	return 0;
+}
+EXPORT_SYMBOL(bdi_register);
+
+/**
+ * bdi_unregister - stop a device's flusher
+ * @bdi: the device's backing_dev_info
+ *
+ * Any inodes still on the device's lists are handed to the default device.
+ */
+void bdi_unregister(struct backing_dev_info *bdi)
+{
+	struct backing_dev_info *def = &default_backing_dev_info;
+	struct task_struct *task;
+
+	down_write(&bdi_list_sem);
+	if (!bdi->wb_refs || --bdi->wb_refs) {
+		up_write(&bdi_list_sem);
+		return;
+	}
+
+	spin_lock(&inode_lock);
+	spin_lock_irq(&bdi_lock);
+	clear_bit(BDI_registered, &bdi->state);
+	list_del(&bdi->bdi_list);
+	task = bdi->wb_task;
+	bdi->wb_task = NULL;
+	spin_unlock_irq(&bdi_lock);
+	list_splice_init(&bdi->b_io, &def->b_dirty);
+	list_splice_init(&bdi->b_dirty, &def->b_dirty);
+	spin_unlock(&inode_lock);
+	up_write(&bdi_list_sem);
+
+	kthread_stop(task);
+}
+EXPORT_SYMBOL(bdi_unregister);
+
+/*
+ * Called under bdi_lock, which keeps the device registered and its flusher
+ * alive, and protects wb_nr_pages.  bdi_lock is taken with interrupts off
+ * because wakeup_bdflush() may be called from atomic context.
+ */
+void __bdi_start_writeback(struct backing_dev_info *bdi, long nr_pages)
+{
+	bdi = writeback_bdi(bdi);
+
+	bdi->wb_nr_pages += nr_pages;
+	if (bdi->wb_nr_pages < 0)		/* Overflow */
+		bdi->wb_nr_pages = LONG_MAX;
+	if (bdi->wb_task)
+		wake_up_process(bdi->wb_task);
+}
+
+/**
+ * bdi_start_writeback - ask a device's flusher to write back some pages
+ * @bdi: the device
+ * @nr_pages: how many pages to write
+ */
+void bdi_start_writeback(struct backing_dev_info *bdi, long nr_pages)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&bdi_lock, flags);
+	__bdi_start_writeback(bdi, nr_pages);
+	spin_unlock_irqrestore(&bdi_lock, flags);
+}
+
+/**
+ * bdi_start_background_writeback - start background writeout of a device
+ * @bdi: the device
+ *
+ * The flusher keeps writing until the device is back under its share of the
+ * background threshold.
+ */
+void bdi_start_background_writeback(struct backing_dev_info *bdi)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&bdi_lock, flags);
+	bdi = writeback_bdi(bdi);
+	set_bit(BDI_background, &bdi->state);
+	if (bdi->wb_task)
+		wake_up_process(bdi->wb_task);
+	spin_unlock_irqrestore(&bdi_lock, flags);
+}
+
+static int __init default_bdi_init(void)
+{
+	struct backing_dev_info *bdi = &default_backing_dev_info;
+	struct task_struct *task;
+
+	bdi->wb_last_old_flush = jiffies;
+	task = kthread_run(bdi_flusher, bdi, "flush-default");
+	if (IS_ERR(task))
+		panic("Failed to start the default flusher thread\n");
+	spin_lock_irq(&bdi_lock);
+	bdi->wb_task = task;
+	spin_unlock_irq(&bdi_lock);
+	return 0;
+}
+
+module_init(default_bdi_init);
@@ -0,0 +1,495 @@
+/*
+ * mm/compaction.c
+ *
+ * Memory compaction: assemble high-order free blocks by moving in-use
+ * pages out of the way.
+ *
+ * Two scanners walk a zone towards each other.  The migrate scanner goes
+ * up from the bottom of the zone taking pages off the LRU, the free scanner
+ * comes down from the top taking free pages out of movable pageblocks, and
+ * the pages found by the first are copied into the pages found by the
+ * second.  Free memory thus collects at the bottom of the zone where the
+ * buddy allocator can merge it.
+ *
+ * Pages are moved through the reverse mappings: page cache and swap cache
+ * pages are unmapped and replaced in their radix tree, anonymous pages get
+ * their pte pointed at the copy.
+ */
+
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/swap.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/rmap.h>
+#include <linux/mm_inline.h>
+#include <linux/sysctl.h>
+#include <linux/init.h>
+#include <linux/rcupdate.h>
+
+/* Pages isolated for moving at a time */
+#define COMPACT_CLUSTER_MAX	SWAP_CLUSTER_MAX
+
+/*
+ * State of one compaction run over a zone.  Scanner positions are indices
+ * into zone->zone_mem_map.
+ */
+struct compact_control {
+	/**
+	 * ѸĿҳΪǨĿꡣ
+	 */
+	struct list_head freepages;
+	/**
+	 * ѴLRU롢ȴǨƵҳ
+	 */
+	struct list_head migratepages;
+	unsigned long nr_freepages;
+	unsigned long nr_migratepages;
+	/**
+	 * ҳɨһҪ鿴pageblockԶ¡
+	 */
+	unsigned long free_idx;
+	/**
+	 * ǨɨһҪ鿴ҳԵϡ
+	 */
+	unsigned long migrate_idx;
+	int order;			/* order wanted, -1 for all of it */
+	struct zone *zone;
+};
+
+int sysctl_compact_memory;
+
+/*
+ * Take free pages out of movable pageblocks, from the top of the zone
+ * down, until there are enough to move the isolated pages into.  Blocks
+ * of the other types are skipped: filling them with movable pages would
+ * spoil the grouping done by the page allocator.
+ */
+static void isolate_freepages(struct compact_control *cc)
+{
+	struct zone *zone = cc->zone;
+	unsigned long idx, end, i;
+	unsigned long flags;
+
+	for (idx = cc->free_idx; idx > cc->migrate_idx &&
+			cc->nr_freepages < cc->nr_migratepages;
+			idx -= pageblock_nr_pages) {
+		struct page *page = zone->zone_mem_map + idx;
+
+		if (get_pageblock_migratetype(zone, page) != MIGRATE_MOVABLE)
+			continue;
+
+		end = idx + pageblock_nr_pages;
+		if (end > zone->spanned_pages)
+			end = zone->spanned_pages;
+
+		spin_lock_irqsave(&zone->lock, flags);
+		for (i = idx; i < end; ) {
+			int n = split_free_page(zone, zone->zone_mem_map + i,
+						&cc->freepages);
+
+			cc->nr_freepages += n;
+			i += n ? n : 1;
+		}
+		spin_unlock_irqrestore(&zone->lock, flags);
+	}
+	cc->free_idx = idx;
+}
+
+/*
+ * Take up to COMPACT_CLUSTER_MAX pages off the LRU, scanning at most a
+ * pageblock from where the migrate scanner stopped last time.  The pages
+ * keep PG_active so that they can be put back where they came from.
+ */
+static unsigned long isolate_migratepages(struct compact_control *cc)
+{
+	struct zone *zone = cc->zone;
+	unsigned long idx = cc->migrate_idx;
+	unsigned long end = idx + pageblock_nr_pages;
+
+	if (end > cc->free_idx)
+		end = cc->free_idx;
+
+	spin_lock_irq(&zone->lru_lock);
+	for (; idx < end && cc->nr_migratepages < COMPACT_CLUSTER_MAX; idx++) {
+		struct page *page = zone->zone_mem_map + idx;
+
+		if (!PageLRU(page) || PageUnevictable(page) ||
+		    !TestClearPageLRU(page))
+			continue;
+		if (get_page_testone(page)) {
+			/*
+			 * It is being freed elsewhere
+			 */
+			__put_page(page);
+			SetPageLRU(page);
+			continue;
+		}
+		del_page_from_lru_list(zone, page, page_lru(page));
+		list_add(&page->lru, &cc->migratepages);
+		cc->nr_migratepages++;
+	}
+	spin_unlock_irq(&zone->lru_lock);
+
+	cc->migrate_idx = idx;
+	return cc->nr_migratepages;
+}
+
+/*
+ * Put isolated pages back on the LRU and drop the reference taken when
+ * they were isolated.
+ */
+static void putback_lru_pages(struct list_head *l)
+{
+	struct page *page, *page2;
+
+	list_for_each_entry_safe(page, page2, l, lru) {
+		struct zone *zone = page_zone(page);
+
+		list_del(&page->lru);
+		spin_lock_irq(&zone->lru_lock);
+		if (TestSetPageLRU(page))
+			BUG();
+		add_page_to_lru_list(zone, page, page_lru(page));
+		spin_unlock_irq(&zone->lru_lock);
+		page_cache_release(page);
+	}
+}
+
+static void release_freepages(struct compact_control *cc)
+{
+	struct page *page, *page2;
+
+	list_for_each_entry_safe(page, page2, &cc->freepages, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+	cc->nr_freepages = 0;
+}
+
+/*
+ * Replace @page by @newpage in the page cache or swap cache it belongs to.
+ * @page is locked and unmapped; if anybody but the cache and our isolation
+ * still holds it, we give up.  Lookups that find @newpage see it locked
+ * and !PageUptodate, so they wait until the contents have been copied.
+ */
+static int replace_page_cache(struct address_space *mapping,
+			      struct page *page, struct page *newpage)
+{
+	pgoff_t index = PageSwapCache(page) ? page->private : page->index;
+	void **slot;
+
+	spin_lock_irq(&mapping->tree_lock);
+	slot = radix_tree_lookup_slot(&mapping->page_tree, index);
+	if (!slot || *slot != page || page_mapped(page)) {
+		spin_unlock_irq(&mapping->tree_lock);
+		return -EAGAIN;
+	}
+	/* Keep lockless lookups off @page while the slot changes hands */
+	if (!page_freeze_refs(page, 2)) {
+		spin_unlock_irq(&mapping->tree_lock);
+		return -EAGAIN;
+	}
+
+	get_page(newpage);
+	newpage->index = page->index;
+	newpage->mapping = page->mapping;
+	if (PageSwapCache(page)) {
+		SetPageSwapCache(newpage);
+		newpage->private = page->private;
+	}
+	/* The radix tree tags belong to the index and stay as they are */
+	rcu_assign_pointer(*slot, newpage);
+	/* Drop the cache's reference, we still hold our own */
+	page_unfreeze_refs(page, 1);
+	spin_unlock_irq(&mapping->tree_lock);
+
+	ClearPageSwapCache(page);
+	page->private = 0;
+	page->mapping = NULL;
+	return 0;
+}
+
+/*
+ * Hand the state of @page over to @newpage.  Dirty pages stay accounted
+ * as dirty: the flag simply moves over.
+ */
+static void migrate_page_flags(struct page *newpage, struct page *page)
+{
+	if (PageError(page))
+		SetPageError(newpage);
+	if (PageReferenced(page))
+		SetPageReferenced(newpage);
+	if (PageUptodate(page))
+		SetPageUptodate(newpage);
+	if (PageChecked(page))
+		SetPageChecked(newpage);
+	if (PageMappedToDisk(page))
+		SetPageMappedToDisk(newpage);
+	if (PageSwapBacked(page))
+		SetPageSwapBacked(newpage);
+	if (PageActive(page)) {
+		SetPageActive(newpage);
+		ClearPageActive(page);
+	}
+	if (PageDirty(page)) {
+		SetPageDirty(newpage);
+		ClearPageDirty(page);
+	}
+}
+
+/*
+ * Move the contents and identity of @page to the free page @newpage.
+ * Pages under writeback or carrying filesystem private data are left
+ * alone, and so is anything we can't lock without waiting.  Returns 0 on
+ * success, after which the caller's reference is the last one on @page.
+ */
+static int migrate_page(struct page *page, struct page *newpage)
+{
+	struct address_space *mapping;
+	int rc = -EAGAIN;
+
+	if (TestSetPageLocked(page))
+		return rc;
+	if (PageWriteback(page) || PagePrivate(page))
+		goto out;
+
+	SetPageLocked(newpage);
+	mapping = page_mapping(page);
+	if (!mapping) {
+		/* Anonymous page never added to swap: move its pte */
+		if (PageAnon(page) &&
+		    try_to_remap_anon(page, newpage) == SWAP_SUCCESS)
+			rc = 0;
+	} else if (!page_mapped(page) || try_to_unmap(page, 1) == SWAP_SUCCESS) {
+		rc = replace_page_cache(mapping, page, newpage);
+		if (!rc)
+			copy_highpage(newpage, page);
+	}
+	if (!rc)
+		migrate_page_flags(newpage, page);
+	unlock_page(newpage);
+out:
+	unlock_page(page);
+	return rc;
+}
+
+static void migrate_pages(struct compact_control *cc)
+{
+	LIST_HEAD(moved);
+	LIST_HEAD(failed);
+	unsigned long nr_moved = 0, nr_failed = 0;
+	struct page *page, *newpage;
+
+	while (!list_empty(&cc->migratepages)) {
+		if (list_empty(&cc->freepages)) {
+			isolate_freepages(cc);
+			if (list_empty(&cc->freepages))
+				break;
+		}
+		page = list_entry(cc->migratepages.next, struct page, lru);
+		list_del(&page->lru);
+		cc->nr_migratepages--;
+		newpage = list_entry(cc->freepages.next, struct page, lru);
+		list_del(&newpage->lru);
+		cc->nr_freepages--;
+
+		if (!migrate_page(page, newpage)) {
+			page_cache_release(page);
+			list_add(&newpage->lru, &moved);
+			nr_moved++;
+		} else {
+			list_add(&page->lru, &failed);
+			list_add(&newpage->lru, &cc->freepages);
+			cc->nr_freepages++;
+			nr_failed++;
+		}
+	}
+
+	putback_lru_pages(&moved);
+	putback_lru_pages(&failed);
+	putback_lru_pages(&cc->migratepages);
+	cc->nr_migratepages = 0;
+
+	mod_page_state(compact_pages_moved, nr_moved);
+	mod_page_state(compact_pagemigrate_failed, nr_failed);
+}
+
+static int compact_finished(struct compact_control *cc)
+{
+	struct zone *zone = cc->zone;
+
+	if (cc->free_idx <= cc->migrate_idx)
+		return COMPACT_COMPLETE;
+	if (cc->order < 0)
+		return 0;
+	if (zone_watermark_ok(zone, cc->order, zone->pages_low, 0, 0, 0))
+		return COMPACT_PARTIAL;
+	return 0;
+}
+
+static int compact_zone(struct zone *zone, int order)
+{
+	struct compact_control cc;
+	int ret;
+
+	cc.zone = zone;
+	cc.order = order;
+	INIT_LIST_HEAD(&cc.freepages);
+	INIT_LIST_HEAD(&cc.migratepages);
+	cc.nr_freepages = 0;
+	cc.nr_migratepages = 0;
+	cc.migrate_idx = 0;
+	cc.free_idx = (zone->spanned_pages - 1) & ~(pageblock_nr_pages - 1);
+
+	while (!(ret = compact_finished(&cc))) {
+		cond_resched();
+		if (isolate_migratepages(&cc))
+			migrate_pages(&cc);
+	}
+	release_freepages(&cc);
+	return ret;
+}
+
+/*
+ * Compact @zone for an allocation of @order, unless it hasn't the free
+ * memory to move pages into, or already has a block of that order.
+ */
+static int compact_zone_order(struct zone *zone, int order)
+{
+	if (!zone->present_pages ||
+	    zone->free_pages < zone->pages_low + (2UL << order))
+		return COMPACT_SKIPPED;
+	if (zone_watermark_ok(zone, order, zone->pages_low, 0, 0, 0))
+		return COMPACT_PARTIAL;
+	return compact_zone(zone, order);
+}
+
+/**
+ * try_to_compact_pages - direct compaction for a failed allocation
+ * @zones: the zonelist of the allocation
+ * @order: the order it wants
+ *
+ * Compact the zones in turn until one of them has a free block of
+ * @order.  Returns COMPACT_SKIPPED if no zone was worth trying.
+ */
+int try_to_compact_pages(struct zone **zones, int order)
+{
+	struct zone *zone;
+	int i, status, rc = COMPACT_SKIPPED;
+
+	for (i = 0; (zone = zones[i]) != NULL; i++) {
+		status = compact_zone_order(zone, order);
+		if (status > rc)
+			rc = status;
+		if (status == COMPACT_PARTIAL)
+			break;
+	}
+	return rc;
+}
+
+/*
+ * kcompactd works for the allocations which cannot compact for
+ * themselves: atomic high-order requests, jumbo frame receives and the
+ * like, wake it up when they fail so the next one finds a block ready.
+ */
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	struct task_struct *tsk = current;
+	DEFINE_WAIT(wait);
+	cpumask_t cpumask;
+
+	daemonize("kcompactd%d", pgdat->node_id);
+	cpumask = node_to_cpumask(pgdat->node_id);
+	if (!cpus_empty(cpumask))
+		set_cpus_allowed(tsk, cpumask);
+
+	for ( ; ; ) {
+		int order, i;
+
+		if (current->flags & PF_FREEZE)
+			refrigerator(PF_FREEZE);
+
+		prepare_to_wait(&pgdat->kcompactd_wait, &wait,
+				TASK_INTERRUPTIBLE);
+		if (!pgdat->kcompactd_max_order)
+			schedule();
+		finish_wait(&pgdat->kcompactd_wait, &wait);
+
+		order = pgdat->kcompactd_max_order;
+		pgdat->kcompactd_max_order = 0;
+
+		for (i = 0; order && i < MAX_NR_ZONES; i++) {
+			switch (compact_zone_order(pgdat->node_zones + i,
+						   order)) {
+			case COMPACT_PARTIAL:
+				inc_page_state(compact_success);
+				break;
+			case COMPACT_COMPLETE:
+				inc_page_state(compact_fail);
+				break;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ * An allocation of @order failed in a context that can't compact:
+ * have kcompactd work on the zone's node.
+ */
+void wakeup_kcompactd(struct zone *zone, int order)
+{
+	pg_data_t *pgdat = zone->zone_pgdat;
+
+	if (zone->present_pages == 0)
+		return;
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/* Compact every zone of every node as far as it goes */
+static void compact_nodes(void)
+{
+	pg_data_t *pgdat;
+	int i;
+
+	for_each_pgdat(pgdat)
+		for (i = 0; i < MAX_NR_ZONES; i++) {
+			struct zone *zone = pgdat->node_zones + i;
+
+			if (zone->present_pages)
+				compact_zone(zone, -1);
+		}
+}
+
+/*
+ * sysctl_compaction_handler - writing anything to
+ *	/proc/sys/vm/compact_memory compacts all of memory.
+ */
+int sysctl_compaction_handler(ctl_table *table, int write,
+		struct file *file, void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec(table, write, file, buffer, length, ppos);
+	if (write && !ret)
+		compact_nodes();
+	return ret;
+}
+
+static int __init kcompactd_init(void)
+{
+	pg_data_t *pgdat;
+
+	for_each_pgdat(pgdat)
+		pgdat->kcompactd
+		= find_task_by_pid(kernel_thread(kcompactd, pgdat, CLONE_KERNEL));
+	return 0;
+}
+
+module_init(kcompactd_init)
@@ -28,6 +28,9 @@
 #include <linux/blkdev.h>
 #include <linux/security.h>
 #include <linux/syscalls.h>
+#include <linux/rcupdate.h>
+#include <linux/rmap.h>
+#include <linux/acct.h>
 /*
  * This is needed for the following functions:
  *  - try_to_release_page
@@ -96,12 +99,16 @@
  *    ->zone.lru_lock		(follow_page->mark_page_accessed)
  *    ->private_lock		(page_remove_rmap->set_page_dirty)
  *    ->tree_lock		(page_remove_rmap->set_page_dirty)
+ *    ->tree_lock		(filemap_map_pages->find_get_pages)
  *    ->inode_lock		(page_remove_rmap->set_page_dirty)
  *    ->inode_lock		(zap_pte_range->set_page_dirty)
  *    ->private_lock		(zap_pte_range->__set_page_dirty_buffers)
  *
  *  ->task->proc_lock
  *    ->dcache_lock		(proc_pid_lookup)
+ *
+ *  ->mapping->tree_lock
+ *    ->zone.lru_lock		(add_to_page_cache->workingset_refault)
  */
 
 /*
@@ -113,13 +120,36 @@
  * ҳٻɾҳ
  */
 void __remove_from_page_cache(struct page *page)
+{
+	__remove_from_page_cache_shadow(page, NULL);
+}
+
+/*
+ * Like __remove_from_page_cache(), but if @shadow is not NULL it is left
+ * in the page's radix tree slot to be found when the page is read again.
+ * The page is clean and not under writeback, so its slot carries no tags.
+ */
+/**
+ * ҳٻɾҳshadowΪգҳԭĻλӰ
+ */
+void __remove_from_page_cache_shadow(struct page *page, void *shadow)
 {
 	struct address_space *mapping = page->mapping;
 
-	/**
-	 * radix_tree_deleteҳӸڵ㿪ʼִɾ
-	 */
-	radix_tree_delete(&mapping->page_tree, page->index);
+	if (shadow) {
+		void **slot;
+
+		slot = radix_tree_lookup_slot(&mapping->page_tree,
+					      page->index);
+		BUG_ON(!slot || *slot != page);
+		*slot = shadow;
+		workingset_add_shadow(mapping);
+	} else {
+		/**
+		 * radix_tree_deleteҳӸڵ㿪ʼִɾ
+		 */
+		radix_tree_delete(&mapping->page_tree, page->index);
+	}
 	/**
 	 * mappingֶ
 	 */
@@ -383,6 +413,8 @@ int filemap_write_and_wait(struct address_space *mapping)
  * The other page state flags were set by rmqueue().
  *
  * This function does not add the page to the LRU.  The caller must do that.
+ * If the page replaces the shadow of a recently evicted page it is marked
+ * PG_active, and lru_cache_add() puts it straight on the active list.
  */
 /**
  * һҳ뵽ҳٻ档
@@ -399,6 +431,24 @@ int add_to_page_cache(struct page *page, struct address_space *mapping,
 	int error = radix_tree_preload(gfp_mask & ~__GFP_HIGHMEM);
 
 	if (error == 0) {
+		/*
+		 * Lockless lookups may find the page as soon as it is in the
+		 * tree, so it must be pinned, locked and set up before that.
+		 */
+		/**
+		 * ҳʹü
+		 */
+		page_cache_get(page);
+		/**
+		 * ҳµģʹЧҳPG_locked־ֹں·ʸҳ
+		 */
+		SetPageLocked(page);
+		/**
+		 * ʹòʼpage
+		 */
+		page->mapping = mapping;
+		page->index = offset;
+
 		/**
 		 * ȡtree_lock
 		 * radix_tree_preloadѾֹںռ
@@ -408,20 +458,24 @@ int add_to_page_cache(struct page *page, struct address_space *mapping,
 		 * radix_tree_insertв½
 		 */
 		error = radix_tree_insert(&mapping->page_tree, offset, page);
-		if (!error) {
-			/**
-			 * ҳʹü
-			 */
-			page_cache_get(page);
-			/**
-			 * ҳµģʹЧҳPG_locked־ֹں·ʸҳ
-			 */
-			SetPageLocked(page);
+		if (error == -EEXIST) {
 			/**
-			 * ʹòʼpage
+			 * λϿֻһҳµӰҳ滻
+			 * ҳձղãֱӽΪҳ
 			 */
-			page->mapping = mapping;
-			page->index = offset;
+			void **slot = radix_tree_lookup_slot(&mapping->page_tree,
+							     offset);
+			void *shadow = *slot;
+
+			if (radix_tree_exceptional_entry(shadow)) {
+				rcu_assign_pointer(*slot, page);
+				workingset_del_shadow(mapping);
+				if (workingset_refault(shadow))
+					SetPageActive(page);
+				error = 0;
+			}
+		}
+		if (!error) {
 			mapping->nrpages++;
 			/**
 			 * ӵַռĻҳļ
@@ -433,6 +487,11 @@ int add_to_page_cache(struct page *page, struct address_space *mapping,
 		 */
 		spin_unlock_irq(&mapping->tree_lock);
 		radix_tree_preload_end();
+		if (unlikely(error)) {
+			page->mapping = NULL;
+			ClearPageLocked(page);
+			__put_page(page);
+		}
 	}
 	return error;
 }
@@ -536,35 +595,66 @@ void fastcall __lock_page(struct page *page)
 }
 EXPORT_SYMBOL(__lock_page);
 
+/*
+ * Page cache lookups which only take a reference on the page run under
+ * rcu_read_lock() where page_cache_get_speculative() is available, see
+ * <linux/pagemap.h>.  Elsewhere they keep using tree_lock.
+ */
+#ifdef PAGECACHE_LOCKLESS_LOOKUP
+#define pagecache_lookup_begin(mapping)	rcu_read_lock()
+#define pagecache_lookup_end(mapping)	rcu_read_unlock()
+#else
+#define pagecache_lookup_begin(mapping)	spin_lock_irq(&(mapping)->tree_lock)
+#define pagecache_lookup_end(mapping)	spin_unlock_irq(&(mapping)->tree_lock)
+#endif
+
 /*
  * a rather lightweight function, finding and getting a reference to a
  * hashed page atomically.
  */
 /**
- * ҳٻĻвҳ
+ * ҳٻĻвҳ
+ * Ҳtree_lockRCU±ƲԵҳü
+ * ȻȷϸҳȻԭλϣԡ
  */
 struct page * find_get_page(struct address_space *mapping, unsigned long offset)
 {
+	void **pagep;
 	struct page *page;
 
+	pagecache_lookup_begin(mapping);
+repeat:
+	page = NULL;
 	/**
-	 * Ȼȡ
-	 */
-	spin_lock_irq(&mapping->tree_lock);
-	/**
-	 * radix_tree_lookupӵָƫĻҶӽڵ㡣
-	 * ƫֵеλδʼָ룬򷵻NULL򣬷Ҷӽڵĵַ
-	 */
-	page = radix_tree_lookup(&mapping->page_tree, offset);
-	/**
-	 * ҵҪҳӸҳʹü
-	 */
-	if (page)
-		page_cache_get(page);
-	/**
-	 * ͷŻҳַ
+	 * radix_tree_lookup_slotӵָƫĻҶӽڵ㡣
+	 * ƫֵеλδʼָ룬򷵻NULL򣬷Ҷӽڵвλĵַ
 	 */
-	spin_unlock_irq(&mapping->tree_lock);
+	pagep = radix_tree_lookup_slot(&mapping->page_tree, offset);
+	if (pagep) {
+		page = rcu_dereference(*pagep);
+		/**
+		 * ӰʾҳѾա
+		 */
+		if (unlikely(!page || radix_tree_exceptional_entry(page))) {
+			page = NULL;
+			goto out;
+		}
+		/**
+		 * ҳѾͷţڱնü
+		 */
+		if (!page_cache_get_speculative(page))
+			goto repeat;
+		/*
+		 * The page may have been removed from the page cache, freed
+		 * and reused between the lookup and taking the reference.
+		 */
+		if (unlikely(page != *pagep)) {
+			page_cache_release(page);
+			goto repeat;
+		}
+	}
+out:
+	pagecache_lookup_end(mapping);
 	return page;
 }
 
@@ -582,6 +672,8 @@ struct page *find_trylock_page(struct address_space *mapping, unsigned long offs
 
 	spin_lock_irq(&mapping->tree_lock);
 	page = radix_tree_lookup(&mapping->page_tree, offset);
+	if (radix_tree_exceptional_entry(page))
+		page = NULL;
 	if (page && TestSetPageLocked(page))
 		page = NULL;
 	spin_unlock_irq(&mapping->tree_lock);
@@ -612,6 +704,8 @@ struct page *find_lock_page(struct address_space *mapping,
 	spin_lock_irq(&mapping->tree_lock);
 repeat:
 	page = radix_tree_lookup(&mapping->page_tree, offset);
+	if (radix_tree_exceptional_entry(page))
+		page = NULL;
 	if (page) {
 		page_cache_get(page);
 		if (TestSetPageLocked(page)) {/* Ѿס */
@@ -710,17 +804,34 @@ unsigned find_get_pages(struct address_space *mapping, pgoff_t start,
 {
 	unsigned int i;
 	unsigned int ret;
+	unsigned int nr_found;
 
-	spin_lock_irq(&mapping->tree_lock);
+	pagecache_lookup_begin(mapping);
 	/**
-	 * radix_tree_gang_lookupʵĲҲΪָ鸳ֵҵҳ
+	 * radix_tree_gang_lookup_slotʵĲҲҵĲλַȷpagesУҵҳ
 	 * һЩҳܲҳٻУԽлֿȱҳǷصҳֵǵġ
 	 */
-	ret = radix_tree_gang_lookup(&mapping->page_tree,
-				(void **)pages, start, nr_pages);
-	for (i = 0; i < ret; i++)
-		page_cache_get(pages[i]);
-	spin_unlock_irq(&mapping->tree_lock);
+	nr_found = radix_tree_gang_lookup_slot(&mapping->page_tree,
+				(void ***)pages, start, nr_pages);
+	ret = 0;
+	for (i = 0; i < nr_found; i++) {
+		void **pagep = (void **)pages[i];
+		struct page *page;
+repeat:
+		page = rcu_dereference(*pagep);
+		if (unlikely(!page || radix_tree_exceptional_entry(page)))
+			continue;
+		if (!page_cache_get_speculative(page))
+			goto repeat;
+		/* Has the page moved? */
+		if (unlikely(page != *pagep)) {
+			page_cache_release(page);
+			goto repeat;
+		}
+		pages[ret] = page;
+		ret++;
+	}
+	pagecache_lookup_end(mapping);
 	return ret;
 }
 
@@ -1720,6 +1831,82 @@ page_not_uptodate:
 
 EXPORT_SYMBOL(filemap_nopage);
 
+/*
+ * Map the pages of [start, end) which are already in the page cache and
+ * up to date, for the fault-around in do_no_page().  Called with
+ * page_table_lock held and @pte mapping @start; the range lies within one
+ * page table and within the vma, which is not nonlinear.  Nothing here
+ * may sleep or start I/O: whatever is missing, locked or not uptodate is
+ * simply left to a later fault.
+ *
+ * The page lock keeps the page in the mapping while we look at it, and
+ * truncation zaps ptes under page_table_lock after setting i_size, so a
+ * page found inside i_size with page_table_lock held cannot be left
+ * mapped past a truncate.
+ */
+/**
+ * ȱҳʱ˳ӳ丽Ѿҳٻвµҳȱҳ
+ */
+void filemap_map_pages(struct vm_area_struct *vma, unsigned long start,
+		       unsigned long end, pte_t *pte)
+{
+	struct address_space *mapping = vma->vm_file->f_mapping;
+	struct mm_struct *mm = vma->vm_mm;
+	struct page *pages[PAGEVEC_SIZE];
+	pgoff_t first, pgoff, last, size;
+	unsigned int i, nr, mapped = 0;
+
+	first = ((start - vma->vm_start) >> PAGE_SHIFT) + vma->vm_pgoff;
+	last = first + ((end - start) >> PAGE_SHIFT);
+	size = (i_size_read(mapping->host) + PAGE_CACHE_SIZE - 1) >>
+							PAGE_CACHE_SHIFT;
+	if (last > size)
+		last = size;
+
+	for (pgoff = first; pgoff < last; ) {
+		nr = find_get_pages(mapping, pgoff,
+				min_t(pgoff_t, last - pgoff, PAGEVEC_SIZE), pages);
+		if (!nr)
+			break;
+		for (i = 0; i < nr; i++) {
+			struct page *page = pages[i];
+			pte_t *ptep;
+
+			if (page->index >= last)
+				goto skip;
+			ptep = pte + (page->index - first);
+			if (!pte_none(*ptep))
+				goto skip;
+			if (!PageUptodate(page) || TestSetPageLocked(page))
+				goto skip;
+			if (page->mapping != mapping || !PageUptodate(page))
+				goto unlock;
+
+			++mm->rss;
+			flush_icache_page(vma, page);
+			set_pte(ptep, mk_pte(page, vma->vm_page_prot));
+			page_add_file_rmap(page);
+			update_mmu_cache(vma,
+				start + ((page->index - first) << PAGE_SHIFT),
+				*ptep);
+			unlock_page(page);
+			mapped++;
+			/* The reference now belongs to the pte */
+			continue;
+unlock:
+			unlock_page(page);
+skip:
+			page_cache_release(page);
+		}
+		pgoff = pages[nr - 1]->index + 1;
+	}
+	if (mapped) {
+		acct_update_integrals();
+		update_mem_hiwater();
+	}
+}
+EXPORT_SYMBOL(filemap_map_pages);
+
 static struct page * filemap_getpage(struct file *file, unsigned long pgoff,
 					int nonblock)
 {
@@ -1894,6 +2081,7 @@ repeat:
 struct vm_operations_struct generic_file_vm_ops = {
 	.nopage		= filemap_nopage,
 	.populate	= filemap_populate,
+	.map_pages	= filemap_map_pages,
 };
 
 /* This is used for a general mmap of a disk file */
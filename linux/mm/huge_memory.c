@@ -0,0 +1,531 @@
+/*
+ * mm/huge_memory.c
+ *
+ * Transparent huge pages for anonymous memory.
+ *
+ * A fault in an empty, pmd-aligned stretch of a private anonymous vma maps
+ * a whole huge page with a single pmd, which saves the page table and most
+ * of the TLB misses that would go with it.  The huge page is allocated in
+ * one piece and then split into independent small pages, each with its own
+ * count, mapcount and place on the LRU, so that the rest of the VM never
+ * has to know about it: whatever wants to work on part of the range --
+ * mprotect, munmap, mremap, fork, reclaim -- just has the pmd replaced by a
+ * page table pointing at the same pages.  That table is allocated together
+ * with the huge page and kept on mm->huge_pte_deposit, so that splitting
+ * never has to allocate and never fails.
+ *
+ * khugepaged goes the other way: it copies ranges that had to be faulted
+ * in with small pages into a huge page once one can be had.
+ */
+
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/swap.h>
+#include <linux/highmem.h>
+#include <linux/pagemap.h>
+#include <linux/rmap.h>
+#include <linux/acct.h>
+#include <linux/huge_mm.h>
+#include <linux/init.h>
+
+#include <asm/pgalloc.h>
+#include <asm/tlb.h>
+#include <asm/tlbflush.h>
+
+#include "internal.h"
+
+int sysctl_transparent_hugepage = 1;
+int khugepaged_pages_to_scan = HPAGE_PMD_NR * 8;
+int khugepaged_scan_sleep_millisecs = 10000;
+
+/*
+ * The mms khugepaged scans, round robin.  An mm is added on its first
+ * eligible fault and taken off by mmput().
+ */
+static LIST_HEAD(khugepaged_mm_list);
+static DEFINE_SPINLOCK(khugepaged_mm_lock);
+static DECLARE_WAIT_QUEUE_HEAD(khugepaged_wait);
+
+#define HPAGE_GFP	(GFP_HIGHUSER_MOVABLE | __GFP_NOWARN | __GFP_NORETRY)
+
+/* Take back the page table set aside for a huge pmd.  page_table_lock held. */
+static struct page *withdraw_pte_page(struct mm_struct *mm)
+{
+	struct page *page;
+
+	BUG_ON(list_empty(&mm->huge_pte_deposit));
+	page = list_entry(mm->huge_pte_deposit.next, struct page, lru);
+	list_del(&page->lru);
+	return page;
+}
+
+/*
+ * Make the small pages of a new huge page at @haddr anonymous pages of
+ * @vma, and build the pmd mapping them.  page_table_lock held.
+ */
+static pmd_t prep_huge_anon_pmd(struct mm_struct *mm, struct vm_area_struct *vma,
+				struct page *page, unsigned long haddr)
+{
+	pte_t entry;
+	int i;
+
+	split_page(page, HPAGE_PMD_ORDER);
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		page_add_anon_rmap(page + i, vma, haddr + i * PAGE_SIZE);
+		SetPageSwapBacked(page + i);
+		lru_cache_add_active(page + i);
+	}
+	mm->rss += HPAGE_PMD_NR;
+
+	/* The pages are ours alone: no point waiting for a COW fault */
+	entry = mk_pte(page, vma->vm_page_prot);
+	if (vma->vm_flags & VM_WRITE)
+		entry = pte_mkwrite(pte_mkdirty(entry));
+	return pte_trans_pmd(pte_mkyoung(entry));
+}
+
+
+/**
+ * ȱҳʱΪһյġ䲢ӳһҳ
+ * ʱpage_table_lock1ʾȱҳѴͷţ
+ * 0ʾӦ˻صͨҳ·ʱԳpmdǴҳ
+ */
+int huge_pmd_fault(struct mm_struct *mm, struct vm_area_struct *vma,
+		   unsigned long address, pmd_t *pmd, int write_access)
+{
+	unsigned long haddr = address & HPAGE_PMD_MASK;
+	struct page *page, *pte_page;
+	pte_t entry;
+	int i;
+
+	if (pmd_trans_huge(*pmd)) {
+		entry = pmd_trans_pte(*pmd);
+		if (write_access && !pte_write(entry)) {
+			/* Only ptrace can get here: let do_wp_page deal */
+			split_huge_pmd(mm, pmd);
+			return 0;
+		}
+		/* Raced with another thread's fault on the same range */
+		entry = pte_mkyoung(entry);
+		if (write_access)
+			entry = pte_mkdirty(entry);
+		set_pmd(pmd, pte_trans_pmd(entry));
+		spin_unlock(&mm->page_table_lock);
+		return 1;
+	}
+
+	spin_unlock(&mm->page_table_lock);
+	khugepaged_enter(mm);
+
+	if (unlikely(anon_vma_prepare(vma)))
+		goto fallback;
+	page = alloc_pages_vma(HPAGE_GFP, HPAGE_PMD_ORDER, vma, haddr);
+	if (!page) {
+		inc_page_state(thp_fault_fallback);
+		goto fallback;
+	}
+	pte_page = pte_alloc_one(mm, haddr);
+	if (!pte_page) {
+		__free_pages(page, HPAGE_PMD_ORDER);
+		goto fallback;
+	}
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		clear_user_highpage(page + i, haddr + i * PAGE_SIZE);
+		cond_resched();
+	}
+
+	spin_lock(&mm->page_table_lock);
+	if (!pmd_none(*pmd)) {
+		spin_unlock(&mm->page_table_lock);
+		pte_free(pte_page);
+		__free_pages(page, HPAGE_PMD_ORDER);
+		return 1;
+	}
+	mm->nr_ptes++;
+	inc_page_state(nr_page_table_pages);
+	list_add(&pte_page->lru, &mm->huge_pte_deposit);
+	set_pmd(pmd, prep_huge_anon_pmd(mm, vma, page, haddr));
+	acct_update_integrals();
+	update_mem_hiwater();
+	spin_unlock(&mm->page_table_lock);
+	inc_page_state(thp_fault_alloc);
+	return 1;
+
+fallback:
+	spin_lock(&mm->page_table_lock);
+	if (pmd_trans_huge(*pmd)) {
+		spin_unlock(&mm->page_table_lock);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * һҳpmdӳͬЩСҳҳҳȡԤ˲ʧܡ
+ * ʱpage_table_lock
+ */
+void split_huge_pmd(struct mm_struct *mm, pmd_t *pmd)
+{
+	struct page *pte_page;
+	unsigned long pfn;
+	pgprot_t prot;
+	pte_t *pte;
+	int i;
+
+	pfn = pte_pfn(pmd_trans_pte(*pmd));
+	prot = pmd_trans_pgprot(*pmd);
+	pte_page = withdraw_pte_page(mm);
+	pte = (pte_t *)page_address(pte_page);
+	for (i = 0; i < HPAGE_PMD_NR; i++)
+		set_pte(pte + i, pfn_pte(pfn + i, prot));
+	pmd_populate(mm, pmd, pte_page);
+	flush_tlb_mm(mm);
+	inc_page_state(thp_split);
+}
+
+/*
+ * Unmap a whole huge pmd, handing its pages and its page table to
+ * the mmu_gather like zap_pte_range() does for small ones.
+ */
+void zap_huge_pmd(struct mmu_gather *tlb, pmd_t *pmd)
+{
+	struct mm_struct *mm = tlb->mm;
+	struct page *page;
+	int i;
+
+	page = pfn_to_page(pte_pfn(pmd_trans_pte(*pmd)));
+	pmd_clear(pmd);
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		mm->anon_rss--;
+		tlb->freed++;
+		page_remove_rmap(page + i);
+		tlb_remove_page(tlb, page + i);
+	}
+	mm->nr_ptes--;
+	dec_page_state(nr_page_table_pages);
+	pte_free_tlb(tlb, withdraw_pte_page(mm));
+}
+
+/* follow_page() for a huge pmd.  page_table_lock held. */
+struct page *follow_trans_huge_pmd(pmd_t *pmd, unsigned long address,
+				   int read, int write)
+{
+	pte_t entry = pmd_trans_pte(*pmd);
+	struct page *page;
+
+	if (write && !pte_write(entry))
+		return NULL;
+	if (read && !pte_read(entry))
+		return NULL;
+	page = trans_huge_pmd_page(*pmd, address);
+	if (write && !pte_dirty(entry) && !PageDirty(page))
+		set_page_dirty(page);
+	mark_page_accessed(page);
+	return page;
+}
+
+/*
+ * page_referenced() for a small page mapped by a huge pmd.  There is
+ * only one accessed bit for all of them, so when it was set the other
+ * pages are marked referenced too and don't look idle on their turn.
+ */
+int huge_pmd_referenced(struct vm_area_struct *vma, pmd_t *pmd,
+			unsigned long address, struct page *page)
+{
+	struct page *head;
+	int i;
+
+	if (!pmdp_test_and_clear_young(pmd))
+		return 0;
+	flush_tlb_page(vma, address);
+
+	head = trans_huge_pmd_page(*pmd, address & HPAGE_PMD_MASK);
+	for (i = 0; i < HPAGE_PMD_NR; i++)
+		if (head + i != page)
+			SetPageReferenced(head + i);
+	return 1;
+}
+
+/*
+ * Can the pte at @address go into a huge page?  Returns 1 for a page
+ * that can be copied, 0 for a hole or the zero page, -1 if the range
+ * must stay as it is.
+ */
+static int collapse_pte_check(pte_t pte, unsigned long address)
+{
+	unsigned long pfn;
+	struct page *page;
+
+	if (pte_none(pte))
+		return 0;
+	if (!pte_present(pte))
+		return -1;		/* swapped out */
+	pfn = pte_pfn(pte);
+	if (!pfn_valid(pfn))
+		return -1;
+	page = pfn_to_page(pfn);
+	if (page == ZERO_PAGE(address))
+		return 0;
+	if (PageReserved(page) || !PageAnon(page) || PageSwapCache(page))
+		return -1;
+	/* Shared with a child, pinned for I/O, or being reclaimed */
+	if (page_mapcount(page) != 1 || page_count(page) != 1)
+		return -1;
+	return 1;
+}
+
+/*
+ * Look up the page table covering @haddr and check every pte in it.
+ * Returns the pmd if the range can be collapsed.  page_table_lock held.
+ */
+static pmd_t *collapse_range_check(struct mm_struct *mm, unsigned long haddr)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *pte;
+	int i, ret, present = 0;
+
+	pgd = pgd_offset(mm, haddr);
+	if (!pgd_present(*pgd))
+		return NULL;
+	pud = pud_offset(pgd, haddr);
+	if (!pud_present(*pud))
+		return NULL;
+	pmd = pmd_offset(pud, haddr);
+	if (!pmd_present(*pmd) || pmd_trans_huge(*pmd))
+		return NULL;
+
+	pte = pte_offset_map(pmd, haddr);
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		ret = collapse_pte_check(pte[i], haddr + i * PAGE_SIZE);
+		if (ret < 0) {
+			present = 0;
+			break;
+		}
+		present += ret;
+	}
+	pte_unmap(pte);
+	return present ? pmd : NULL;
+}
+
+/*
+ * Copy the small pages at @haddr into a new huge page and map it with
+ * the pmd.  Called with mmap_sem held for reading, which is dropped:
+ * the range is rebuilt under the write lock so that no fault can be
+ * looking at the old page table meanwhile.
+ */
+static void collapse_huge_page(struct mm_struct *mm,
+			       struct vm_area_struct *vma, unsigned long haddr)
+{
+	struct page *new_page, *pte_page;
+	unsigned long address;
+	pmd_t *pmd;
+	pte_t *pte, entry;
+	int i;
+
+	new_page = alloc_pages_vma(HPAGE_GFP, HPAGE_PMD_ORDER, vma, haddr);
+	up_read(&mm->mmap_sem);
+	if (!new_page)
+		return;
+
+	down_write(&mm->mmap_sem);
+	vma = find_vma(mm, haddr);
+	if (!vma || !vma->anon_vma || !transparent_hugepage_vma(vma) ||
+	    !transparent_hugepage_range(vma, haddr))
+		goto out_free;
+
+	spin_lock(&mm->page_table_lock);
+	pmd = collapse_range_check(mm, haddr);
+	if (!pmd) {
+		spin_unlock(&mm->page_table_lock);
+		goto out_free;
+	}
+
+	/* Nothing may write the old pages once the copy has started */
+	pte_page = pmd_page(*pmd);
+	pmd_clear(pmd);
+	flush_tlb_range(vma, haddr, haddr + HPAGE_PMD_SIZE);
+
+	pte = (pte_t *)page_address(pte_page);
+	address = haddr;
+	for (i = 0; i < HPAGE_PMD_NR; i++, address += PAGE_SIZE) {
+		struct page *page;
+
+		entry = ptep_get_and_clear(pte + i);
+		if (pte_none(entry) ||
+		    (page = pte_page(entry)) == ZERO_PAGE(address)) {
+			clear_user_highpage(new_page + i, address);
+			continue;
+		}
+		copy_user_highpage(new_page + i, page, address);
+		page_remove_rmap(page);
+		mm->anon_rss--;
+		mm->rss--;
+		page_cache_release(page);
+	}
+
+	/* The old page table becomes the one kept for splitting */
+	list_add(&pte_page->lru, &mm->huge_pte_deposit);
+	set_pmd(pmd, prep_huge_anon_pmd(mm, vma, new_page, haddr));
+	spin_unlock(&mm->page_table_lock);
+	up_write(&mm->mmap_sem);
+	inc_page_state(thp_collapse_alloc);
+	return;
+
+out_free:
+	up_write(&mm->mmap_sem);
+	__free_pages(new_page, HPAGE_PMD_ORDER);
+}
+
+/*
+ * Scan up to @pages ptes of @mm from where the last pass stopped, and
+ * collapse the first range that qualifies.  Returns the work done.
+ */
+static int khugepaged_scan_mm(struct mm_struct *mm, int pages)
+{
+	struct vm_area_struct *vma;
+	unsigned long address, start, end;
+	int progress = 0;
+
+	if (!down_read_trylock(&mm->mmap_sem))
+		return 1;
+
+	address = mm->khugepaged_scan_address;
+	vma = find_vma(mm, address);
+	while (vma && progress < pages) {
+		progress++;
+		start = (vma->vm_start + ~HPAGE_PMD_MASK) & HPAGE_PMD_MASK;
+		end = vma->vm_end & HPAGE_PMD_MASK;
+		if (!vma->anon_vma || !transparent_hugepage_vma(vma)) {
+			vma = vma->vm_next;
+			continue;
+		}
+		if (address < start)
+			address = start;
+		while (address < end && progress < pages) {
+			pmd_t *pmd;
+
+			progress += HPAGE_PMD_NR;
+			spin_lock(&mm->page_table_lock);
+			pmd = collapse_range_check(mm, address);
+			spin_unlock(&mm->page_table_lock);
+			address += HPAGE_PMD_SIZE;
+			if (pmd) {
+				mm->khugepaged_scan_address = address;
+				collapse_huge_page(mm, vma,
+						   address - HPAGE_PMD_SIZE);
+				return progress;
+			}
+		}
+		if (address < end)
+			break;
+		vma = vma->vm_next;
+	}
+	mm->khugepaged_scan_address = vma ? address : 0;
+	up_read(&mm->mmap_sem);
+	return progress;
+}
+
+/*
+ * Pick the next mm to scan and rotate it to the tail.  Returns it with
+ * an mm_users reference, or NULL if there is none.
+ */
+static struct mm_struct *khugepaged_next_mm(void)
+{
+	struct mm_struct *mm = NULL;
+
+	spin_lock(&khugepaged_mm_lock);
+	while (!list_empty(&khugepaged_mm_list)) {
+		mm = list_entry(khugepaged_mm_list.next, struct mm_struct,
+				khugepaged_list);
+		list_move_tail(&mm->khugepaged_list, &khugepaged_mm_list);
+		if (atomic_inc_return(&mm->mm_users) != 1)
+			break;
+		/* Already on its way out through mmput() */
+		atomic_dec(&mm->mm_users);
+		list_del_init(&mm->khugepaged_list);
+		mm = NULL;
+	}
+	spin_unlock(&khugepaged_mm_lock);
+	return mm;
+}
+
+static void khugepaged_do_scan(void)
+{
+	int pages = khugepaged_pages_to_scan;
+
+	while (pages > 0) {
+		struct mm_struct *mm = khugepaged_next_mm();
+
+		if (!mm)
+			break;
+		pages -= khugepaged_scan_mm(mm, pages);
+		mmput(mm);
+		cond_resched();
+	}
+}
+
+/*
+ * khugepaged wakes up every khugepaged_scan_sleep_millisecs and looks
+ * at khugepaged_pages_to_scan ptes' worth of registered address space.
+ */
+static int khugepaged(void *unused)
+{
+	DEFINE_WAIT(wait);
+
+	daemonize("khugepaged");
+	set_user_nice(current, 19);
+
+	for ( ; ; ) {
+		if (current->flags & PF_FREEZE)
+			refrigerator(PF_FREEZE);
+
+		if (sysctl_transparent_hugepage)
+			khugepaged_do_scan();
+
+		prepare_to_wait(&khugepaged_wait, &wait, TASK_INTERRUPTIBLE);
+		if (list_empty(&khugepaged_mm_list))
+			schedule();
+		else
+			schedule_timeout(msecs_to_jiffies(
+					khugepaged_scan_sleep_millisecs));
+		finish_wait(&khugepaged_wait, &wait);
+	}
+	return 0;
+}
+
+/* @mm faulted in eligible memory: have khugepaged look at it. */
+void khugepaged_enter(struct mm_struct *mm)
+{
+	int wake = 0;
+
+	if (!list_empty(&mm->khugepaged_list))
+		return;
+	spin_lock(&khugepaged_mm_lock);
+	if (list_empty(&mm->khugepaged_list)) {
+		wake = list_empty(&khugepaged_mm_list);
+		list_add_tail(&mm->khugepaged_list, &khugepaged_mm_list);
+	}
+	spin_unlock(&khugepaged_mm_lock);
+	if (wake)
+		wake_up_interruptible(&khugepaged_wait);
+}
+
+/* Called from mmput() as the last user goes away. */
+void khugepaged_exit(struct mm_struct *mm)
+{
+	if (list_empty(&mm->khugepaged_list))
+		return;
+	spin_lock(&khugepaged_mm_lock);
+	list_del_init(&mm->khugepaged_list);
+	spin_unlock(&khugepaged_mm_lock);
+}
+
+static int __init khugepaged_init(void)
+{
+	kernel_thread(khugepaged, NULL, CLONE_KERNEL);
+	return 0;
+}
+
+module_init(khugepaged_init)
@@ -11,3 +11,8 @@
 
 /* page_alloc.c */
 extern void set_page_refs(struct page *page, int order);
+extern void split_page(struct page *page, unsigned int order);
+
+/* mlock.c */
+extern void munlock_vma_pages_range(struct vm_area_struct *vma,
+			unsigned long start, unsigned long end);
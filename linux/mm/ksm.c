@@ -0,0 +1,782 @@
+/*
+ * mm/ksm.c
+ *
+ * Kernel same-page merging for anonymous memory.
+ *
+ * Applications mark areas that are likely to hold many copies of the same
+ * data with madvise(MADV_MERGEABLE), and ksmd walks them a few pages at a
+ * time.  Each page it finds is checksummed and looked up first among the
+ * pages already merged (the stable table), then among the candidates seen
+ * on earlier passes (the unstable table).  When the contents match, the
+ * ptes are write-protected, the contents compared once more, and the ptes
+ * pointed at a single read-only KSM page.  A write to it faults, and
+ * do_wp_page() hands the writer a private copy again.
+ *
+ * A page only becomes a candidate once its checksum stayed the same from
+ * one pass to the next, which keeps pages that are being written to out
+ * of the way.  Both tables are hashed on the checksum, and every match is
+ * confirmed by comparing the whole page.
+ *
+ * Every page ksmd looked at has an rmap_item, kept on a per-mm list in
+ * address order, which remembers the checksum and the KSM page mapped
+ * there, if any.  KSM pages have no anon_vma and are kept off the LRU, so
+ * they are never swapped: they are found only through these tables, and
+ * freed once nothing maps them any more.
+ *
+ * ksm_sem serializes ksmd against ksm_exit() and covers the tables and the
+ * rmap_items.  ksmd only trylocks mmap_sem while holding it.
+ */
+
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/swap.h>
+#include <linux/highmem.h>
+#include <linux/pagemap.h>
+#include <linux/rmap.h>
+#include <linux/slab.h>
+#include <linux/jhash.h>
+#include <linux/huge_mm.h>
+#include <linux/ksm.h>
+#include <linux/init.h>
+
+#include <asm/semaphore.h>
+#include <asm/tlbflush.h>
+
+int sysctl_ksm_run = 1;
+int ksm_pages_to_scan = 100;
+int ksm_sleep_millisecs = 20;
+unsigned long ksm_pages_shared;
+unsigned long ksm_pages_sharing;
+
+/*
+ * The mms ksmd scans, round robin.  An mm is added by MADV_MERGEABLE or
+ * by fork from a registered parent, and taken off by mmput().
+ */
+static LIST_HEAD(ksm_mm_list);
+static DEFINE_SPINLOCK(ksm_mm_lock);
+static DECLARE_WAIT_QUEUE_HEAD(ksm_wait);
+static DECLARE_MUTEX(ksm_sem);
+
+#define KSM_HASH_BITS	12
+#define KSM_HASH_SIZE	(1 << KSM_HASH_BITS)
+
+/**
+ * һKSMҳݵУ͹stable_hash
+ */
+struct stable_node {
+	struct hlist_node hash;		/* on stable_hash */
+	struct page *page;		/* the KSM page, holds a reference */
+	u32 checksum;
+	int nr_items;			/* rmap_items that map it */
+};
+
+/**
+ * ksmdÿһҳӦһrmap_item
+ */
+struct rmap_item {
+	struct list_head link;		/* on mm->ksm_rmap_list, by address */
+	struct hlist_node hash;		/* on unstable_hash, if a candidate */
+	struct mm_struct *mm;
+	unsigned long address;
+	u32 checksum;			/* of the contents at the last pass */
+	struct stable_node *node;	/* KSM page mapped here, if any */
+};
+
+static struct hlist_head stable_hash[KSM_HASH_SIZE];
+static struct hlist_head unstable_hash[KSM_HASH_SIZE];
+static unsigned long ksm_stable_nodes;
+
+static kmem_cache_t *rmap_item_cachep;
+static kmem_cache_t *stable_node_cachep;
+
+static inline struct hlist_head *ksm_hash(struct hlist_head *table,
+					  u32 checksum)
+{
+	return &table[checksum & (KSM_HASH_SIZE - 1)];
+}
+
+static u32 calc_checksum(struct page *page)
+{
+	void *addr = kmap_atomic(page, KM_USER0);
+	u32 checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+
+	kunmap_atomic(addr, KM_USER0);
+	return checksum;
+}
+
+static int pages_identical(struct page *page1, struct page *page2)
+{
+	char *addr1, *addr2;
+	int ret;
+
+	addr1 = kmap_atomic(page1, KM_USER0);
+	addr2 = kmap_atomic(page2, KM_USER1);
+	ret = !memcmp(addr1, addr2, PAGE_SIZE);
+	kunmap_atomic(addr2, KM_USER1);
+	kunmap_atomic(addr1, KM_USER0);
+	return ret;
+}
+
+static void stable_item_add(struct rmap_item *item, struct stable_node *node)
+{
+	item->node = node;
+	if (node->nr_items++)
+		ksm_pages_sharing++;
+	else
+		ksm_pages_shared++;
+}
+
+/* Take @item off the KSM page or the unstable table it is on. */
+static void unlink_rmap_item(struct rmap_item *item)
+{
+	struct stable_node *node = item->node;
+
+	if (node) {
+		item->node = NULL;
+		if (--node->nr_items)
+			ksm_pages_sharing--;
+		else
+			ksm_pages_shared--;
+	} else if (!hlist_unhashed(&item->hash))
+		hlist_del_init(&item->hash);
+}
+
+static void free_rmap_item(struct rmap_item *item)
+{
+	unlink_rmap_item(item);
+	list_del(&item->link);
+	kmem_cache_free(rmap_item_cachep, item);
+}
+
+/*
+ * Make a KSM page holding a copy of @page.  It is neither mapped nor in
+ * the stable table yet.
+ */
+static struct stable_node *alloc_stable_node(struct page *page)
+{
+	struct stable_node *node;
+	struct page *kpage;
+
+	node = kmem_cache_alloc(stable_node_cachep, GFP_KERNEL);
+	if (!node)
+		return NULL;
+	kpage = alloc_page(GFP_HIGHUSER);
+	if (!kpage) {
+		kmem_cache_free(stable_node_cachep, node);
+		return NULL;
+	}
+	copy_highpage(kpage, page);
+	kpage->mapping = (struct address_space *) PAGE_MAPPING_ANON;
+	kpage->private = (unsigned long) node;
+	SetPageKsm(kpage);
+
+	INIT_HLIST_NODE(&node->hash);
+	node->page = kpage;
+	/* Of the copy: @page may have changed since it was checksummed */
+	node->checksum = calc_checksum(kpage);
+	node->nr_items = 0;
+	return node;
+}
+
+static void free_stable_node(struct stable_node *node)
+{
+	struct page *kpage = node->page;
+
+	if (!hlist_unhashed(&node->hash)) {
+		hlist_del(&node->hash);
+		ksm_stable_nodes--;
+	}
+	ClearPageKsm(kpage);
+	kpage->private = 0;
+	page_cache_release(kpage);
+	kmem_cache_free(stable_node_cachep, node);
+}
+
+/*
+ * Map the pte for @address, or return NULL if there is no page table
+ * or a huge pmd covers it.  page_table_lock held.
+ */
+static pte_t *ksm_pte_offset(struct mm_struct *mm, unsigned long address)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	pgd = pgd_offset(mm, address);
+	if (!pgd_present(*pgd))
+		return NULL;
+	pud = pud_offset(pgd, address);
+	if (!pud_present(*pud))
+		return NULL;
+	pmd = pmd_offset(pud, address);
+	if (!pmd_present(*pmd) || pmd_trans_huge(*pmd))
+		return NULL;
+	return pte_offset_map(pmd, address);
+}
+
+/* The anonymous page mapped at @address, with a reference, or NULL. */
+static struct page *ksm_follow_page(struct mm_struct *mm,
+				    unsigned long address)
+{
+	struct page *page = NULL;
+	pte_t *pte;
+
+	spin_lock(&mm->page_table_lock);
+	pte = ksm_pte_offset(mm, address);
+	if (pte) {
+		if (pte_present(*pte) && pfn_valid(pte_pfn(*pte))) {
+			page = pfn_to_page(pte_pfn(*pte));
+			if (PageReserved(page) || !PageAnon(page))
+				page = NULL;
+			else
+				get_page(page);
+		}
+		pte_unmap(pte);
+	}
+	spin_unlock(&mm->page_table_lock);
+	return page;
+}
+
+static inline int ksm_scan_vma(struct vm_area_struct *vma)
+{
+	return (vma->vm_flags & VM_MERGEABLE) &&
+		!(vma->vm_flags & VM_LOCKED) && vma->anon_vma;
+}
+
+/*
+ * The vma @item is in, if that is still mergeable.  @item->mm's mmap_sem
+ * held.
+ */
+static struct vm_area_struct *find_mergeable_vma(struct rmap_item *item)
+{
+	struct vm_area_struct *vma;
+
+	vma = find_vma(item->mm, item->address);
+	if (!vma || vma->vm_start > item->address || !ksm_scan_vma(vma))
+		return NULL;
+	return vma;
+}
+
+/*
+ * Make the pte of @page at @address read-only and clean, so that the
+ * contents cannot change without a fault, and return it in @orig_pte.
+ * Fails if something other than the mappings holds on to the page, such
+ * as O_DIRECT, which could still write to it behind our back.
+ */
+static int write_protect_page(struct vm_area_struct *vma,
+			      unsigned long address, struct page *page,
+			      pte_t *orig_pte)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	pte_t *pte, entry;
+	int err = -EFAULT;
+
+	spin_lock(&mm->page_table_lock);
+	pte = ksm_pte_offset(mm, address);
+	if (!pte)
+		goto out_unlock;
+	if (!pte_present(*pte) || pte_pfn(*pte) != page_to_pfn(page))
+		goto out_unmap;
+
+	if (pte_write(*pte) || pte_dirty(*pte)) {
+		int swapped = PageSwapCache(page);
+
+		flush_cache_page(vma, address);
+		entry = ptep_clear_flush(vma, address, pte);
+		/* The mappings, our reference and the swap cache's */
+		if (page_mapcount(page) + 1 + swapped != page_count(page)) {
+			set_pte(pte, entry);
+			goto out_unmap;
+		}
+		if (pte_dirty(entry))
+			set_page_dirty(page);
+		set_pte(pte, pte_mkclean(pte_wrprotect(entry)));
+	}
+	*orig_pte = *pte;
+	err = 0;
+out_unmap:
+	pte_unmap(pte);
+out_unlock:
+	spin_unlock(&mm->page_table_lock);
+	return err;
+}
+
+/* Point the pte at @address, still @orig_pte, at @kpage instead of @page. */
+static int replace_page(struct vm_area_struct *vma, unsigned long address,
+			struct page *page, struct page *kpage, pte_t orig_pte)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	pte_t *pte;
+	int err = -EFAULT;
+
+	spin_lock(&mm->page_table_lock);
+	pte = ksm_pte_offset(mm, address);
+	if (!pte)
+		goto out_unlock;
+	if (pte_same(*pte, orig_pte)) {
+		get_page(kpage);
+		page_add_ksm_rmap(kpage);
+		flush_cache_page(vma, address);
+		ptep_clear_flush(vma, address, pte);
+		set_pte(pte, pte_wrprotect(mk_pte(kpage, vma->vm_page_prot)));
+		update_mmu_cache(vma, address, *pte);
+		/* anon_rss stays: a KSM page counts as anonymous */
+		page_remove_rmap(page);
+		page_cache_release(page);
+		err = 0;
+	}
+	pte_unmap(pte);
+out_unlock:
+	spin_unlock(&mm->page_table_lock);
+	return err;
+}
+
+/*
+ * Map @kpage in place of @page at @address if their contents are the
+ * same.  mmap_sem held.
+ */
+static int try_to_merge_one_page(struct vm_area_struct *vma,
+				 unsigned long address, struct page *page,
+				 struct page *kpage)
+{
+	pte_t orig_pte;
+	int err = -EFAULT;
+
+	if (!PageAnon(page) || PageKsm(page))
+		return err;
+	/* Keeps the page out of and in the swap cache while we look */
+	if (TestSetPageLocked(page))
+		return -EBUSY;
+	if (!write_protect_page(vma, address, page, &orig_pte) &&
+	    pages_identical(page, kpage))
+		err = replace_page(vma, address, page, kpage, orig_pte);
+	unlock_page(page);
+	return err;
+}
+
+/*
+ * Merge @page, seen at @item, into @kpage.  Gives up rather than wait
+ * for @item->mm's mmap_sem.
+ */
+static int try_to_merge_with_ksm_page(struct rmap_item *item,
+				      struct page *page, struct page *kpage)
+{
+	struct mm_struct *mm = item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	if (!atomic_read(&mm->mm_users) || !down_read_trylock(&mm->mmap_sem))
+		return -EBUSY;
+	vma = find_mergeable_vma(item);
+	if (vma)
+		err = try_to_merge_one_page(vma, item->address, page, kpage);
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
+/*
+ * The page mapped where @item was seen, with a reference, if it may
+ * still be merged.
+ */
+static struct page *get_mergeable_page(struct rmap_item *item)
+{
+	struct mm_struct *mm = item->mm;
+	struct page *page = NULL;
+
+	if (!atomic_read(&mm->mm_users) || !down_read_trylock(&mm->mmap_sem))
+		return NULL;
+	if (find_mergeable_vma(item))
+		page = ksm_follow_page(mm, item->address);
+	up_read(&mm->mmap_sem);
+	if (page && PageKsm(page)) {
+		page_cache_release(page);
+		page = NULL;
+	}
+	return page;
+}
+
+static struct stable_node *stable_hash_search(struct page *page,
+					      u32 checksum)
+{
+	struct stable_node *node;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry(node, pos, ksm_hash(stable_hash, checksum), hash)
+		if (node->checksum == checksum &&
+		    pages_identical(page, node->page))
+			return node;
+	return NULL;
+}
+
+/*
+ * Find a candidate with the same contents as @page, and return it with
+ * its page in @tree_pagep.  Candidates whose page has gone or changed
+ * since are dropped on the way.
+ */
+static struct rmap_item *unstable_hash_search(struct rmap_item *item,
+					      struct page *page,
+					      struct page **tree_pagep)
+{
+	struct rmap_item *tree_item;
+	struct hlist_node *pos, *n;
+	struct page *tree_page;
+
+	hlist_for_each_entry_safe(tree_item, pos, n,
+			ksm_hash(unstable_hash, item->checksum), hash) {
+		if (tree_item->checksum != item->checksum)
+			continue;
+		tree_page = get_mergeable_page(tree_item);
+		if (tree_page == page) {
+			/* Still shared with a parent or child since fork */
+			page_cache_release(tree_page);
+			continue;
+		}
+		if (tree_page) {
+			if (pages_identical(page, tree_page)) {
+				*tree_pagep = tree_page;
+				return tree_item;
+			}
+			page_cache_release(tree_page);
+		}
+		hlist_del_init(&tree_item->hash);
+	}
+	return NULL;
+}
+
+/*
+ * Two candidates with the same contents: copy them into a new KSM page
+ * and map that in place of both.
+ */
+static void try_to_merge_two_pages(struct rmap_item *item, struct page *page,
+				   struct rmap_item *tree_item,
+				   struct page *tree_page)
+{
+	struct stable_node *node;
+
+	node = alloc_stable_node(page);
+	if (!node)
+		return;
+	if (try_to_merge_with_ksm_page(item, page, node->page)) {
+		free_stable_node(node);
+		return;
+	}
+	hlist_add_head(&node->hash, ksm_hash(stable_hash, node->checksum));
+	ksm_stable_nodes++;
+	stable_item_add(item, node);
+	/*
+	 * Should the other one have changed meanwhile, the KSM page is left
+	 * mapped just once: that saves nothing, but costs nothing either.
+	 */
+	if (!try_to_merge_with_ksm_page(tree_item, tree_page, node->page))
+		stable_item_add(tree_item, node);
+}
+
+/*
+ * ksmd found @page at @item: merge it with a KSM page or with an earlier
+ * candidate of the same contents, or make it a candidate itself.
+ */
+static void cmp_and_merge_page(struct page *page, struct rmap_item *item)
+{
+	struct stable_node *node;
+	struct rmap_item *tree_item;
+	struct page *tree_page;
+	u32 checksum;
+
+	if (PageKsm(page)) {
+		/* Merged here before, or come with fork or mremap */
+		node = (struct stable_node *) page->private;
+		if (item->node != node) {
+			unlink_rmap_item(item);
+			stable_item_add(item, node);
+		}
+		return;
+	}
+	/* Whatever was here on the last pass has been written to or unmapped */
+	unlink_rmap_item(item);
+
+	checksum = calc_checksum(page);
+	node = stable_hash_search(page, checksum);
+	if (node) {
+		if (!try_to_merge_with_ksm_page(item, page, node->page))
+			stable_item_add(item, node);
+		return;
+	}
+
+	if (checksum != item->checksum) {
+		item->checksum = checksum;
+		return;
+	}
+	tree_item = unstable_hash_search(item, page, &tree_page);
+	if (!tree_item) {
+		hlist_add_head(&item->hash, ksm_hash(unstable_hash, checksum));
+		return;
+	}
+	hlist_del_init(&tree_item->hash);
+	try_to_merge_two_pages(item, page, tree_item, tree_page);
+	page_cache_release(tree_page);
+}
+
+/*
+ * The rmap_item for @address, found at *@cursor in @mm's address-ordered
+ * list, or a new one inserted there.  Items for lower addresses passed on
+ * the way are for pages that have gone, and are freed.  With @create
+ * clear, the item for @address is freed as well.
+ */
+static struct rmap_item *get_rmap_item(struct mm_struct *mm,
+				       struct list_head **cursor,
+				       unsigned long address, int create)
+{
+	struct rmap_item *item;
+
+	while (*cursor != &mm->ksm_rmap_list) {
+		item = list_entry(*cursor, struct rmap_item, link);
+		if (item->address > address)
+			break;
+		*cursor = item->link.next;
+		if (item->address == address && create)
+			return item;
+		free_rmap_item(item);
+	}
+	if (!create)
+		return NULL;
+
+	item = kmem_cache_alloc(rmap_item_cachep, GFP_KERNEL);
+	if (!item)
+		return NULL;
+	INIT_HLIST_NODE(&item->hash);
+	item->mm = mm;
+	item->address = address;
+	item->checksum = 0;
+	item->node = NULL;
+	list_add_tail(&item->link, *cursor);
+	return item;
+}
+
+/*
+ * Scan up to @pages ptes of @mm from where the last pass stopped.
+ * Returns the work done.
+ */
+static int ksm_scan_mm(struct mm_struct *mm, int pages)
+{
+	struct vm_area_struct *vma;
+	struct list_head *cursor;
+	struct rmap_item *item;
+	struct page *page;
+	unsigned long address;
+	int progress = 0;
+
+	if (!down_read_trylock(&mm->mmap_sem))
+		return 1;
+
+	address = mm->ksm_scan_address;
+	cursor = mm->ksm_rmap_list.next;
+	while (cursor != &mm->ksm_rmap_list &&
+	       list_entry(cursor, struct rmap_item, link)->address < address)
+		cursor = cursor->next;
+
+	while ((vma = find_vma(mm, address)) && progress < pages) {
+		progress++;
+		if (!ksm_scan_vma(vma)) {
+			address = vma->vm_end;
+			continue;
+		}
+		if (address < vma->vm_start)
+			address = vma->vm_start;
+
+		page = ksm_follow_page(mm, address);
+		item = get_rmap_item(mm, &cursor, address, page != NULL);
+		address += PAGE_SIZE;
+		if (!page)
+			continue;
+		if (!item) {
+			page_cache_release(page);
+			continue;
+		}
+
+		/* The other mms involved are only ever trylocked */
+		up_read(&mm->mmap_sem);
+		cmp_and_merge_page(page, item);
+		page_cache_release(page);
+		cond_resched();
+		if (!down_read_trylock(&mm->mmap_sem)) {
+			mm->ksm_scan_address = address;
+			return progress;
+		}
+	}
+	if (!vma) {
+		/* Came to the end: whatever is left over has gone */
+		while (cursor != &mm->ksm_rmap_list) {
+			item = list_entry(cursor, struct rmap_item, link);
+			cursor = cursor->next;
+			free_rmap_item(item);
+		}
+		address = 0;
+	}
+	mm->ksm_scan_address = address;
+	up_read(&mm->mmap_sem);
+	return progress;
+}
+
+/*
+ * Pick the next mm to scan and rotate it to the tail.  It takes no
+ * reference: ksm_exit() waits for ksm_sem, which the caller holds.
+ */
+static struct mm_struct *ksm_next_mm(void)
+{
+	struct mm_struct *mm = NULL;
+
+	spin_lock(&ksm_mm_lock);
+	if (!list_empty(&ksm_mm_list)) {
+		mm = list_entry(ksm_mm_list.next, struct mm_struct, ksm_list);
+		list_move_tail(&mm->ksm_list, &ksm_mm_list);
+	}
+	spin_unlock(&ksm_mm_lock);
+	return mm;
+}
+
+/*
+ * Free the KSM pages nothing maps any more.  One still mapped in an mm
+ * ksmd has not been back to, after fork or mremap, is kept for it.
+ */
+static void ksm_prune_stable(void)
+{
+	struct stable_node *node;
+	struct hlist_node *pos, *n;
+	int i;
+
+	if (ksm_stable_nodes == ksm_pages_shared)
+		return;
+	for (i = 0; i < KSM_HASH_SIZE; i++)
+		hlist_for_each_entry_safe(node, pos, n, &stable_hash[i], hash)
+			if (!node->nr_items && !page_mapped(node->page))
+				free_stable_node(node);
+}
+
+static void ksm_do_scan(void)
+{
+	int pages = ksm_pages_to_scan;
+	struct mm_struct *mm;
+
+	down(&ksm_sem);
+	/* Drop the pagevec references that would make pages look pinned */
+	lru_add_drain();
+	while (pages > 0 && (mm = ksm_next_mm()) != NULL) {
+		if (atomic_read(&mm->mm_users))
+			pages -= max(ksm_scan_mm(mm, pages), 1);
+		else
+			pages--;
+	}
+	ksm_prune_stable();
+	up(&ksm_sem);
+}
+
+/*
+ * ksmd wakes up every ksm_sleep_millisecs and looks at ksm_pages_to_scan
+ * pages of registered address space.
+ */
+static int ksmd(void *unused)
+{
+	DEFINE_WAIT(wait);
+
+	daemonize("ksmd");
+	set_user_nice(current, 5);
+
+	for ( ; ; ) {
+		if (current->flags & PF_FREEZE)
+			refrigerator(PF_FREEZE);
+
+		if (sysctl_ksm_run)
+			ksm_do_scan();
+
+		prepare_to_wait(&ksm_wait, &wait, TASK_INTERRUPTIBLE);
+		if (list_empty(&ksm_mm_list))
+			schedule();
+		else
+			schedule_timeout(msecs_to_jiffies(ksm_sleep_millisecs));
+		finish_wait(&ksm_wait, &wait);
+	}
+	return 0;
+}
+
+/* @mm has mergeable areas now: have ksmd look at it. */
+void ksm_enter(struct mm_struct *mm)
+{
+	int wake = 0;
+
+	if (!list_empty(&mm->ksm_list))
+		return;
+	spin_lock(&ksm_mm_lock);
+	if (list_empty(&mm->ksm_list)) {
+		wake = list_empty(&ksm_mm_list);
+		list_add_tail(&mm->ksm_list, &ksm_mm_list);
+	}
+	spin_unlock(&ksm_mm_lock);
+	if (wake)
+		wake_up_interruptible(&ksm_wait);
+}
+
+/*
+ * Called from mmput() as the last user goes away, before the mappings
+ * are torn down: waits for ksmd to be done with @mm.
+ */
+void ksm_exit(struct mm_struct *mm)
+{
+	struct rmap_item *item, *next;
+
+	if (list_empty(&mm->ksm_list))
+		return;
+	spin_lock(&ksm_mm_lock);
+	list_del_init(&mm->ksm_list);
+	spin_unlock(&ksm_mm_lock);
+
+	down(&ksm_sem);
+	list_for_each_entry_safe(item, next, &mm->ksm_rmap_list, link)
+		free_rmap_item(item);
+	mm->ksm_scan_address = 0;
+	up(&ksm_sem);
+}
+
+/*
+ * Give the range private copies of the KSM pages mapped in it, for
+ * MADV_UNMERGEABLE.  mmap_sem held for writing.
+ */
+int ksm_unmerge(struct vm_area_struct *vma, unsigned long start,
+		unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long address;
+
+	for (address = start; address < end; address += PAGE_SIZE) {
+		for ( ; ; ) {
+			struct page *page;
+			int ksm, ret;
+
+			spin_lock(&mm->page_table_lock);
+			page = follow_page(mm, address, 0);
+			ksm = page && PageKsm(page);
+			spin_unlock(&mm->page_table_lock);
+			if (!ksm)
+				break;
+			/* A write fault copies it, as for any other writer */
+			ret = handle_mm_fault(mm, vma, address, 1);
+			if (ret == VM_FAULT_OOM)
+				return -ENOMEM;
+			if (ret == VM_FAULT_SIGBUS)
+				return -EFAULT;
+		}
+		cond_resched();
+	}
+	return 0;
+}
+
+static int __init ksm_init(void)
+{
+	rmap_item_cachep = kmem_cache_create("ksm_rmap_item",
+			sizeof(struct rmap_item), 0, SLAB_PANIC, NULL, NULL);
+	stable_node_cachep = kmem_cache_create("ksm_stable_node",
+			sizeof(struct stable_node), 0, SLAB_PANIC, NULL, NULL);
+	kernel_thread(ksmd, NULL, CLONE_KERNEL);
+	return 0;
+}
+
+module_init(ksm_init)
@@ -9,6 +9,7 @@
 #include <linux/pagemap.h>
 #include <linux/syscalls.h>
 #include <linux/hugetlb.h>
+#include <linux/ksm.h>
 
 /*
  * We can potentially split a vm area into separate
@@ -111,6 +112,51 @@ static long madvise_dontneed(struct vm_area_struct * vma,
 	return 0;
 }
 
+#ifdef CONFIG_KSM
+/*
+ * Let ksmd merge the identical pages of the range, or stop it and give
+ * the range private copies of the pages merged so far.
+ */
+static long madvise_mergeable(struct vm_area_struct * vma,
+			      unsigned long start, unsigned long end,
+			      int behavior)
+{
+	struct mm_struct * mm = vma->vm_mm;
+	int error = 0;
+
+	if (behavior == MADV_MERGEABLE) {
+		if ((vma->vm_flags & VM_MERGEABLE) || !ksm_vma_eligible(vma))
+			return 0;
+	} else if (!(vma->vm_flags & VM_MERGEABLE))
+		return 0;
+
+	if (start != vma->vm_start) {
+		error = split_vma(mm, vma, start, 1);
+		if (error)
+			goto out;
+	}
+
+	if (end != vma->vm_end) {
+		error = split_vma(mm, vma, end, 0);
+		if (error)
+			goto out;
+	}
+
+	if (behavior == MADV_MERGEABLE) {
+		vma->vm_flags |= VM_MERGEABLE;
+		ksm_enter(mm);
+	} else {
+		vma->vm_flags &= ~VM_MERGEABLE;
+		error = ksm_unmerge(vma, start, end);
+	}
+
+out:
+	if (error == -ENOMEM)
+		error = -EAGAIN;
+	return error;
+}
+#endif
+
 static long madvise_vma(struct vm_area_struct * vma, unsigned long start,
 			unsigned long end, int behavior)
 {
@@ -131,6 +177,13 @@ static long madvise_vma(struct vm_area_struct * vma, unsigned long start,
 		error = madvise_dontneed(vma, start, end);
 		break;
 
+#ifdef CONFIG_KSM
+	case MADV_MERGEABLE:
+	case MADV_UNMERGEABLE:
+		error = madvise_mergeable(vma, start, end, behavior);
+		break;
+#endif
+
 	default:
 		error = -EINVAL;
 		break;
@@ -161,6 +214,10 @@ static long madvise_vma(struct vm_area_struct * vma, unsigned long start,
  *		some pages ahead.
  *  MADV_DONTNEED - the application is finished with the given range,
  *		so the kernel can free resources associated with it.
+ *  MADV_MERGEABLE - the range holds many pages with the same contents:
+ *		ksmd may merge them into one write-protected copy.
+ *  MADV_UNMERGEABLE - undo MADV_MERGEABLE, giving the range private
+ *		copies of the pages merged so far.
  *
  * return values:
  *  zero    - success
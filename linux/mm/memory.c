@@ -41,6 +41,7 @@
 #include <linux/kernel_stat.h>
 #include <linux/mm.h>
 #include <linux/hugetlb.h>
+#include <linux/huge_mm.h>
 #include <linux/mman.h>
 #include <linux/swap.h>
 #include <linux/highmem.h>
@@ -49,6 +50,7 @@
 #include <linux/acct.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/mempolicy.h>
 
 #include <asm/pgalloc.h>
 #include <asm/uaccess.h>
@@ -344,6 +346,8 @@ static int copy_pte_range(struct mm_struct *dst_mm,  struct mm_struct *src_mm,
 		return -ENOMEM;
 
 	spin_lock(&src_mm->page_table_lock);
+	if (pmd_trans_huge(*src_pmd))
+		split_huge_pmd(src_mm, src_pmd);
 	s = src_pte = pte_offset_map_nested(src_pmd, addr);
 	for (; addr < end; addr += PAGE_SIZE, s++, d++) {
 		if (pte_none(*s))
@@ -376,7 +380,7 @@ static int copy_pmd_range(struct mm_struct *dst_mm,  struct mm_struct *src_mm,
 			next = end;
 		if (pmd_none(*src_pmd))
 			continue;
-		if (pmd_bad(*src_pmd)) {
+		if (!pmd_trans_huge(*src_pmd) && pmd_bad(*src_pmd)) {
 			pmd_ERROR(*src_pmd);
 			pmd_clear(src_pmd);
 			continue;
@@ -477,6 +481,14 @@ static void zap_pte_range(struct mmu_gather *tlb,
 
 	if (pmd_none(*pmd))
 		return;
+	if (pmd_trans_huge(*pmd)) {
+		/* Only a full, aligned range can drop the huge page whole */
+		if (!details && !(address & ~PMD_MASK) && size >= PMD_SIZE) {
+			zap_huge_pmd(tlb, pmd);
+			return;
+		}
+		split_huge_pmd(tlb->mm, pmd);
+	}
 	if (unlikely(pmd_bad(*pmd))) {
 		pmd_ERROR(*pmd);
 		pmd_clear(pmd);
@@ -783,7 +795,11 @@ __follow_page(struct mm_struct *mm, unsigned long address, int read, int write)
 		goto out;
 	
 	pmd = pmd_offset(pud, address);
-	if (pmd_none(*pmd) || unlikely(pmd_bad(*pmd)))
+	if (pmd_none(*pmd))
+		goto out;
+	if (pmd_trans_huge(*pmd))
+		return follow_trans_huge_pmd(pmd, address, read, write);
+	if (unlikely(pmd_bad(*pmd)))
 		goto out;
 	if (pmd_huge(*pmd))
 		return follow_huge_pmd(mm, address, pmd, write);
@@ -864,7 +880,8 @@ untouched_anonymous_page(struct mm_struct* mm, struct vm_area_struct *vma,
 
 	/* Check if page middle directory entry exists. */
 	pmd = pmd_offset(pud, address);
-	if (pmd_none(*pmd) || unlikely(pmd_bad(*pmd)))
+	if (pmd_none(*pmd) ||
+	    unlikely(!pmd_trans_huge(*pmd) && pmd_bad(*pmd)))
 		return 1;
 
 	/* There is a pte slot for 'address' in 'mm'. */
@@ -1335,7 +1352,8 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 	 */
 	old_page = pfn_to_page(pfn);
 
-	if (!TestSetPageLocked(old_page)) {
+	/* A page merged by ksmd is always copied, even if mapped only here */
+	if (!PageKsm(old_page) && !TestSetPageLocked(old_page)) {
 		/**
 		 * old_pagecountֶ
 		 * ֻһӵиҳʱΪ1Ȼҳ潻
@@ -1388,7 +1406,7 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 		if (!new_page)
 			goto no_new_page;
 	} else {
-		new_page = alloc_page_vma(GFP_HIGHUSER, vma, address);
+		new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, address);
 		if (!new_page)
 			goto no_new_page;
 		/**
@@ -1422,6 +1440,7 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 		 * lru_cache_add_activeҳ뵽ҳ潻صݽṹС
 		 * ҳͻҳ潻ˡ
 		 */
+		SetPageSwapBacked(new_page);
 		lru_cache_add_active(new_page);
 		page_add_anon_rmap(new_page, vma, address);
 
@@ -2006,6 +2025,7 @@ do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		/**
 		 * lru_cache_add_activeҳ뽻صݽṹС
 		 */
+		SetPageSwapBacked(page);
 		lru_cache_add_active(page);
 		SetPageReferenced(page);
 		page_add_anon_rmap(page, vma, addr);
@@ -2023,6 +2043,42 @@ no_mem:
 	return VM_FAULT_OOM;
 }
 
+/*
+ * Number of pages around a read fault on a file mapping that we try to
+ * map from the page cache while the page table is at hand.  Rounded down
+ * to a power of two; 1 disables fault-around.
+ */
+/**
+ * ļӳȱҳʱ˳ӳĴڴС(ҳ)
+ */
+int sysctl_fault_around_pages = 16;
+
+/*
+ * Map the already cached pages of the naturally aligned window around
+ * @address, clipped to the vma and to the page table which maps @address.
+ * Called with page_table_lock held and the pte unmapped.
+ */
+static void do_fault_around(struct vm_area_struct *vma, unsigned long address,
+			    pmd_t *pmd)
+{
+	unsigned long nr = sysctl_fault_around_pages;
+	unsigned long start, end;
+	pte_t *pte;
+
+	if (nr > PTRS_PER_PTE)
+		nr = PTRS_PER_PTE;
+	nr = 1UL << (fls(nr) - 1);
+
+	start = address & ~((nr << PAGE_SHIFT) - 1);
+	start = max(start, max(vma->vm_start, address & PMD_MASK));
+	end = (address & ~((nr << PAGE_SHIFT) - 1)) + (nr << PAGE_SHIFT);
+	end = min(end, min(vma->vm_end, (address & PMD_MASK) + PMD_SIZE));
+
+	pte = pte_offset_map(pmd, start);
+	vma->vm_ops->map_pages(vma, start, end, pte);
+	pte_unmap(pte);
+}
+
 /*
  * do_no_page() tries to create a new page mapping. It aggressively
  * tries to share with existing pages, but makes a separate copy if
@@ -2107,7 +2163,7 @@ retry:
 		/**
 		 * һҳȡҳһݵҳС
 		 */
-		page = alloc_page_vma(GFP_HIGHUSER, vma, address);
+		page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, address);
 		if (!page)
 			goto oom;
 		copy_user_highpage(page, new_page, address);
@@ -2165,6 +2221,7 @@ retry:
 			entry = maybe_mkwrite(pte_mkdirty(entry), vma);
 		set_pte(page_table, entry);
 		if (anon) {
+			SetPageSwapBacked(new_page);
 			lru_cache_add_active(new_page);
 			page_add_anon_rmap(new_page, vma, address);
 		} else
@@ -2180,6 +2237,14 @@ retry:
 
 	/* no need to invalidate: a not-present page shouldn't be cached */
 	update_mmu_cache(vma, address, entry);
+
+	/*
+	 * A read fault on a file mapping is usually followed by faults on
+	 * its neighbours: map whatever of them is already cached now.
+	 */
+	if (!write_access && !anon && vma->vm_ops->map_pages &&
+	    !(vma->vm_flags & VM_NONLINEAR) && sysctl_fault_around_pages > 1)
+		do_fault_around(vma, address, pmd);
 	spin_unlock(&mm->page_table_lock);
 out:
 	return ret;
@@ -2350,6 +2415,17 @@ int handle_mm_fault(struct mm_struct *mm, struct vm_area_struct * vma,
 	if (!pmd)
 		goto oom;
 
+	/*
+	 * An empty pmd in a big enough anonymous region gets a whole huge
+	 * page; a huge pmd is either still good or gets split below.
+	 */
+	if (pmd_trans_huge(*pmd) ||
+	    (pmd_none(*pmd) && transparent_hugepage_vma(vma) &&
+	     transparent_hugepage_range(vma, address))) {
+		if (huge_pmd_fault(mm, vma, address, pmd, write_access))
+			return VM_FAULT_MINOR;
+	}
+
 	pte = pte_alloc_map(mm, pmd, address);
 	if (!pte)
 		goto oom;
@@ -2364,6 +2440,136 @@ int handle_mm_fault(struct mm_struct *mm, struct vm_area_struct * vma,
 	return VM_FAULT_OOM;
 }
 
+/*
+ * Try to handle a fault without mmap_sem.  The vma is looked up and
+ * copied under RCU, then revalidated against its vm_sequence once we hold
+ * page_table_lock: anything which changes the vma bumps vm_sequence before
+ * it touches the page tables, and it needs page_table_lock to do that, so
+ * a vma that still checks out under the lock is good until we drop it.
+ *
+ * Only the common cheap cases are handled here: private anonymous vmas
+ * which already have their anon_vma and page tables, a first touch of a
+ * page, or a pte which somebody else has just filled in.  Everything else,
+ * including a failure to allocate, returns 0 and the caller goes through
+ * mmap_sem and handle_mm_fault() as usual.
+ *
+ * Returns 1 if the fault has been handled.
+ */
+/**
+ * mmap_semȱҳֻҳ˽еȱҳ
+ * 0ɵͨ·
+ */
+int handle_speculative_fault(struct mm_struct *mm, unsigned long address,
+			     int write_access)
+{
+	struct vm_area_struct *vma, vmc;
+	struct page *page = NULL;
+	unsigned int seq;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *pte, entry;
+	int ret = 0;
+
+again:
+	rcu_read_lock();
+	vma = find_vma_speculative(mm, address, &seq);
+	if (!vma || (seq & 1))
+		goto out_rcu;
+	/*
+	 * Work on a copy: the vma itself may change as soon as we have
+	 * checked it, and only the copy is known to be consistent.
+	 */
+	vmc = *vma;
+	if (read_seqcount_retry(&vma->vm_sequence, seq))
+		goto out_rcu;
+
+	if (vmc.vm_ops || vmc.vm_file || !vmc.anon_vma || vma_policy(&vmc))
+		goto out_rcu;
+	if (write_access) {
+		if (!(vmc.vm_flags & VM_WRITE))
+			goto out_rcu;
+	} else if (!(vmc.vm_flags & (VM_READ | VM_EXEC)))
+		goto out_rcu;
+
+	pgd = pgd_offset(mm, address);
+	spin_lock(&mm->page_table_lock);
+	if (read_seqcount_retry(&vma->vm_sequence, seq))
+		goto out_unlock;
+
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		goto out_unlock;
+	pud = pud_offset(pgd, address);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		goto out_unlock;
+	pmd = pmd_offset(pud, address);
+	if (pmd_none(*pmd) || pmd_trans_huge(*pmd) || unlikely(pmd_bad(*pmd)))
+		goto out_unlock;
+
+	pte = pte_offset_map(pmd, address);
+	entry = *pte;
+	if (pte_present(entry)) {
+		/* Another thread faulted it in, or just young/dirty to set */
+		if (write_access) {
+			if (!pte_write(entry))
+				goto out_unmap;
+			entry = pte_mkdirty(entry);
+		}
+		entry = pte_mkyoung(entry);
+		ptep_set_access_flags(&vmc, address, pte, entry, write_access);
+		update_mmu_cache(&vmc, address, entry);
+		ret = 1;
+		goto out_unmap;
+	}
+	if (!pte_none(entry))
+		goto out_unmap;
+
+	if (!write_access) {
+		entry = pte_wrprotect(mk_pte(ZERO_PAGE(address),
+					     vmc.vm_page_prot));
+	} else {
+		if (!page) {
+			/* Cannot sleep under RCU: allocate, then look again */
+			pte_unmap(pte);
+			spin_unlock(&mm->page_table_lock);
+			rcu_read_unlock();
+			page = alloc_zeroed_user_highpage(&vmc, address);
+			if (!page)
+				return 0;
+			goto again;
+		}
+		mm->rss++;
+		acct_update_integrals();
+		update_mem_hiwater();
+		entry = maybe_mkwrite(pte_mkdirty(mk_pte(page,
+							 vmc.vm_page_prot)),
+				      &vmc);
+		SetPageSwapBacked(page);
+		lru_cache_add_active(page);
+		SetPageReferenced(page);
+		page_add_anon_rmap(page, &vmc, address);
+		page = NULL;
+	}
+	set_pte(pte, entry);
+	/* No need to invalidate - it was non-present before */
+	update_mmu_cache(&vmc, address, entry);
+	ret = 1;
+
+out_unmap:
+	pte_unmap(pte);
+out_unlock:
+	spin_unlock(&mm->page_table_lock);
+out_rcu:
+	rcu_read_unlock();
+	if (page)
+		page_cache_release(page);
+	if (ret) {
+		inc_page_state(pgfault);
+		inc_page_state(pgfault_speculative);
+	}
+	return ret;
+}
+
 #ifndef __ARCH_HAS_4LEVEL_HACK
 /*
  * Allocate page upper directory.
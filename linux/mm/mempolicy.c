@@ -63,6 +63,7 @@
 #include <linux/mm.h>
 #include <linux/highmem.h>
 #include <linux/hugetlb.h>
+#include <linux/huge_mm.h>
 #include <linux/kernel.h>
 #include <linux/sched.h>
 #include <linux/mm.h>
@@ -261,6 +262,14 @@ verify_pages(struct mm_struct *mm,
 			addr = (addr + PMD_SIZE) & PMD_MASK;
 			continue;
 		}
+		if (pmd_trans_huge(*pmd)) {
+			/* A huge page lives on a single node. */
+			p = trans_huge_pmd_page(*pmd, addr);
+			if (!test_bit(page_to_nid(p), nodes))
+				return -EIO;
+			addr = (addr + PMD_SIZE) & PMD_MASK;
+			continue;
+		}
 		p = NULL;
 		pte = pte_offset_map(pmd, addr);
 		if (pte_present(*pte))
@@ -721,7 +730,7 @@ static struct page *alloc_page_interleave(unsigned gfp, unsigned order, unsigned
 }
 
 /**
- * 	alloc_page_vma	- Allocate a page for a VMA.
+ * 	alloc_pages_vma	- Allocate pages for a VMA.
  *
  * 	@gfp:
  *      %GFP_USER    user allocation.
@@ -730,6 +739,8 @@ static struct page *alloc_page_interleave(unsigned gfp, unsigned order, unsigned
  *      %GFP_FS      allocation should not call back into a file system.
  *      %GFP_ATOMIC  don't sleep.
  *
+ *	@order: Power of two of allocation size in pages; interleaving
+ *		steps in units of this size.
  * 	@vma:  Pointer to VMA or NULL if not available.
  *	@addr: Virtual Address of the allocation. Must be inside the VMA.
  *
@@ -743,7 +754,8 @@ static struct page *alloc_page_interleave(unsigned gfp, unsigned order, unsigned
  *	Should be called with the mm_sem of the vma hold.
  */
 struct page *
-alloc_page_vma(unsigned gfp, struct vm_area_struct *vma, unsigned long addr)
+alloc_pages_vma(unsigned gfp, unsigned int order,
+		struct vm_area_struct *vma, unsigned long addr)
 {
 	struct mempolicy *pol = get_vma_policy(vma, addr);
 
@@ -755,14 +767,14 @@ alloc_page_vma(unsigned gfp, struct vm_area_struct *vma, unsigned long addr)
 			BUG_ON(addr < vma->vm_start);
 			off = vma->vm_pgoff;
 			off += (addr - vma->vm_start) >> PAGE_SHIFT;
-			nid = offset_il_node(pol, vma, off);
+			nid = offset_il_node(pol, vma, off >> order);
 		} else {
 			/* fall back to process interleaving */
 			nid = interleave_nodes(pol);
 		}
-		return alloc_page_interleave(gfp, 0, nid);
+		return alloc_page_interleave(gfp, order, nid);
 	}
-	return __alloc_pages(gfp, 0, zonelist_policy(gfp, pol));
+	return __alloc_pages(gfp, order, zonelist_policy(gfp, pol));
 }
 
 /**
@@ -8,7 +8,47 @@
 #include <linux/mman.h>
 #include <linux/mm.h>
 #include <linux/syscalls.h>
+#include <linux/swap.h>
 
+#include "internal.h"
+
+/**
+ * munlock_vma_pages_range - let a vma's pages be reclaimed again
+ * @vma: vma that is losing VM_LOCKED
+ * @start: start address in @vma
+ * @end: end address in @vma
+ *
+ * Reclaim moves the pages of locked vmas to the unevictable list as it
+ * comes across them.  When the lock goes away, clear PG_mlocked on the
+ * pages still mapped in the range and put them back on the normal lists.
+ * A page still locked through some other vma will simply be culled again
+ * the next time reclaim looks at it.
+ */
+void munlock_vma_pages_range(struct vm_area_struct *vma,
+			unsigned long start, unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long addr;
+
+	for (addr = start; addr < end; addr += PAGE_SIZE) {
+		struct page *page;
+
+		spin_lock(&mm->page_table_lock);
+		page = follow_page(mm, addr, 0);
+		if (page && !PageReserved(page))
+			get_page(page);
+		else
+			page = NULL;
+		spin_unlock(&mm->page_table_lock);
+
+		if (page) {
+			if (TestClearPageMlocked(page))
+				check_move_unevictable_page(page);
+			put_page(page);
+		}
+		cond_resched();
+	}
+}
 
 static int mlock_fixup(struct vm_area_struct * vma, 
 	unsigned long start, unsigned long end, unsigned int newflags)
@@ -37,7 +77,11 @@ static int mlock_fixup(struct vm_area_struct * vma,
 	 * It's okay if try_to_unmap_one unmaps a page just after we
 	 * set VM_LOCKED, make_pages_present below will bring it back.
 	 */
+	vma_write_begin(vma);
 	vma->vm_flags = newflags;
+	vma_write_end(vma);
+	if (!(newflags & VM_LOCKED))
+		munlock_vma_pages_range(vma, start, end);
 
 	/*
 	 * Keep track of amount of locked VM.
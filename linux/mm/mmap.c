@@ -30,6 +30,8 @@
 #include <asm/cacheflush.h>
 #include <asm/tlb.h>
 
+#include "internal.h"
+
 /*
  * WARNING: the debugging will use recursive algorithms so never enable this
  * unless you know what you are doing.
@@ -179,6 +181,22 @@ static void __remove_shared_vm_struct(struct vm_area_struct *vma,
 	flush_dcache_mmap_unlock(mapping);
 }
 
+static void vma_free_rcu(struct rcu_head *head)
+{
+	kmem_cache_free(vm_area_cachep,
+		container_of(head, struct vm_area_struct, vm_rcu_head));
+}
+
+/*
+ * A vma which has been in the rbtree may still be looked at by a fault
+ * running without mmap_sem (find_vma_speculative), so it is only freed
+ * after an RCU grace period.
+ */
+static inline void free_vma(struct vm_area_struct *vma)
+{
+	call_rcu(&vma->vm_rcu_head, vma_free_rcu);
+}
+
 /*
  * Remove one vm structure and free it.
  */
@@ -199,7 +217,7 @@ static void remove_vm_struct(struct vm_area_struct *vma)
 		fput(file);
 	anon_vma_unlink(vma);
 	mpol_free(vma_policy(vma));
-	kmem_cache_free(vm_area_cachep, vma);
+	free_vma(vma);
 }
 
 /*
@@ -385,8 +403,10 @@ __vma_link_list(struct mm_struct *mm, struct vm_area_struct *vma,
 void __vma_link_rb(struct mm_struct *mm, struct vm_area_struct *vma,
 		struct rb_node **rb_link, struct rb_node *rb_parent)
 {
+	write_seqcount_begin(&mm->mm_rb_seq);
 	rb_link_node(&vma->vm_rb, rb_parent, rb_link);
 	rb_insert_color(&vma->vm_rb, &mm->mm_rb);
+	write_seqcount_end(&mm->mm_rb_seq);
 }
 
 static inline void __vma_link_file(struct vm_area_struct *vma)
@@ -481,7 +501,11 @@ __vma_unlink(struct mm_struct *mm, struct vm_area_struct *vma,
 	/**
 	 * Ӻɾvma
 	 */
+	write_seqcount_begin(&mm->mm_rb_seq);
+	vma_write_begin(vma);
 	rb_erase(&vma->vm_rb, &mm->mm_rb);
+	vma_write_end(vma);
+	write_seqcount_end(&mm->mm_rb_seq);
 	/**
 	 * mmap_cacheָҪɾͶ¡
 	 */
@@ -590,12 +614,16 @@ again:			remove_next = 1 + (end > next->vm_end);
 			vma_prio_tree_remove(next, root);
 	}
 
+	vma_write_begin(vma);
 	vma->vm_start = start;
 	vma->vm_end = end;
 	vma->vm_pgoff = pgoff;
+	vma_write_end(vma);
 	if (adjust_next) {
+		vma_write_begin(next);
 		next->vm_start += adjust_next << PAGE_SHIFT;
 		next->vm_pgoff += adjust_next;
+		vma_write_end(next);
 	}
 
 	if (root) {
@@ -634,7 +662,7 @@ again:			remove_next = 1 + (end > next->vm_end);
 			fput(file);
 		mm->map_count--;
 		mpol_free(vma_policy(next));
-		kmem_cache_free(vm_area_cachep, next);
+		free_vma(next);
 		/*
 		 * In mprotect's case 6 (see comments on vma_merge),
 		 * we must remove another next too. It would clutter
@@ -1626,6 +1654,63 @@ struct vm_area_struct * find_vma(struct mm_struct * mm, unsigned long addr)
 
 EXPORT_SYMBOL(find_vma);
 
+/*
+ * A balanced tree is never this deep; a walk that gets there has been
+ * led astray by a concurrent rebalance and will fail the retry check.
+ */
+#define SPECULATIVE_RB_DEPTH	(2 * BITS_PER_LONG)
+
+/*
+ * find_vma() for a fault which does not hold mmap_sem.  The caller is
+ * inside rcu_read_lock(), which keeps unlinked vmas from being freed, and
+ * mm->mm_rb_seq tells whether the tree changed under the walk.  The vma's
+ * vm_sequence is sampled while the vma is known to be in the tree; the
+ * caller rechecks it once it has used the vma.  Returns NULL when no vma
+ * contains @addr, or when the tree keeps changing: the caller then takes
+ * the ordinary path.  mmap_cache is left alone, it belongs to mmap_sem
+ * holders.
+ */
+struct vm_area_struct *find_vma_speculative(struct mm_struct *mm,
+				unsigned long addr, unsigned *seq)
+{
+	struct vm_area_struct *vma;
+	int tries;
+
+	for (tries = 0; tries < 3; tries++) {
+		struct rb_node *rb_node;
+		unsigned int rb_seq;
+		int depth = 0;
+
+		rb_seq = read_seqcount_begin(&mm->mm_rb_seq);
+		if (rb_seq & 1)
+			continue;
+
+		vma = NULL;
+		rb_node = rcu_dereference(mm->mm_rb.rb_node);
+		while (rb_node && ++depth < SPECULATIVE_RB_DEPTH) {
+			struct vm_area_struct *vma_tmp;
+
+			vma_tmp = rb_entry(rb_node, struct vm_area_struct, vm_rb);
+			if (vma_tmp->vm_end > addr) {
+				vma = vma_tmp;
+				if (vma_tmp->vm_start <= addr)
+					break;
+				rb_node = rcu_dereference(rb_node->rb_left);
+			} else
+				rb_node = rcu_dereference(rb_node->rb_right);
+		}
+		if (vma)
+			*seq = read_seqcount_begin(&vma->vm_sequence);
+
+		if (read_seqcount_retry(&mm->mm_rb_seq, rb_seq))
+			continue;
+		if (!vma || vma->vm_start > addr)
+			return NULL;
+		return vma;
+	}
+	return NULL;
+}
+
 /* Same as find_vma, but also return a pointer to the previous VMA in *pprev. */
 /**
  * find_vmaƣͬѺѡеǰһָ븳Ӳppre
@@ -1745,8 +1830,11 @@ int expand_stack(struct vm_area_struct * vma, unsigned long address)
 		grow = (address - vma->vm_end) >> PAGE_SHIFT;
 
 		error = acct_stack_growth(vma, size, grow);
-		if (!error)
+		if (!error) {
+			vma_write_begin(vma);
 			vma->vm_end = address;
+			vma_write_end(vma);
+		}
 	}
 	anon_vma_unlock(vma);
 	return error;
@@ -1804,8 +1892,10 @@ int expand_stack(struct vm_area_struct *vma, unsigned long address)
 
 		error = acct_stack_growth(vma, size, grow);
 		if (!error) {
+			vma_write_begin(vma);
 			vma->vm_start = address;
 			vma->vm_pgoff -= grow;
+			vma_write_end(vma);
 		}
 	}
 	anon_vma_unlock(vma);
@@ -1997,12 +2087,16 @@ detach_vmas_to_be_unmapped(struct mm_struct *mm, struct vm_area_struct *vma,
 	struct vm_area_struct *tail_vma = NULL;
 
 	insertion_point = (prev ? &prev->vm_next : &mm->mmap);
+	write_seqcount_begin(&mm->mm_rb_seq);
 	do {
+		vma_write_begin(vma);
 		rb_erase(&vma->vm_rb, &mm->mm_rb);
+		vma_write_end(vma);
 		mm->map_count--;
 		tail_vma = vma;
 		vma = vma->vm_next;
 	} while (vma && vma->vm_start < end);
+	write_seqcount_end(&mm->mm_rb_seq);
 	*insertion_point = vma;
 	tail_vma->vm_next = NULL;
 	mm->mmap_cache = NULL;		/* Kill the cache. */
@@ -2171,6 +2265,19 @@ int do_munmap(struct mm_struct *mm, unsigned long start, size_t len)
 	 */
 	mpnt = prev? prev->vm_next: mm->mmap;
 
+	/*
+	 * Pages of locked vmas may sit on the unevictable list: put them
+	 * back on the normal lists before their mappings disappear.
+	 */
+	if (mm->locked_vm) {
+		struct vm_area_struct *tmp;
+
+		for (tmp = mpnt; tmp && tmp->vm_start < end; tmp = tmp->vm_next)
+			if (tmp->vm_flags & VM_LOCKED)
+				munlock_vma_pages_range(tmp, tmp->vm_start,
+							tmp->vm_end);
+	}
+
 	/*
 	 * Remove the vma's, and unmap the actual pages
 	 */
@@ -2327,6 +2434,13 @@ void exit_mmap(struct mm_struct *mm)
 	struct vm_area_struct *vma;
 	unsigned long nr_accounted = 0;
 
+	if (mm->locked_vm) {
+		for (vma = mm->mmap; vma; vma = vma->vm_next)
+			if (vma->vm_flags & VM_LOCKED)
+				munlock_vma_pages_range(vma, vma->vm_start,
+							vma->vm_end);
+	}
+
 	lru_add_drain();
 
 	spin_lock(&mm->page_table_lock);
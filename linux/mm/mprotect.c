@@ -10,6 +10,7 @@
 
 #include <linux/mm.h>
 #include <linux/hugetlb.h>
+#include <linux/huge_mm.h>
 #include <linux/slab.h>
 #include <linux/shm.h>
 #include <linux/mman.h>
@@ -25,19 +26,34 @@
 #include <asm/cacheflush.h>
 #include <asm/tlbflush.h>
 
-static inline void
+/*
+ * mprotect() over several vmas used to flush the TLB once per vma, each
+ * time interrupting every other cpu running the mm.  Instead we note the
+ * range whose ptes were really changed and flush it once, just before
+ * mprotect() drops mmap_sem; a range with no present pte changed needs
+ * no flush at all.
+ */
+struct mprotect_flush {
+	unsigned long start, end;	/* range with changed ptes */
+	int nr_changes;			/* change_protection() calls */
+};
+
+static inline unsigned long
 change_pte_range(pmd_t *pmd, unsigned long address,
 		unsigned long size, pgprot_t newprot)
 {
 	pte_t * pte;
 	unsigned long end;
+	unsigned long pages = 0;
 
 	if (pmd_none(*pmd))
-		return;
+		return 0;
+	if (pmd_trans_huge(*pmd))
+		split_huge_pmd(current->mm, pmd);
 	if (pmd_bad(*pmd)) {
 		pmd_ERROR(*pmd);
 		pmd_clear(pmd);
-		return;
+		return 0;
 	}
 	pte = pte_offset_map(pmd, address);
 	address &= ~PMD_MASK;
@@ -46,34 +62,42 @@ change_pte_range(pmd_t *pmd, unsigned long address,
 		end = PMD_SIZE;
 	do {
 		if (pte_present(*pte)) {
-			pte_t entry;
+			pte_t entry = *pte;
 
+			/* Leave alone (and unflushed) what is already right */
+			if (pte_val(pte_modify(entry, newprot)) ==
+							pte_val(entry))
+				goto next;
 			/* Avoid an SMP race with hardware updated dirty/clean
 			 * bits by wiping the pte and then setting the new pte
 			 * into place.
 			 */
 			entry = ptep_get_and_clear(pte);
 			set_pte(pte, pte_modify(entry, newprot));
+			pages++;
 		}
+next:
 		address += PAGE_SIZE;
 		pte++;
 	} while (address && (address < end));
 	pte_unmap(pte - 1);
+	return pages;
 }
 
-static inline void
+static inline unsigned long
 change_pmd_range(pud_t *pud, unsigned long address,
 		unsigned long size, pgprot_t newprot)
 {
 	pmd_t * pmd;
 	unsigned long end;
+	unsigned long pages = 0;
 
 	if (pud_none(*pud))
-		return;
+		return 0;
 	if (pud_bad(*pud)) {
 		pud_ERROR(*pud);
 		pud_clear(pud);
-		return;
+		return 0;
 	}
 	pmd = pmd_offset(pud, address);
 	address &= ~PUD_MASK;
@@ -81,25 +105,27 @@ change_pmd_range(pud_t *pud, unsigned long address,
 	if (end > PUD_SIZE)
 		end = PUD_SIZE;
 	do {
-		change_pte_range(pmd, address, end - address, newprot);
+		pages += change_pte_range(pmd, address, end - address, newprot);
 		address = (address + PMD_SIZE) & PMD_MASK;
 		pmd++;
 	} while (address && (address < end));
+	return pages;
 }
 
-static inline void
+static inline unsigned long
 change_pud_range(pgd_t *pgd, unsigned long address,
 		unsigned long size, pgprot_t newprot)
 {
 	pud_t * pud;
 	unsigned long end;
+	unsigned long pages = 0;
 
 	if (pgd_none(*pgd))
-		return;
+		return 0;
 	if (pgd_bad(*pgd)) {
 		pgd_ERROR(*pgd);
 		pgd_clear(pgd);
-		return;
+		return 0;
 	}
 	pud = pud_offset(pgd, address);
 	address &= ~PGDIR_MASK;
@@ -107,19 +133,21 @@ change_pud_range(pgd_t *pgd, unsigned long address,
 	if (end > PGDIR_SIZE)
 		end = PGDIR_SIZE;
 	do {
-		change_pmd_range(pud, address, end - address, newprot);
+		pages += change_pmd_range(pud, address, end - address, newprot);
 		address = (address + PUD_SIZE) & PUD_MASK;
 		pud++;
 	} while (address && (address < end));
+	return pages;
 }
 
 static void
 change_protection(struct vm_area_struct *vma, unsigned long start,
-		unsigned long end, pgprot_t newprot)
+		unsigned long end, pgprot_t newprot, struct mprotect_flush *fl)
 {
 	struct mm_struct *mm = current->mm;
 	pgd_t *pgd;
 	unsigned long beg = start, next;
+	unsigned long pages = 0;
 	int i;
 
 	pgd = pgd_offset(mm, start);
@@ -130,17 +158,45 @@ change_protection(struct vm_area_struct *vma, unsigned long start,
 		next = (start + PGDIR_SIZE) & PGDIR_MASK;
 		if (next <= start || next > end)
 			next = end;
-		change_pud_range(pgd, start, next - start, newprot);
+		pages += change_pud_range(pgd, start, next - start, newprot);
 		start = next;
 		pgd++;
 	}
-	flush_tlb_range(vma, beg, end);
 	spin_unlock(&mm->page_table_lock);
+
+	fl->nr_changes++;
+	if (!pages)
+		return;
+	if (fl->start == fl->end) {
+		fl->start = beg;
+		fl->end = end;
+	} else {
+		fl->start = min(fl->start, beg);
+		fl->end = max(fl->end, end);
+	}
+}
+
+/*
+ * The vmas of one mprotect() are contiguous and all end up with the
+ * same protection, so the vma now at the start of the range stands for
+ * the whole of it, as it would have for each part.
+ */
+static void
+mprotect_flush_tlb(struct mm_struct *mm, struct mprotect_flush *fl)
+{
+	int flushes = 0;
+
+	if (fl->start != fl->end) {
+		flush_tlb_range(find_vma(mm, fl->start), fl->start, fl->end);
+		flushes = 1;
+	}
+	mm->tlb_shootdowns_avoided += fl->nr_changes - flushes;
 }
 
 static int
 mprotect_fixup(struct vm_area_struct *vma, struct vm_area_struct **pprev,
-	unsigned long start, unsigned long end, unsigned long newflags)
+	unsigned long start, unsigned long end, unsigned long newflags,
+	struct mprotect_flush *fl)
 {
 	struct mm_struct * mm = vma->vm_mm;
 	unsigned long oldflags = vma->vm_flags;
@@ -207,9 +263,11 @@ success:
 	 * vm_flags and vm_page_prot are protected by the mmap_sem
 	 * held in write mode.
 	 */
+	vma_write_begin(vma);
 	vma->vm_flags = newflags;
 	vma->vm_page_prot = newprot;
-	change_protection(vma, start, end, newprot);
+	vma_write_end(vma);
+	change_protection(vma, start, end, newprot, fl);
 	__vm_stat_account(mm, oldflags, vma->vm_file, -nrpages);
 	__vm_stat_account(mm, newflags, vma->vm_file, nrpages);
 	return 0;
@@ -224,6 +282,7 @@ sys_mprotect(unsigned long start, size_t len, unsigned long prot)
 {
 	unsigned long vm_flags, nstart, end, tmp;
 	struct vm_area_struct *vma, *prev;
+	struct mprotect_flush fl = { 0, 0, 0 };
 	int error = -EINVAL;
 	const int grows = prot & (PROT_GROWSDOWN|PROT_GROWSUP);
 	prot &= ~(PROT_GROWSDOWN|PROT_GROWSUP);
@@ -300,7 +359,7 @@ sys_mprotect(unsigned long start, size_t len, unsigned long prot)
 		tmp = vma->vm_end;
 		if (tmp > end)
 			tmp = end;
-		error = mprotect_fixup(vma, &prev, nstart, tmp, newflags);
+		error = mprotect_fixup(vma, &prev, nstart, tmp, newflags, &fl);
 		if (error)
 			goto out;
 		nstart = tmp;
@@ -317,6 +376,7 @@ sys_mprotect(unsigned long start, size_t len, unsigned long prot)
 		}
 	}
 out:
+	mprotect_flush_tlb(current->mm, &fl);
 	up_write(&current->mm->mmap_sem);
 	return error;
 }
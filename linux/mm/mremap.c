@@ -9,6 +9,7 @@
 
 #include <linux/mm.h>
 #include <linux/hugetlb.h>
+#include <linux/huge_mm.h>
 #include <linux/slab.h>
 #include <linux/shm.h>
 #include <linux/mman.h>
@@ -46,6 +47,8 @@ static pte_t *get_one_pte_map_nested(struct mm_struct *mm, unsigned long addr)
 	pmd = pmd_offset(pud, addr);
 	if (pmd_none(*pmd))
 		goto end;
+	if (pmd_trans_huge(*pmd))
+		split_huge_pmd(mm, pmd);
 	if (pmd_bad(*pmd)) {
 		pmd_ERROR(*pmd);
 		pmd_clear(pmd);
@@ -77,6 +80,8 @@ static pte_t *get_one_pte_map(struct mm_struct *mm, unsigned long addr)
 	pmd = pmd_offset(pud, addr);
 	if (!pmd_present(*pmd))
 		return NULL;
+	if (pmd_trans_huge(*pmd))
+		split_huge_pmd(mm, pmd);
 	return pte_offset_map(pmd, addr);
 }
 
@@ -93,8 +98,11 @@ static inline pte_t *alloc_one_pte_map(struct mm_struct *mm, unsigned long addr)
 	if (!pud)
 		return NULL;
 	pmd = pmd_alloc(mm, pud, addr);
-	if (pmd)
-		pte = pte_alloc_map(mm, pmd, addr);
+	if (!pmd)
+		return NULL;
+	if (pmd_trans_huge(*pmd))
+		split_huge_pmd(mm, pmd);
+	pte = pte_alloc_map(mm, pmd, addr);
 	return pte;
 }
 
@@ -29,6 +29,7 @@
 #include <linux/sysctl.h>
 #include <linux/cpu.h>
 #include <linux/syscalls.h>
+#include <asm/div64.h>
 
 /*
  * The maximum number of pages to writeout in a single bdflush/kupdate
@@ -62,10 +63,10 @@ static inline long sync_writeback_pages(void)
 /* The following parameters are exported via /proc/sys/vm */
 
 /*
- * Start background writeback (via pdflush) at this percentage
+ * Start background writeback (via the flusher threads) at this percentage
  */
 /**
- * ڴеĻҳ˱ʱҳеҳ޸ĵĺỽpdflusḥִлصbackgroud_writeout
+ * ڴеĻҳ˱ʱҳеҳ޸ĵĺỽ豸Ļдִ̣߳к̨д
  */
 int dirty_background_ratio = 10;
 
@@ -80,7 +81,7 @@ int vm_dirty_ratio = 40;
  */
 /**
  * ҳڱһʱںʽĿʼIO䣬ҳд̡
- * ίи˱ڻѵpdflshں̡̱߳߳ѵʱdirty_writeback_centisecs
+ * ίи˱ڻѵĸ豸д̡߳Щ̱߳ѵʱdirty_writeback_centisecs
  * һ1/500룬ǿͨproc/sys/vm/dirty_writeback_centisecs
  */
 int dirty_writeback_centisecs = 5 * 100;
@@ -105,8 +106,6 @@ EXPORT_SYMBOL(laptop_mode);
 /* End of sysctl-exported parameters */
 
 
-static void background_writeout(unsigned long _min_pages);
-
 struct writeback_state
 {
 	unsigned long nr_dirty;
@@ -188,19 +187,113 @@ get_dirty_limits(struct writeback_state *wbs, long *pbackground, long *pdirty,
 	*pdirty = dirty;
 }
 
+/*
+ * Writeback bandwidth estimation.
+ *
+ * Every BANDWIDTH_INTERVAL or so, the pages which completed writeback against
+ * a registered device are turned into a pages-per-second figure and folded
+ * into bdi->write_bandwidth.  Only intervals during which the device had
+ * writeback in flight count: an idle disk says nothing about how fast it is.
+ */
+#define BANDWIDTH_INTERVAL	(HZ / 5)
+
+static void bdi_update_bandwidth(struct backing_dev_info *bdi)
+{
+	unsigned long now = jiffies;
+	unsigned long elapsed;
+	unsigned long written;
+	unsigned long bw;
+
+	if (!bdi_cap_proportional(bdi))
+		return;
+	if (now - bdi->bw_time_stamp < BANDWIDTH_INTERVAL)
+		return;
+	if (!spin_trylock(&bdi->wb_lock))
+		return;		/* Someone else is doing it */
+
+	elapsed = now - bdi->bw_time_stamp;
+	if (elapsed < BANDWIDTH_INTERVAL)
+		goto out;
+	written = atomic_read(&bdi->nr_written);
+	if (elapsed <= 3 * HZ && atomic_read(&bdi->nr_writeback) > 0) {
+		bw = (written - bdi->written_stamp) * HZ / elapsed;
+		bdi->write_bandwidth = (bdi->write_bandwidth * 7 + bw) / 8;
+		if (!bdi->write_bandwidth)
+			bdi->write_bandwidth = 1;
+	}
+	bdi->written_stamp = written;
+	bdi->bw_time_stamp = now;
+out:
+	spin_unlock(&bdi->wb_lock);
+}
+
+/*
+ * Work out a registered device's share of the dirty threshold @thresh.  The
+ * share is proportional to the device's writeback bandwidth, weighed against
+ * the other devices which currently have dirty or writeback pages.  So a
+ * slow disk cannot fill up the dirty memory which a fast one could be using,
+ * and an idle one does not hold on to a share it is not using.
+ */
+static long bdi_dirty_limit(struct backing_dev_info *bdi, long thresh)
+{
+	struct backing_dev_info *tmp;
+	unsigned long total = 0;
+	u64 limit;
+
+	spin_lock_irq(&bdi_lock);
+	list_for_each_entry(tmp, &bdi_list, bdi_list) {
+		if (!bdi_cap_proportional(tmp))
+			continue;
+		if (tmp == bdi || atomic_read(&tmp->nr_dirty) > 0 ||
+				atomic_read(&tmp->nr_writeback) > 0)
+			total += tmp->write_bandwidth;
+	}
+	spin_unlock_irq(&bdi_lock);
+
+	if (!total)
+		return thresh;
+	limit = (u64)thresh * bdi->write_bandwidth;
+	do_div(limit, total);
+	return limit;
+}
+
+/*
+ * The dirty limit which applies to writers against @bdi, and the dirty and
+ * writeback page counts which are measured against it.  A registered device
+ * is throttled on its own pages against its share of the threshold.  For
+ * anything else only the global state is known.
+ */
+static void
+get_bdi_dirty(struct backing_dev_info *bdi, struct writeback_state *wbs,
+		long dirty_thresh, long *pthresh, long *preclaimable,
+		long *pwriteback)
+{
+	if (bdi_cap_proportional(bdi)) {
+		*pthresh = bdi_dirty_limit(bdi, dirty_thresh);
+		*preclaimable = atomic_read(&bdi->nr_dirty);
+		*pwriteback = atomic_read(&bdi->nr_writeback);
+	} else {
+		*pthresh = dirty_thresh;
+		*preclaimable = wbs->nr_dirty + wbs->nr_unstable;
+		*pwriteback = wbs->nr_writeback;
+	}
+}
+
 /*
  * balance_dirty_pages() must be called by processes which are generating dirty
- * data.  It looks at the number of dirty pages in the machine and will force
- * the caller to perform writeback if the system is over `vm_dirty_ratio'.
- * If we're over `background_thresh' then pdflush is woken to perform some
- * writeout.
+ * data.  It looks at the number of dirty pages against the device and will
+ * force the caller to perform writeback if the device is over its share of
+ * `vm_dirty_ratio'.  If the system is over `background_thresh' then the
+ * device's flusher thread is woken to perform some writeout.
  */
 static void balance_dirty_pages(struct address_space *mapping)
 {
 	struct writeback_state wbs;
 	long nr_reclaimable;
+	long nr_writeback;
 	long background_thresh;
 	long dirty_thresh;
+	long bdi_thresh;
 	unsigned long pages_written = 0;
 	unsigned long write_chunk = sync_writeback_pages();
 
@@ -216,8 +309,9 @@ static void balance_dirty_pages(struct address_space *mapping)
 
 		get_dirty_limits(&wbs, &background_thresh,
 					&dirty_thresh, mapping);
-		nr_reclaimable = wbs.nr_dirty + wbs.nr_unstable;
-		if (nr_reclaimable + wbs.nr_writeback <= dirty_thresh)
+		get_bdi_dirty(bdi, &wbs, dirty_thresh, &bdi_thresh,
+					&nr_reclaimable, &nr_writeback);
+		if (nr_reclaimable + nr_writeback <= bdi_thresh)
 			break;
 
 		dirty_exceeded = 1;
@@ -230,10 +324,12 @@ static void balance_dirty_pages(struct address_space *mapping)
 		 */
 		if (nr_reclaimable) {
 			writeback_inodes(&wbc);
+			bdi_update_bandwidth(bdi);
 			get_dirty_limits(&wbs, &background_thresh,
 					&dirty_thresh, mapping);
-			nr_reclaimable = wbs.nr_dirty + wbs.nr_unstable;
-			if (nr_reclaimable + wbs.nr_writeback <= dirty_thresh)
+			get_bdi_dirty(bdi, &wbs, dirty_thresh, &bdi_thresh,
+					&nr_reclaimable, &nr_writeback);
+			if (nr_reclaimable + nr_writeback <= bdi_thresh)
 				break;
 			pages_written += write_chunk - wbc.nr_to_write;
 			if (pages_written >= write_chunk)
@@ -242,11 +338,11 @@ static void balance_dirty_pages(struct address_space *mapping)
 		blk_congestion_wait(WRITE, HZ/10);
 	}
 
-	if (nr_reclaimable + wbs.nr_writeback <= dirty_thresh)
+	if (nr_reclaimable + nr_writeback <= bdi_thresh)
 		dirty_exceeded = 0;
 
-	if (writeback_in_progress(bdi))
-		return;		/* pdflush is already working this queue */
+	if (writeback_in_progress(writeback_bdi(bdi)))
+		return;		/* The flusher is already working this queue */
 
 	/*
 	 * In laptop mode, we wait until hitting the higher threshold before
@@ -257,8 +353,9 @@ static void balance_dirty_pages(struct address_space *mapping)
 	 * background_thresh, to keep the amount of dirty memory low.
 	 */
 	if ((laptop_mode && pages_written) ||
-	     (!laptop_mode && (nr_reclaimable > background_thresh)))
-		pdflush_operation(background_writeout, 0);
+	     (!laptop_mode && (wbs.nr_dirty + wbs.nr_unstable >
+						background_thresh)))
+		bdi_start_background_writeback(bdi);
 }
 
 /**
@@ -298,17 +395,37 @@ void balance_dirty_pages_ratelimited(struct address_space *mapping)
 EXPORT_SYMBOL(balance_dirty_pages_ratelimited);
 
 /*
- * writeback at least _min_pages, and keep writing until the amount of dirty
- * memory is less than the background threshold, or until we're all clean.
+ * Is the system over the background threshold, with @bdi holding more than
+ * its share of the dirty pages?  Devices which are not accounted on their
+ * own only have the global state to go by.
+ */
+static int over_bground_thresh(struct backing_dev_info *bdi)
+{
+	struct writeback_state wbs;
+	long background_thresh;
+	long dirty_thresh;
+
+	get_dirty_limits(&wbs, &background_thresh, &dirty_thresh, NULL);
+	if (wbs.nr_dirty + wbs.nr_unstable < background_thresh)
+		return 0;
+	if (!bdi_cap_proportional(bdi))
+		return 1;
+	return atomic_read(&bdi->nr_dirty) >
+			bdi_dirty_limit(bdi, background_thresh);
+}
+
+/*
+ * writeback at least nr_pages against the device, and if `background' keep
+ * writing until the amount of dirty memory is less than the background
+ * threshold, or until the device is all clean.
  */
 /**
- * ϵͳɨҳٻҪˢµҳ,pdflushĻص֮һ.
- * _min_pages:	Ҫˢµ̵ҳ
+ * ɨ豸ڵҪˢµҳ豸Ļд̵߳á
+ * nr_pages:	Ҫˢµ̵ҳ
  */
-static void background_writeout(unsigned long _min_pages)
+static void bdi_writeback_pages(struct backing_dev_info *bdi, long nr_pages,
+				int background)
 {
-	long min_pages = _min_pages;
-	
 	struct writeback_control wbc = {
 		.bdi		= NULL,
 		.sync_mode	= WB_SYNC_NONE,
@@ -318,34 +435,25 @@ static void background_writeout(unsigned long _min_pages)
 	};
 
 	for ( ; ; ) {
-		struct writeback_state wbs;
-		long background_thresh;
-		long dirty_thresh;
-
-		get_dirty_limits(&wbs, &background_thresh, &dirty_thresh, NULL);
-		if (wbs.nr_dirty + wbs.nr_unstable < background_thresh
-				&& min_pages <= 0)
+		if (nr_pages <= 0 && !(background && over_bground_thresh(bdi)))
 			break;
 		wbc.encountered_congestion = 0;
 		wbc.nr_to_write = MAX_WRITEBACK_PAGES;
 		wbc.pages_skipped = 0;
 		/**
-		 * writeback_inodesд1024ҳ
+		 * writeback_bdi_inodesд1024ҳ
 		 */
-		writeback_inodes(&wbc);
+		writeback_bdi_inodes(bdi, &wbc);
 		/**
 		 * ЧдҳҪдҳĸ
 		 */
-		min_pages -= MAX_WRITEBACK_PAGES - wbc.nr_to_write;
+		nr_pages -= MAX_WRITEBACK_PAGES - wbc.nr_to_write;
+		bdi_update_bandwidth(bdi);
 		/**
 		 * Ѿдҳ1024ԹһЩҳܿ豸дӵ״̬
 		 */
 		if (wbc.nr_to_write > 0 || wbc.pages_skipped > 0) {
 			/* Wrote less than expected */
-			/**
-			 * 豸дӵ״̬ʹǰضĵȴ˯100ms
-			 * ʹǰ˯ߵбòӵ
-			 */
 			blk_congestion_wait(WRITE, HZ/10);
 			if (!wbc.encountered_congestion)
 				break;
@@ -355,40 +463,41 @@ static void background_writeout(unsigned long _min_pages)
 
 /*
  * Start writeback of `nr_pages' pages.  If `nr_pages' is zero, write back
- * the whole world.  Returns 0 if a pdflush thread was dispatched.  Returns
- * -1 if all pdflush threads were busy.
+ * the whole world.  Every device with dirty inodes has its flusher thread
+ * write that many pages, so the devices are written in parallel.
+ *
+ * This can be called from atomic context (mempool_alloc), so it only pokes
+ * the flushers.  Always returns zero.
  */
 /**
- * pdflushں̡߳
+ * Ѹ豸Ļд̡߳
  * ڴ治㣬ûʾˢ²ʱִд˺
- *     û̷̬syncϵͳá
- *     grow_buffersһ»ҳʱʧܡ
- *     ҳ㷨free_more_memorytry_to_free_pages
- *     mempoll_allocһµڴԪʱʧܡ
  * nr_pages:	Ӧˢµҳ0ʾҳӦдش̡
  */
 int wakeup_bdflush(long nr_pages)
 {
+	struct backing_dev_info *bdi;
+	unsigned long flags;
+
 	if (nr_pages == 0) {
 		struct writeback_state wbs;
 
 		get_writeback_state(&wbs);
 		nr_pages = wbs.nr_dirty + wbs.nr_unstable;
 	}
-	/**
-	 * pdflush_operationѿpdflusḥ߳ίִbackground_writeout
-	 */
-	return pdflush_operation(background_writeout, nr_pages);
+
+	spin_lock_irqsave(&bdi_lock, flags);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		/* unlocked list_empty() tests are OK here */
+		if (!list_empty(&bdi->b_dirty) || !list_empty(&bdi->b_io))
+			__bdi_start_writeback(bdi, nr_pages);
+	}
+	spin_unlock_irqrestore(&bdi_lock, flags);
+	return 0;
 }
 
-static void wb_timer_fn(unsigned long unused);
 static void laptop_timer_fn(unsigned long unused);
 
-/**
- * дʱ
- */
-static struct timer_list wb_timer =
-			TIMER_INITIALIZER(wb_timer_fn, 0, 0);
 static struct timer_list laptop_mode_wb_timer =
 			TIMER_INITIALIZER(laptop_timer_fn, 0, 0);
 
@@ -397,24 +506,22 @@ static struct timer_list laptop_mode_wb_timer =
  *
  * Define "old": the first time one of an inode's pages is dirtied, we mark the
  * dirtying-time in the inode's address_space.  So this periodic writeback code
- * just walks the superblock inode list, writing back any inodes which are
+ * just walks the device's dirty inode list, writing back any inodes which are
  * older than a specific point in time.
  *
- * Try to run once per dirty_writeback_centisecs.  But if a writeback event
- * takes longer than a dirty_writeback_centisecs interval, then leave a
- * one-second gap.
+ * Each flusher thread does this once per dirty_writeback_centisecs.  If a
+ * writeback event takes longer than that, the next one is a full interval
+ * after it finishes.
  *
  * older_than_this takes precedence over nr_to_write.  So we'll only write back
  * all dirty pages if they are all attached to "old" mappings.
  */
 /**
- * ҳٻǷ""˺ܳʱҳ
+ * 豸Ƿ""˺ܳʱҳ
  */
-static void wb_kupdate(unsigned long arg)
+static void bdi_kupdate(struct backing_dev_info *bdi)
 {
 	unsigned long oldest_jif;
-	unsigned long start_jif;
-	unsigned long next_jif;
 	long nr_to_write;
 	struct writeback_state wbs;
 	struct writeback_control wbc = {
@@ -426,11 +533,18 @@ static void wb_kupdate(unsigned long arg)
 		.for_kupdate	= 1,
 	};
 
+	if (!dirty_writeback_centisecs)
+		return;
+	if (time_before(jiffies, bdi->wb_last_old_flush +
+				(dirty_writeback_centisecs * HZ) / 100))
+		return;
+
 	/**
-	 * ĳдС
+	 * Ĭ豸Ļд߳̽ĳдС
 	 * ȷκγʱͨᳬ5S
 	 */
-	sync_supers();
+	if (bdi == &default_backing_dev_info)
+		sync_supers();
 
 	get_writeback_state(&wbs);
 	/**
@@ -438,23 +552,13 @@ static void wb_kupdate(unsigned long arg)
 	 * Ҳ˵һҳΪҳʱ30S
 	 */
 	oldest_jif = jiffies - (dirty_expire_centisecs * HZ) / 100;
-	start_jif = jiffies;
-	next_jif = start_jif + (dirty_writeback_centisecs * HZ) / 100;
-	/**
-	 * page_stateȷҳٻҳĴ
-	 */
 	nr_to_write = wbs.nr_dirty + wbs.nr_unstable +
 			(inodes_stat.nr_inodes - inodes_stat.nr_unused);
-	/**
-	 * ֱҳдв˳
-	 */
 	while (nr_to_write > 0) {
 		wbc.encountered_congestion = 0;
 		wbc.nr_to_write = MAX_WRITEBACK_PAGES;
-		/**
-		 * writeback_inodesеҳдص̡
-		 */
-		writeback_inodes(&wbc);
+		writeback_bdi_inodes(bdi, &wbc);
+		bdi_update_bandwidth(bdi);
 		if (wbc.nr_to_write > 0) {
 			if (wbc.encountered_congestion)/* бӵ˯һʱ */
 				blk_congestion_wait(WRITE, HZ/10);
@@ -463,13 +567,30 @@ static void wb_kupdate(unsigned long arg)
 		}
 		nr_to_write -= MAX_WRITEBACK_PAGES - wbc.nr_to_write;
 	}
-	/**
-	 * ִʱ̫´ζʱȵǰʱ˲һ룬ǿ1ſʼһδ
-	 */
-	if (time_before(next_jif, jiffies + HZ))
-		next_jif = jiffies + HZ;
-	if (dirty_writeback_centisecs)
-		mod_timer(&wb_timer, next_jif);
+	bdi->wb_last_old_flush = jiffies;
+}
+
+/*
+ * The work of a device's flusher thread: writeback which was asked for by
+ * bdi_start_writeback() and bdi_start_background_writeback(), then the
+ * periodic writeback of old data.
+ */
+void bdi_writeback_work(struct backing_dev_info *bdi)
+{
+	long nr_pages;
+	int background;
+
+	spin_lock_irq(&bdi_lock);
+	nr_pages = bdi->wb_nr_pages;
+	bdi->wb_nr_pages = 0;
+	spin_unlock_irq(&bdi_lock);
+	background = test_and_clear_bit(BDI_background, &bdi->state);
+
+	writeback_acquire(bdi);
+	if (nr_pages || background)
+		bdi_writeback_pages(bdi, nr_pages, background);
+	bdi_kupdate(bdi);
+	writeback_release(bdi);
 }
 
 /*
@@ -478,29 +599,19 @@ static void wb_kupdate(unsigned long arg)
 int dirty_writeback_centisecs_handler(ctl_table *table, int write,
 		struct file *file, void __user *buffer, size_t *length, loff_t *ppos)
 {
+	struct backing_dev_info *bdi;
+
 	proc_dointvec(table, write, file, buffer, length, ppos);
-	if (dirty_writeback_centisecs) {
-		mod_timer(&wb_timer,
-			jiffies + (dirty_writeback_centisecs * HZ) / 100);
-	} else {
-		del_timer(&wb_timer);
+	/* Have the flushers pick up the new interval */
+	spin_lock_irq(&bdi_lock);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		if (bdi->wb_task)
+			wake_up_process(bdi->wb_task);
 	}
+	spin_unlock_irq(&bdi_lock);
 	return 0;
 }
 
-/**
- * ̻дʱ
- */
-static void wb_timer_fn(unsigned long unused)
-{
-	/**
-	 * pdflushwb_kupdate
-	 * wb_kupdateҳ¾ɵڵ㡣
-	 */
-	if (pdflush_operation(wb_kupdate, 0) < 0)
-		mod_timer(&wb_timer, jiffies + HZ); /* delay 1 second */
-}
-
 static void laptop_flush(unsigned long unused)
 {
 	sys_sync();
@@ -594,7 +705,6 @@ void __init page_writeback_init(void)
 		if (vm_dirty_ratio <= 0)
 			vm_dirty_ratio = 1;
 	}
-	mod_timer(&wb_timer, jiffies + (dirty_writeback_centisecs * HZ) / 100);
 	set_ratelimit();
 	register_cpu_notifier(&ratelimit_nb);
 }
@@ -676,8 +786,10 @@ int __set_page_dirty_nobuffers(struct page *page)
 			mapping2 = page_mapping(page);
 			if (mapping2) { /* Race with truncate? */
 				BUG_ON(mapping2 != mapping);
-				if (!mapping->backing_dev_info->memory_backed)
+				if (!mapping->backing_dev_info->memory_backed) {
 					inc_page_state(nr_dirty);
+					atomic_inc(&mapping->backing_dev_info->nr_dirty);
+				}
 				radix_tree_tag_set(&mapping->page_tree,
 					page_index(page), PAGECACHE_TAG_DIRTY);
 			}
@@ -762,8 +874,10 @@ int test_clear_page_dirty(struct page *page)
 						page_index(page),
 						PAGECACHE_TAG_DIRTY);
 			spin_unlock_irqrestore(&mapping->tree_lock, flags);
-			if (!mapping->backing_dev_info->memory_backed)
+			if (!mapping->backing_dev_info->memory_backed) {
 				dec_page_state(nr_dirty);
+				atomic_dec(&mapping->backing_dev_info->nr_dirty);
+			}
 			return 1;
 		}
 		spin_unlock_irqrestore(&mapping->tree_lock, flags);
@@ -793,8 +907,10 @@ int clear_page_dirty_for_io(struct page *page)
 
 	if (mapping) {
 		if (TestClearPageDirty(page)) {
-			if (!mapping->backing_dev_info->memory_backed)
+			if (!mapping->backing_dev_info->memory_backed) {
 				dec_page_state(nr_dirty);
+				atomic_dec(&mapping->backing_dev_info->nr_dirty);
+			}
 			return 1;
 		}
 		return 0;
@@ -842,6 +958,12 @@ int test_clear_page_writeback(struct page *page)
 						page_index(page),
 						PAGECACHE_TAG_WRITEBACK);
 		spin_unlock_irqrestore(&mapping->tree_lock, flags);
+		if (ret) {
+			struct backing_dev_info *bdi = mapping->backing_dev_info;
+
+			atomic_dec(&bdi->nr_writeback);
+			atomic_inc(&bdi->nr_written);
+		}
 	} else {
 		ret = TestClearPageWriteback(page);
 	}
@@ -858,10 +980,12 @@ int test_set_page_writeback(struct page *page)
 
 		spin_lock_irqsave(&mapping->tree_lock, flags);
 		ret = TestSetPageWriteback(page);
-		if (!ret)
+		if (!ret) {
 			radix_tree_tag_set(&mapping->page_tree,
 						page_index(page),
 						PAGECACHE_TAG_WRITEBACK);
+			atomic_inc(&mapping->backing_dev_info->nr_writeback);
+		}
 		if (!PageDirty(page))
 			radix_tree_tag_clear(&mapping->page_tree,
 						page_index(page),
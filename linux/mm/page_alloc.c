@@ -74,6 +74,13 @@ struct zone *zone_table[1 << (ZONES_SHIFT + NODES_SHIFT)];
 EXPORT_SYMBOL(zone_table);
 
 static char *zone_names[MAX_NR_ZONES] = { "DMA", "Normal", "HighMem" };
+#ifdef CONFIG_PROC_FS
+static char *migratetype_names[MIGRATE_TYPES] = {
+	"Unmovable",
+	"Reclaimable",
+	"Movable",
+};
+#endif
 /**
  * ں˱ڴشС
  * һsqrt(16*ںֱӳڴС)
@@ -119,6 +126,8 @@ static void bad_page(const char *function, struct page *page)
 			1 << PG_active	|
 			1 << PG_dirty	|
 			1 << PG_swapcache |
+			1 << PG_unevictable |
+			1 << PG_ksm |
 			1 << PG_writeback);
 	set_page_count(page, 0);
 	reset_page_mapcount(page);
@@ -205,6 +214,42 @@ static inline void rmv_page_order(struct page *page)
 	page->private = 0;
 }
 
+/*
+ * Mobility type of the pageblock a page lives in.  The type is only
+ * changed under zone->lock; a reader outside of it may see a stale
+ * value, which costs some grouping accuracy but nothing else.
+ */
+static inline unsigned long pageblock_bitidx(struct zone *zone,
+					     struct page *page)
+{
+	return ((page - zone->zone_mem_map) >> pageblock_order) *
+			NR_PAGEBLOCK_BITS;
+}
+
+int get_pageblock_migratetype(struct zone *zone, struct page *page)
+{
+	unsigned long bitidx = pageblock_bitidx(zone, page);
+	unsigned long *map = zone->pageblock_flags;
+
+	return test_bit(bitidx, map) | (test_bit(bitidx + 1, map) << 1);
+}
+
+static void set_pageblock_migratetype(struct zone *zone, struct page *page,
+				      int migratetype)
+{
+	unsigned long bitidx = pageblock_bitidx(zone, page);
+	unsigned long *map = zone->pageblock_flags;
+
+	if (migratetype & 1)
+		__set_bit(bitidx, map);
+	else
+		__clear_bit(bitidx, map);
+	if (migratetype & 2)
+		__set_bit(bitidx + 1, map);
+	else
+		__clear_bit(bitidx + 1, map);
+}
+
 /*
  * This function checks whether a page is free && is the buddy
  * we can do coalesce a page and its buddy if
@@ -337,7 +382,8 @@ static inline void __free_pages_bulk (struct page *page, struct page *base,
 	 */
 	coalesced = base + page_idx;
 	set_page_order(coalesced, order);
-	list_add(&coalesced->lru, &zone->free_area[order].free_list);
+	list_add(&coalesced->lru, &zone->free_area[order].free_list[
+			get_pageblock_migratetype(zone, coalesced)]);
 	zone->free_area[order].nr_free++;
 }
 
@@ -354,10 +400,14 @@ static inline void free_pages_check(const char *function, struct page *page)
 			1 << PG_reclaim	|
 			1 << PG_slab	|
 			1 << PG_swapcache |
+			1 << PG_unevictable |
+			1 << PG_ksm |
 			1 << PG_writeback )))
 		bad_page(function, page);
 	if (PageDirty(page))
 		ClearPageDirty(page);
+	/* These only describe the page's last user */
+	page->flags &= ~(1 << PG_swapbacked | 1 << PG_mlocked);
 }
 
 /*
@@ -433,7 +483,7 @@ void __free_pages_ok(struct page *page, unsigned int order)
  */
 static inline struct page *
 expand(struct zone *zone, struct page *page,
- 	int low, int high, struct free_area *area)
+ 	int low, int high, struct free_area *area, int migratetype)
 {
 	unsigned long size = 1 << high;
 
@@ -442,7 +492,7 @@ expand(struct zone *zone, struct page *page,
 		high--;
 		size >>= 1;
 		BUG_ON(bad_range(zone, &page[size]));
-		list_add(&page[size].lru, &area->free_list);
+		list_add(&page[size].lru, &area->free_list[migratetype]);
 		area->nr_free++;
 		set_page_order(&page[size], high);
 	}
@@ -480,6 +530,8 @@ static void prep_new_page(struct page *page, int order)
 			1 << PG_dirty	|
 			1 << PG_reclaim	|
 			1 << PG_swapcache |
+			1 << PG_unevictable |
+			1 << PG_ksm |
 			1 << PG_writeback )))
 		bad_page(__FUNCTION__, page);
 
@@ -491,17 +543,66 @@ static void prep_new_page(struct page *page, int order)
 	kernel_map_pages(page, 1 << order, 1);
 }
 
-/* 
- * Do the hard work of removing an element from the buddy allocator.
- * Call me with the zone->lock already held.
+/*
+ * Turn a freshly allocated non-compound block into 1 << order order-0
+ * pages with a reference each, so that they can be used and freed one
+ * at a time.
+ */
+void split_page(struct page *page, unsigned int order)
+{
+	int i;
+
+	for (i = 1; i < (1 << order); i++) {
+		struct page *p = page + i;
+
+		p->flags &= ~(1 << PG_uptodate | 1 << PG_error |
+				1 << PG_referenced | 1 << PG_arch_1 |
+				1 << PG_checked | 1 << PG_mappedtodisk);
+		p->private = 0;
+		set_page_count(p, 1);
+	}
+}
+
+/*
+ * Memory compaction wants free pages one at a time: if @page heads a free
+ * block, take the block off the buddy lists and hand it out on @list as
+ * order-0 pages with a reference each.  Returns the number of pages taken,
+ * 0 if @page is not the head of a free block.  Called with zone->lock held.
+ */
+int split_free_page(struct zone *zone, struct page *page,
+		    struct list_head *list)
+{
+	unsigned long order;
+	int i;
+
+	if (!PagePrivate(page) || PageReserved(page) || page_count(page) != 0)
+		return 0;
+
+	order = page_order(page);
+	list_del(&page->lru);
+	zone->free_area[order].nr_free--;
+	zone->free_pages -= 1UL << order;
+	rmv_page_order(page);
+
+	for (i = 0; i < (1 << order); i++) {
+		prep_new_page(page + i, 0);
+		list_add_tail(&page[i].lru, list);
+	}
+	return 1 << order;
+}
+
+/*
+ * Go through the free lists for the given migratetype and remove
+ * the smallest available page from the freelists
  */
 /**
- * ڹҵһп顣
- * ҪĵַorderOrderʾĿҳСĶֵ
+ * ڹҵһǨΪmigratetypeĿп顣
+ * orderʾĿҳСĶֵ
  * ҳ򱻳ɹ䣬򷵻صһҳҳ򷵻NULL
  * Ѿֹͱжϲ
  */
-static struct page *__rmqueue(struct zone *zone, unsigned int order)
+static struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
+				       int migratetype)
 {
 	struct free_area * area;
 	unsigned int current_order;
@@ -515,13 +616,14 @@ static struct page *__rmqueue(struct zone *zone, unsigned int order)
 		/**
 		 * ӦĿпΪգڸĿпнѭ
 		 */
-		if (list_empty(&area->free_list))
+		if (list_empty(&area->free_list[migratetype]))
 			continue;
 
 		/**
 		 * еˣ˵кʵĿп顣
 		 */
-		page = list_entry(area->free_list.next, struct page, lru);
+		page = list_entry(area->free_list[migratetype].next,
+				  struct page, lru);
 		/**
 		 * ڿпɾһҳ
 		 */
@@ -536,22 +638,146 @@ static struct page *__rmqueue(struct zone *zone, unsigned int order)
 		 * 2^orderпûкʵĿп飬ôǴӸĿзġ
 		 * ʣĿпɢʵȥ
 		 */
-		return expand(zone, page, order, current_order, area);
+		return expand(zone, page, order, current_order, area,
+			      migratetype);
 	}
 
-	/**
-	 * ֱѭûҵʵĿп飬ͷNULL
-	 */
 	return NULL;
 }
 
+/*
+ * This array describes the order lists are fallen back to when
+ * the free lists for the desirable migrate type are depleted
+ */
+static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES-1] = {
+	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE },
+	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE },
+	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE },
+};
+
+/*
+ * Move the free blocks of one pageblock to the free lists of
+ * migratetype.  Returns the number of pages moved.
+ */
+static int move_freepages_block(struct zone *zone, struct page *page,
+				int migratetype)
+{
+	struct page *start, *end;
+	unsigned long start_idx;
+	int pages_moved = 0;
+
+	start_idx = (page - zone->zone_mem_map) & ~(pageblock_nr_pages - 1);
+	start = zone->zone_mem_map + start_idx;
+	end = start + pageblock_nr_pages;
+	if (start_idx + pageblock_nr_pages > zone->spanned_pages)
+		end = zone->zone_mem_map + zone->spanned_pages;
+
+	for (page = start; page < end;) {
+		unsigned long order;
+
+		/* Only the head page of a free block is on a list */
+		if (!PagePrivate(page) || PageReserved(page) ||
+		    page_count(page) != 0) {
+			page++;
+			continue;
+		}
+		order = page_order(page);
+		list_move(&page->lru,
+			  &zone->free_area[order].free_list[migratetype]);
+		page += 1 << order;
+		pages_moved += 1 << order;
+	}
+	return pages_moved;
+}
+
+/*
+ * Nothing of the wanted type is left: take a block from another type.
+ * Big blocks are broken up starting from the largest one so that a
+ * single steal serves many future allocations, and when a good part of
+ * a pageblock is free the whole pageblock changes hands, so the types
+ * keep to their own pageblocks as far as possible.
+ */
+static struct page *__rmqueue_fallback(struct zone *zone, int order,
+				       int start_migratetype)
+{
+	struct free_area * area;
+	int current_order;
+	struct page *page;
+	int migratetype, i;
+
+	for (current_order = MAX_ORDER-1; current_order >= order;
+						--current_order) {
+		for (i = 0; i < MIGRATE_TYPES - 1; i++) {
+			migratetype = fallbacks[start_migratetype][i];
+
+			area = zone->free_area + current_order;
+			if (list_empty(&area->free_list[migratetype]))
+				continue;
+
+			page = list_entry(area->free_list[migratetype].next,
+					struct page, lru);
+			area->nr_free--;
+
+			/*
+			 * When breaking up a large block, move all the free
+			 * pages of its pageblock over to the wanted type.
+			 * Reclaimable kernel allocations are more aggressive
+			 * about it, they tend to come in bursts.
+			 */
+			if (unlikely(current_order >= (pageblock_order >> 1)) ||
+			    start_migratetype == MIGRATE_RECLAIMABLE) {
+				int pages;
+
+				pages = move_freepages_block(zone, page,
+							start_migratetype);
+				/* Claim the pageblock if over half is free */
+				if (pages >= (1 << (pageblock_order - 1)))
+					set_pageblock_migratetype(zone, page,
+							start_migratetype);
+				migratetype = start_migratetype;
+			}
+
+			/* Remove the page from the freelists */
+			list_del(&page->lru);
+			rmv_page_order(page);
+			zone->free_pages -= 1UL << order;
+
+			if (current_order == pageblock_order)
+				set_pageblock_migratetype(zone, page,
+							start_migratetype);
+
+			return expand(zone, page, order, current_order, area,
+				      migratetype);
+		}
+	}
+	return NULL;
+}
+
+/* 
+ * Do the hard work of removing an element from the buddy allocator.
+ * Call me with the zone->lock already held.
+ */
+static struct page *__rmqueue(struct zone *zone, unsigned int order,
+			      int migratetype)
+{
+	struct page *page;
+
+	page = __rmqueue_smallest(zone, order, migratetype);
+	if (unlikely(!page))
+		page = __rmqueue_fallback(zone, order, migratetype);
+	return page;
+}
+
 /* 
  * Obtain a specified number of elements from the buddy allocator, all under
  * a single hold of the lock, for efficiency.  Add them to the supplied list.
- * Returns the number of new pages which were placed at *list.
+ * Returns the number of new pages which were placed at *list.  The pages
+ * remember the type they were allocated for in page->private while they
+ * sit on a per-cpu list.
  */
 static int rmqueue_bulk(struct zone *zone, unsigned int order, 
-			unsigned long count, struct list_head *list)
+			unsigned long count, struct list_head *list,
+			int migratetype)
 {
 	unsigned long flags;
 	int i;
@@ -560,9 +786,10 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 	
 	spin_lock_irqsave(&zone->lock, flags);
 	for (i = 0; i < count; ++i) {
-		page = __rmqueue(zone, order);
+		page = __rmqueue(zone, order, migratetype);
 		if (page == NULL)
 			break;
+		page->private = migratetype;
 		allocated++;
 		list_add_tail(&page->lru, list);
 	}
@@ -596,7 +823,7 @@ static void __drain_pages(unsigned int cpu)
 void mark_free_pages(struct zone *zone)
 {
 	unsigned long zone_pfn, flags;
-	int order;
+	int order, t;
 	struct list_head *curr;
 
 	if (!zone->spanned_pages)
@@ -607,7 +834,8 @@ void mark_free_pages(struct zone *zone)
 		ClearPageNosaveFree(pfn_to_page(zone_pfn + zone->zone_start_pfn));
 
 	for (order = MAX_ORDER - 1; order >= 0; --order)
-		list_for_each(curr, &zone->free_area[order].free_list) {
+		for (t = 0; t < MIGRATE_TYPES; t++)
+		list_for_each(curr, &zone->free_area[order].free_list[t]) {
 			unsigned long start_pfn, i;
 
 			start_pfn = page_to_pfn(list_entry(curr, struct page, lru));
@@ -696,7 +924,9 @@ static void fastcall free_hot_cold_page(struct page *page, int cold)
 		pcp->count -= free_pages_bulk(zone, pcp->batch, &pcp->list, 0);
 	/**
 	 * ͷŵҳӵٻϡcountֶΡ
+	 * privateֶμ¼ҳpageblockǨ͡
 	 */
+	page->private = get_pageblock_migratetype(zone, page);
 	list_add(&page->lru, &pcp->list);
 	pcp->count++;
 	local_irq_restore(flags);
@@ -740,12 +970,14 @@ buffered_rmqueue(struct zone *zone, int order, int gfp_flags)
 	unsigned long flags;
 	struct page *page = NULL;
 	int cold = !!(gfp_flags & __GFP_COLD);
+	int migratetype = allocflags_to_migratetype(gfp_flags);
 
 	/**
 	 * order!=0ÿCPUҳٻͲܱʹá
 	 */
 	if (order == 0) {
 		struct per_cpu_pages *pcp;
+		struct page *p;
 
 		/**
 		 * __GFP_COLD־ʶڴCPUٻǷҪ䡣
@@ -760,13 +992,33 @@ buffered_rmqueue(struct zone *zone, int order, int gfp_flags)
 		 */
 		if (pcp->count <= pcp->low)
 			pcp->count += rmqueue_bulk(zone, 0,
-						pcp->batch, &pcp->list);
+					pcp->batch, &pcp->list, migratetype);
 		/**
-		 * countΪӸٻлһҳ
-		 * count1
+		 * ӸٻһǨҳ
+		 * ûУͲһ͵ҳ
 		 */
-		if (pcp->count) {
-			page = list_entry(pcp->list.next, struct page, lru);
+		list_for_each_entry(p, &pcp->list, lru) {
+			if (p->private == migratetype) {
+				page = p;
+				break;
+			}
+		}
+		if (!page) {
+			LIST_HEAD(fresh);
+			int n = rmqueue_bulk(zone, 0, pcp->batch, &fresh,
+					     migratetype);
+
+			if (n) {
+				list_splice(&fresh, &pcp->list);
+				pcp->count += n;
+				page = list_entry(pcp->list.next,
+						  struct page, lru);
+			}
+		}
+		/**
+		 * ҵˣcount1
+		 */
+		if (page) {
 			list_del(&page->lru);
 			pcp->count--;
 		}
@@ -784,7 +1036,7 @@ buffered_rmqueue(struct zone *zone, int order, int gfp_flags)
 	 */
 	if (page == NULL) {
 		spin_lock_irqsave(&zone->lock, flags);
-		page = __rmqueue(zone, order);
+		page = __rmqueue(zone, order, migratetype);
 		spin_unlock_irqrestore(&zone->lock, flags);
 	}
 
@@ -811,6 +1063,117 @@ buffered_rmqueue(struct zone *zone, int order, int gfp_flags)
 	return page;
 }
 
+/*
+ * Take up to @count order-0 pages of @migratetype for @zone off this
+ * cpu's hot or cold list, then off the buddy lists with a single hold
+ * of zone->lock.
+ * Returns the number of pages placed at *list.
+ */
+static int rmqueue_bulk_pcp(struct zone *zone, int cold, unsigned long count,
+			    struct list_head *list, int migratetype)
+{
+	struct per_cpu_pages *pcp;
+	struct page *page, *next;
+	unsigned long flags;
+	int allocated = 0;
+
+	pcp = &zone->pageset[get_cpu()].pcp[cold];
+	local_irq_save(flags);
+	list_for_each_entry_safe(page, next, &pcp->list, lru) {
+		if (allocated == count)
+			break;
+		if (page->private != migratetype)
+			continue;
+		list_move_tail(&page->lru, list);
+		pcp->count--;
+		allocated++;
+	}
+	local_irq_restore(flags);
+	put_cpu();
+
+	if (allocated < count)
+		allocated += rmqueue_bulk(zone, 0, count - allocated, list,
+					  migratetype);
+	return allocated;
+}
+
+/**
+ * alloc_pages_bulk - allocate a batch of order-0 pages
+ * @gfp_mask: the usual allocation flags; __GFP_COLD picks the cold lists
+ * @nr_pages: number of pages wanted
+ * @list: the pages are added to the tail of this list, linked by page->lru
+ *
+ * Callers that need many single pages at once (readahead, network
+ * receive refills) would otherwise take zone->lock once per pcp refill.
+ * Here each zone of the local node's zonelist hands over as many pages
+ * as it can above its low watermark in one go.
+ *
+ * Only that watermark pass is done in bulk.  If it yields nothing, a
+ * single page is allocated through __alloc_pages() so that the caller
+ * still gets reclaim and the usual failure handling.  Memory policies
+ * are not consulted.
+ *
+ * Returns the number of pages added to @list, which may be less than
+ * @nr_pages.
+ */
+unsigned int alloc_pages_bulk(unsigned int gfp_mask, unsigned int nr_pages,
+			      struct list_head *list)
+{
+	struct zonelist *zonelist;
+	struct zone **zones, *z;
+	struct page *page;
+	unsigned int allocated = 0;
+	int cold = !!(gfp_mask & __GFP_COLD);
+	int classzone_idx;
+	int i;
+
+	might_sleep_if(gfp_mask & __GFP_WAIT);
+
+	zonelist = NODE_DATA(numa_node_id())->node_zonelists +
+			(gfp_mask & GFP_ZONEMASK);
+	zones = zonelist->zones;
+	if (unlikely(zones[0] == NULL))
+		return 0;
+	classzone_idx = zone_idx(zones[0]);
+
+	for (i = 0; (z = zones[i]) != NULL && allocated < nr_pages; i++) {
+		unsigned int want = nr_pages - allocated;
+		unsigned int got;
+		LIST_HEAD(batch);
+
+		if (!zone_watermark_ok(z, 0, z->pages_low + want,
+				       classzone_idx, 0, 0))
+			continue;
+
+		got = rmqueue_bulk_pcp(z, cold, want, &batch,
+				allocflags_to_migratetype(gfp_mask));
+		if (!got)
+			continue;
+
+		mod_page_state_zone(z, pgalloc, got);
+		list_for_each_entry(page, &batch, lru) {
+			BUG_ON(bad_range(z, page));
+			prep_new_page(page, 0);
+			if (gfp_mask & __GFP_ZERO)
+				prep_zero_page(page, 0, gfp_mask);
+			zone_statistics(zonelist, z);
+		}
+		list_splice(&batch, list->prev);
+		allocated += got;
+	}
+
+	if (!allocated) {
+		page = __alloc_pages(gfp_mask, 0, zonelist);
+		if (page) {
+			list_add_tail(&page->lru, list);
+			allocated = 1;
+		}
+	}
+	return allocated;
+}
+
+EXPORT_SYMBOL(alloc_pages_bulk);
+
 /*
  * Return 1 if free pages are above 'mark'. This takes into account the order
  * of the allocation.
@@ -989,8 +1352,16 @@ __alloc_pages(unsigned int gfp_mask, unsigned int order,
 	/**
 	 * gfp_mask__GFP_WAIT־ûбλͷNULL
 	 */
-	if (!wait)
+	if (!wait) {
+		/*
+		 * We can't compact from here, but kcompactd can have a
+		 * block of this order ready for the next attempt.
+		 */
+		if (order)
+			for (i = 0; (z = zones[i]) != NULL; i++)
+				wakeup_kcompactd(z, order);
 		goto nopage;
+	}
 
 rebalance:
 	/**
@@ -998,6 +1369,29 @@ rebalance:
 	 */
 	cond_resched();
 
+	/*
+	 * A high-order request often fails although plenty of memory is
+	 * free, only scattered: try to move pages together before
+	 * reclaiming any more.
+	 */
+	if (order && try_to_compact_pages(zones, order) != COMPACT_SKIPPED) {
+		inc_page_state(compact_stall);
+		for (i = 0; (z = zones[i]) != NULL; i++) {
+			if (!zone_watermark_ok(z, order, z->pages_min,
+					       classzone_idx, can_try_harder,
+					       gfp_mask & __GFP_HIGH))
+				continue;
+
+			page = buffered_rmqueue(z, order, gfp_mask);
+			if (page) {
+				inc_page_state(compact_success);
+				goto got_pg;
+			}
+		}
+		inc_page_state(compact_fail);
+		cond_resched();
+	}
+
 	/* We now go into synchronous reclaim */
 	/**
 	 * PF_MEMALLOC־ʾѾ׼ִڴա
@@ -1372,8 +1766,8 @@ void __get_zone_counts(unsigned long *active, unsigned long *inactive,
 	*inactive = 0;
 	*free = 0;
 	for (i = 0; i < MAX_NR_ZONES; i++) {
-		*active += zones[i].nr_active;
-		*inactive += zones[i].nr_inactive;
+		*active += zone_nr_active(&zones[i]);
+		*inactive += zone_nr_inactive(&zones[i]);
 		*free += zones[i].free_pages;
 	}
 }
@@ -1395,6 +1789,21 @@ void get_zone_counts(unsigned long *active,
 	}
 }
 
+/*
+ * Sum the per-list LRU sizes of every zone, for /proc/meminfo.
+ */
+void get_lru_counts(unsigned long *nr_lru)
+{
+	struct zone *zone;
+	int l;
+
+	for_each_lru(l)
+		nr_lru[l] = 0;
+	for_each_zone(zone)
+		for_each_lru(l)
+			nr_lru[l] += zone->nr_lru[l];
+}
+
 void si_meminfo(struct sysinfo *val)
 {
 	val->totalram = totalram_pages;
@@ -1498,8 +1907,11 @@ void show_free_areas(void)
 			" min:%lukB"
 			" low:%lukB"
 			" high:%lukB"
-			" active:%lukB"
-			" inactive:%lukB"
+			" active_anon:%lukB"
+			" inactive_anon:%lukB"
+			" active_file:%lukB"
+			" inactive_file:%lukB"
+			" unevictable:%lukB"
 			" present:%lukB"
 			" pages_scanned:%lu"
 			" all_unreclaimable? %s"
@@ -1509,8 +1921,11 @@ void show_free_areas(void)
 			K(zone->pages_min),
 			K(zone->pages_low),
 			K(zone->pages_high),
-			K(zone->nr_active),
-			K(zone->nr_inactive),
+			K(zone->nr_lru[LRU_ACTIVE_ANON]),
+			K(zone->nr_lru[LRU_INACTIVE_ANON]),
+			K(zone->nr_lru[LRU_ACTIVE_FILE]),
+			K(zone->nr_lru[LRU_INACTIVE_FILE]),
+			K(zone->nr_lru[LRU_UNEVICTABLE]),
 			K(zone->present_pages),
 			zone->pages_scanned,
 			(zone->all_unreclaimable ? "yes" : "no")
@@ -1834,11 +2249,32 @@ void __init memmap_init_zone(unsigned long size, int nid, unsigned long zone,
 void zone_init_free_lists(struct pglist_data *pgdat, struct zone *zone,
 				unsigned long size)
 {
-	int order;
-	for (order = 0; order < MAX_ORDER ; order++) {
-		INIT_LIST_HEAD(&zone->free_area[order].free_list);
+	int order, t;
+	for_each_migratetype_order(order, t)
+		INIT_LIST_HEAD(&zone->free_area[order].free_list[t]);
+	for (order = 0; order < MAX_ORDER ; order++)
 		zone->free_area[order].nr_free = 0;
-	}
+}
+
+/*
+ * Every pageblock starts out movable: the memory freed at boot is then
+ * grouped with user pages, and kernel allocations claim pageblocks of
+ * their own as they fall back.
+ */
+static void __init setup_pageblock_flags(struct pglist_data *pgdat,
+				struct zone *zone, unsigned long size)
+{
+	unsigned long nr_blocks, bytes, i;
+
+	nr_blocks = (size + pageblock_nr_pages - 1) >> pageblock_order;
+	bytes = BITS_TO_LONGS(nr_blocks * NR_PAGEBLOCK_BITS) *
+			sizeof(unsigned long);
+	zone->pageblock_flags = alloc_bootmem_node(pgdat, bytes);
+
+	for (i = 0; i < nr_blocks; i++)
+		set_pageblock_migratetype(zone,
+			zone->zone_mem_map + (i << pageblock_order),
+			MIGRATE_MOVABLE);
 }
 
 #ifndef __HAVE_ARCH_MEMMAP_INIT
@@ -1852,6 +2288,47 @@ void zone_init_free_lists(struct pglist_data *pgdat, struct zone *zone,
  *   - mark all memory queues empty
  *   - clear the memory bitmaps
  */
+static unsigned long zone_batchsize(struct zone *zone)
+{
+	unsigned long batch;
+
+	/*
+	 * The per-cpu-pages pools are set to around 1000th of the
+	 * size of the zone.  But no more than 1/4 of a meg - there's
+	 * no point in going beyond the size of L2 cache.
+	 *
+	 * OK, so we don't know how big the cache is.  So guess.
+	 */
+	batch = zone->present_pages / 1024;
+	if (batch * PAGE_SIZE > 256 * 1024)
+		batch = (256 * 1024) / PAGE_SIZE;
+	batch /= 4;		/* We effectively *= 4 below */
+	if (batch < 1)
+		batch = 1;
+	return batch;
+}
+
+/*
+ * Set the watermarks of one cpu's hot and cold lists from the batch
+ * size.  The lists themselves are left alone, so this is safe to call
+ * on a live pageset: a cpu sees the new values on its next refill or
+ * free.
+ */
+static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
+{
+	struct per_cpu_pages *pcp;
+
+	pcp = &p->pcp[0];		/* hot */
+	pcp->low = 2 * batch;
+	pcp->high = 6 * batch;
+	pcp->batch = 1 * batch;
+
+	pcp = &p->pcp[1];		/* cold */
+	pcp->low = 0;
+	pcp->high = 2 * batch;
+	pcp->batch = 1 * batch;
+}
+
 static void __init free_area_init_core(struct pglist_data *pgdat,
 		unsigned long *zones_size, unsigned long *zholes_size)
 {
@@ -1862,12 +2339,16 @@ static void __init free_area_init_core(struct pglist_data *pgdat,
 
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat->kswapd_max_order = 0;
 	
 	for (j = 0; j < MAX_NR_ZONES; j++) {
 		struct zone *zone = pgdat->node_zones + j;
 		unsigned long size, realsize;
 		unsigned long batch;
+		int l;
 
 		zone_table[NODEZONE(nid, j)] = zone;
 		realsize = size = zones_size[j];
@@ -1889,44 +2370,30 @@ static void __init free_area_init_core(struct pglist_data *pgdat,
 		zone->temp_priority = zone->prev_priority = DEF_PRIORITY;
 
 		/*
-		 * The per-cpu-pages pools are set to around 1000th of the
-		 * size of the zone.  But no more than 1/4 of a meg - there's
-		 * no point in going beyond the size of L2 cache.
-		 *
-		 * OK, so we don't know how big the cache is.  So guess.
+		 * Only the zone size is known this early; the lists are
+		 * resized for the number of cpus once those are up.
 		 */
-		batch = zone->present_pages / 1024;
-		if (batch * PAGE_SIZE > 256 * 1024)
-			batch = (256 * 1024) / PAGE_SIZE;
-		batch /= 4;		/* We effectively *= 4 below */
-		if (batch < 1)
-			batch = 1;
+		batch = zone_batchsize(zone);
 
 		for (cpu = 0; cpu < NR_CPUS; cpu++) {
-			struct per_cpu_pages *pcp;
+			struct per_cpu_pageset *p = &zone->pageset[cpu];
 
-			pcp = &zone->pageset[cpu].pcp[0];	/* hot */
-			pcp->count = 0;
-			pcp->low = 2 * batch;
-			pcp->high = 6 * batch;
-			pcp->batch = 1 * batch;
-			INIT_LIST_HEAD(&pcp->list);
-
-			pcp = &zone->pageset[cpu].pcp[1];	/* cold */
-			pcp->count = 0;
-			pcp->low = 0;
-			pcp->high = 2 * batch;
-			pcp->batch = 1 * batch;
-			INIT_LIST_HEAD(&pcp->list);
+			p->pcp[0].count = 0;
+			INIT_LIST_HEAD(&p->pcp[0].list);
+			p->pcp[1].count = 0;
+			INIT_LIST_HEAD(&p->pcp[1].list);
+			setup_pageset(p, batch);
 		}
 		printk(KERN_DEBUG "  %s zone: %lu pages, LIFO batch:%lu\n",
 				zone_names[j], realsize, batch);
-		INIT_LIST_HEAD(&zone->active_list);
-		INIT_LIST_HEAD(&zone->inactive_list);
-		zone->nr_scan_active = 0;
-		zone->nr_scan_inactive = 0;
-		zone->nr_active = 0;
-		zone->nr_inactive = 0;
+		for_each_lru(l) {
+			INIT_LIST_HEAD(&zone->lru[l]);
+			zone->nr_lru[l] = 0;
+			zone->nr_scan[l] = 0;
+		}
+		zone->recent_scanned[0] = zone->recent_scanned[1] = 0;
+		zone->recent_rotated[0] = zone->recent_rotated[1] = 0;
+		atomic_set(&zone->inactive_age, 0);
 		if (!size)
 			continue;
 
@@ -1956,6 +2423,7 @@ static void __init free_area_init_core(struct pglist_data *pgdat,
 
 		zone_start_pfn += size;
 
+		setup_pageblock_flags(pgdat, zone, zone->spanned_pages);
 		zone_init_free_lists(pgdat, zone, zone->spanned_pages);
 	}
 }
@@ -2040,9 +2508,12 @@ static int frag_show(struct seq_file *m, void *arg)
 	struct zone *zone;
 	struct zone *node_zones = pgdat->node_zones;
 	unsigned long flags;
-	int order;
+	int order, t;
 
 	for (zone = node_zones; zone - node_zones < MAX_NR_ZONES; ++zone) {
+		unsigned long blocks[MIGRATE_TYPES] = { 0, };
+		unsigned long i;
+
 		if (!zone->present_pages)
 			continue;
 
@@ -2050,7 +2521,36 @@ static int frag_show(struct seq_file *m, void *arg)
 		seq_printf(m, "Node %d, zone %8s ", pgdat->node_id, zone->name);
 		for (order = 0; order < MAX_ORDER; ++order)
 			seq_printf(m, "%6lu ", zone->free_area[order].nr_free);
+		seq_putc(m, '\n');
+
+		/* Free blocks of each order by mobility type */
+		for (t = 0; t < MIGRATE_TYPES; t++) {
+			seq_printf(m, "Node %d, zone %8s, type %12s ",
+					pgdat->node_id, zone->name,
+					migratetype_names[t]);
+			for (order = 0; order < MAX_ORDER; ++order) {
+				unsigned long freecount = 0;
+				struct list_head *curr;
+
+				list_for_each(curr,
+					&zone->free_area[order].free_list[t])
+					freecount++;
+				seq_printf(m, "%6lu ", freecount);
+			}
+			seq_putc(m, '\n');
+		}
+
+		/* Pageblocks owned by each type */
+		for (i = 0; i < zone->spanned_pages; i += pageblock_nr_pages)
+			blocks[get_pageblock_migratetype(zone,
+					zone->zone_mem_map + i)]++;
 		spin_unlock_irqrestore(&zone->lock, flags);
+
+		seq_printf(m, "Node %d, zone %8s, pageblocks ",
+				pgdat->node_id, zone->name);
+		for (t = 0; t < MIGRATE_TYPES; t++)
+			seq_printf(m, " %s %lu", migratetype_names[t],
+					blocks[t]);
 		seq_putc(m, '\n');
 	}
 	return 0;
@@ -2070,6 +2570,7 @@ static char *vmstat_text[] = {
 	"nr_page_table_pages",
 	"nr_mapped",
 	"nr_slab",
+	"nr_shadows",
 
 	"pgpgin",
 	"pgpgout",
@@ -2085,6 +2586,7 @@ static char *vmstat_text[] = {
 
 	"pgfault",
 	"pgmajfault",
+	"pgfault_speculative",
 	"pgrefill_high",
 	"pgrefill_normal",
 	"pgrefill_dma",
@@ -2108,6 +2610,30 @@ static char *vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+
+	"compact_pages_moved",
+	"compact_pagemigrate_failed",
+	"compact_stall",
+	"compact_fail",
+	"compact_success",
+
+	"thp_fault_alloc",
+	"thp_fault_fallback",
+	"thp_collapse_alloc",
+	"thp_split",
+
+	"unevictable_pgs_culled",
+	"unevictable_pgs_rescued",
+
+	"workingset_refault",
+	"workingset_activate",
+	"workingset_shadow_reclaim",
+
+	"zswpout",
+	"zswpin",
+	"zswpmiss",
+	"zswpreject",
+	"zswpwriteback",
 };
 
 static void *vmstat_start(struct seq_file *m, loff_t *pos)
@@ -2159,6 +2685,57 @@ struct seq_operations vmstat_op = {
 
 #endif /* CONFIG_PROC_FS */
 
+/*
+ * percpu_pagelist_fraction - when non-zero, the hot list of each cpu may
+ *	hold at most 1/percpu_pagelist_fraction of its zone.  Zero sizes the
+ *	lists automatically from the zone size and the number of cpus.
+ */
+int percpu_pagelist_fraction;
+
+static unsigned long zone_pcp_batch(struct zone *zone)
+{
+	unsigned long batch, limit;
+	int cpus = num_online_cpus();
+
+	if (percpu_pagelist_fraction) {
+		/* the hot list's high mark is six batches */
+		batch = zone->present_pages / percpu_pagelist_fraction / 6;
+	} else {
+		/*
+		 * Every refill and every spill takes zone->lock, and more
+		 * cpus fight over it, so give each cpu bigger batches as
+		 * their number grows: 1 cpu keeps the boot size, 2 get
+		 * twice it, 4 three times and so on.  But don't let the hot
+		 * lists of all cpus together pin more than an eighth of the
+		 * zone.
+		 */
+		batch = zone_batchsize(zone) * fls(cpus);
+		limit = zone->present_pages / (8 * 6 * cpus);
+		if (batch > limit)
+			batch = limit;
+	}
+	if (batch < 1)
+		batch = 1;
+	return batch;
+}
+
+/*
+ * setup_per_zone_pagesets - called at boot once the cpus are up, on cpu
+ *	hotplug and whenever percpu_pagelist_fraction changes.
+ */
+static void setup_per_zone_pagesets(void)
+{
+	struct zone *zone;
+	unsigned long batch;
+	int cpu;
+
+	for_each_zone(zone) {
+		batch = zone_pcp_batch(zone);
+		for (cpu = 0; cpu < NR_CPUS; cpu++)
+			setup_pageset(&zone->pageset[cpu], batch);
+	}
+}
+
 #ifdef CONFIG_HOTPLUG_CPU
 static int page_alloc_cpu_notify(struct notifier_block *self,
 				 unsigned long action, void *hcpu)
@@ -2167,6 +2744,9 @@ static int page_alloc_cpu_notify(struct notifier_block *self,
 	long *count;
 	unsigned long *src, *dest;
 
+	if (action == CPU_ONLINE)
+		setup_per_zone_pagesets();
+
 	if (action == CPU_DEAD) {
 		int i;
 
@@ -2188,6 +2768,7 @@ static int page_alloc_cpu_notify(struct notifier_block *self,
 		}
 
 		local_irq_enable();
+		setup_per_zone_pagesets();
 	}
 	return NOTIFY_OK;
 }
@@ -2316,6 +2897,7 @@ static int __init init_per_zone_pages_min(void)
 		min_free_kbytes = 65536;
 	setup_per_zone_pages_min();
 	setup_per_zone_lowmem_reserve();
+	setup_per_zone_pagesets();
 	return 0;
 }
 module_init(init_per_zone_pages_min)
@@ -2350,6 +2932,31 @@ int lowmem_reserve_ratio_sysctl_handler(ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * percpu_pagelist_fraction_sysctl_handler - just a wrapper around
+ *	proc_dointvec() which resizes the per-cpu lists whenever
+ *	percpu_pagelist_fraction changes.  Zero is allowed (automatic
+ *	sizing), anything else must leave room for at least eight cpus'
+ *	worth of lists.
+ */
+int percpu_pagelist_fraction_sysctl_handler(ctl_table *table, int write,
+		struct file *file, void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int old = percpu_pagelist_fraction;
+	int ret;
+
+	ret = proc_dointvec(table, write, file, buffer, length, ppos);
+	if (!write || ret)
+		return ret;
+	if (percpu_pagelist_fraction < 0 ||
+	    (percpu_pagelist_fraction && percpu_pagelist_fraction < 8)) {
+		percpu_pagelist_fraction = old;
+		return -EINVAL;
+	}
+	setup_per_zone_pagesets();
+	return 0;
+}
+
 __initdata int hashdist = HASHDIST_DEFAULT;
 
 #ifdef CONFIG_NUMA
@@ -17,6 +17,7 @@
 #include <linux/bio.h>
 #include <linux/swapops.h>
 #include <linux/writeback.h>
+#include <linux/zswap.h>
 #include <asm/pgtable.h>
 
 static struct bio *get_swap_bio(int gfp_flags, pgoff_t index,
@@ -93,17 +94,28 @@ static int end_swap_bio_read(struct bio *bio, unsigned int bytes_done, int err)
  */
 int swap_writepage(struct page *page, struct writeback_control *wbc)
 {
-	struct bio *bio;
-	int ret = 0, rw = WRITE;
-
 	/**
 	 * Ƿһû̬øҳûоʹӽٻɾҳ0.
 	 * ԭ:һܻ̿PFRAshrink_listͷһҳ
 	 */
 	if (remove_exclusive_swap_page(page)) {
 		unlock_page(page);
-		goto out;
+		return 0;
 	}
+	/* Kept compressed in memory: no I/O at all */
+	if (!zswap_store(page)) {
+		unlock_page(page);
+		return 0;
+	}
+	return __swap_writepage(page, wbc);
+}
+
+/* Write the locked swap cache @page out to its slot on the swap device. */
+int __swap_writepage(struct page *page, struct writeback_control *wbc)
+{
+	struct bio *bio;
+	int ret = 0, rw = WRITE;
+
 	/**
 	 * 䲢ʼһBIO
 	 * ӻҳʶַȻҵҳ۵Ĵ
@@ -140,6 +152,11 @@ int swap_readpage(struct file *file, struct page *page)
 
 	BUG_ON(!PageLocked(page));
 	ClearPageUptodate(page);
+	if (!zswap_load(page)) {
+		SetPageUptodate(page);
+		unlock_page(page);
+		goto out;
+	}
 	bio = get_swap_bio(GFP_KERNEL, page->private, page, end_swap_bio_read);
 	if (bio == NULL) {
 		unlock_page(page);
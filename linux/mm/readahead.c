@@ -20,13 +20,6 @@ void default_unplug_io_fn(struct backing_dev_info *bdi, struct page *page)
 }
 EXPORT_SYMBOL(default_unplug_io_fn);
 
-struct backing_dev_info default_backing_dev_info = {
-	.ra_pages	= (VM_MAX_READAHEAD * 1024) / PAGE_CACHE_SIZE,
-	.state		= 0,
-	.unplug_io_fn	= default_unplug_io_fn,
-};
-EXPORT_SYMBOL_GPL(default_backing_dev_info);
-
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
  * memset *ra to zero.
@@ -262,6 +255,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	struct page *page;
 	unsigned long end_index;	/* The last page we want to read */
 	LIST_HEAD(page_pool);
+	LIST_HEAD(spare);
 	int page_idx;
 	int ret = 0;
 	loff_t isize = i_size_read(inode);
@@ -282,20 +276,36 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 			break;
 
 		page = radix_tree_lookup(&mapping->page_tree, page_offset);
-		if (page)
+		if (page && !radix_tree_exceptional_entry(page))
 			continue;
 
-		spin_unlock_irq(&mapping->tree_lock);
-		page = page_cache_alloc_cold(mapping);
-		spin_lock_irq(&mapping->tree_lock);
-		if (!page)
-			break;
+		/*
+		 * Grab pages for the rest of the window in one go rather
+		 * than one buddy round trip each.
+		 */
+		if (list_empty(&spare)) {
+			spin_unlock_irq(&mapping->tree_lock);
+			alloc_pages_bulk(mapping_gfp_mask(mapping)|__GFP_COLD,
+					nr_to_read - page_idx, &spare);
+			spin_lock_irq(&mapping->tree_lock);
+			if (list_empty(&spare))
+				break;
+		}
+		page = list_entry(spare.next, struct page, lru);
+		list_del(&page->lru);
 		page->index = page_offset;
 		list_add(&page->lru, &page_pool);
 		ret++;
 	}
 	spin_unlock_irq(&mapping->tree_lock);
 
+	/* Pages for offsets that turned out to be cached already */
+	while (!list_empty(&spare)) {
+		page = list_entry(spare.next, struct page, lru);
+		list_del(&page->lru);
+		page_cache_release(page);
+	}
+
 	/*
 	 * Now start the IO.  We ignore I/O errors - if the page is not
 	 * uptodate then the caller will launch readpage again, and
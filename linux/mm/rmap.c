@@ -53,6 +53,7 @@
 #include <linux/init.h>
 #include <linux/acct.h>
 #include <linux/rmap.h>
+#include <linux/huge_mm.h>
 #include <linux/rcupdate.h>
 
 #include <asm/tlbflush.h>
@@ -278,6 +279,15 @@ static int page_referenced_one(struct page *page,
 	if (!pmd_present(*pmd))
 		goto out_unlock;
 
+	if (pmd_trans_huge(*pmd)) {
+		if (trans_huge_pmd_page(*pmd, address) != page)
+			goto out_unlock;
+		if (huge_pmd_referenced(vma, pmd, address, page))
+			referenced++;
+		(*mapcount)--;
+		goto out_unlock;
+	}
+
 	pte = pte_offset_map(pmd, address);
 	if (!pte_present(*pte))
 		goto out_unmap;
@@ -285,6 +295,15 @@ static int page_referenced_one(struct page *page,
 	if (page_to_pfn(page) != pte_pfn(*pte))
 		goto out_unmap;
 
+	/*
+	 * Don't let an mlocked mapping keep the page active: it has to get
+	 * as far as try_to_unmap, which sends it to the unevictable list.
+	 */
+	if (vma->vm_flags & VM_LOCKED) {
+		*mapcount = 0;	/* break early from loop */
+		goto out_unmap;
+	}
+
 	if (ptep_clear_flush_young(vma, address, pte))
 		referenced++;
 
@@ -367,11 +386,6 @@ static int page_referenced_file(struct page *page, int ignore_token)
 	mapcount = page_mapcount(page);
 
 	vma_prio_tree_foreach(vma, &iter, &mapping->i_mmap, pgoff, pgoff) {
-		if ((vma->vm_flags & (VM_LOCKED|VM_MAYSHARE))
-				  == (VM_LOCKED|VM_MAYSHARE)) {
-			referenced++;
-			break;
-		}
 		referenced += page_referenced_one(page, vma, &mapcount,
 							ignore_token);
 		if (!mapcount)
@@ -477,6 +491,22 @@ void page_add_file_rmap(struct page *page)
 		inc_page_state(nr_mapped);
 }
 
+/**
+ * page_add_ksm_rmap - add pte mapping to a page merged by ksmd
+ * @page: the page to add the mapping to
+ *
+ * KSM pages are mapped at unrelated addresses of unrelated vmas, so they
+ * have no anon_vma and no index: they are never on the LRU, and are only
+ * found again through ksmd's own tables.
+ *
+ * The caller needs to hold the mm->page_table_lock.
+ */
+void page_add_ksm_rmap(struct page *page)
+{
+	if (atomic_inc_and_test(&page->_mapcount))
+		inc_page_state(nr_mapped);
+}
+
 /**
  * page_remove_rmap - take down pte mapping from a page
  * @page: page to remove mapping from
@@ -513,7 +543,8 @@ void page_remove_rmap(struct page *page)
  * 		page:	һָĿҳָ롣ҳзӳ䡣
  *		vma:	ָָ롣
  */
-static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma)
+static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
+			    int ignore_refs)
 {
 	struct mm_struct *mm = vma->vm_mm;
 	unsigned long address;
@@ -560,6 +591,10 @@ static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma)
 	if (!pmd_present(*pmd))
 		goto out_unlock;
 
+	/* Reclaim works on small pages: break the huge mapping up first */
+	if (pmd_trans_huge(*pmd))
+		split_huge_pmd(mm, pmd);
+
 	pte = pte_offset_map(pmd, address);
 	if (!pte_present(*pte))
 		goto out_unmap;
@@ -585,8 +620,13 @@ static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma)
 	 * ֤߱ġ
 	 * ҳеķʱ־λǷ0ûУ0SWAP_FAILñ־λʾҳʹãܱա
 	 */
-	if ((vma->vm_flags & (VM_LOCKED|VM_RESERVED)) ||
-			ptep_clear_flush_young(vma, address, pte)) {
+	if (vma->vm_flags & VM_LOCKED) {
+		ret = SWAP_MLOCK;
+		goto out_unmap;
+	}
+	if ((vma->vm_flags & VM_RESERVED) ||
+			(!ignore_refs &&
+			 ptep_clear_flush_young(vma, address, pte))) {
 		ret = SWAP_FAIL;
 		goto out_unmap;
 	}
@@ -787,7 +827,7 @@ out_unlock:
  * ҳʱPFRAɨanon_vmaеϸǷÿ򶼴һҳҳӦҳĿҳ
  * ĿҳΪ
  */
-static int try_to_unmap_anon(struct page *page)
+static int try_to_unmap_anon(struct page *page, int ignore_refs)
 {
 	struct anon_vma *anon_vma;
 	struct vm_area_struct *vma;
@@ -807,11 +847,11 @@ static int try_to_unmap_anon(struct page *page)
 	 * anon_vmaеÿһvmatry_to_unmap_one
 	 */
 	list_for_each_entry(vma, &anon_vma->head, anon_vma_node) {
-		ret = try_to_unmap_one(page, vma);
+		ret = try_to_unmap_one(page, vma, ignore_refs);
 		/**
-		 * ĳԭ򷵻ֵΪSWAP_FAILҳ_mapcountֶαѾҵøҳҳֹͣɨ衣
+		 * ĳԭ򷵻ֵΪSWAP_FAILSWAP_MLOCKҳ_mapcountֶαѾҵøҳҳֹͣɨ衣
 		 */
-		if (ret == SWAP_FAIL || !page_mapped(page))
+		if (ret == SWAP_FAIL || ret == SWAP_MLOCK || !page_mapped(page))
 			break;
 	}
 	/**
@@ -833,7 +873,7 @@ static int try_to_unmap_anon(struct page *page)
 /**
  * try_to_unmapãִӳҳķӳ䡣
  */
-static int try_to_unmap_file(struct page *page)
+static int try_to_unmap_file(struct page *page, int ignore_refs)
 {
 	struct address_space *mapping = page->mapping;
 	pgoff_t pgoff = page->index << (PAGE_CACHE_SHIFT - PAGE_SHIFT);
@@ -854,11 +894,11 @@ static int try_to_unmap_file(struct page *page)
 	 * Էֵÿһvm_area_structtry_unmap_oneԶԸҳڵҳ0.
 	 */
 	vma_prio_tree_foreach(vma, &iter, &mapping->i_mmap, pgoff, pgoff) {
-		ret = try_to_unmap_one(page, vma);
+		ret = try_to_unmap_one(page, vma, ignore_refs);
 		/**
 		 * ҳ_mapcountֶαøҳҳѾҵִ߳󣬾ͽ̡
 		 */
-		if (ret == SWAP_FAIL || !page_mapped(page))
+		if (ret == SWAP_FAIL || ret == SWAP_MLOCK || !page_mapped(page))
 			goto out;
 	}
 
@@ -872,6 +912,15 @@ static int try_to_unmap_file(struct page *page)
 	if (list_empty(&mapping->i_mmap_nonlinear))
 		goto out;
 
+	/*
+	 * The nonlinear scan below unmaps whatever it comes across, which
+	 * is of no use to a caller who wants this particular page gone.
+	 */
+	if (ignore_refs) {
+		ret = SWAP_FAIL;
+		goto out;
+	}
+
 	/**
 	 * ӳ
 	 */
@@ -959,14 +1008,17 @@ out:
 /**
  * try_to_unmap - try to remove all page table mappings to a page
  * @page: the page to get unmapped
+ * @ignore_refs: unmap even if the ptes were recently referenced
  *
  * Tries to remove all the page table entries which are mapping this
- * page, used in the pageout path.  Caller must hold the page lock.
+ * page, used in the pageout path and, with @ignore_refs set, by memory
+ * compaction to move the page elsewhere.  Caller must hold the page lock.
  * Return values are:
  *
  * SWAP_SUCCESS	- we succeeded in removing all mappings
  * SWAP_AGAIN	- we missed a mapping, try again later
  * SWAP_FAIL	- the page is unswappable
+ * SWAP_MLOCK	- the page is mapped by an mlocked vma
  */
 /**
  * ҳָΪøҳӦҳҳ
@@ -974,7 +1026,7 @@ out:
  *		ЩòSWAP_AGAIN
  *		SWAP_FAIL
  */
-int try_to_unmap(struct page *page)
+int try_to_unmap(struct page *page, int ignore_refs)
 {
 	int ret;
 
@@ -982,11 +1034,147 @@ int try_to_unmap(struct page *page)
 	BUG_ON(!PageLocked(page));
 
 	if (PageAnon(page))
-		ret = try_to_unmap_anon(page);
+		ret = try_to_unmap_anon(page, ignore_refs);
 	else
-		ret = try_to_unmap_file(page);
+		ret = try_to_unmap_file(page, ignore_refs);
 
 	if (!page_mapped(page))
 		ret = SWAP_SUCCESS;
 	return ret;
 }
+
+/*
+ * Subfunction of try_to_remap_anon: switch the pte mapping @page in @vma
+ * over to @newpage.  The old pte is cleared and flushed before the copy,
+ * so no write through it can slip in behind our back.
+ */
+static int try_to_remap_one(struct page *page, struct page *newpage,
+			    struct vm_area_struct *vma)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long address;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *pte;
+	pte_t pteval, entry;
+	int ret = SWAP_AGAIN;
+
+	if (!mm->rss)
+		goto out;
+	address = vma_address(page, vma);
+	if (address == -EFAULT)
+		goto out;
+
+	spin_lock(&mm->page_table_lock);
+
+	pgd = pgd_offset(mm, address);
+	if (!pgd_present(*pgd))
+		goto out_unlock;
+
+	pud = pud_offset(pgd, address);
+	if (!pud_present(*pud))
+		goto out_unlock;
+
+	pmd = pmd_offset(pud, address);
+	if (!pmd_present(*pmd))
+		goto out_unlock;
+
+	/* Moving a piece of a huge page would only fragment it. */
+	if (pmd_trans_huge(*pmd)) {
+		ret = SWAP_FAIL;
+		goto out_unlock;
+	}
+
+	pte = pte_offset_map(pmd, address);
+	if (!pte_present(*pte))
+		goto out_unmap;
+
+	if (page_to_pfn(page) != pte_pfn(*pte))
+		goto out_unmap;
+
+	if (vma->vm_flags & VM_RESERVED) {
+		ret = SWAP_FAIL;
+		goto out_unmap;
+	}
+
+	/*
+	 * Only the pte and the caller may hold the page.  get_user_pages
+	 * raises the count under page_table_lock, so once we have checked
+	 * here nobody else can get at the old page.
+	 */
+	if (page_count(page) != 2) {
+		ret = SWAP_FAIL;
+		goto out_unmap;
+	}
+
+	flush_cache_page(vma, address);
+	pteval = ptep_clear_flush(vma, address, pte);
+
+	copy_highpage(newpage, page);
+
+	entry = mk_pte(newpage, vma->vm_page_prot);
+	if (pte_write(pteval))
+		entry = pte_mkwrite(entry);
+	if (pte_dirty(pteval))
+		entry = pte_mkdirty(entry);
+	if (pte_young(pteval))
+		entry = pte_mkyoung(entry);
+
+	get_page(newpage);
+	page_add_anon_rmap(newpage, vma, address);
+	mm->anon_rss--;		/* page_add_anon_rmap counted it again */
+	set_pte(pte, entry);
+	update_mmu_cache(vma, address, entry);
+
+	page_remove_rmap(page);
+	page_cache_release(page);
+	ret = SWAP_SUCCESS;
+
+out_unmap:
+	pte_unmap(pte);
+out_unlock:
+	spin_unlock(&mm->page_table_lock);
+out:
+	return ret;
+}
+
+/**
+ * try_to_remap_anon - move an anonymous page to a new page frame
+ * @page: the page to move
+ * @newpage: the page to move it to
+ *
+ * An anonymous page outside the swap cache has no handle other than its
+ * pte, so instead of unmapping it we point the pte at @newpage, copying
+ * the contents on the way.  Only pages mapped by a single pte are handled:
+ * forked pages are shared by several mms and are left alone.  The caller
+ * holds the lock and a reference on both pages.
+ *
+ * SWAP_SUCCESS	- the pte now maps @newpage, @page is unmapped
+ * SWAP_AGAIN	- the page went away or moved under us
+ * SWAP_FAIL	- the page cannot be moved
+ */
+int try_to_remap_anon(struct page *page, struct page *newpage)
+{
+	struct anon_vma *anon_vma;
+	struct vm_area_struct *vma;
+	int ret = SWAP_AGAIN;
+
+	BUG_ON(PageReserved(page));
+	BUG_ON(!PageLocked(page));
+
+	if (!PageAnon(page) || PageSwapCache(page) || page_mapcount(page) != 1)
+		return SWAP_FAIL;
+
+	anon_vma = page_lock_anon_vma(page);
+	if (!anon_vma)
+		return ret;
+
+	list_for_each_entry(vma, &anon_vma->head, anon_vma_node) {
+		ret = try_to_remap_one(page, newpage, vma);
+		if (ret != SWAP_AGAIN || !page_mapped(page))
+			break;
+	}
+	spin_unlock(&anon_vma->lock);
+	return ret;
+}
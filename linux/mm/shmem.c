@@ -369,7 +369,8 @@ static swp_entry_t *shmem_swp_alloc(struct shmem_inode_info *info, unsigned long
 		}
 
 		spin_unlock(&info->lock);
-		page = shmem_dir_alloc(mapping_gfp_mask(inode->i_mapping) | __GFP_ZERO);
+		page = shmem_dir_alloc((mapping_gfp_mask(inode->i_mapping) &
+				~__GFP_MOVABLE) | __GFP_ZERO);
 		if (page) {
 			page->nr_swapped = 0;
 		}
@@ -1109,6 +1110,7 @@ repeat:
 				error = -ENOMEM;
 				goto failed;
 			}
+			SetPageSwapBacked(filepage);
 
 			spin_lock(&info->lock);
 			entry = shmem_swp_alloc(info, idx, sgp);
@@ -92,6 +92,7 @@
 #include	<linux/sysctl.h>
 #include	<linux/module.h>
 #include	<linux/rcupdate.h>
+#include	<linux/nodemask.h>
 
 #include	<asm/uaccess.h>
 #include	<asm/cacheflush.h>
@@ -235,6 +236,10 @@ struct slab {
 	 * slabһж±ꡣûʣ¿жΪBUFCT_END
 	 */
 	kmem_bufctl_t		free;
+	/**
+	 * slabڵĽڵkmem_list3Ľڵš
+	 */
+	unsigned short		nodeid;
 };
 
 /*
@@ -293,6 +298,10 @@ struct array_cache {
 	 * ʹùΪ1
 	 */
 	unsigned int touched;
+	/**
+	 * alien档ÿCPUػ͹治ʹ
+	 */
+	spinlock_t lock;
 };
 
 /* bootstrap: The caches do not work without cpuarrays anymore,
@@ -305,11 +314,15 @@ struct arraycache_init {
 };
 
 /*
- * The slab lists of all objects.
+ * The slab lists of all objects, one set per node.
  * Hopefully reduce the internal fragmentation
- * NUMA: The spinlock could be moved from the kmem_cache_t
- * into this structure, too. Figure out what causes
- * fewer cross-node spinlock operations.
+ *
+ * Each node's lists have their own lock, so that cpus only contend with
+ * the cpus of their own node.  A slab always stays on the lists of the
+ * node it was grown for (slabp->nodeid).  Objects freed on another node
+ * are collected in that node's "alien" cache for the home node and go
+ * back in batches, so that the home node's lock is taken once per batch
+ * instead of once per object.
  */
 /**
  * slabٻǶṹ
@@ -341,20 +354,46 @@ struct kmem_list3 {
 	 * ĳʼСbatchcountֶε8
 	 */
 	struct array_cache	*shared;
+	/**
+	 * ڵͷŵġڵĶ󣬰ڵ㻺黹
+	 */
+	struct array_cache	**alien;
+	/**
+	 * ڵпжޡ
+	 */
+	unsigned int		free_limit;
+	/**
+	 * ڵ͹档
+	 */
+	spinlock_t		list_lock;
 };
 
-#define LIST3_INIT(parent) \
-	{ \
-		.slabs_full	= LIST_HEAD_INIT(parent.slabs_full), \
-		.slabs_partial	= LIST_HEAD_INIT(parent.slabs_partial), \
-		.slabs_free	= LIST_HEAD_INIT(parent.slabs_free) \
-	}
-#define list3_data(cachep) \
-	(&(cachep)->lists)
+/*
+ * Need this for bootstrapping a per node allocator: the kmem_list3
+ * structures are allocated from the general caches, which need
+ * kmem_list3 structures themselves.
+ */
+#define NUM_INIT_LISTS (2 * MAX_NUMNODES + 1)
+static struct kmem_list3 __initdata initkmem_list3[NUM_INIT_LISTS];
+#define	CACHE_CACHE 0
+#define	SIZE_AC 1
+#define	SIZE_L3 (1 + MAX_NUMNODES)
 
-/* NUMA: per-node */
-#define list3_data_ptr(cachep, ptr) \
-		list3_data(cachep)
+static void kmem_list3_init(struct kmem_list3 *parent)
+{
+	INIT_LIST_HEAD(&parent->slabs_full);
+	INIT_LIST_HEAD(&parent->slabs_partial);
+	INIT_LIST_HEAD(&parent->slabs_free);
+	parent->shared = NULL;
+	parent->alien = NULL;
+	spin_lock_init(&parent->list_lock);
+	parent->free_objects = 0;
+	parent->free_touched = 0;
+}
+
+/* The lists of the node the current cpu belongs to */
+#define list3_data(cachep) \
+	((cachep)->nodelists[numa_node_id()])
 
 /*
  * kmem_cache_t
@@ -378,12 +417,15 @@ struct kmem_cache_s {
 	 * ظٻпжĿɵ
 	 */
 	unsigned int		limit;
+	/**
+	 * ÿڵ㹲ĴСbatchcountΪλ
+	 */
+	unsigned int		shared;
 /* 2) touched by every alloc & free from the backend */
 	/**
-	 * ΪʲôҪŵһ?
+	 * ÿڵһslab
 	 */
-	struct kmem_list3	lists;
-	/* NUMA: kmem_3list_t	*nodelists[MAX_NUMNODES] */
+	struct kmem_list3	*nodelists[MAX_NUMNODES];
 	/**
 	 * ٻаĶĴС
 	 */
@@ -397,11 +439,7 @@ struct kmem_cache_s {
 	 */
 	unsigned int		num;	/* # of objs per slab */
 	/**
-	 * slabٻпжޡ
-	 */
-	unsigned int		free_limit; /* upper limit of objects in the lists */
-	/**
-	 * ٻ
+	 * ٻcolour_nextͿɵslabɸڵlist_lock
 	 */
 	spinlock_t		spinlock;
 
@@ -478,6 +516,7 @@ struct kmem_cache_s {
 	unsigned long 		errors;
 	unsigned long		max_freeable;
 	unsigned long		node_allocs;
+	unsigned long		node_frees;
 	atomic_t		allochit;
 	atomic_t		allocmiss;
 	atomic_t		freehit;
@@ -519,6 +558,7 @@ struct kmem_cache_s {
 				} while (0)
 #define	STATS_INC_ERR(x)	((x)->errors++)
 #define	STATS_INC_NODEALLOCS(x)	((x)->node_allocs++)
+#define	STATS_INC_NODEFREES(x)	((x)->node_frees++)
 #define	STATS_SET_FREEABLE(x, i) \
 				do { if ((x)->max_freeable < i) \
 					(x)->max_freeable = i; \
@@ -537,6 +577,7 @@ struct kmem_cache_s {
 #define	STATS_SET_HIGH(x)	do { } while (0)
 #define	STATS_INC_ERR(x)	do { } while (0)
 #define	STATS_INC_NODEALLOCS(x)	do { } while (0)
+#define	STATS_INC_NODEFREES(x)	do { } while (0)
 #define	STATS_SET_FREEABLE(x, i) \
 				do { } while (0)
 
@@ -678,7 +719,6 @@ static struct arraycache_init initarray_generic =
  * һͨٻ
  */
 static kmem_cache_t cache_cache = {
-	.lists		= LIST3_INIT(cache_cache.lists),
 	.batchcount	= 1,
 	.limit		= BOOT_CPUCACHE_ENTRIES,
 	.objsize	= sizeof(kmem_cache_t),
@@ -712,7 +752,8 @@ EXPORT_SYMBOL(slab_reclaim_pages);
  */
 static enum {
 	NONE,
-	PARTIAL,
+	PARTIAL_AC,
+	PARTIAL_L3,
 	FULL
 } g_cpucache_up;
 
@@ -721,7 +762,7 @@ static enum {
  */
 static DEFINE_PER_CPU(struct work_struct, reap_work);
 
-static void free_block(kmem_cache_t* cachep, void** objpp, int len);
+static void free_block(kmem_cache_t* cachep, void** objpp, int len, int node);
 static void enable_cpucache (kmem_cache_t *cachep);
 static void cache_reap (void *unused);
 
@@ -810,14 +851,14 @@ static void __devinit start_cpu_timer(int cpu)
 	}
 }
 
-static struct array_cache *alloc_arraycache(int cpu, int entries, int batchcount)
+static struct array_cache *alloc_arraycache(int node, int entries, int batchcount)
 {
 	int memsize = sizeof(void*)*entries+sizeof(struct array_cache);
 	struct array_cache *nc = NULL;
 
-	if (cpu != -1) {
+	if (node != -1) {
 		nc = kmem_cache_alloc_node(kmem_find_general_cachep(memsize,
-					GFP_KERNEL), cpu_to_node(cpu));
+					GFP_KERNEL), node);
 	}
 	if (!nc)
 		nc = kmalloc(memsize, GFP_KERNEL);
@@ -826,16 +867,136 @@ static struct array_cache *alloc_arraycache(int cpu, int entries, int batchcount
 		nc->limit = entries;
 		nc->batchcount = batchcount;
 		nc->touched = 0;
+		spin_lock_init(&nc->lock);
 	}
 	return nc;
 }
 
+/*
+ * Point a cache being created during bootstrap at the static lists
+ * starting at index, one per online node.
+ */
+static void set_up_list3s(kmem_cache_t *cachep, int index)
+{
+	int node;
+
+	for_each_online_node(node) {
+		struct kmem_list3 *l3 = &initkmem_list3[index + node];
+
+		l3->next_reap = jiffies + REAPTIMEOUT_LIST3 +
+				((unsigned long)cachep)%REAPTIMEOUT_LIST3;
+		l3->free_limit = (1 + nr_cpus_node(node))*cachep->batchcount +
+				cachep->num;
+		cachep->nodelists[node] = l3;
+	}
+}
+
+static struct kmem_list3 *alloc_kmem_list3(kmem_cache_t *cachep, int node)
+{
+	struct kmem_list3 *l3;
+
+	l3 = kmem_cache_alloc_node(kmem_find_general_cachep(
+			sizeof(struct kmem_list3), GFP_KERNEL), node);
+	if (l3) {
+		kmem_list3_init(l3);
+		l3->next_reap = jiffies + REAPTIMEOUT_LIST3 +
+				((unsigned long)cachep)%REAPTIMEOUT_LIST3;
+		l3->free_limit = (1 + nr_cpus_node(node))*cachep->batchcount +
+				cachep->num;
+	}
+	return l3;
+}
+
+#ifdef CONFIG_NUMA
+/*
+ * Alien caches: one small array per remote node, holding objects of
+ * that node which were freed on this node.
+ */
+#define ALIEN_LIMIT	12
+
+static struct array_cache **alloc_alien_cache(int node, int limit)
+{
+	struct array_cache **ac_ptr;
+	int memsize = sizeof(void*)*MAX_NUMNODES;
+	int i;
+
+	if (limit > 1)
+		limit = ALIEN_LIMIT;
+	ac_ptr = kmem_cache_alloc_node(kmem_find_general_cachep(memsize,
+					GFP_KERNEL), node);
+	if (!ac_ptr)
+		return NULL;
+	for (i = 0; i < MAX_NUMNODES; i++) {
+		if (i == node || !node_online(i)) {
+			ac_ptr[i] = NULL;
+			continue;
+		}
+		ac_ptr[i] = alloc_arraycache(node, limit, 0xbaadf00d);
+		if (!ac_ptr[i]) {
+			for (i--; i >= 0; i--)
+				kfree(ac_ptr[i]);
+			kfree(ac_ptr);
+			return NULL;
+		}
+	}
+	return ac_ptr;
+}
+
+static void free_alien_cache(struct array_cache **ac_ptr)
+{
+	int i;
+
+	if (!ac_ptr)
+		return;
+	for (i = 0; i < MAX_NUMNODES; i++)
+		kfree(ac_ptr[i]);
+	kfree(ac_ptr);
+}
+
+/* Give the objects in @ac back to their home @node. ac->lock held. */
+static void __drain_alien_cache(kmem_cache_t *cachep,
+				struct array_cache *ac, int node)
+{
+	struct kmem_list3 *rl3 = cachep->nodelists[node];
+
+	if (ac->avail) {
+		spin_lock(&rl3->list_lock);
+		free_block(cachep, ac_entry(ac), ac->avail, node);
+		ac->avail = 0;
+		spin_unlock(&rl3->list_lock);
+	}
+}
+
+static void drain_alien_cache(kmem_cache_t *cachep, struct kmem_list3 *l3)
+{
+	struct array_cache *ac;
+	unsigned long flags;
+	int i;
+
+	if (!l3->alien)
+		return;
+	for (i = 0; i < MAX_NUMNODES; i++) {
+		ac = l3->alien[i];
+		if (ac) {
+			spin_lock_irqsave(&ac->lock, flags);
+			__drain_alien_cache(cachep, ac, i);
+			spin_unlock_irqrestore(&ac->lock, flags);
+		}
+	}
+}
+#else
+#define drain_alien_cache(cachep, l3) do { } while (0)
+#define free_alien_cache(ac_ptr) do { } while (0)
+#endif
+
 static int __devinit cpuup_callback(struct notifier_block *nfb,
 				  unsigned long action,
 				  void *hcpu)
 {
 	long cpu = (long)hcpu;
+	int node = cpu_to_node(cpu);
 	kmem_cache_t* cachep;
+	struct kmem_list3 *l3;
 
 	switch (action) {
 	case CPU_UP_PREPARE:
@@ -843,16 +1004,47 @@ static int __devinit cpuup_callback(struct notifier_block *nfb,
 		list_for_each_entry(cachep, &cache_chain, next) {
 			struct array_cache *nc;
 
-			nc = alloc_arraycache(cpu, cachep->limit, cachep->batchcount);
+			/* The first cpu of a node may have to set up its lists. */
+			l3 = cachep->nodelists[node];
+			if (!l3) {
+				l3 = alloc_kmem_list3(cachep, node);
+				if (!l3)
+					goto bad;
+				cachep->nodelists[node] = l3;
+			}
+
+			nc = alloc_arraycache(node, cachep->limit, cachep->batchcount);
 			if (!nc)
 				goto bad;
 
-			spin_lock_irq(&cachep->spinlock);
+			spin_lock_irq(&l3->list_lock);
 			cachep->array[cpu] = nc;
-			cachep->free_limit = (1+num_online_cpus())*cachep->batchcount
+			l3->free_limit = (1 + nr_cpus_node(node))*cachep->batchcount
 						+ cachep->num;
-			spin_unlock_irq(&cachep->spinlock);
-
+			spin_unlock_irq(&l3->list_lock);
+
+			if (!l3->shared && cachep->shared) {
+				nc = alloc_arraycache(node,
+					cachep->shared*cachep->batchcount,
+					0xbaadf00d);
+				if (!nc)
+					goto bad;
+				spin_lock_irq(&l3->list_lock);
+				l3->shared = nc;
+				spin_unlock_irq(&l3->list_lock);
+			}
+#ifdef CONFIG_NUMA
+			if (!l3->alien) {
+				struct array_cache **alien;
+
+				alien = alloc_alien_cache(node, cachep->limit);
+				if (!alien)
+					goto bad;
+				spin_lock_irq(&l3->list_lock);
+				l3->alien = alien;
+				spin_unlock_irq(&l3->list_lock);
+			}
+#endif
 		}
 		up(&cache_chain_sem);
 		break;
@@ -867,14 +1059,32 @@ static int __devinit cpuup_callback(struct notifier_block *nfb,
 
 		list_for_each_entry(cachep, &cache_chain, next) {
 			struct array_cache *nc;
+			cpumask_t mask;
+
+			l3 = cachep->nodelists[node];
+			if (!l3)
+				continue;
+			cpus_and(mask, node_to_cpumask(node), cpu_online_map);
 
-			spin_lock_irq(&cachep->spinlock);
+			spin_lock_irq(&l3->list_lock);
 			/* cpu is dead; no one can alloc from it. */
 			nc = cachep->array[cpu];
 			cachep->array[cpu] = NULL;
-			cachep->free_limit -= cachep->batchcount;
-			free_block(cachep, ac_entry(nc), nc->avail);
-			spin_unlock_irq(&cachep->spinlock);
+			l3->free_limit -= cachep->batchcount;
+			if (nc)
+				free_block(cachep, ac_entry(nc), nc->avail, node);
+			/*
+			 * Last cpu of the node: nobody would drain the
+			 * node's shared and alien caches any more.
+			 */
+			if (cpus_empty(mask) && l3->shared) {
+				free_block(cachep, ac_entry(l3->shared),
+						l3->shared->avail, node);
+				l3->shared->avail = 0;
+			}
+			spin_unlock_irq(&l3->list_lock);
+			if (cpus_empty(mask))
+				drain_alien_cache(cachep, l3);
 			kfree(nc);
 		}
 		up(&cache_chain_sem);
@@ -895,11 +1105,50 @@ static struct notifier_block cpucache_notifier = { &cpuup_callback, NULL, 0 };
 /**
  * ͨٻ档
  */
+static int __init kmalloc_index(size_t size)
+{
+	int i = 0;
+
+	while (malloc_sizes[i].cs_size && size > malloc_sizes[i].cs_size)
+		i++;
+	return i;
+}
+
+/*
+ * Swap a static bootstrap kmem_list3 for a kmalloc'ed one.
+ */
+static void __init init_list(kmem_cache_t *cachep, struct kmem_list3 *list,
+			     int nodeid)
+{
+	struct kmem_list3 *ptr;
+
+	ptr = kmem_cache_alloc_node(kmem_find_general_cachep(
+			sizeof(struct kmem_list3), GFP_KERNEL), nodeid);
+	BUG_ON(!ptr);
+
+	local_irq_disable();
+	memcpy(ptr, list, sizeof(struct kmem_list3));
+	INIT_LIST_HEAD(&ptr->slabs_full);
+	list_splice(&list->slabs_full, &ptr->slabs_full);
+	INIT_LIST_HEAD(&ptr->slabs_partial);
+	list_splice(&list->slabs_partial, &ptr->slabs_partial);
+	INIT_LIST_HEAD(&ptr->slabs_free);
+	list_splice(&list->slabs_free, &ptr->slabs_free);
+	spin_lock_init(&ptr->list_lock);
+	cachep->nodelists[nodeid] = ptr;
+	local_irq_enable();
+}
+
 void __init kmem_cache_init(void)
 {
 	size_t left_over;
 	struct cache_sizes *sizes;
 	struct cache_names *names;
+	int index_ac, index_l3;
+	int i;
+
+	for (i = 0; i < NUM_INIT_LISTS; i++)
+		kmem_list3_init(&initkmem_list3[i]);
 
 	/*
 	 * Fragmentation resistance on low memory - only use bigger
@@ -916,13 +1165,17 @@ void __init kmem_cache_init(void)
 	 *    is statically allocated.
 	 *    Initially an __init data area is used for the head array, it's
 	 *    replaced with a kmalloc allocated array at the end of the bootstrap.
-	 * 2) Create the first kmalloc cache.
-	 *    The kmem_cache_t for the new cache is allocated normally. An __init
-	 *    data area is used for the head array.
-	 * 3) Create the remaining kmalloc caches, with minimally sized head arrays.
+	 *    Its kmem_list3 is a static __init one as well.
+	 * 2) Create the kmalloc cache the head arrays come from, then the one
+	 *    the kmem_list3 structures come from.  The kmem_cache_t for the
+	 *    new caches is allocated normally.  __init data areas are used
+	 *    for the head array and the kmem_list3s.
+	 * 3) Create the remaining kmalloc caches, with minimally sized head
+	 *    arrays and kmalloc allocated kmem_list3s.
 	 * 4) Replace the __init data head arrays for cache_cache and the first
 	 *    kmalloc cache with kmalloc allocated arrays.
-	 * 5) Resize the head arrays of the kmalloc caches to their final sizes.
+	 * 5) Replace the __init data kmem_list3s the same way.
+	 * 6) Resize the head arrays of the kmalloc caches to their final sizes.
 	 */
 
 	/* 1) create the cache_cache */
@@ -931,6 +1184,7 @@ void __init kmem_cache_init(void)
 	list_add(&cache_cache.next, &cache_chain);
 	cache_cache.colour_off = cache_line_size();
 	cache_cache.array[smp_processor_id()] = &initarray_cache.cache;
+	cache_cache.nodelists[numa_node_id()] = &initkmem_list3[CACHE_CACHE];
 
 	cache_cache.objsize = ALIGN(cache_cache.objsize, cache_line_size());
 
@@ -947,6 +1201,18 @@ void __init kmem_cache_init(void)
 	/* 2+3) create the kmalloc caches */
 	sizes = malloc_sizes;
 	names = cache_names;
+	index_ac = kmalloc_index(sizeof(struct arraycache_init));
+	index_l3 = kmalloc_index(sizeof(struct kmem_list3));
+
+	sizes[index_ac].cs_cachep = kmem_cache_create(names[index_ac].name,
+		sizes[index_ac].cs_size, ARCH_KMALLOC_MINALIGN,
+		(ARCH_KMALLOC_FLAGS | SLAB_PANIC), NULL, NULL);
+	if (index_ac == index_l3)
+		g_cpucache_up = PARTIAL_L3;
+	else
+		sizes[index_l3].cs_cachep = kmem_cache_create(names[index_l3].name,
+			sizes[index_l3].cs_size, ARCH_KMALLOC_MINALIGN,
+			(ARCH_KMALLOC_FLAGS | SLAB_PANIC), NULL, NULL);
 
 	while (sizes->cs_size) {
 		/* For performance, all the general caches are L1 aligned.
@@ -954,9 +1220,10 @@ void __init kmem_cache_init(void)
 		 * eliminates "false sharing".
 		 * Note for systems short on memory removing the alignment will
 		 * allow tighter packing of the smaller caches. */
-		sizes->cs_cachep = kmem_cache_create(names->name,
-			sizes->cs_size, ARCH_KMALLOC_MINALIGN,
-			(ARCH_KMALLOC_FLAGS | SLAB_PANIC), NULL, NULL);
+		if (!sizes->cs_cachep)
+			sizes->cs_cachep = kmem_cache_create(names->name,
+				sizes->cs_size, ARCH_KMALLOC_MINALIGN,
+				(ARCH_KMALLOC_FLAGS | SLAB_PANIC), NULL, NULL);
 
 		/* Inc off-slab bufctl limit until the ceiling is hit. */
 		if (!(OFF_SLAB(sizes->cs_cachep))) {
@@ -985,14 +1252,28 @@ void __init kmem_cache_init(void)
 	
 		ptr = kmalloc(sizeof(struct arraycache_init), GFP_KERNEL);
 		local_irq_disable();
-		BUG_ON(ac_data(malloc_sizes[0].cs_cachep) != &initarray_generic.cache);
-		memcpy(ptr, ac_data(malloc_sizes[0].cs_cachep),
+		BUG_ON(ac_data(malloc_sizes[index_ac].cs_cachep) != &initarray_generic.cache);
+		memcpy(ptr, ac_data(malloc_sizes[index_ac].cs_cachep),
 				sizeof(struct arraycache_init));
-		malloc_sizes[0].cs_cachep->array[smp_processor_id()] = ptr;
+		malloc_sizes[index_ac].cs_cachep->array[smp_processor_id()] = ptr;
 		local_irq_enable();
 	}
+	/* 5) Replace the bootstrap kmem_list3's */
+	{
+		int node;
+
+		init_list(&cache_cache, &initkmem_list3[CACHE_CACHE],
+				numa_node_id());
+		for_each_online_node(node) {
+			init_list(malloc_sizes[index_ac].cs_cachep,
+					&initkmem_list3[SIZE_AC+node], node);
+			if (index_ac != index_l3)
+				init_list(malloc_sizes[index_l3].cs_cachep,
+						&initkmem_list3[SIZE_L3+node], node);
+		}
+	}
 
-	/* 5) resize the head arrays to their final sizes */
+	/* 6) resize the head arrays to their final sizes */
 	{
 		kmem_cache_t *cachep;
 		down(&cache_chain_sem);
@@ -1051,6 +1332,8 @@ static void *kmem_getpages(kmem_cache_t *cachep, int flags, int nodeid)
 	void *addr;
 	int i;
 
+	/* Slab pages get the mobility of the cache, not of the caller */
+	flags &= ~GFP_MOVABLE_MASK;
 	flags |= cachep->gfpflags;
 	if (likely(nodeid == -1)) {
 		page = alloc_pages(flags, cachep->gfporder);
@@ -1611,12 +1894,10 @@ next:
 	cachep->gfpflags = 0;
 	if (flags & SLAB_CACHE_DMA)
 		cachep->gfpflags |= GFP_DMA;
+	if (flags & SLAB_RECLAIM_ACCOUNT)
+		cachep->gfpflags |= __GFP_RECLAIMABLE;
 	spin_lock_init(&cachep->spinlock);
 	cachep->objsize = size;
-	/* NUMA */
-	INIT_LIST_HEAD(&cachep->lists.slabs_full);
-	INIT_LIST_HEAD(&cachep->lists.slabs_partial);
-	INIT_LIST_HEAD(&cachep->lists.slabs_free);
 
 	if (flags & CFLGS_OFF_SLAB)
 		cachep->slabp_cache = kmem_find_general_cachep(slab_size,0);
@@ -1636,24 +1917,36 @@ next:
 			 * the creation of further caches will BUG().
 			 */
 			cachep->array[smp_processor_id()] = &initarray_generic.cache;
-			g_cpucache_up = PARTIAL;
+			cachep->batchcount = 1;
+			cachep->limit = BOOT_CPUCACHE_ENTRIES;
+			/* Its kmem_list3s can't be kmalloc'ed yet either */
+			set_up_list3s(cachep, SIZE_AC);
+			g_cpucache_up = PARTIAL_AC;
 		} else {
 			cachep->array[smp_processor_id()] = kmalloc(sizeof(struct arraycache_init),GFP_KERNEL);
+			cachep->batchcount = 1;
+			cachep->limit = BOOT_CPUCACHE_ENTRIES;
+			if (g_cpucache_up == PARTIAL_AC) {
+				/* This is the cache for the kmem_list3s */
+				set_up_list3s(cachep, SIZE_L3);
+				g_cpucache_up = PARTIAL_L3;
+			} else {
+				int node;
+
+				for_each_online_node(node) {
+					cachep->nodelists[node] =
+						alloc_kmem_list3(cachep, node);
+					BUG_ON(!cachep->nodelists[node]);
+				}
+			}
 		}
 		BUG_ON(!ac_data(cachep));
 		ac_data(cachep)->avail = 0;
 		ac_data(cachep)->limit = BOOT_CPUCACHE_ENTRIES;
 		ac_data(cachep)->batchcount = 1;
 		ac_data(cachep)->touched = 0;
-		cachep->batchcount = 1;
-		cachep->limit = BOOT_CPUCACHE_ENTRIES;
-		cachep->free_limit = (1+num_online_cpus())*cachep->batchcount
-					+ cachep->num;
 	} 
 
-	cachep->lists.next_reap = jiffies + REAPTIMEOUT_LIST3 +
-					((unsigned long)cachep)%REAPTIMEOUT_LIST3;
-
 	/* Need the semaphore to access the chain. */
 	down(&cache_chain_sem);
 	{
@@ -1710,13 +2003,22 @@ static void check_spinlock_acquired(kmem_cache_t *cachep)
 {
 #ifdef CONFIG_SMP
 	check_irq_off();
-	BUG_ON(spin_trylock(&cachep->spinlock));
+	BUG_ON(spin_trylock(&list3_data(cachep)->list_lock));
+#endif
+}
+
+static void check_spinlock_acquired_node(kmem_cache_t *cachep, int node)
+{
+#ifdef CONFIG_SMP
+	check_irq_off();
+	BUG_ON(spin_trylock(&cachep->nodelists[node]->list_lock));
 #endif
 }
 #else
 #define check_irq_off()	do { } while(0)
 #define check_irq_on()	do { } while(0)
 #define check_spinlock_acquired(x) do { } while(0)
+#define check_spinlock_acquired_node(x, y) do { } while(0)
 #endif
 
 /*
@@ -1738,68 +2040,91 @@ static void smp_call_function_all_cpus(void (*func) (void *arg), void *arg)
 }
 
 static void drain_array_locked(kmem_cache_t* cachep,
-				struct array_cache *ac, int force);
+			struct array_cache *ac, int force, int node);
 
 static void do_drain(void *arg)
 {
 	kmem_cache_t *cachep = (kmem_cache_t*)arg;
 	struct array_cache *ac;
+	int node = numa_node_id();
 
 	check_irq_off();
 	ac = ac_data(cachep);
-	spin_lock(&cachep->spinlock);
-	free_block(cachep, &ac_entry(ac)[0], ac->avail);
-	spin_unlock(&cachep->spinlock);
+	spin_lock(&cachep->nodelists[node]->list_lock);
+	free_block(cachep, &ac_entry(ac)[0], ac->avail, node);
+	spin_unlock(&cachep->nodelists[node]->list_lock);
 	ac->avail = 0;
 }
 
 static void drain_cpu_caches(kmem_cache_t *cachep)
 {
+	struct kmem_list3 *l3;
+	int node;
+
 	smp_call_function_all_cpus(do_drain, cachep);
 	check_irq_on();
-	spin_lock_irq(&cachep->spinlock);
-	if (cachep->lists.shared)
-		drain_array_locked(cachep, cachep->lists.shared, 1);
-	spin_unlock_irq(&cachep->spinlock);
+	for_each_online_node(node) {
+		l3 = cachep->nodelists[node];
+		if (!l3)
+			continue;
+		spin_lock_irq(&l3->list_lock);
+		if (l3->shared)
+			drain_array_locked(cachep, l3->shared, 1, node);
+		spin_unlock_irq(&l3->list_lock);
+		if (l3->alien)
+			drain_alien_cache(cachep, l3);
+	}
 }
 
-
-/* NUMA shrink all list3s */
-static int __cache_shrink(kmem_cache_t *cachep)
+static int __node_shrink(kmem_cache_t *cachep, int node)
 {
 	struct slab *slabp;
+	struct kmem_list3 *l3 = cachep->nodelists[node];
 	int ret;
 
-	drain_cpu_caches(cachep);
-
-	check_irq_on();
-	spin_lock_irq(&cachep->spinlock);
-
 	for(;;) {
 		struct list_head *p;
 
-		p = cachep->lists.slabs_free.prev;
-		if (p == &cachep->lists.slabs_free)
+		p = l3->slabs_free.prev;
+		if (p == &l3->slabs_free)
 			break;
 
-		slabp = list_entry(cachep->lists.slabs_free.prev, struct slab, list);
+		slabp = list_entry(l3->slabs_free.prev, struct slab, list);
 #if DEBUG
 		if (slabp->inuse)
 			BUG();
 #endif
 		list_del(&slabp->list);
 
-		cachep->lists.free_objects -= cachep->num;
-		spin_unlock_irq(&cachep->spinlock);
+		l3->free_objects -= cachep->num;
+		spin_unlock_irq(&l3->list_lock);
 		slab_destroy(cachep, slabp);
-		spin_lock_irq(&cachep->spinlock);
+		spin_lock_irq(&l3->list_lock);
 	}
-	ret = !list_empty(&cachep->lists.slabs_full) ||
-		!list_empty(&cachep->lists.slabs_partial);
-	spin_unlock_irq(&cachep->spinlock);
+	ret = !list_empty(&l3->slabs_full) ||
+		!list_empty(&l3->slabs_partial);
 	return ret;
 }
 
+static int __cache_shrink(kmem_cache_t *cachep)
+{
+	struct kmem_list3 *l3;
+	int ret = 0, node;
+
+	drain_cpu_caches(cachep);
+
+	check_irq_on();
+	for_each_online_node(node) {
+		l3 = cachep->nodelists[node];
+		if (l3) {
+			spin_lock_irq(&l3->list_lock);
+			ret += __node_shrink(cachep, node);
+			spin_unlock_irq(&l3->list_lock);
+		}
+	}
+	return (ret ? 1 : 0);
+}
+
 /**
  * kmem_cache_shrink - Shrink a cache.
  * @cachep: The cache to shrink.
@@ -1844,6 +2169,7 @@ EXPORT_SYMBOL(kmem_cache_shrink);
 int kmem_cache_destroy (kmem_cache_t * cachep)
 {
 	int i;
+	struct kmem_list3 *l3;
 
 	if (!cachep || in_interrupt())
 		BUG();
@@ -1878,8 +2204,13 @@ int kmem_cache_destroy (kmem_cache_t * cachep)
 		kfree(cachep->array[i]);
 
 	/* NUMA: free the list3 structures */
-	kfree(cachep->lists.shared);
-	cachep->lists.shared = NULL;
+	for_each_online_node(i) {
+		if ((l3 = cachep->nodelists[i])) {
+			kfree(l3->shared);
+			free_alien_cache(l3->alien);
+			kfree(l3);
+		}
+	}
 	kmem_cache_free(&cache_cache, cachep);
 
 	unlock_cpu_hotplug();
@@ -2011,11 +2342,12 @@ static int cache_grow (kmem_cache_t * cachep, int flags, int nodeid)
 	size_t		 offset;
 	int		 local_flags;
 	unsigned long	 ctor_flags;
+	struct kmem_list3 *l3;
 
 	/* Be lazy and only check for valid flags here,
  	 * keeping it out of the critical path in kmem_cache_alloc().
 	 */
-	if (flags & ~(SLAB_DMA|SLAB_LEVEL_MASK|SLAB_NO_GROW))
+	if (flags & ~(SLAB_DMA|SLAB_LEVEL_MASK|SLAB_NO_GROW|GFP_MOVABLE_MASK))
 		BUG();
 	if (flags & SLAB_NO_GROW)
 		return 0;
@@ -2072,6 +2404,9 @@ static int cache_grow (kmem_cache_t * cachep, int flags, int nodeid)
 	if (!(slabp = alloc_slabmgmt(cachep, objp, offset, local_flags)))
 		goto opps1;
 
+	/* The slab goes onto the lists of the node it was grown for. */
+	slabp->nodeid = nodeid == -1 ? numa_node_id() : nodeid;
+	l3 = cachep->nodelists[slabp->nodeid];
 	/**
 	 * set_slab_attrɨslabҳҳ
 	 * ٻslabĵֱַ𸳸ҳlruֶεnextprevֶ
@@ -2089,16 +2424,16 @@ static int cache_grow (kmem_cache_t * cachep, int flags, int nodeid)
 	if (local_flags & __GFP_WAIT)
 		local_irq_disable();
 	check_irq_off();
-	spin_lock(&cachep->spinlock);
+	spin_lock(&l3->list_lock);
 
 	/* Make slab active. */
 	/**
 	 * µõslabslabpӵٻcachepȫslabĩˡ¿ж
 	 */
-	list_add_tail(&slabp->list, &(list3_data(cachep)->slabs_free));
+	list_add_tail(&slabp->list, &(l3->slabs_free));
 	STATS_INC_GROWN(cachep);
-	list3_data(cachep)->free_objects += cachep->num;
-	spin_unlock(&cachep->spinlock);
+	l3->free_objects += cachep->num;
+	spin_unlock(&l3->list_lock);
 	return 1;
 opps1:
 	kmem_freepages(cachep, objp);
@@ -2258,9 +2593,9 @@ retry:
 
 	BUG_ON(ac->avail > 0);
 	/**
-	 * ȡspinlock
+	 * ȡڵspinlock
 	 */
-	spin_lock(&cachep->spinlock);
+	spin_lock(&l3->list_lock);
 	/**
 	 * slabٻظٻ
 	 */
@@ -2358,7 +2693,7 @@ alloc_done:
 	/**
 	 * ͷspinlock
 	 */
-	spin_unlock(&cachep->spinlock);
+	spin_unlock(&l3->list_lock);
 
 	/**
 	 * ûзκθٻ
@@ -2486,24 +2821,26 @@ static inline void * __cache_alloc (kmem_cache_t *cachep, int flags)
 	return objp;
 }
 
-/* 
- * NUMA: different approach needed if the spinlock is moved into
- * the l3 structure
+/*
+ * Caller needs to acquire the list_lock of the node the objects
+ * belong to.
  */
 /**
  * ڱظٻеnr_objects黹slab
+ * Щnodeڵ㡣
  */
-static void free_block(kmem_cache_t *cachep, void **objpp, int nr_objects)
+static void free_block(kmem_cache_t *cachep, void **objpp, int nr_objects,
+		       int node)
 {
 	int i;
+	struct kmem_list3 *l3 = cachep->nodelists[node];
 
-	check_spinlock_acquired(cachep);
+	check_spinlock_acquired_node(cachep, node);
 
-	/* NUMA: move add into loop */
 	/**
-	 * Ӹٻfree_objectsֶΡ
+	 * ӽڵfree_objectsֶΡ
 	 */
-	cachep->lists.free_objects += nr_objects;
+	l3->free_objects += nr_objects;
 
 	for (i = 0; i < nr_objects; i++) {
 		void *objp = objpp[i];
@@ -2515,9 +2852,12 @@ static void free_block(kmem_cache_t *cachep, void **objpp, int nr_objects)
 		 * Ǽpgslabҳ
 		 */
 		slabp = GET_PAGE_SLAB(virt_to_page(objp));
+#if DEBUG
+		BUG_ON(slabp->nodeid != node);
+#endif
 		/**
 		 * slabٻɾslab
-		 * cachep->lists.slabs_partialcachep->lists.slabs_full
+		 * l3->slabs_partiall3->slabs_full
 		 */
 		list_del(&slabp->list);
 		/**
@@ -2553,27 +2893,25 @@ static void free_block(kmem_cache_t *cachep, void **objpp, int nr_objects)
 		 */
 		if (slabp->inuse == 0) {
 			/**
-			 * slabٻпжĸ(cachep->lists.free_objects)cachep->free_limit
-			 * cachep->free_limitֶеֵͨcachep->num + (1 + CPU)*cachep->batchcount
+			 * Ҹýڵпжĸ(l3->free_objects)l3->free_limit
+			 * l3->free_limitֶеֵͨcachep->num + (1 + ڵCPU)*cachep->batchcount
 			 */
-			if (cachep->lists.free_objects > cachep->free_limit) {
+			if (l3->free_objects > l3->free_limit) {
 				/**
 				 * slabҳͷŵҳ
 				 */
-				cachep->lists.free_objects -= cachep->num;
+				l3->free_objects -= cachep->num;
 				slab_destroy(cachep, slabp);
 			} else {
 				/* slab뵽slabs_free */
-				list_add(&slabp->list,
-				&list3_data_ptr(cachep, objp)->slabs_free);
+				list_add(&slabp->list, &l3->slabs_free);
 			}
 		} else {/* inuse > 0,slab䣬slab뵽slabs_partial */
 			/* Unconditionally move a slab to the end of the
 			 * partial list on free - maximum time for the
 			 * other objects to be freed, too.
 			 */
-			list_add_tail(&slabp->list,
-				&list3_data_ptr(cachep, objp)->slabs_partial);
+			list_add_tail(&slabp->list, &l3->slabs_partial);
 		}
 	}
 }
@@ -2585,21 +2923,24 @@ static void free_block(kmem_cache_t *cachep, void **objpp, int nr_objects)
 static void cache_flusharray (kmem_cache_t* cachep, struct array_cache *ac)
 {
 	int batchcount;
+	struct kmem_list3 *l3;
+	int node = numa_node_id();
 
 	batchcount = ac->batchcount;
 #if DEBUG
 	BUG_ON(!batchcount || batchcount > ac->avail);
 #endif
 	check_irq_off();
+	l3 = cachep->nodelists[node];
 	/**
-	 * 
+	 * ñڵ
 	 */
-	spin_lock(&cachep->spinlock);
+	spin_lock(&l3->list_lock);
 	/**
 	 * һظٻ
 	 */
-	if (cachep->lists.shared) {
-		struct array_cache *shared_array = cachep->lists.shared;
+	if (l3->shared) {
+		struct array_cache *shared_array = l3->shared;
 		int max = shared_array->limit-shared_array->avail;
 		/**
 		 * ù滹û
@@ -2624,15 +2965,15 @@ static void cache_flusharray (kmem_cache_t* cachep, struct array_cache *ac)
 	/**
 	 * ǰڱظٻеac->batchcount黹slab
 	 */
-	free_block(cachep, &ac_entry(ac)[0], batchcount);
+	free_block(cachep, &ac_entry(ac)[0], batchcount, node);
 free_done:
 #if STATS
 	{
 		int i = 0;
 		struct list_head *p;
 
-		p = list3_data(cachep)->slabs_free.next;
-		while (p != &(list3_data(cachep)->slabs_free)) {
+		p = l3->slabs_free.next;
+		while (p != &(l3->slabs_free)) {
 			struct slab *slabp;
 
 			slabp = list_entry(p, struct slab, list);
@@ -2647,7 +2988,7 @@ free_done:
 	/**
 	 * ͷ
 	 */
-	spin_unlock(&cachep->spinlock);
+	spin_unlock(&l3->list_lock);
 	/**
 	 * ͨȥƵظٻͷŵslabĶĸ±ظٻavailֶ
 	 */
@@ -2674,6 +3015,41 @@ static inline void __cache_free (kmem_cache_t *cachep, void* objp)
 	check_irq_off();
 	objp = cache_free_debugcheck(cachep, objp, __builtin_return_address(0));
 
+	/* Make sure we are not freeing a object from another
+	 * node to the array cache on this cpu.
+	 */
+#ifdef CONFIG_NUMA
+	{
+		struct slab *slabp;
+		slabp = GET_PAGE_SLAB(virt_to_page(objp));
+		if (unlikely(slabp->nodeid != numa_node_id())) {
+			struct array_cache *alien = NULL;
+			int nodeid = slabp->nodeid;
+			struct kmem_list3 *l3 = list3_data(cachep);
+
+			STATS_INC_NODEFREES(cachep);
+			/**
+			 * Զ˽ڵĶȷŵڵalienУٳ黹
+			 */
+			if (l3->alien && l3->alien[nodeid]) {
+				alien = l3->alien[nodeid];
+				spin_lock(&alien->lock);
+				if (unlikely(alien->avail == alien->limit))
+					__drain_alien_cache(cachep,
+							alien, nodeid);
+				ac_entry(alien)[alien->avail++] = objp;
+				spin_unlock(&alien->lock);
+			} else {
+				spin_lock(&(cachep->nodelists[nodeid])->
+						list_lock);
+				free_block(cachep, &objp, 1, nodeid);
+				spin_unlock(&(cachep->nodelists[nodeid])->
+						list_lock);
+			}
+			return;
+		}
+	}
+#endif
 	/**
 	 * ȼ鱾ظٻǷпռָһжĶָ롣
 	 */
@@ -2772,52 +3148,44 @@ out:
  */
 void *kmem_cache_alloc_node(kmem_cache_t *cachep, int nodeid)
 {
-	int loop;
-	void *objp;
+	struct list_head *entry;
+	struct kmem_list3 *l3;
 	struct slab *slabp;
 	kmem_bufctl_t next;
+	void *objp;
+	int x;
 
-	for (loop = 0;;loop++) {
-		struct list_head *q;
-
-		objp = NULL;
-		check_irq_on();
-		spin_lock_irq(&cachep->spinlock);
-		/* walk through all partial and empty slab and find one
-		 * from the right node */
-		list_for_each(q,&cachep->lists.slabs_partial) {
-			slabp = list_entry(q, struct slab, list);
-
-			if (page_to_nid(virt_to_page(slabp->s_mem)) == nodeid ||
-					loop > 2)
-				goto got_slabp;
-		}
-		list_for_each(q, &cachep->lists.slabs_free) {
-			slabp = list_entry(q, struct slab, list);
-
-			if (page_to_nid(virt_to_page(slabp->s_mem)) == nodeid ||
-					loop > 2)
-				goto got_slabp;
-		}
-		spin_unlock_irq(&cachep->spinlock);
+	/*
+	 * The local node is served by the per-cpu arrays; so is any node
+	 * the cache has no lists for yet.
+	 */
+	if (nodeid == -1 || nodeid == numa_node_id() ||
+	    !cachep->nodelists[nodeid])
+		return __cache_alloc(cachep, GFP_KERNEL);
 
-		local_irq_disable();
-		if (!cache_grow(cachep, GFP_KERNEL, nodeid)) {
-			local_irq_enable();
-			return NULL;
-		}
-		local_irq_enable();
+	l3 = cachep->nodelists[nodeid];
+	check_irq_on();
+retry:
+	spin_lock_irq(&l3->list_lock);
+	entry = l3->slabs_partial.next;
+	if (entry == &l3->slabs_partial) {
+		l3->free_touched = 1;
+		entry = l3->slabs_free.next;
+		if (entry == &l3->slabs_free)
+			goto must_grow;
 	}
-got_slabp:
-	/* found one: allocate object */
+
+	slabp = list_entry(entry, struct slab, list);
+	check_spinlock_acquired_node(cachep, nodeid);
 	check_slabp(cachep, slabp);
-	check_spinlock_acquired(cachep);
 
 	STATS_INC_ALLOCED(cachep);
 	STATS_INC_ACTIVE(cachep);
 	STATS_SET_HIGH(cachep);
 	STATS_INC_NODEALLOCS(cachep);
 
+	BUG_ON(slabp->inuse == cachep->num);
+
 	objp = slabp->s_mem + slabp->free*cachep->objsize;
 
 	slabp->inuse++;
@@ -2827,20 +3195,27 @@ got_slabp:
 #endif
 	slabp->free = next;
 	check_slabp(cachep, slabp);
+	l3->free_objects--;
 
 	/* move slabp to correct slabp list: */
 	list_del(&slabp->list);
 	if (slabp->free == BUFCTL_END)
-		list_add(&slabp->list, &cachep->lists.slabs_full);
+		list_add(&slabp->list, &l3->slabs_full);
 	else
-		list_add(&slabp->list, &cachep->lists.slabs_partial);
-
-	list3_data(cachep)->free_objects--;
-	spin_unlock_irq(&cachep->spinlock);
+		list_add(&slabp->list, &l3->slabs_partial);
 
+	spin_unlock_irq(&l3->list_lock);
 	objp = cache_alloc_debugcheck_after(cachep, GFP_KERNEL, objp,
 					__builtin_return_address(0));
 	return objp;
+
+must_grow:
+	spin_unlock(&l3->list_lock);
+	x = cache_grow(cachep, GFP_KERNEL, nodeid);
+	local_irq_enable();
+	if (!x)
+		return NULL;
+	goto retry;
 }
 EXPORT_SYMBOL(kmem_cache_alloc_node);
 
@@ -3061,16 +3436,77 @@ static void do_ccupdate_local(void *info)
 }
 
 
+/*
+ * Make sure every online node has its kmem_list3, shared array and
+ * alien caches sized for the current tunables.
+ */
+static int alloc_kmemlist(kmem_cache_t *cachep)
+{
+	int node;
+	struct kmem_list3 *l3;
+	struct array_cache *new_shared;
+	struct array_cache **new_alien = NULL;
+
+	for_each_online_node(node) {
+#ifdef CONFIG_NUMA
+		new_alien = alloc_alien_cache(node, cachep->limit);
+		if (!new_alien)
+			goto fail;
+#endif
+		new_shared = NULL;
+		if (cachep->shared) {
+			new_shared = alloc_arraycache(node,
+					cachep->shared*cachep->batchcount,
+					0xbaadf00d);
+			if (!new_shared) {
+				free_alien_cache(new_alien);
+				goto fail;
+			}
+		}
+		if ((l3 = cachep->nodelists[node])) {
+			struct array_cache *shared = l3->shared;
+
+			spin_lock_irq(&l3->list_lock);
+			if (shared)
+				free_block(cachep, ac_entry(shared),
+						shared->avail, node);
+			l3->shared = new_shared;
+			if (!l3->alien) {
+				l3->alien = new_alien;
+				new_alien = NULL;
+			}
+			l3->free_limit = (1 + nr_cpus_node(node))*
+				cachep->batchcount + cachep->num;
+			spin_unlock_irq(&l3->list_lock);
+			kfree(shared);
+			free_alien_cache(new_alien);
+			continue;
+		}
+		l3 = alloc_kmem_list3(cachep, node);
+		if (!l3) {
+			kfree(new_shared);
+			free_alien_cache(new_alien);
+			goto fail;
+		}
+		l3->shared = new_shared;
+		l3->alien = new_alien;
+		cachep->nodelists[node] = l3;
+	}
+	return 0;
+fail:
+	return -ENOMEM;
+}
+
 static int do_tune_cpucache (kmem_cache_t* cachep, int limit, int batchcount, int shared)
 {
 	struct ccupdate_struct new;
-	struct array_cache *new_shared;
-	int i;
+	int i, err;
 
 	memset(&new.new,0,sizeof(new.new));
 	for (i = 0; i < NR_CPUS; i++) {
 		if (cpu_online(i)) {
-			new.new[i] = alloc_arraycache(i, limit, batchcount);
+			new.new[i] = alloc_arraycache(cpu_to_node(i), limit,
+						batchcount);
 			if (!new.new[i]) {
 				for (i--; i >= 0; i--) kfree(new.new[i]);
 				return -ENOMEM;
@@ -3087,31 +3523,27 @@ static int do_tune_cpucache (kmem_cache_t* cachep, int limit, int batchcount, in
 	spin_lock_irq(&cachep->spinlock);
 	cachep->batchcount = batchcount;
 	cachep->limit = limit;
-	cachep->free_limit = (1+num_online_cpus())*cachep->batchcount + cachep->num;
+	cachep->shared = shared;
 	spin_unlock_irq(&cachep->spinlock);
 
 	for (i = 0; i < NR_CPUS; i++) {
 		struct array_cache *ccold = new.new[i];
+		int node = cpu_to_node(i);
+
 		if (!ccold)
 			continue;
-		spin_lock_irq(&cachep->spinlock);
-		free_block(cachep, ac_entry(ccold), ccold->avail);
-		spin_unlock_irq(&cachep->spinlock);
+		spin_lock_irq(&cachep->nodelists[node]->list_lock);
+		free_block(cachep, ac_entry(ccold), ccold->avail, node);
+		spin_unlock_irq(&cachep->nodelists[node]->list_lock);
 		kfree(ccold);
 	}
-	new_shared = alloc_arraycache(-1, batchcount*shared, 0xbaadf00d);
-	if (new_shared) {
-		struct array_cache *old;
 
-		spin_lock_irq(&cachep->spinlock);
-		old = cachep->lists.shared;
-		cachep->lists.shared = new_shared;
-		if (old)
-			free_block(cachep, ac_entry(old), old->avail);
-		spin_unlock_irq(&cachep->spinlock);
-		kfree(old);
+	err = alloc_kmemlist(cachep);
+	if (err) {
+		printk(KERN_ERR "alloc_kmemlist failed for %s, error %d.\n",
+				cachep->name, -err);
+		BUG();
 	}
-
 	return 0;
 }
 
@@ -3169,11 +3601,11 @@ static void enable_cpucache (kmem_cache_t *cachep)
 }
 
 static void drain_array_locked(kmem_cache_t *cachep,
-				struct array_cache *ac, int force)
+			struct array_cache *ac, int force, int node)
 {
 	int tofree;
 
-	check_spinlock_acquired(cachep);
+	check_spinlock_acquired_node(cachep, node);
 	if (ac->touched && !force) {
 		ac->touched = 0;
 	} else if (ac->avail) {
@@ -3181,7 +3613,7 @@ static void drain_array_locked(kmem_cache_t *cachep,
 		if (tofree > ac->avail) {
 			tofree = (ac->avail+1)/2;
 		}
-		free_block(cachep, ac_entry(ac), tofree);
+		free_block(cachep, ac_entry(ac), tofree, node);
 		ac->avail -= tofree;
 		memmove(&ac_entry(ac)[0], &ac_entry(ac)[tofree],
 					sizeof(void*)*ac->avail);
@@ -3226,6 +3658,7 @@ static void cache_reap(void *unused)
 		struct list_head* p;
 		int tofree;
 		struct slab *slabp;
+		struct kmem_list3 *l3;
 
 		searchp = list_entry(walk, kmem_cache_t, next);
 
@@ -3237,48 +3670,59 @@ static void cache_reap(void *unused)
 
 		check_irq_on();
 
-		spin_lock_irq(&searchp->spinlock);
+		/**
+		 * ֻcpuڽڵڵԼcpuո
+		 */
+		l3 = list3_data(searchp);
+		/**
+		 * ѱڵ㻺Զ˶黹ڵĽڵ㡣
+		 */
+		if (l3->alien)
+			drain_alien_cache(searchp, l3);
+		spin_lock_irq(&l3->list_lock);
 
 		/**
 		 * drain_array_lockedվֲٻ档
 		 */
-		drain_array_locked(searchp, ac_data(searchp), 0);
+		drain_array_locked(searchp, ac_data(searchp), 0,
+				numa_node_id());
 
 		/**
 		 * ÿٻ涼ոʱ䣬ǰСոʱʹһٻ档
 		 */
-		if(time_after(searchp->lists.next_reap, jiffies))
+		if(time_after(l3->next_reap, jiffies))
 			goto next_unlock;
 
 		/**
 		 * ´ոʱΪǰʱ4롣
 		 */
-		searchp->lists.next_reap = jiffies + REAPTIMEOUT_LIST3;
+		l3->next_reap = jiffies + REAPTIMEOUT_LIST3;
 
 		/**
 		 * ͷslabٻ档
 		 */
-		if (searchp->lists.shared)
-			drain_array_locked(searchp, searchp->lists.shared, 0);
+		if (l3->shared)
+			drain_array_locked(searchp, l3->shared, 0,
+					numa_node_id());
 
 		/**
 		 * µslabٻ档ٻ棬һ
 		 */
-		if (searchp->lists.free_touched) {
-			searchp->lists.free_touched = 0;
+		if (l3->free_touched) {
+			l3->free_touched = 0;
 			goto next_unlock;
 		}
 
 		/**
 		 * ݾҪͷŵslab
 		 */
-		tofree = (searchp->free_limit+5*searchp->num-1)/(5*searchp->num);
+		tofree = (l3->free_limit+5*searchp->num-1)/(5*searchp->num);
 		/**
 		 * ѭеslabֱΪջѾĿĿslab
 		 */
 		do {
-			p = list3_data(searchp)->slabs_free.next;
-			if (p == &(list3_data(searchp)->slabs_free))
+			p = l3->slabs_free.next;
+			if (p == &(l3->slabs_free))
 				break;
 
 			slabp = list_entry(p, struct slab, list);
@@ -3291,13 +3735,13 @@ static void cache_reap(void *unused)
 			 * searchp cannot disappear, we hold
 			 * cache_chain_lock
 			 */
-			searchp->lists.free_objects -= searchp->num;
-			spin_unlock_irq(&searchp->spinlock);
+			l3->free_objects -= searchp->num;
+			spin_unlock_irq(&l3->list_lock);
 			slab_destroy(searchp, slabp);
-			spin_lock_irq(&searchp->spinlock);
+			spin_lock_irq(&l3->list_lock);
 		} while(--tofree > 0);
 next_unlock:
-		spin_unlock_irq(&searchp->spinlock);
+		spin_unlock_irq(&l3->list_lock);
 next:
 		/**
 		 * ռȡ
@@ -3339,7 +3783,8 @@ static void *s_start(struct seq_file *m, loff_t *pos)
 		seq_puts(m, " : slabdata <active_slabs> <num_slabs> <sharedavail>");
 #if STATS
 		seq_puts(m, " : globalstat <listallocs> <maxobjs> <grown> <reaped>"
-				" <error> <maxfreeable> <freelimit> <nodeallocs>");
+				" <error> <maxfreeable> <freelimit> <nodeallocs>"
+				" <nodefrees>");
 		seq_puts(m, " : cpustat <allochit> <allocmiss> <freehit> <freemiss>");
 #endif
 		seq_putc(m, '\n');
@@ -3377,36 +3822,51 @@ static int s_show(struct seq_file *m, void *p)
 	unsigned long	num_slabs;
 	const char *name; 
 	char *error = NULL;
+	unsigned long	free_objects = 0;
+	unsigned long	shared_avail = 0;
+	int node;
+	struct kmem_list3 *l3;
 
 	check_irq_on();
 	spin_lock_irq(&cachep->spinlock);
 	active_objs = 0;
 	num_slabs = 0;
-	list_for_each(q,&cachep->lists.slabs_full) {
-		slabp = list_entry(q, struct slab, list);
-		if (slabp->inuse != cachep->num && !error)
-			error = "slabs_full accounting error";
-		active_objs += cachep->num;
-		active_slabs++;
-	}
-	list_for_each(q,&cachep->lists.slabs_partial) {
-		slabp = list_entry(q, struct slab, list);
-		if (slabp->inuse == cachep->num && !error)
-			error = "slabs_partial inuse accounting error";
-		if (!slabp->inuse && !error)
-			error = "slabs_partial/inuse accounting error";
-		active_objs += slabp->inuse;
-		active_slabs++;
-	}
-	list_for_each(q,&cachep->lists.slabs_free) {
-		slabp = list_entry(q, struct slab, list);
-		if (slabp->inuse && !error)
-			error = "slabs_free/inuse accounting error";
-		num_slabs++;
+	for_each_online_node(node) {
+		l3 = cachep->nodelists[node];
+		if (!l3)
+			continue;
+
+		spin_lock(&l3->list_lock);
+		list_for_each(q,&l3->slabs_full) {
+			slabp = list_entry(q, struct slab, list);
+			if (slabp->inuse != cachep->num && !error)
+				error = "slabs_full accounting error";
+			active_objs += cachep->num;
+			active_slabs++;
+		}
+		list_for_each(q,&l3->slabs_partial) {
+			slabp = list_entry(q, struct slab, list);
+			if (slabp->inuse == cachep->num && !error)
+				error = "slabs_partial inuse accounting error";
+			if (!slabp->inuse && !error)
+				error = "slabs_partial/inuse accounting error";
+			active_objs += slabp->inuse;
+			active_slabs++;
+		}
+		list_for_each(q,&l3->slabs_free) {
+			slabp = list_entry(q, struct slab, list);
+			if (slabp->inuse && !error)
+				error = "slabs_free/inuse accounting error";
+			num_slabs++;
+		}
+		free_objects += l3->free_objects;
+		if (l3->shared)
+			shared_avail += l3->shared->avail;
+		spin_unlock(&l3->list_lock);
 	}
 	num_slabs+=active_slabs;
 	num_objs = num_slabs*cachep->num;
-	if (num_objs - active_objs != cachep->lists.free_objects && !error)
+	if (num_objs - active_objs != free_objects && !error)
 		error = "free_objects accounting error";
 
 	name = cachep->name; 
@@ -3417,10 +3877,9 @@ static int s_show(struct seq_file *m, void *p)
 		name, active_objs, num_objs, cachep->objsize,
 		cachep->num, (1<<cachep->gfporder));
 	seq_printf(m, " : tunables %4u %4u %4u",
-			cachep->limit, cachep->batchcount,
-			cachep->lists.shared->limit/cachep->batchcount);
-	seq_printf(m, " : slabdata %6lu %6lu %6u",
-			active_slabs, num_slabs, cachep->lists.shared->avail);
+			cachep->limit, cachep->batchcount, cachep->shared);
+	seq_printf(m, " : slabdata %6lu %6lu %6lu",
+			active_slabs, num_slabs, shared_avail);
 #if STATS
 	{	/* list3 stats */
 		unsigned long high = cachep->high_mark;
@@ -3429,12 +3888,14 @@ static int s_show(struct seq_file *m, void *p)
 		unsigned long reaped = cachep->reaped;
 		unsigned long errors = cachep->errors;
 		unsigned long max_freeable = cachep->max_freeable;
-		unsigned long free_limit = cachep->free_limit;
+		unsigned long free_limit = list3_data(cachep)->free_limit;
 		unsigned long node_allocs = cachep->node_allocs;
+		unsigned long node_frees = cachep->node_frees;
 
-		seq_printf(m, " : globalstat %7lu %6lu %5lu %4lu %4lu %4lu %4lu %4lu",
+		seq_printf(m, " : globalstat %7lu %6lu %5lu %4lu %4lu %4lu %4lu %4lu %4lu",
 				allocs, high, grown, reaped, errors, 
-				max_freeable, free_limit, node_allocs);
+				max_freeable, free_limit, node_allocs,
+				node_frees);
 	}
 	/* cpu stats */
 	{
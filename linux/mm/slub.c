@@ -0,0 +1,1541 @@
+/*
+ * linux/mm/slub.c
+ *
+ * A slab allocator without object queues.
+ *
+ * This is an alternative to mm/slab.c behind the same kmem_cache_*()
+ * and kmalloc() interface, selected with CONFIG_SLUB.
+ *
+ * The differences to mm/slab.c:
+ *
+ * - No slab management structures.  The free objects of a slab are
+ *   chained through a pointer stored inside each free object, and the
+ *   remaining per-slab state (cache, freelist, number of objects in
+ *   use) lives in the struct page of the slab:
+ *
+ *	page->mapping	the kmem_cache the slab belongs to
+ *	page->index	the freelist of the slab
+ *	page->_mapcount	number of objects in use, minus one, so that
+ *			an empty slab goes back with the -1 the page
+ *			allocator expects
+ *	page->private	the first page of the slab (set on every page)
+ *	page->lru	linkage on the per-node partial list
+ *	PG_locked	the slab lock
+ *	PG_active	the slab is a cpu slab ("frozen")
+ *
+ * - No per-cpu object arrays and no shared arrays.  Each cpu instead
+ *   owns one slab at a time, the cpu slab.  The free objects of the cpu
+ *   slab are taken over by the cpu as its private freelist, so that
+ *   kmem_cache_alloc() and the kmem_cache_free() of an object that
+ *   belongs to the cpu slab do not take any lock: they only need
+ *   interrupts off.  Frees from other cpus go to the slab's own
+ *   freelist under the slab lock, and are picked up by the owning cpu
+ *   once its private freelist runs dry.
+ *
+ * - No full and no free lists.  Only partially used slabs that are not
+ *   a cpu slab are kept on a per-node list; full slabs are not tracked
+ *   at all and a slab that becomes empty goes back to the page
+ *   allocator right away.  There is nothing to reap, so there is no
+ *   periodic cache_reap() run on every cpu either.
+ *
+ * - Caches with compatible size, alignment and flags and without
+ *   constructors are merged: kmem_cache_create() hands out the
+ *   existing cache and kmem_cache_destroy() drops a reference.  A
+ *   merged cache shows up in /proc/slabinfo under the name of the
+ *   cache that was created first.  Boot with slub_nomerge to prevent
+ *   this.
+ *
+ * The debugging options of mm/slab.c (SLAB_RED_ZONE, SLAB_POISON,
+ * SLAB_STORE_USER, SLAB_DEBUG_*) are accepted but not implemented;
+ * caches asking for them are just never merged.
+ *
+ * Lock order:
+ *	slab_lock(page)
+ *	  kmem_cache_node->list_lock
+ *
+ * Allocation and free paths run with interrupts disabled.  The partial
+ * list walk only trylocks slabs, so it may nest the other way round.
+ */
+
+#include <linux/config.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/cache.h>
+#include <linux/interrupt.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/notifier.h>
+#include <linux/kallsyms.h>
+#include <linux/cpu.h>
+#include <linux/sysctl.h>
+#include <linux/rcupdate.h>
+#include <linux/string.h>
+#include <linux/nodemask.h>
+
+#include <asm/uaccess.h>
+#include <asm/cacheflush.h>
+#include <asm/tlbflush.h>
+#include <asm/page.h>
+
+#ifndef cache_line_size
+#define cache_line_size()	L1_CACHE_BYTES
+#endif
+
+#ifndef ARCH_KMALLOC_MINALIGN
+#define ARCH_KMALLOC_MINALIGN 0
+#endif
+
+#ifndef ARCH_SLAB_MINALIGN
+#define ARCH_SLAB_MINALIGN 0
+#endif
+
+#ifndef ARCH_KMALLOC_FLAGS
+#define ARCH_KMALLOC_FLAGS SLAB_HWCACHE_ALIGN
+#endif
+
+/* Same limits as mm/slab.c */
+#if defined(CONFIG_LARGE_ALLOCS)
+#define	MAX_OBJ_ORDER	13	/* up to 32Mb */
+#elif defined(CONFIG_MMU)
+#define	MAX_OBJ_ORDER	5	/* 32 pages */
+#else
+#define	MAX_OBJ_ORDER	8	/* up to 1Mb */
+#endif
+
+#define CREATE_MASK	(SLAB_DEBUG_FREE | SLAB_DEBUG_INITIAL | \
+			 SLAB_RED_ZONE | SLAB_POISON | SLAB_NO_REAP | \
+			 SLAB_HWCACHE_ALIGN | SLAB_CACHE_DMA | \
+			 SLAB_MUST_HWCACHE_ALIGN | SLAB_STORE_USER | \
+			 SLAB_RECLAIM_ACCOUNT | SLAB_PANIC | \
+			 SLAB_DESTROY_BY_RCU)
+
+/* Caches with these flags are never merged with others ... */
+#define SLUB_NEVER_MERGE (SLAB_DEBUG_FREE | SLAB_DEBUG_INITIAL | \
+			  SLAB_RED_ZONE | SLAB_POISON | SLAB_STORE_USER | \
+			  SLAB_DESTROY_BY_RCU)
+
+/* ... and these have to be the same on both sides. */
+#define SLUB_MERGE_SAME	(SLAB_CACHE_DMA | SLAB_RECLAIM_ACCOUNT)
+
+/*
+ * The slab of a cpu and the objects of it that the cpu has taken
+ * over.  Only ever touched by its own cpu with interrupts off, or for
+ * an offline cpu from the hotplug notifier.
+ */
+struct kmem_cache_cpu {
+	/**
+	 * cpu˽еĿжͷŵĿ·ֻ
+	 */
+	void **freelist;
+	/**
+	 * ǰcpu slab
+	 */
+	struct page *page;
+	/**
+	 * cpu slabڵĽڵ㡣
+	 */
+	int node;
+} ____cacheline_aligned_in_smp;
+
+/*
+ * Partially used slabs of a node.
+ */
+struct kmem_cache_node {
+	spinlock_t list_lock;	/* Protects partial list and nr_partial */
+	unsigned long nr_partial;
+	/**
+	 * ڵϵslabslabcpu slab
+	 */
+	atomic_t nr_slabs;
+	struct list_head partial;
+};
+
+struct kmem_cache_s {
+/* 1) per-cpu data, touched on every allocation */
+	struct kmem_cache_cpu *cpu_slab[NR_CPUS];
+
+/* 2) constant after kmem_cache_create() */
+	unsigned long flags;
+	/**
+	 * slabռõĴСָͶ롣
+	 */
+	int size;
+	/**
+	 * ĶСϲȡֵ
+	 */
+	int objsize;
+	/**
+	 * ָڶеƫơ
+	 */
+	int offset;
+	int order;
+	/**
+	 * ÿslabеĶ
+	 */
+	int objects;
+	int align;
+	unsigned int allocflags;	/* GFP_DMA for DMA caches */
+	void (*ctor)(void *, kmem_cache_t *, unsigned long);
+	void (*dtor)(void *, kmem_cache_t *, unsigned long);
+	const char *name;	/* our own copy, but for the boot caches */
+
+/* 3) cache chain, protected by slub_sem */
+	/**
+	 * ϲkmem_cache_create()
+	 */
+	int refcount;
+	struct list_head list;
+
+/* 4) partial slabs */
+	struct kmem_cache_node node[MAX_NUMNODES];
+};
+
+/*
+ * Tunables.  A slab holds at least slub_min_objects objects if that is
+ * possible with an order of at most slub_max_order; larger objects get
+ * the smallest order that holds one.
+ */
+static int slub_min_order;
+static int slub_max_order = 1;
+static int slub_min_objects = 4;
+static int slub_nomerge;
+
+static int __init setup_slub_min_order(char *str)
+{
+	get_option(&str, &slub_min_order);
+	return 1;
+}
+__setup("slub_min_order=", setup_slub_min_order);
+
+static int __init setup_slub_max_order(char *str)
+{
+	get_option(&str, &slub_max_order);
+	return 1;
+}
+__setup("slub_max_order=", setup_slub_max_order);
+
+static int __init setup_slub_min_objects(char *str)
+{
+	get_option(&str, &slub_min_objects);
+	return 1;
+}
+__setup("slub_min_objects=", setup_slub_min_objects);
+
+static int __init setup_slub_nomerge(char *str)
+{
+	slub_nomerge = 1;
+	return 1;
+}
+__setup("slub_nomerge", setup_slub_nomerge);
+
+/* The cache of the kmem_cache structures themselves */
+static kmem_cache_t kmem_cache_cache;
+
+/* Set once kmalloc() works, at the end of kmem_cache_init() */
+static int slub_up;
+
+/*
+ * The cpu structures of the caches created before that: the cache of
+ * caches and the kmalloc caches, on the boot cpu.  Any other cpu
+ * structure is allocated on the cpu's node when the cache is created
+ * or the cpu is brought up, so a cache only pays for the cpus that
+ * have been online.
+ */
+#define CACHE(x) + 2
+static struct kmem_cache_cpu boot_cpu_slab[1
+#include <linux/kmalloc_sizes.h>
+	];
+#undef CACHE
+static int nr_boot_cpu_slab;
+
+/* Guard access to the cache chain. */
+static DECLARE_MUTEX(slub_sem);
+static LIST_HEAD(slab_caches);
+
+/*
+ * Pages that can be reclaimed via shrink_slab(); checked by
+ * __vm_enough_memory() to give overcommit some slack.
+ */
+atomic_t slab_reclaim_pages;
+EXPORT_SYMBOL(slab_reclaim_pages);
+
+/* These are the default caches for kmalloc. Custom caches can have other sizes. */
+struct cache_sizes malloc_sizes[] = {
+#define CACHE(x) { .cs_size = (x) },
+#include <linux/kmalloc_sizes.h>
+	{ 0, }
+#undef CACHE
+};
+
+EXPORT_SYMBOL(malloc_sizes);
+
+/* Must match cache_sizes above. Out of line to keep cache footprint low. */
+struct cache_names {
+	char *name;
+	char *name_dma;
+};
+
+static struct cache_names __initdata cache_names[] = {
+#define CACHE(x) { .name = "size-" #x, .name_dma = "size-" #x "(DMA)" },
+#include <linux/kmalloc_sizes.h>
+	{ NULL, }
+#undef CACHE
+};
+
+/*
+ * Per-slab state kept in the struct page, see the top of the file.
+ */
+static inline kmem_cache_t *page_slab(struct page *page)
+{
+	return (kmem_cache_t *)page->mapping;
+}
+
+static inline void **page_freelist(struct page *page)
+{
+	return (void **)page->index;
+}
+
+static inline void set_page_freelist(struct page *page, void **freelist)
+{
+	page->index = (unsigned long)freelist;
+}
+
+static inline int slab_inuse(struct page *page)
+{
+	return page_mapcount(page);
+}
+
+static inline void set_slab_inuse(struct page *page, int inuse)
+{
+	atomic_set(&page->_mapcount, inuse - 1);
+}
+
+static inline struct page *virt_to_slab(const void *x)
+{
+	return (struct page *)virt_to_page(x)->private;
+}
+
+#define SlabFrozen(page)	PageActive(page)
+#define SetSlabFrozen(page)	SetPageActive(page)
+#define ClearSlabFrozen(page)	ClearPageActive(page)
+
+/*
+ * The slab lock is a bit lock on the page, always taken with interrupts
+ * disabled.
+ */
+static inline void slab_lock(struct page *page)
+{
+	while (unlikely(TestSetPageLocked(page)))
+		while (PageLocked(page))
+			cpu_relax();
+}
+
+static inline int slab_trylock(struct page *page)
+{
+	return !TestSetPageLocked(page);
+}
+
+static inline void slab_unlock(struct page *page)
+{
+	smp_mb__before_clear_bit();
+	ClearPageLocked(page);
+}
+
+static inline void *get_freepointer(kmem_cache_t *s, void *object)
+{
+	return *(void **)(object + s->offset);
+}
+
+static inline void set_freepointer(kmem_cache_t *s, void *object, void *fp)
+{
+	*(void **)(object + s->offset) = fp;
+}
+
+static inline struct kmem_cache_node *get_node(kmem_cache_t *s, int node)
+{
+	return &s->node[node];
+}
+
+static inline int node_match(struct kmem_cache_cpu *c, int node)
+{
+#ifdef CONFIG_NUMA
+	if (node != -1 && c->node != node)
+		return 0;
+#endif
+	return 1;
+}
+
+/*
+ * Slab allocation and freeing
+ */
+static struct page *allocate_slab(kmem_cache_t *s, unsigned int flags,
+				  int node)
+{
+	struct page *page;
+
+	flags |= s->allocflags;
+	if (node == -1)
+		page = alloc_pages(flags, s->order);
+	else
+		page = alloc_pages_node(node, flags, s->order);
+	if (!page)
+		return NULL;
+
+	if (s->flags & SLAB_RECLAIM_ACCOUNT)
+		atomic_add(1 << s->order, &slab_reclaim_pages);
+	add_page_state(nr_slab, 1 << s->order);
+	return page;
+}
+
+static struct page *new_slab(kmem_cache_t *s, unsigned int flags, int node)
+{
+	struct page *page;
+	unsigned long ctor_flags;
+	void *start, *p, *last;
+	int i;
+
+	page = allocate_slab(s, flags & GFP_LEVEL_MASK, node);
+	if (!page)
+		return NULL;
+
+	atomic_inc(&get_node(s, page_to_nid(page))->nr_slabs);
+	for (i = 0; i < (1 << s->order); i++) {
+		page[i].private = (unsigned long)page;
+		SetPageSlab(page + i);
+	}
+	page->mapping = (struct address_space *)s;
+
+	ctor_flags = SLAB_CTOR_CONSTRUCTOR;
+	if (!(flags & __GFP_WAIT))
+		ctor_flags |= SLAB_CTOR_ATOMIC;
+
+	start = page_address(page);
+	last = start;
+	for (p = start + s->size; p < start + s->objects * s->size;
+							p += s->size) {
+		if (s->ctor)
+			s->ctor(last, s, ctor_flags);
+		set_freepointer(s, last, p);
+		last = p;
+	}
+	if (s->ctor)
+		s->ctor(last, s, ctor_flags);
+	set_freepointer(s, last, NULL);
+
+	set_page_freelist(page, start);
+	set_slab_inuse(page, 0);
+	return page;
+}
+
+static void __free_slab(kmem_cache_t *s, struct page *page)
+{
+	int pages = 1 << s->order;
+	int i;
+
+	if (s->dtor) {
+		void *start = page_address(page);
+		void *p;
+
+		for (p = start; p < start + s->objects * s->size; p += s->size)
+			s->dtor(p, s, 0);
+	}
+
+	for (i = 0; i < pages; i++) {
+		if (!TestClearPageSlab(page + i))
+			BUG();
+		page[i].private = 0;
+	}
+	page->mapping = NULL;
+	page->index = 0;
+
+	sub_page_state(nr_slab, pages);
+	if (current->reclaim_state)
+		current->reclaim_state->reclaimed_slab += pages;
+	__free_pages(page, s->order);
+	if (s->flags & SLAB_RECLAIM_ACCOUNT)
+		atomic_sub(pages, &slab_reclaim_pages);
+}
+
+/* The page is off all lists by now, so its lru can hold the rcu_head. */
+static void rcu_free_slab(struct rcu_head *h)
+{
+	struct page *page = container_of((struct list_head *)h,
+					 struct page, lru);
+
+	__free_slab(page_slab(page), page);
+}
+
+static void discard_slab(kmem_cache_t *s, struct page *page)
+{
+	atomic_dec(&get_node(s, page_to_nid(page))->nr_slabs);
+
+	if (unlikely(s->flags & SLAB_DESTROY_BY_RCU)) {
+		BUILD_BUG_ON(sizeof(struct rcu_head) > sizeof(struct list_head));
+		call_rcu((struct rcu_head *)&page->lru, rcu_free_slab);
+	} else
+		__free_slab(s, page);
+}
+
+/*
+ * Partial list handling
+ */
+static void add_partial(kmem_cache_t *s, struct page *page)
+{
+	struct kmem_cache_node *n = get_node(s, page_to_nid(page));
+
+	spin_lock(&n->list_lock);
+	n->nr_partial++;
+	list_add(&page->lru, &n->partial);
+	spin_unlock(&n->list_lock);
+}
+
+static void remove_partial(kmem_cache_t *s, struct page *page)
+{
+	struct kmem_cache_node *n = get_node(s, page_to_nid(page));
+
+	spin_lock(&n->list_lock);
+	list_del(&page->lru);
+	n->nr_partial--;
+	spin_unlock(&n->list_lock);
+}
+
+/*
+ * Take a slab off a node's partial list, locked and frozen.  Slabs that
+ * are locked by somebody else are skipped: they are about to change
+ * state anyway.
+ */
+static struct page *get_partial_node(struct kmem_cache_node *n)
+{
+	struct page *page;
+
+	if (!n->nr_partial)
+		return NULL;
+
+	spin_lock(&n->list_lock);
+	list_for_each_entry(page, &n->partial, lru)
+		if (slab_trylock(page)) {
+			list_del(&page->lru);
+			n->nr_partial--;
+			SetSlabFrozen(page);
+			goto out;
+		}
+	page = NULL;
+out:
+	spin_unlock(&n->list_lock);
+	return page;
+}
+
+static struct page *get_partial(kmem_cache_t *s, int node)
+{
+	struct page *page;
+	int searchnode = (node == -1) ? numa_node_id() : node;
+
+	page = get_partial_node(get_node(s, searchnode));
+	if (page || node != -1)
+		return page;
+
+#ifdef CONFIG_NUMA
+	/* Rather a remote partial slab than a new local one. */
+	for_each_online_node(searchnode) {
+		page = get_partial_node(get_node(s, searchnode));
+		if (page)
+			return page;
+	}
+#endif
+	return NULL;
+}
+
+/*
+ * Give a cpu slab back: put the objects the cpu took over back on the
+ * slab's freelist, then file the slab according to its state.  Called
+ * with the slab locked, returns with it unlocked.
+ */
+static void deactivate_slab(kmem_cache_t *s, struct kmem_cache_cpu *c)
+{
+	struct page *page = c->page;
+	void **freelist = page_freelist(page);
+	int inuse = slab_inuse(page);
+
+	while (c->freelist) {
+		void **object = c->freelist;
+
+		c->freelist = get_freepointer(s, object);
+		set_freepointer(s, object, freelist);
+		freelist = object;
+		inuse--;
+	}
+	set_page_freelist(page, freelist);
+	set_slab_inuse(page, inuse);
+	c->page = NULL;
+
+	ClearSlabFrozen(page);
+	if (inuse) {
+		/* Full slabs are not kept on any list. */
+		if (freelist)
+			add_partial(s, page);
+		slab_unlock(page);
+	} else {
+		slab_unlock(page);
+		discard_slab(s, page);
+	}
+}
+
+static void __flush_cpu_slab(kmem_cache_t *s, int cpu)
+{
+	struct kmem_cache_cpu *c = s->cpu_slab[cpu];
+
+	if (c && c->page) {
+		slab_lock(c->page);
+		deactivate_slab(s, c);
+	}
+}
+
+static void flush_cpu_slab(void *d)
+{
+	unsigned long flags;
+
+	/* UP on_each_cpu() calls us with interrupts on */
+	local_irq_save(flags);
+	__flush_cpu_slab((kmem_cache_t *)d, smp_processor_id());
+	local_irq_restore(flags);
+}
+
+static void flush_all(kmem_cache_t *s)
+{
+	on_each_cpu(flush_cpu_slab, s, 1, 1);
+}
+
+/*
+ * Slow path of the allocation: the cpu's private freelist is empty or
+ * the cpu slab is on the wrong node.  First try to refill from the
+ * slab's own freelist (objects freed by other cpus), then switch to a
+ * partial slab, then to a new one.
+ *
+ * Interrupts are off on entry and on return, but may be turned on in
+ * between to allocate a new slab.
+ */
+static void *__slab_alloc(kmem_cache_t *s, unsigned int gfpflags, int node,
+			  struct kmem_cache_cpu *c)
+{
+	struct page *page;
+	void **object;
+
+	if (!c->page)
+		goto new_slab;
+
+	slab_lock(c->page);
+	if (unlikely(!node_match(c, node)))
+		goto another_slab;
+load_freelist:
+	object = page_freelist(c->page);
+	if (unlikely(!object))
+		goto another_slab;
+
+	/* The cpu takes over all free objects of the slab. */
+	c->freelist = get_freepointer(s, object);
+	set_page_freelist(c->page, NULL);
+	set_slab_inuse(c->page, s->objects);
+	c->node = page_to_nid(c->page);
+	slab_unlock(c->page);
+	return object;
+
+another_slab:
+	deactivate_slab(s, c);
+
+new_slab:
+	page = get_partial(s, node);
+	if (page) {
+		c->page = page;
+		goto load_freelist;
+	}
+
+	if (gfpflags & SLAB_NO_GROW)
+		return NULL;
+
+	if (gfpflags & __GFP_WAIT)
+		local_irq_enable();
+	page = new_slab(s, gfpflags, node);
+	if (gfpflags & __GFP_WAIT)
+		local_irq_disable();
+	if (!page)
+		return NULL;
+
+	/* We may have been migrated, or raced with another new slab. */
+	c = s->cpu_slab[smp_processor_id()];
+	if (c->page) {
+		slab_lock(c->page);
+		deactivate_slab(s, c);
+	}
+	slab_lock(page);
+	SetSlabFrozen(page);
+	c->page = page;
+	goto load_freelist;
+}
+
+static inline void *slab_alloc(kmem_cache_t *s, unsigned int gfpflags,
+			       int node)
+{
+	struct kmem_cache_cpu *c;
+	void **object;
+	unsigned long flags;
+
+	might_sleep_if(gfpflags & __GFP_WAIT);
+
+	local_irq_save(flags);
+	c = s->cpu_slab[smp_processor_id()];
+	if (likely(c->freelist && node_match(c, node))) {
+		object = c->freelist;
+		c->freelist = get_freepointer(s, object);
+	} else
+		object = __slab_alloc(s, gfpflags, node, c);
+	local_irq_restore(flags);
+	return object;
+}
+
+/*
+ * Slow path of the free: the object belongs to a slab that is not our
+ * cpu slab.  It goes on the slab's freelist under the slab lock; a slab
+ * that was full becomes partial, a partial slab that becomes empty is
+ * freed.  Slabs frozen by another cpu are left alone, that cpu will
+ * find the object on its next refill.
+ */
+static void __slab_free(kmem_cache_t *s, struct page *page, void *x)
+{
+	void **prior;
+	int inuse;
+
+	slab_lock(page);
+	prior = page_freelist(page);
+	set_freepointer(s, x, prior);
+	set_page_freelist(page, x);
+	inuse = slab_inuse(page) - 1;
+	set_slab_inuse(page, inuse);
+
+	if (unlikely(SlabFrozen(page)))
+		goto out_unlock;
+
+	if (unlikely(!inuse))
+		goto slab_empty;
+
+	if (unlikely(!prior))
+		add_partial(s, page);
+
+out_unlock:
+	slab_unlock(page);
+	return;
+
+slab_empty:
+	if (prior)
+		remove_partial(s, page);
+	slab_unlock(page);
+	discard_slab(s, page);
+}
+
+static inline void slab_free(kmem_cache_t *s, struct page *page, void *x)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	c = s->cpu_slab[smp_processor_id()];
+	if (likely(page == c->page)) {
+		set_freepointer(s, x, c->freelist);
+		c->freelist = x;
+	} else
+		__slab_free(s, page, x);
+	local_irq_restore(flags);
+}
+
+/**
+ * kmem_cache_alloc - Allocate an object
+ * @cachep: The cache to allocate from.
+ * @flags: See kmalloc().
+ *
+ * Allocate an object from this cache.  The flags are only relevant
+ * if the cache has no available objects.
+ */
+void *kmem_cache_alloc(kmem_cache_t *cachep, int flags)
+{
+	return slab_alloc(cachep, flags, -1);
+}
+EXPORT_SYMBOL(kmem_cache_alloc);
+
+#ifdef CONFIG_NUMA
+/**
+ * kmem_cache_alloc_node - Allocate an object on the specified node
+ * @cachep: The cache to allocate from.
+ * @nodeid: node number of the target node.
+ *
+ * Identical to kmem_cache_alloc, except that this function is slow
+ * and can sleep. And it will allocate memory on the given node, which
+ * can improve the performance for cpu bound structures.
+ */
+void *kmem_cache_alloc_node(kmem_cache_t *cachep, int nodeid)
+{
+	return slab_alloc(cachep, GFP_KERNEL, nodeid);
+}
+EXPORT_SYMBOL(kmem_cache_alloc_node);
+#endif
+
+/**
+ * kmem_cache_free - Deallocate an object
+ * @cachep: The cache the allocation was from.
+ * @objp: The previously allocated object.
+ *
+ * Free an object which was previously allocated from this
+ * cache.
+ */
+void kmem_cache_free(kmem_cache_t *cachep, void *objp)
+{
+	struct page *page = virt_to_slab(objp);
+
+	slab_free(cachep, page, objp);
+}
+EXPORT_SYMBOL(kmem_cache_free);
+
+/**
+ * kmem_ptr_validate - check if an untrusted pointer might
+ *	be a slab entry.
+ * @cachep: the cache we're checking against
+ * @ptr: pointer to validate
+ *
+ * This verifies that the untrusted pointer looks sane:
+ * it is _not_ a guarantee that the pointer is actually
+ * part of the slab cache in question, but it at least
+ * validates that the pointer can be dereferenced and
+ * looks half-way sane.
+ *
+ * Currently only used for dentry validation.
+ */
+int fastcall kmem_ptr_validate(kmem_cache_t *cachep, void *ptr)
+{
+	unsigned long addr = (unsigned long) ptr;
+	unsigned long min_addr = PAGE_OFFSET;
+	unsigned long align_mask = sizeof(void *) - 1;
+	unsigned long size = cachep->objsize;
+	struct page *page;
+
+	if (unlikely(addr < min_addr))
+		goto out;
+	if (unlikely(addr > (unsigned long)high_memory - size))
+		goto out;
+	if (unlikely(addr & align_mask))
+		goto out;
+	if (unlikely(!kern_addr_valid(addr)))
+		goto out;
+	if (unlikely(!kern_addr_valid(addr + size - 1)))
+		goto out;
+	page = virt_to_page(ptr);
+	if (unlikely(!PageSlab(page)))
+		goto out;
+	if (unlikely(page_slab(virt_to_slab(ptr)) != cachep))
+		goto out;
+	return 1;
+out:
+	return 0;
+}
+
+unsigned int kmem_cache_size(kmem_cache_t *cachep)
+{
+	return cachep->objsize;
+}
+EXPORT_SYMBOL(kmem_cache_size);
+
+/*
+ * Cache setup
+ */
+static int calculate_order(int size)
+{
+	int order, fraction;
+
+	/*
+	 * Take the smallest order that holds slub_min_objects with little
+	 * waste, and accept more waste before giving up.
+	 */
+	for (fraction = 16; fraction >= 4; fraction /= 2)
+		for (order = slub_min_order; order <= slub_max_order; order++) {
+			unsigned long slab_size = PAGE_SIZE << order;
+
+			if (slab_size < slub_min_objects * size)
+				continue;
+			if (slab_size % size <= slab_size / fraction)
+				return order;
+		}
+
+	/* Large objects: the smallest order that holds one. */
+	order = get_order(size);
+	if (order < slub_min_order)
+		order = slub_min_order;
+	return order <= MAX_OBJ_ORDER ? order : -1;
+}
+
+static unsigned long calculate_alignment(unsigned long flags,
+					 unsigned long align, unsigned long size)
+{
+	/*
+	 * Like mm/slab.c: cache line alignment is only a hint, small
+	 * objects may share a line.
+	 */
+	if (flags & SLAB_MUST_HWCACHE_ALIGN)
+		align = max(align, (unsigned long)cache_line_size());
+	else if (flags & SLAB_HWCACHE_ALIGN) {
+		unsigned long ralign = cache_line_size();
+
+		while (size <= ralign / 2)
+			ralign /= 2;
+		align = max(align, ralign);
+	}
+	if (align < ARCH_SLAB_MINALIGN)
+		align = ARCH_SLAB_MINALIGN;
+	return ALIGN(align, sizeof(void *));
+}
+
+/* The object size a cache would end up with, for merging. */
+static unsigned long slab_size(unsigned long size, unsigned long align,
+			       unsigned long flags)
+{
+	return ALIGN(ALIGN(size, sizeof(void *)),
+		     calculate_alignment(flags, align, size));
+}
+
+static int kmem_cache_open(kmem_cache_t *s, const char *name, size_t size,
+	size_t align, unsigned long flags,
+	void (*ctor)(void *, kmem_cache_t *, unsigned long),
+	void (*dtor)(void *, kmem_cache_t *, unsigned long))
+{
+	int node;
+
+	memset(s, 0, sizeof(*s));
+	s->name = name;
+	s->objsize = size;
+	s->flags = flags;
+	s->ctor = ctor;
+	s->dtor = dtor;
+	s->refcount = 1;
+	if (flags & SLAB_CACHE_DMA)
+		s->allocflags = GFP_DMA;
+	if (flags & SLAB_RECLAIM_ACCOUNT)
+		s->allocflags |= __GFP_RECLAIMABLE;
+
+	/*
+	 * The free pointer overlays the start of a free object, unless
+	 * the object has to keep its contents while free: constructed
+	 * objects, and objects readers may still look at under RCU.
+	 */
+	size = ALIGN(size, sizeof(void *));
+	if (ctor || dtor || (flags & SLAB_DESTROY_BY_RCU)) {
+		s->offset = size;
+		size += sizeof(void *);
+	}
+	s->align = calculate_alignment(flags, align, s->objsize);
+	s->size = ALIGN(size, s->align);
+
+	s->order = calculate_order(s->size);
+	if (s->order < 0)
+		return 0;
+	s->objects = (PAGE_SIZE << s->order) / s->size;
+	if (!s->objects)
+		return 0;
+
+	for (node = 0; node < MAX_NUMNODES; node++) {
+		struct kmem_cache_node *n = get_node(s, node);
+
+		spin_lock_init(&n->list_lock);
+		INIT_LIST_HEAD(&n->partial);
+		atomic_set(&n->nr_slabs, 0);
+	}
+	return 1;
+}
+
+static kmem_cache_t *kmem_find_general_cachep(size_t size, int gfpflags);
+
+static int alloc_cpu_slab(kmem_cache_t *s, int cpu)
+{
+	struct kmem_cache_cpu *c;
+
+	if (s->cpu_slab[cpu])
+		return 1;
+	c = kmem_cache_alloc_node(kmem_find_general_cachep(sizeof(*c),
+					GFP_KERNEL), cpu_to_node(cpu));
+	if (!c)
+		return 0;
+	memset(c, 0, sizeof(*c));
+	s->cpu_slab[cpu] = c;
+	return 1;
+}
+
+static void free_cpu_slabs(kmem_cache_t *s)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		kfree(s->cpu_slab[cpu]);
+		s->cpu_slab[cpu] = NULL;
+	}
+}
+
+/*
+ * Give @s a cpu structure for each online cpu.  The cpus that come up
+ * later get theirs from the cpu notifier.
+ */
+static int init_cpu_slabs(kmem_cache_t *s)
+{
+	int cpu;
+
+	if (!slub_up) {
+		BUG_ON(nr_boot_cpu_slab >= ARRAY_SIZE(boot_cpu_slab));
+		s->cpu_slab[smp_processor_id()] =
+			boot_cpu_slab + nr_boot_cpu_slab++;
+		return 1;
+	}
+	for_each_online_cpu(cpu)
+		if (!alloc_cpu_slab(s, cpu)) {
+			free_cpu_slabs(s);
+			return 0;
+		}
+	return 1;
+}
+
+static kmem_cache_t *find_mergeable(size_t size, size_t align,
+	unsigned long flags,
+	void (*ctor)(void *, kmem_cache_t *, unsigned long),
+	void (*dtor)(void *, kmem_cache_t *, unsigned long))
+{
+	kmem_cache_t *s;
+
+	if (slub_nomerge || ctor || dtor || (flags & SLUB_NEVER_MERGE))
+		return NULL;
+
+	align = calculate_alignment(flags, align, size);
+	size = slab_size(size, align, flags);
+
+	list_for_each_entry(s, &slab_caches, list) {
+		if (s->ctor || s->dtor || (s->flags & SLUB_NEVER_MERGE))
+			continue;
+		if (size > s->size)
+			continue;
+		if ((flags & SLUB_MERGE_SAME) != (s->flags & SLUB_MERGE_SAME))
+			continue;
+		/* The existing objects must be aligned at least as well. */
+		if (s->size & (align - 1))
+			continue;
+		/* Don't waste more than a word per object. */
+		if (s->size - size >= sizeof(void *))
+			continue;
+		return s;
+	}
+	return NULL;
+}
+
+/**
+ * kmem_cache_create - Create a cache.
+ * @name: A string which is used in /proc/slabinfo to identify this cache.
+ * @size: The size of objects to be created in this cache.
+ * @align: The required alignment for the objects.
+ * @flags: SLAB flags
+ * @ctor: A constructor for the objects.
+ * @dtor: A destructor for the objects.
+ *
+ * Returns a ptr to the cache on success, NULL on failure.
+ * Cannot be called within a int, but can be interrupted.
+ * The @ctor is run when new pages are allocated by the cache
+ * and the @dtor is run before the pages are handed back.
+ *
+ * Caches without @ctor and @dtor may be merged with an existing
+ * compatible cache, in which case that cache is returned.
+ *
+ * The cache keeps a copy of @name, so when it is merged the name stays
+ * valid after the module that created it first goes away.
+ */
+kmem_cache_t *
+kmem_cache_create (const char *name, size_t size, size_t align,
+	unsigned long flags, void (*ctor)(void*, kmem_cache_t *, unsigned long),
+	void (*dtor)(void*, kmem_cache_t *, unsigned long))
+{
+	kmem_cache_t *s;
+
+	if ((!name) ||
+		in_interrupt() ||
+		(size < sizeof(void *)) ||
+		(size > (1<<MAX_OBJ_ORDER)*PAGE_SIZE) ||
+		(dtor && !ctor)) {
+			printk(KERN_ERR "%s: Early error in slab %s\n",
+					__FUNCTION__, name);
+			BUG();
+		}
+	if (flags & SLAB_DESTROY_BY_RCU)
+		BUG_ON(dtor);
+	if (flags & ~CREATE_MASK)
+		BUG();
+
+	/* Don't let cpus come up without a cpu structure */
+	lock_cpu_hotplug();
+	down(&slub_sem);
+	s = find_mergeable(size, align, flags, ctor, dtor);
+	if (s) {
+		s->refcount++;
+		if (s->objsize < size)
+			s->objsize = size;
+		goto out;
+	}
+
+	s = kmem_cache_alloc(&kmem_cache_cache, SLAB_KERNEL);
+	if (!s)
+		goto out;
+	if (!kmem_cache_open(s, name, size, align, flags, ctor, dtor))
+		goto out_free;
+	if (slub_up) {
+		char *copy = kmalloc(strlen(name) + 1, GFP_KERNEL);
+
+		if (!copy)
+			goto out_free;
+		s->name = strcpy(copy, name);
+	}
+	if (!init_cpu_slabs(s)) {
+		if (slub_up)
+			kfree(s->name);
+		goto out_free;
+	}
+	list_add(&s->list, &slab_caches);
+	goto out;
+
+out_free:
+	kmem_cache_free(&kmem_cache_cache, s);
+	s = NULL;
+out:
+	up(&slub_sem);
+	unlock_cpu_hotplug();
+	if (!s && (flags & SLAB_PANIC))
+		panic("kmem_cache_create(): failed to create slab `%s'\n",
+			name);
+	return s;
+}
+EXPORT_SYMBOL(kmem_cache_create);
+
+/*
+ * Free the empty slabs on the partial lists.  Returns the number of
+ * slabs still in use.
+ */
+static unsigned long free_empty_partial(kmem_cache_t *s)
+{
+	unsigned long left = 0;
+	int node;
+
+	for (node = 0; node < MAX_NUMNODES; node++) {
+		struct kmem_cache_node *n = get_node(s, node);
+		struct page *page, *h;
+		unsigned long flags;
+
+		spin_lock_irqsave(&n->list_lock, flags);
+		list_for_each_entry_safe(page, h, &n->partial, lru)
+			if (!slab_inuse(page) && slab_trylock(page)) {
+				list_del(&page->lru);
+				n->nr_partial--;
+				slab_unlock(page);
+				discard_slab(s, page);
+			}
+		spin_unlock_irqrestore(&n->list_lock, flags);
+		left += atomic_read(&n->nr_slabs);
+	}
+	return left;
+}
+
+/**
+ * kmem_cache_shrink - Shrink a cache.
+ * @cachep: The cache to shrink.
+ *
+ * Releases as many slabs as possible for a cache.
+ * To help debugging, a zero exit status indicates all slabs were released.
+ */
+int kmem_cache_shrink(kmem_cache_t *cachep)
+{
+	if (!cachep || in_interrupt())
+		BUG();
+
+	lock_cpu_hotplug();
+	flush_all(cachep);
+	unlock_cpu_hotplug();
+	return free_empty_partial(cachep) != 0;
+}
+EXPORT_SYMBOL(kmem_cache_shrink);
+
+/**
+ * kmem_cache_destroy - delete a cache
+ * @cachep: the cache to destroy
+ *
+ * Remove a kmem_cache_t object from the slab cache.
+ * Returns 0 on success.
+ *
+ * It is expected this function will be called by a module when it is
+ * unloaded.  This will remove the cache completely, and avoid a duplicate
+ * cache being allocated each time a module is loaded and unloaded, if the
+ * module doesn't have persistent in-kernel storage across loads and unloads.
+ *
+ * A merged cache only goes away with its last user.
+ *
+ * The caller must guarantee that noone will allocate memory from the cache
+ * during the kmem_cache_destroy().
+ */
+int kmem_cache_destroy(kmem_cache_t *cachep)
+{
+	if (!cachep || in_interrupt())
+		BUG();
+
+	/* Don't let CPUs to come and go */
+	lock_cpu_hotplug();
+
+	down(&slub_sem);
+	if (--cachep->refcount) {
+		up(&slub_sem);
+		unlock_cpu_hotplug();
+		return 0;
+	}
+	list_del(&cachep->list);
+	up(&slub_sem);
+
+	flush_all(cachep);
+	if (free_empty_partial(cachep)) {
+		printk(KERN_ERR "slab error in %s(): cache `%s': "
+		       "Can't free all objects\n", __FUNCTION__, cachep->name);
+		dump_stack();
+		down(&slub_sem);
+		cachep->refcount++;
+		list_add(&cachep->list, &slab_caches);
+		up(&slub_sem);
+		unlock_cpu_hotplug();
+		return 1;
+	}
+
+	if (unlikely(cachep->flags & SLAB_DESTROY_BY_RCU))
+		synchronize_kernel();
+
+	/* The boot caches are never destroyed, so these are all ours */
+	free_cpu_slabs(cachep);
+	kfree(cachep->name);
+	kmem_cache_free(&kmem_cache_cache, cachep);
+
+	unlock_cpu_hotplug();
+
+	return 0;
+}
+EXPORT_SYMBOL(kmem_cache_destroy);
+
+/*
+ * kmalloc and friends
+ */
+static kmem_cache_t *kmem_find_general_cachep(size_t size, int gfpflags)
+{
+	struct cache_sizes *csizep = malloc_sizes;
+
+	for ( ; csizep->cs_size; csizep++) {
+		if (size > csizep->cs_size)
+			continue;
+		break;
+	}
+	return (gfpflags & GFP_DMA) ? csizep->cs_dmacachep : csizep->cs_cachep;
+}
+
+/**
+ * kmalloc - allocate memory
+ * @size: how many bytes of memory are required.
+ * @flags: the type of memory to allocate.
+ *
+ * kmalloc is the normal method of allocating memory
+ * in the kernel.  See the kmalloc() in include/linux/slab.h for the
+ * meaning of @flags.
+ */
+void *__kmalloc(size_t size, int flags)
+{
+	kmem_cache_t *s = kmem_find_general_cachep(size, flags);
+
+	if (unlikely(!s))
+		return NULL;
+	return slab_alloc(s, flags, -1);
+}
+EXPORT_SYMBOL(__kmalloc);
+
+/**
+ * kcalloc - allocate memory for an array. The memory is set to zero.
+ * @n: number of elements.
+ * @size: element size.
+ * @flags: the type of memory to allocate.
+ */
+void *kcalloc(size_t n, size_t size, int flags)
+{
+	void *ret = NULL;
+
+	if (n != 0 && size > INT_MAX / n)
+		return ret;
+
+	ret = kmalloc(n * size, flags);
+	if (ret)
+		memset(ret, 0, n * size);
+	return ret;
+}
+EXPORT_SYMBOL(kcalloc);
+
+/**
+ * kfree - free previously allocated memory
+ * @objp: pointer returned by kmalloc.
+ *
+ * Don't free memory not originally allocated by kmalloc()
+ * or you will run into trouble.
+ */
+void kfree(const void *objp)
+{
+	struct page *page;
+
+	if (!objp)
+		return;
+	page = virt_to_slab(objp);
+	BUG_ON(!PageSlab(virt_to_page(objp)));
+	slab_free(page_slab(page), page, (void *)objp);
+}
+EXPORT_SYMBOL(kfree);
+
+unsigned int ksize(const void *objp)
+{
+	if (unlikely(!objp))
+		return 0;
+	return page_slab(virt_to_slab(objp))->objsize;
+}
+
+#ifdef CONFIG_SMP
+/**
+ * __alloc_percpu - allocate one copy of the object for every present
+ * cpu in the system, zeroing them.
+ * Objects should be dereferenced using the per_cpu_ptr macro only.
+ *
+ * @size: how many bytes of memory are required.
+ * @align: the alignment, which can't be greater than SMP_CACHE_BYTES.
+ */
+void *__alloc_percpu(size_t size, size_t align)
+{
+	int i;
+	struct percpu_data *pdata = kmalloc(sizeof (*pdata), GFP_KERNEL);
+
+	if (!pdata)
+		return NULL;
+
+	for (i = 0; i < NR_CPUS; i++) {
+		if (!cpu_possible(i))
+			continue;
+		pdata->ptrs[i] = kmem_cache_alloc_node(
+				kmem_find_general_cachep(size, GFP_KERNEL),
+				cpu_to_node(i));
+
+		if (!pdata->ptrs[i])
+			goto unwind_oom;
+		memset(pdata->ptrs[i], 0, size);
+	}
+
+	/* Catch derefs w/o wrappers */
+	return (void *) (~(unsigned long) pdata);
+
+unwind_oom:
+	while (--i >= 0) {
+		if (!cpu_possible(i))
+			continue;
+		kfree(pdata->ptrs[i]);
+	}
+	kfree(pdata);
+	return NULL;
+}
+EXPORT_SYMBOL(__alloc_percpu);
+
+/**
+ * free_percpu - free previously allocated percpu memory
+ * @objp: pointer returned by alloc_percpu.
+ *
+ * Don't free memory not originally allocated by alloc_percpu()
+ * The complemented objp is to check for that.
+ */
+void
+free_percpu(const void *objp)
+{
+	int i;
+	struct percpu_data *p = (struct percpu_data *) (~(unsigned long) objp);
+
+	for (i = 0; i < NR_CPUS; i++) {
+		if (!cpu_possible(i))
+			continue;
+		kfree(p->ptrs[i]);
+	}
+	kfree(p);
+}
+EXPORT_SYMBOL(free_percpu);
+#endif
+
+/*
+ * A cpu coming up needs a cpu structure in every cache, and a dead cpu
+ * can't give its cpu slabs back itself.  The cpu structures of a dead
+ * cpu are kept for when it comes back.
+ */
+static int __devinit slab_cpuup_callback(struct notifier_block *nfb,
+					 unsigned long action, void *hcpu)
+{
+	int cpu = (long)hcpu;
+	kmem_cache_t *s;
+	unsigned long flags;
+
+	switch (action) {
+	case CPU_UP_PREPARE:
+		down(&slub_sem);
+		list_for_each_entry(s, &slab_caches, list)
+			if (!alloc_cpu_slab(s, cpu)) {
+				up(&slub_sem);
+				return NOTIFY_BAD;
+			}
+		up(&slub_sem);
+		break;
+	case CPU_UP_CANCELED:
+	case CPU_DEAD:
+		down(&slub_sem);
+		list_for_each_entry(s, &slab_caches, list) {
+			local_irq_save(flags);
+			__flush_cpu_slab(s, cpu);
+			local_irq_restore(flags);
+		}
+		up(&slub_sem);
+		break;
+	default:
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block slab_notifier = { &slab_cpuup_callback, NULL, 0 };
+
+void __init kmem_cache_init(void)
+{
+	struct cache_sizes *sizes = malloc_sizes;
+	struct cache_names *names = cache_names;
+
+	/* 1) the cache of caches, by hand */
+	if (!kmem_cache_open(&kmem_cache_cache, "kmem_cache",
+			     sizeof(kmem_cache_t), cache_line_size(),
+			     SLAB_NO_REAP, NULL, NULL))
+		BUG();
+	init_cpu_slabs(&kmem_cache_cache);
+	list_add(&kmem_cache_cache.list, &slab_caches);
+
+	/* 2) the kmalloc caches */
+	while (sizes->cs_size) {
+		sizes->cs_cachep = kmem_cache_create(names->name,
+			sizes->cs_size, ARCH_KMALLOC_MINALIGN,
+			(ARCH_KMALLOC_FLAGS | SLAB_PANIC), NULL, NULL);
+
+		sizes->cs_dmacachep = kmem_cache_create(names->name_dma,
+			sizes->cs_size, ARCH_KMALLOC_MINALIGN,
+			(ARCH_KMALLOC_FLAGS | SLAB_CACHE_DMA | SLAB_PANIC),
+			NULL, NULL);
+
+		sizes++;
+		names++;
+	}
+
+	slub_up = 1;
+	register_cpu_notifier(&slab_notifier);
+
+	printk(KERN_INFO "SLUB: min_objects %d, orders %d-%d, "
+	       "kmem_cache %d bytes%s\n", slub_min_objects, slub_min_order,
+	       slub_max_order, kmem_cache_cache.size,
+	       slub_nomerge ? ", no merging" : "");
+}
+
+#ifdef CONFIG_PROC_FS
+
+static void *s_start(struct seq_file *m, loff_t *pos)
+{
+	loff_t n = *pos;
+	struct list_head *p;
+
+	down(&slub_sem);
+	if (!n) {
+		/*
+		 * Same format as mm/slab.c, so that the existing tools
+		 * keep working.  There is nothing to tune.
+		 */
+		seq_puts(m, "slabinfo - version: 2.1\n");
+		seq_puts(m, "# name            <active_objs> <num_objs> <objsize> <objperslab> <pagesperslab>");
+		seq_puts(m, " : tunables <limit> <batchcount> <sharedfactor>");
+		seq_puts(m, " : slabdata <active_slabs> <num_slabs> <sharedavail>");
+		seq_putc(m, '\n');
+	}
+	p = slab_caches.next;
+	while (n--) {
+		p = p->next;
+		if (p == &slab_caches)
+			return NULL;
+	}
+	return list_entry(p, kmem_cache_t, list);
+}
+
+static void *s_next(struct seq_file *m, void *p, loff_t *pos)
+{
+	kmem_cache_t *s = p;
+
+	++*pos;
+	return s->list.next == &slab_caches ? NULL
+		: list_entry(s->list.next, kmem_cache_t, list);
+}
+
+static void s_stop(struct seq_file *m, void *p)
+{
+	up(&slub_sem);
+}
+
+static int s_show(struct seq_file *m, void *p)
+{
+	kmem_cache_t *s = p;
+	unsigned long num_slabs = 0, free_objs = 0, active_objs, num_objs;
+	int node;
+
+	/*
+	 * Objects on cpu freelists count as active; they are bounded by
+	 * one slab per cpu.
+	 */
+	for (node = 0; node < MAX_NUMNODES; node++) {
+		struct kmem_cache_node *n = get_node(s, node);
+		struct page *page;
+		unsigned long flags;
+
+		num_slabs += atomic_read(&n->nr_slabs);
+		spin_lock_irqsave(&n->list_lock, flags);
+		list_for_each_entry(page, &n->partial, lru)
+			free_objs += s->objects - slab_inuse(page);
+		spin_unlock_irqrestore(&n->list_lock, flags);
+	}
+	num_objs = num_slabs * s->objects;
+	active_objs = num_objs > free_objs ? num_objs - free_objs : 0;
+
+	seq_printf(m, "%-17s %6lu %6lu %6u %4u %4d",
+		s->name, active_objs, num_objs, s->size,
+		s->objects, (1 << s->order));
+	seq_printf(m, " : tunables %4u %4u %4u", 0, 0, 0);
+	seq_printf(m, " : slabdata %6lu %6lu %6u", num_slabs, num_slabs, 0);
+	seq_putc(m, '\n');
+	return 0;
+}
+
+/*
+ * slabinfo_op - iterator that generates /proc/slabinfo
+ */
+struct seq_operations slabinfo_op = {
+	.start	= s_start,
+	.next	= s_next,
+	.stop	= s_stop,
+	.show	= s_show,
+};
+
+/**
+ * slabinfo_write - there are no per-cache tunables to set.
+ */
+ssize_t slabinfo_write(struct file *file, const char __user *buffer,
+				size_t count, loff_t *ppos)
+{
+	return -EINVAL;
+}
+#endif
@@ -78,16 +78,15 @@ int rotate_reclaimable_page(struct page *page)
 		return 1;
 	if (PageDirty(page))
 		return 1;
-	if (PageActive(page))
+	if (PageActive(page) || PageUnevictable(page))
 		return 1;
 	if (!PageLRU(page))
 		return 1;
 
 	zone = page_zone(page);
 	spin_lock_irqsave(&zone->lru_lock, flags);
-	if (PageLRU(page) && !PageActive(page)) {
-		list_del(&page->lru);
-		list_add_tail(&page->lru, &zone->inactive_list);
+	if (PageLRU(page) && !PageActive(page) && !PageUnevictable(page)) {
+		list_move_tail(&page->lru, &zone->lru[page_lru_base_type(page)]);
 		inc_page_state(pgrotated);
 	}
 	if (!test_clear_page_writeback(page))
@@ -100,8 +99,8 @@ int rotate_reclaimable_page(struct page *page)
  * FIXME: speed this up?
  */
 /**
- * PG_active־ûλ(ҳڷǻ)ҳƵС
- * εdel_page_from_inactive_listadd_page_to_active_listPG_active־λ
+ * PG_active־ûλ(ҳڷǻ)ҳƵͬ͵ĻС
+ * ɻеҳƶ
  * ƶҳ֮ǰùlru_lock
  */
 void fastcall activate_page(struct page *page)
@@ -109,11 +108,15 @@ void fastcall activate_page(struct page *page)
 	struct zone *zone = page_zone(page);
 
 	spin_lock_irq(&zone->lru_lock);
-	if (PageLRU(page) && !PageActive(page)) {
-		del_page_from_inactive_list(zone, page);
+	if (PageLRU(page) && !PageActive(page) && !PageUnevictable(page)) {
+		int lru = page_lru_base_type(page);
+
+		del_page_from_lru_list(zone, page, lru);
 		SetPageActive(page);
-		add_page_to_active_list(zone, page);
+		add_page_to_lru_list(zone, page, lru + LRU_ACTIVE);
 		inc_page_state(pgactivate);
+		if (lru == LRU_INACTIVE_FILE)
+			workingset_activation(page);
 	}
 	spin_unlock_irq(&zone->lru_lock);
 }
@@ -323,7 +326,13 @@ void __pagevec_lru_add(struct pagevec *pvec)
 		}
 		if (TestSetPageLRU(page))
 			BUG();
-		add_page_to_inactive_list(zone, page);
+		if (unlikely(!page_evictable(page))) {
+			SetPageUnevictable(page);
+			add_page_to_lru_list(zone, page, LRU_UNEVICTABLE);
+			continue;
+		}
+		/* PG_active may be set by a page cache refault */
+		add_page_to_lru_list(zone, page, page_lru(page));
 	}
 	if (zone)
 		spin_unlock_irq(&zone->lru_lock);
@@ -350,6 +359,11 @@ void __pagevec_lru_add_active(struct pagevec *pvec)
 		}
 		if (TestSetPageLRU(page))
 			BUG();
+		if (unlikely(!page_evictable(page))) {
+			SetPageUnevictable(page);
+			add_page_to_lru_list(zone, page, LRU_UNEVICTABLE);
+			continue;
+		}
 		if (TestSetPageActive(page))
 			BUG();
 		add_page_to_active_list(zone, page);
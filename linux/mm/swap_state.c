@@ -99,7 +99,7 @@ static int __add_to_swap_cache(struct page *page,
 /**
  * ҳ뽻ٻС
  */
-static int add_to_swap_cache(struct page *page, swp_entry_t entry)
+int add_to_swap_cache(struct page *page, swp_entry_t entry, int gfp_mask)
 {
 	int error;
 
@@ -114,7 +114,7 @@ static int add_to_swap_cache(struct page *page, swp_entry_t entry)
 	 * __add_to_swap_cacheradix_tree_insertҳٻ档Ȼҳü
 	 * PG_swapcachePG_locked־λ
 	 */
-	error = __add_to_swap_cache(page, entry, GFP_KERNEL);
+	error = __add_to_swap_cache(page, entry, gfp_mask);
 	/*
 	 * Anon pages are already on the LRU, we don't run lru_cache_add here.
 	 */
@@ -414,7 +414,7 @@ struct page *read_swap_cache_async(swp_entry_t entry,
 		 * ҳûҳٻУһҳܷҳ򣬾ͷ0Աʾû㹻ڴ档
 		 */
 		if (!new_page) {
-			new_page = alloc_page_vma(GFP_HIGHUSER, vma, addr);
+			new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, addr);
 			if (!new_page)
 				break;		/* Out of memory */
 		}
@@ -432,7 +432,7 @@ struct page *read_swap_cache_async(swp_entry_t entry,
 		/**
 		 * ҳ뽻ٻ档Ҳҳ
 		 */
-		err = add_to_swap_cache(new_page, entry);
+		err = add_to_swap_cache(new_page, entry, GFP_KERNEL);
 		if (!err) {
 			/*
 			 * Initiate read into locked page and return.
@@ -440,6 +440,7 @@ struct page *read_swap_cache_async(swp_entry_t entry,
 			/**
 			 * ҳLRUĻ
 			 */
+			SetPageSwapBacked(new_page);
 			lru_cache_add_active(new_page);
 			/**
 			 * ӽҳݡ
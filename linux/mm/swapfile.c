@@ -27,6 +27,7 @@
 #include <linux/acct.h>
 #include <linux/backing-dev.h>
 #include <linux/syscalls.h>
+#include <linux/zswap.h>
 
 #include <asm/pgtable.h>
 #include <asm/tlbflush.h>
@@ -345,6 +346,7 @@ static int swap_entry_free(struct swap_info_struct *p, unsigned long offset)
 				p->highest_bit = offset;
 			nr_swap_pages++;
 			p->inuse_pages--;
+			zswap_invalidate(p - swap_info, offset);
 		}
 	}
 	return count;
@@ -560,6 +562,9 @@ static unsigned long unuse_pmd(struct vm_area_struct *vma, pmd_t *dir,
 
 	if (pmd_none(*dir))
 		return 0;
+	/* A huge pmd maps resident pages only, never swap entries */
+	if (pmd_trans_huge(*dir))
+		return 0;
 	if (pmd_bad(*dir)) {
 		pmd_ERROR(*dir);
 		pmd_clear(dir);
@@ -1411,6 +1416,7 @@ asmlinkage long sys_swapoff(const char __user * specialfile)
 	/**
 	 * е˵ҳ۶Ѿɹ͵RAMС
 	 */
+	zswap_invalidate_area(type);
 	down(&swapon_sem);
 	swap_list_lock();
 	drain_mmlist();
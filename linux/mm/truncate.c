@@ -12,6 +12,7 @@
 #include <linux/module.h>
 #include <linux/pagemap.h>
 #include <linux/pagevec.h>
+#include <linux/swap.h>
 #include <linux/buffer_head.h>	/* grr. try_to_release_page,
 				   block_invalidatepage */
 
@@ -90,6 +91,39 @@ invalidate_complete_page(struct address_space *mapping, struct page *page)
 	return 1;
 }
 
+/*
+ * Remove the shadow entries that reclaim left behind for evicted pages at
+ * or beyond @start.  Runs after the pages are gone, so that no new shadow
+ * can appear behind it.
+ */
+static void truncate_shadow_entries(struct address_space *mapping,
+				    pgoff_t start)
+{
+	void *entries[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	pgoff_t next = start;
+	unsigned int i, nr;
+
+	while (mapping->nrshadows) {
+		spin_lock_irq(&mapping->tree_lock);
+		nr = radix_tree_gang_lookup_index(&mapping->page_tree, entries,
+						indices, next, PAGEVEC_SIZE);
+		for (i = 0; i < nr; i++) {
+			if (!radix_tree_exceptional_entry(entries[i]))
+				continue;
+			radix_tree_delete(&mapping->page_tree, indices[i]);
+			workingset_del_shadow(mapping);
+		}
+		spin_unlock_irq(&mapping->tree_lock);
+		if (nr == 0)
+			break;
+		next = indices[nr - 1] + 1;
+		if (next == 0)
+			break;
+		cond_resched();
+	}
+}
+
 /**
  * truncate_inode_pages - truncate *all* the pages from an offset
  * @mapping: mapping to truncate
@@ -121,7 +155,7 @@ void truncate_inode_pages(struct address_space *mapping, loff_t lstart)
 	pgoff_t next;
 	int i;
 
-	if (mapping->nrpages == 0)
+	if (mapping->nrpages == 0 && mapping->nrshadows == 0)
 		return;
 
 	pagevec_init(&pvec, 0);
@@ -179,6 +213,8 @@ void truncate_inode_pages(struct address_space *mapping, loff_t lstart)
 		}
 		pagevec_release(&pvec);
 	}
+
+	truncate_shadow_entries(mapping, start);
 }
 
 EXPORT_SYMBOL(truncate_inode_pages);
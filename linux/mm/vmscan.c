@@ -54,7 +54,7 @@ typedef enum {
  * ղ
  */
 struct scan_control {
-	/* Ask refill_inactive_zone, or shrink_cache to scan this many pages */
+	/* Ask shrink_active_list, or shrink_inactive_list to scan this many pages */
 	/**
 	 * дɨĿҳ
 	 */
@@ -72,12 +72,7 @@ struct scan_control {
 	 */
 	unsigned long nr_reclaimed;
 
-	/**
-	 * ûַ̬ռõҳ
-	 */
-	unsigned long nr_mapped;	/* From page_state */
-
-	/* How many pages shrink_cache() should reclaim */
+	/* How many pages shrink_inactive_list() should reclaim */
 	/**
 	 * յĿҳ
 	 */
@@ -146,7 +141,6 @@ struct shrinker {
  * From 0 .. 100.  Higher means more swappy.
  */
 int vm_swappiness = 60;
-static long total_memory;
 
 /**
  * д̸ٻѹ˫
@@ -453,6 +447,13 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		BUG_ON(PageActive(page));
 
 		sc->nr_scanned++;
+
+		/**
+		 * ɻյҳ(ramfsеҳ)ֱƵɻ
+		 */
+		if (unlikely(!page_evictable(page)))
+			goto cull_mlocked;
+
 		/* Double the slab pressure for mapped and swapcache pages */
 		if (page_mapped(page) || PageSwapCache(page))
 			sc->nr_scanned++;
@@ -498,9 +499,12 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		 * processes. Try to unmap it here.
 		 */
 		if (page_mapped(page) && mapping) {
-			switch (try_to_unmap(page)) {/* ҳ뽻ٻtry_to_unmapȷҳÿû̬ҳַȻ󽫻ҳʶдС */
+			switch (try_to_unmap(page, 0)) {/* ҳ뽻ٻtry_to_unmapȷҳÿû̬ҳַȻ󽫻ҳʶдС */
 			case SWAP_FAIL:
 				goto activate_locked;
+			case SWAP_MLOCK:
+				SetPageMlocked(page);
+				goto cull_mlocked;
 			case SWAP_AGAIN:
 				goto keep_locked;
 			case SWAP_SUCCESS:
@@ -588,8 +592,14 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		 * ˣһжȽ˳ҳü2ôӵ߾:ҳٻ(ҳ˵ǽٻ)
 		 * ԼPFRA£ҳΪ࣬ôҳͿԻա
 		 * ֻҪüΪ2ҳȻΪ࣬ôͲҳ
+		 * üĲҾ޷ٻøҳ
 		 */
-		if (page_count(page) != 2 || PageDirty(page)) {
+		if (!page_freeze_refs(page, 2)) {
+			spin_unlock_irq(&mapping->tree_lock);
+			goto keep_locked;
+		}
+		if (unlikely(PageDirty(page))) {
+			page_unfreeze_refs(page, 2);
 			spin_unlock_irq(&mapping->tree_lock);
 			goto keep_locked;
 		}
@@ -601,19 +611,26 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		if (PageSwapCache(page)) {
 			swp_entry_t swap = { .val = page->private };
 			__delete_from_swap_cache(page);
+			/* Drop the pagecache ref */
+			page_unfreeze_refs(page, 1);
 			spin_unlock_irq(&mapping->tree_lock);
 			swap_free(swap);
-			__put_page(page);	/* The pagecache ref */
 			goto free_it;
 		}
 #endif /* CONFIG_SWAP */
 
 		/**
 		 * ˣԻոڴҳȸҳPG_swapcache־ֵҳٻ򽻻ٻɾҳ
+		 * ļҳڻӰԱٴζʱжǷڹ
 		 */
-		__remove_from_page_cache(page);
+		if (!PageSwapBacked(page))
+			__remove_from_page_cache_shadow(page,
+					workingset_eviction(mapping, page));
+		else
+			__remove_from_page_cache(page);
+		/* Drop the pagecache ref */
+		page_unfreeze_refs(page, 1);
 		spin_unlock_irq(&mapping->tree_lock);
-		__put_page(page);
 
 free_it:
 		unlock_page(page);
@@ -625,6 +642,16 @@ free_it:
 			__pagevec_release_nonlru(&freed_pvec);
 		continue;
 
+		/**
+		 * ҳĳӳڲɻյӳ䣬벻ɻԺɨͲ
+		 */
+cull_mlocked:
+		SetPageUnevictable(page);
+		inc_page_state(unevictable_pgs_culled);
+		unlock_page(page);
+		list_add(&page->lru, &ret_pages);
+		continue;
+
 		/**
 		 * ĳԭ򣬸ҳܱͷ(类)ôҳŵֲСջٷŻpage_listظϲ㺯
 		 */
@@ -652,29 +679,92 @@ keep:
 	return reclaimed;
 }
 
+/*
+ * Unevictable pages are mlocked pages and pages of mappings which have no
+ * backing store at all, like ramfs.  Reclaim can do nothing with them, so
+ * they are parked on their own list instead of being scanned over and over.
+ */
+/**
+ * жҳǷԱաmlockҳԼramfsӳеҳɻա
+ */
+int page_evictable(struct page *page)
+{
+	if (PageMlocked(page))
+		return 0;
+	if (mapping_unevictable(page_mapping(page)))
+		return 0;
+	return 1;
+}
+
+/**
+ * check_move_unevictable_page - move a page back to the evictable lists
+ * @page: page that may have become evictable
+ *
+ * Called when something that pinned @page, such as an mlock, goes away.
+ * If the page is on the unevictable list and nothing else keeps it
+ * there, put it back on the inactive list of its type.
+ */
+void check_move_unevictable_page(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+
+	if (!PageUnevictable(page) || !page_evictable(page))
+		return;
+
+	spin_lock_irq(&zone->lru_lock);
+	if (PageLRU(page) && PageUnevictable(page) && page_evictable(page)) {
+		del_page_from_lru_list(zone, page, LRU_UNEVICTABLE);
+		ClearPageUnevictable(page);
+		add_page_to_inactive_list(zone, page);
+		inc_page_state(unevictable_pgs_rescued);
+	}
+	spin_unlock_irq(&zone->lru_lock);
+}
+
+/*
+ * Put a page that shrink_list() or shrink_active_list() could not free
+ * back on the LRU list its flags say it belongs to.  A page culled as
+ * unevictable may have been munlocked while it was off the LRU, so check
+ * once more here rather than strand it.  Called with zone->lru_lock held.
+ */
+static inline void putback_lru_page(struct zone *zone, struct page *page)
+{
+	if (TestSetPageLRU(page))
+		BUG();
+	if (unlikely(PageUnevictable(page)) && page_evictable(page))
+		ClearPageUnevictable(page);
+	add_page_to_lru_list(zone, page, page_lru(page));
+}
+
 /*
  * zone->lru_lock is heavily contented.  We relieve it by quickly privatising
  * a batch of pages and working on them outside the lock.  Any pages which were
  * not freed will be added back to the LRU.
  *
- * shrink_cache() adds the number of pages reclaimed to sc->nr_reclaimed
+ * shrink_inactive_list() adds the number of pages reclaimed to
+ * sc->nr_reclaimed
  *
  * For pagecache intensive workloads, the first loop here is the hottest spot
  * in the kernel (apart from the copy_*_user functions).
  */
 /**
- * ҪĿǴӹǻȡһҳǷһʱȻshrink_listеÿһҳЧҳղ
+ * ҪĿǴӹļǻȡһҳǷһʱ
+ * Ȼshrink_listеÿһҳЧҳղ
+ *		file:		Ϊ1ʱļҳΪ0ʱҳ
  */
-static void shrink_cache(struct zone *zone, struct scan_control *sc)
+static void shrink_inactive_list(struct zone *zone, struct scan_control *sc,
+				 int file)
 {
 	LIST_HEAD(page_list);
 	struct pagevec pvec;
 	int max_scan = sc->nr_to_scan;
+	int l = LRU_BASE + file * LRU_FILE;
+	struct list_head *src = &zone->lru[l];
 
 	pagevec_init(&pvec, 1);
 
 	/**
-	 * Ȼpagevecݽṹеҳǻ
+	 * ȻpagevecݽṹеҳLRU
 	 */
 	lru_add_drain();
 	/**
@@ -690,12 +780,10 @@ static void shrink_cache(struct zone *zone, struct scan_control *sc)
 		/**
 		 * ǻеҳ32ҳ
 		 */
-		while (nr_scan++ < SWAP_CLUSTER_MAX &&
-				!list_empty(&zone->inactive_list)) {
-			page = lru_to_page(&zone->inactive_list);
+		while (nr_scan++ < SWAP_CLUSTER_MAX && !list_empty(src)) {
+			page = lru_to_page(src);
 
-			prefetchw_prev_lru_page(page,
-						&zone->inactive_list, flags);
+			prefetchw_prev_lru_page(page, src, flags);
 
 			if (!TestClearPageLRU(page))
 				BUG();
@@ -709,7 +797,7 @@ static void shrink_cache(struct zone *zone, struct scan_control *sc)
 				 */
 				__put_page(page);
 				SetPageLRU(page);
-				list_add(&page->lru, &zone->inactive_list);
+				list_add(&page->lru, src);
 				continue;
 			}
 			/**
@@ -719,9 +807,11 @@ static void shrink_cache(struct zone *zone, struct scan_control *sc)
 			nr_taken++;
 		}
 		/**
-		 * nr_inactiveȥӷǻɾҳ
+		 * ȥӷǻɾҳ
+		 * ͬʱۼrecent_scannedget_scan_ratioɨ
 		 */
-		zone->nr_inactive -= nr_taken;
+		zone->nr_lru[l] -= nr_taken;
+		zone->recent_scanned[file] += nr_taken;
 		/**
 		 * pages_scannedΪڷǻЧҳ
 		 */
@@ -759,20 +849,15 @@ static void shrink_cache(struct zone *zone, struct scan_control *sc)
 		 * Put back any unfreeable pages.
 		 */
 		/**
-		 * page_listûбյҳŻطǻ߻
+		 * page_listûбյҳŻӦLRU
+		 * shrink_list¼ҳ˵ʹãrecent_rotated
 		 */
 		while (!list_empty(&page_list)) {
 			page = lru_to_page(&page_list);
-			if (TestSetPageLRU(page))
-				BUG();
 			list_del(&page->lru);
-			/**
-			 * shrink_listнҳPG_active־λôҳŵŵǻ
-			 */
 			if (PageActive(page))
-				add_page_to_active_list(zone, page);
-			else
-				add_page_to_inactive_list(zone, page);
+				zone->recent_rotated[file]++;
+			putback_lru_page(zone, page);
 			if (!pagevec_add(&pvec, page)) {
 				spin_unlock_irq(&zone->lru_lock);
 				__pagevec_release(&pvec);
@@ -803,31 +888,31 @@ done:
  * But we had to alter page->flags anyway.
  */
 /**
- * shrink_zoneáӻҳƵǻӶԹǿͻйҳӻƶǻ
- * PFRAͻմҳϵͳܻܵӰ졣̫裬û㹻δҳǻPFRAͲܻڴ档
- * ˣʼʱÿεãɨǻҳPFRAѻڴʱÿεʱɨĴҲǽscan_controlݽṹpriorityֶεֵ
+ * shrink_zoneáļҳƵͬ͵ķǻ
+ * õӳҳڻУrecent_rotatedΪҳ"մ"ݡ
+ * ҳļҳɨ٣get_scan_ratioﲻټ㽻ֵ
  *		zone:		ָһڴ
  *		sc:			ָһscan_controlṹýṹŻղִʱйϢ
+ *		file:		Ϊ1ʱļҳΪ0ʱҳ
  */
 static void
-refill_inactive_zone(struct zone *zone, struct scan_control *sc)
+shrink_active_list(struct zone *zone, struct scan_control *sc, int file)
 {
 	int pgmoved;
 	int pgdeactivate = 0;
 	int pgscanned = 0;
+	int pgrotated = 0;
 	int nr_pages = sc->nr_to_scan;
+	int l = LRU_BASE + file * LRU_FILE;
+	struct list_head *src = &zone->lru[l + LRU_ACTIVE];
 	LIST_HEAD(l_hold);	/* The pages which were snipped off */
-	LIST_HEAD(l_inactive);	/* Pages to go onto the inactive_list */
-	LIST_HEAD(l_active);	/* Pages to go onto the active_list */
+	LIST_HEAD(l_inactive);	/* Pages to go onto the inactive list */
+	LIST_HEAD(l_active);	/* Pages to go onto the active list */
 	struct page *page;
 	struct pagevec pvec;
-	int reclaim_mapped = 0;
-	long mapped_ratio;
-	long distress;
-	long swap_tendency;
 
 	/**
-	 * pagevecݽṹеҳǻ
+	 * pagevecݽṹеҳLRU
 	 */
 	lru_add_drain();
 	pgmoved = 0;
@@ -836,11 +921,11 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 	 */
 	spin_lock_irq(&zone->lru_lock);
 	/**
-	 * Իеҳ״ĵײʼϣһֱִȥֱΪջߴﵽɨҳ
+	 * Իеҳ״ɨ裬ĵײʼϣһֱִȥֱΪջߴﵽɨҳ
 	 */
-	while (pgscanned < nr_pages && !list_empty(&zone->active_list)) {
-		page = lru_to_page(&zone->active_list);
-		prefetchw_prev_lru_page(page, &zone->active_list, flags);
+	while (pgscanned < nr_pages && !list_empty(src)) {
+		page = lru_to_page(src);
+		prefetchw_prev_lru_page(page, src, flags);
 		if (!TestClearPageLRU(page))
 			BUG();
 		list_del(&page->lru);
@@ -854,13 +939,9 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 			 * put the refcount back and put the page back on the
 			 * LRU
 			 */
-			/**
-			 * üΪ0ҳһڹĻϵͳͷҳʱݼʹüȻҳLRUɾϵͳҳLRUɾϵͳ
-			 * ڵݼü󣬻ûдLRUɾǰ̡ܻ
-			 */
 			__put_page(page);
 			SetPageLRU(page);
-			list_add(&page->lru, &zone->active_list);
+			list_add(&page->lru, src);
 		} else {
 			/**
 			 * ɨ赽ҳ뵽ʱС
@@ -874,73 +955,27 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 	 * ɨҳм
 	 */
 	zone->pages_scanned += pgscanned;
-	zone->nr_active -= pgmoved;
+	zone->nr_lru[l + LRU_ACTIVE] -= pgmoved;
+	zone->recent_scanned[file] += pgmoved;
 	/**
 	 * ͷ
 	 */
 	spin_unlock_irq(&zone->lru_lock);
 
-	/*
-	 * `distress' is a measure of how much trouble we're having reclaiming
-	 * pages.  0 -> no problems.  100 -> great trouble.
-	 */
-	/**
-	 * 㽻ֵ=ӳ/2 + ֵ + ֵ
-	 */
-	distress = 100 >> zone->prev_priority;
-
-	/*
-	 * The point of this algorithm is to decide when to start reclaiming
-	 * mapped memory instead of just pagecache.  Work out how much memory
-	 * is mapped.
-	 */
-	mapped_ratio = (sc->nr_mapped * 100) / total_memory;
-
-	/*
-	 * Now decide how much we really want to unmap some pages.  The mapped
-	 * ratio is downgraded - just because there's a lot of mapped memory
-	 * doesn't necessarily mean that page reclaim isn't succeeding.
-	 *
-	 * The distress ratio is important - we don't want to start going oom.
-	 *
-	 * A 100% value of vm_swappiness overrides this algorithm altogether.
-	 */
-	swap_tendency = mapped_ratio / 2 + distress + vm_swappiness;
-
-	/*
-	 * Now use this metric to decide whether to start moving mapped memory
-	 * onto the inactive list.
-	 */
-	if (swap_tendency >= 100)
-		reclaim_mapped = 1;
-
 	/**
 	 * Ծֲl_holdеҳеڶѭеҳֵl_activel_inactiveС
+	 * ĳҳʹӳҳڻС
 	 */
 	while (!list_empty(&l_hold)) {
 		cond_resched();
 		page = lru_to_page(&l_hold);
 		list_del(&page->lru);
-		/**
-		 * ҳǽûַ̬ռҳ
-		 */
-		if (page_mapped(page)) {
-			/**
-			 * reclaim_mappedΪ0ʾֵС100
-			 * ҳûмĽ
-			 * page_referencedֵҳĳҳʹ
-			 * ҳ
-			 */
-			if (!reclaim_mapped ||
-			    (total_swap_pages == 0 && PageAnon(page)) ||
-			    page_referenced(page, 0, sc->priority <= 0)) {
-				list_add(&page->lru, &l_active);
-				continue;
-			}
+		if (page_mapped(page) &&
+		    page_referenced(page, 0, sc->priority <= 0)) {
+			list_add(&page->lru, &l_active);
+			pgrotated++;
+			continue;
 		}
-		/**
-		 * ҳǻ
-		 */
 		list_add(&page->lru, &l_inactive);
 	}
 
@@ -950,6 +985,7 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 	 * ٴλlru_lock
 	 */
 	spin_lock_irq(&zone->lru_lock);
+	zone->recent_rotated[file] += pgrotated;
 	/**
 	 * Էǻеѭҳķǻ·ǻҳֵ
 	 */
@@ -960,10 +996,10 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 			BUG();
 		if (!TestClearPageActive(page))
 			BUG();
-		list_move(&page->lru, &zone->inactive_list);
+		list_move(&page->lru, &zone->lru[l]);
 		pgmoved++;
 		if (!pagevec_add(&pvec, page)) {
-			zone->nr_inactive += pgmoved;
+			zone->nr_lru[l] += pgmoved;
 			spin_unlock_irq(&zone->lru_lock);
 			pgdeactivate += pgmoved;
 			pgmoved = 0;
@@ -973,7 +1009,7 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 			spin_lock_irq(&zone->lru_lock);
 		}
 	}
-	zone->nr_inactive += pgmoved;
+	zone->nr_lru[l] += pgmoved;
 	pgdeactivate += pgmoved;
 	if (buffer_heads_over_limit) {
 		spin_unlock_irq(&zone->lru_lock);
@@ -991,17 +1027,17 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 		if (TestSetPageLRU(page))
 			BUG();
 		BUG_ON(!PageActive(page));
-		list_move(&page->lru, &zone->active_list);
+		list_move(&page->lru, src);
 		pgmoved++;
 		if (!pagevec_add(&pvec, page)) {
-			zone->nr_active += pgmoved;
+			zone->nr_lru[l + LRU_ACTIVE] += pgmoved;
 			pgmoved = 0;
 			spin_unlock_irq(&zone->lru_lock);
 			__pagevec_release(&pvec);
 			spin_lock_irq(&zone->lru_lock);
 		}
 	}
-	zone->nr_active += pgmoved;
+	zone->nr_lru[l + LRU_ACTIVE] += pgmoved;
 	/**
 	 * ͷء
 	 */
@@ -1012,87 +1048,201 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 	mod_page_state(pgdeactivate, pgdeactivate);
 }
 
+/*
+ * The inactive anon list should be about as big as the active one, so that
+ * anon pages get a fair chance to be referenced before they are swapped.
+ */
+static inline int inactive_anon_is_low(struct zone *zone)
+{
+	return zone->nr_lru[LRU_INACTIVE_ANON] < zone->nr_lru[LRU_ACTIVE_ANON];
+}
+
+/*
+ * Determine how aggressively the anon and file LRU lists should be
+ * scanned.  The relative value of each set of LRU lists is determined
+ * by looking at the fraction of the pages scanned we did rotate back
+ * onto the active list instead of evict.  File pages that are read back
+ * in after being evicted count as rotated as well (see mm/workingset.c).
+ *
+ * percent[0] specifies how much pressure to put on ram/swap backed
+ * memory, while percent[1] determines pressure on the file LRUs.
+ */
+/**
+ * ҳļҳԵɨ(ٷֱ)
+ * ûпýʱɨҳ޽ϵͳװɨҳ
+ * ɨҳб¼ıҳĻմۣԽߣɨԽ١
+ */
+static void get_scan_ratio(struct zone *zone, struct scan_control *sc,
+			   unsigned long *percent)
+{
+	unsigned long anon, file, free;
+	unsigned long anon_prio, file_prio;
+	unsigned long ap, fp;
+
+	/* If we have no swap space, do not bother scanning anon pages. */
+	if (nr_swap_pages <= 0) {
+		percent[0] = 0;
+		percent[1] = 100;
+		return;
+	}
+
+	anon = zone->nr_lru[LRU_ACTIVE_ANON] + zone->nr_lru[LRU_INACTIVE_ANON];
+	file = zone->nr_lru[LRU_ACTIVE_FILE] + zone->nr_lru[LRU_INACTIVE_FILE];
+	free = zone->free_pages;
+
+	/* If we have very few page cache pages, force-scan anon pages. */
+	if (unlikely(file + free <= zone->pages_high)) {
+		percent[0] = 100;
+		percent[1] = 0;
+		return;
+	}
+
+	/*
+	 * OK, so we have swap space and a fair amount of page cache
+	 * pages.  We use the recently rotated / recently scanned
+	 * ratios to determine how valuable each cache is.
+	 *
+	 * Because workloads change over time (and to avoid overflow)
+	 * we keep these statistics as a floating average, which ends
+	 * up weighing recent references more than old ones.
+	 *
+	 * anon in [0], file in [1]
+	 */
+	if (unlikely(zone->recent_scanned[0] > anon / 4)) {
+		spin_lock_irq(&zone->lru_lock);
+		zone->recent_scanned[0] /= 2;
+		zone->recent_rotated[0] /= 2;
+		spin_unlock_irq(&zone->lru_lock);
+	}
+
+	if (unlikely(zone->recent_scanned[1] > file / 4)) {
+		spin_lock_irq(&zone->lru_lock);
+		zone->recent_scanned[1] /= 2;
+		zone->recent_rotated[1] /= 2;
+		spin_unlock_irq(&zone->lru_lock);
+	}
+
+	/*
+	 * With swappiness at 100, anonymous and file have the same priority.
+	 * This scanning priority is essentially the inverse of IO cost.
+	 */
+	anon_prio = vm_swappiness;
+	file_prio = 200 - vm_swappiness;
+
+	/*
+	 * The amount of pressure on anon vs file pages is inversely
+	 * proportional to the fraction of recently scanned pages on
+	 * each list that were recently referenced and in active use.
+	 */
+	ap = (anon_prio + 1) * (zone->recent_scanned[0] + 1);
+	ap /= zone->recent_rotated[0] + 1;
+
+	fp = (file_prio + 1) * (zone->recent_scanned[1] + 1);
+	fp /= zone->recent_rotated[1] + 1;
+
+	/* Normalize to percentages */
+	percent[0] = 100 * ap / (ap + fp + 1);
+	percent[1] = 100 - percent[0];
+}
+
 /*
  * This is a basic per-zone page freer.  Used by both kswapd and direct reclaim.
  */
 /**
  * ҳٻûַ̬ռҳաĿǴӹǻ32ҳ
- * ÿڸһιǻظøshrink_cacheұظrefill_inactive_zoneǻ
+ * ҳļҳһԻ/ǻÿɨget_scan_ratio䡣
+ * shrink_active_listshrink_inactive_listֱɨ߻յ㹻ҳ
  *		zone:		ҪлյĹ
  *		sc:			ƻյĲ
  */
 static void
 shrink_zone(struct zone *zone, struct scan_control *sc)
 {
-	unsigned long nr_active;
-	unsigned long nr_inactive;
+	unsigned long nr[NR_LRU_LISTS];
+	unsigned long percent[2];	/* anon @ 0; file @ 1 */
+	int l;
 
-	/*
-	 * Add one to `nr_to_scan' just to make sure that the kernel will
-	 * slowly sift through the active list.
-	 */
-	/**
-	 * ɨҳȼΪ0ôͽлҳ뵽ɨҳС
-	 */
-	zone->nr_scan_active += (zone->nr_active >> sc->priority) + 1;
-	/**
-	 * ɨҳ32ͽֲnr_active
-	 */
-	nr_active = zone->nr_scan_active;
-	if (nr_active >= SWAP_CLUSTER_MAX)
-		zone->nr_scan_active = 0;
-	else
-		nr_active = 0;
+	get_scan_ratio(zone, sc, percent);
 
 	/**
-	 * ɨҳȼΪ0ôͽзǻҳ뵽ɨҳС
+	 * ȼɨۼÿĴɨҳܹ32ҳɨ衣
 	 */
-	zone->nr_scan_inactive += (zone->nr_inactive >> sc->priority) + 1;
-	/**
-	 * ɨǻҳ32ͽֲnr_inactive
+	for_each_evictable_lru(l) {
+		int file = is_file_lru(l);
+		unsigned long scan;
+
+		scan = zone->nr_lru[l];
+		if (sc->priority || !percent[file]) {
+			scan >>= sc->priority;
+			scan = (scan * percent[file]) / 100;
+		}
+		zone->nr_scan[l] += scan;
+		nr[l] = zone->nr_scan[l];
+		if (nr[l] >= SWAP_CLUSTER_MAX)
+			zone->nr_scan[l] = 0;
+		else
+			nr[l] = 0;
+	}
+
+	/*
+	 * The active anon list is only aged while the inactive anon list is
+	 * short of pages, the active file list whenever it has been given
+	 * any pressure.
 	 */
-	nr_inactive = zone->nr_scan_inactive;
-	if (nr_inactive >= SWAP_CLUSTER_MAX)
-		zone->nr_scan_inactive = 0;
-	else
-		nr_inactive = 0;
+	if (!inactive_anon_is_low(zone))
+		nr[LRU_ACTIVE_ANON] = 0;
 
 	/**
 	 * ÿƲĻҳΪ32
 	 */
 	sc->nr_to_reclaim = SWAP_CLUSTER_MAX;
 
-	/**
-	 * nr_activenr_inactiveΪ0κ飬û̬ûзκҳʱų
-	 */
-	while (nr_active || nr_inactive) {
-		/**
-		 * nr_activeΪ򲹳ǻಹ32ҳ
-		 */
-		if (nr_active) {
-			sc->nr_to_scan = min(nr_active,
+	while (nr[LRU_INACTIVE_ANON] || nr[LRU_ACTIVE_ANON] ||
+	       nr[LRU_INACTIVE_FILE] || nr[LRU_ACTIVE_FILE]) {
+		for_each_evictable_lru(l) {
+			if (!nr[l])
+				continue;
+			sc->nr_to_scan = min(nr[l],
 					(unsigned long)SWAP_CLUSTER_MAX);
-			nr_active -= sc->nr_to_scan;
-			refill_inactive_zone(zone, sc);
+			nr[l] -= sc->nr_to_scan;
+			if (is_active_lru(l))
+				shrink_active_list(zone, sc, is_file_lru(l));
+			else
+				shrink_inactive_list(zone, sc, is_file_lru(l));
 		}
-
 		/**
-		 * ҳ
+		 * ɹճ32ҳ˳
 		 */
-		if (nr_inactive) {
-			sc->nr_to_scan = min(nr_inactive,
-					(unsigned long)SWAP_CLUSTER_MAX);
-			nr_inactive -= sc->nr_to_scan;
-			shrink_cache(zone, sc);
-			/**
-			 * ɹճ32ҳ˳
-			 */
-			if (sc->nr_to_reclaim <= 0)
-				break;
-		}
+		if (sc->nr_to_reclaim <= 0)
+			break;
+	}
+
+	/*
+	 * Even if we did not try to evict anon pages at all, we want to
+	 * rebalance the anon lru active/inactive ratio, so that there is
+	 * something to swap out once the file cache runs low.
+	 */
+	if (nr_swap_pages > 0 && inactive_anon_is_low(zone)) {
+		sc->nr_to_scan = SWAP_CLUSTER_MAX;
+		shrink_active_list(zone, sc, 0);
 	}
 }
 
+/*
+ * The pages a zone can hope to reclaim: the file lists always, the anon
+ * lists only when there is swap space to put them in.
+ */
+static unsigned long zone_reclaimable_pages(struct zone *zone)
+{
+	unsigned long nr;
+
+	nr = zone->nr_lru[LRU_ACTIVE_FILE] + zone->nr_lru[LRU_INACTIVE_FILE];
+	if (nr_swap_pages > 0)
+		nr += zone->nr_lru[LRU_ACTIVE_ANON] +
+			zone->nr_lru[LRU_INACTIVE_ANON];
+	return nr;
+}
+
 /*
  * This is the direct reclaim path, for page-allocating processes.  We only
  * try to reclaim pages from zones which will satisfy the caller's allocation
@@ -1196,7 +1346,7 @@ int try_to_free_pages(struct zone **zones,
 		struct zone *zone = zones[i];
 
 		zone->temp_priority = DEF_PRIORITY;
-		lru_pages += zone->nr_active + zone->nr_inactive;
+		lru_pages += zone_reclaimable_pages(zone);
 	}
 
 	/**
@@ -1204,9 +1354,8 @@ int try_to_free_pages(struct zone **zones,
 	 */
 	for (priority = DEF_PRIORITY; priority >= 0; priority--) {
 		/**
-		 * scһЩֶΣû̵̬ҳnr_mappedֶΣѱεĵǰȼpriorityֶΡ
+		 * scһЩֶΣѱεĵǰȼpriorityֶΡ
 		 */
-		sc.nr_mapped = read_page_state(nr_mapped);
 		sc.nr_scanned = 0;
 		sc.nr_reclaimed = 0;
 		sc.priority = priority;
@@ -1313,7 +1462,6 @@ loop_again:
 	 */
 	sc.gfp_mask = GFP_KERNEL;
 	sc.may_writepage = 0;
-	sc.nr_mapped = read_page_state(nr_mapped);
 
 	inc_page_state(pageoutrun);
 
@@ -1372,12 +1520,12 @@ loop_again:
 		}
 scan:
 		/**
-		 * ٴɨлͷǻϵҳ
+		 * ٴɨпɻյLRUϵҳ
 		 */
 		for (i = 0; i <= end_zone; i++) {
 			struct zone *zone = pgdat->node_zones + i;
 
-			lru_pages += zone->nr_active + zone->nr_inactive;
+			lru_pages += zone_reclaimable_pages(zone);
 		}
 
 		/*
@@ -1426,8 +1574,7 @@ scan:
 			total_scanned += sc.nr_scanned;
 			if (zone->all_unreclaimable)
 				continue;
-			if (zone->pages_scanned >= (zone->nr_active +
-							zone->nr_inactive) * 4)
+			if (zone->pages_scanned >= zone_reclaimable_pages(zone) * 4)
 				zone->all_unreclaimable = 1;
 			/*
 			 * If we've done a decent amount of scanning and
@@ -1649,7 +1796,6 @@ static int __init kswapd_init(void)
 	for_each_pgdat(pgdat)
 		pgdat->kswapd
 		= find_task_by_pid(kernel_thread(kswapd, pgdat, CLONE_KERNEL));
-	total_memory = nr_free_pagecache_pages();
 	hotcpu_notifier(cpu_callback, 0);
 	return 0;
 }
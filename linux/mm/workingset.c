@@ -0,0 +1,266 @@
+/*
+ * mm/workingset.c
+ *
+ * Working set detection for the page cache.
+ *
+ * A file page that is read once enters the inactive list and, unless it
+ * is accessed again there, is evicted from its tail.  That protects the
+ * active list from streaming IO, but also means a page that is part of
+ * the working set, and only fell off because the inactive list is too
+ * short for its access distance, has to start all over again each time.
+ *
+ * So when reclaim evicts a page cache page it leaves a shadow entry in the
+ * page's radix tree slot, recording the zone's inactive_age: a counter of
+ * evictions and activations, i.e. of how far the inactive list has moved.
+ * If the page is read back in, the difference between the current and the
+ * recorded inactive_age is how many more slots the inactive list would
+ * have needed to keep the page.  Those could only come out of the active
+ * list, so when the distance is no greater than the active file list the
+ * page is activated straight away, competing with the current working set
+ * instead of going through the inactive list again.
+ *
+ * Every refault also means reclaim took a page from the file lists that
+ * was still needed, so it is charged to them as a rotation in
+ * recent_rotated[1], like a page scanned and put back on the active list.
+ * get_scan_ratio() then shifts pressure towards anon pages while the page
+ * cache keeps refaulting.  Activations off the inactive file list are
+ * charged the same way.
+ *
+ * Shadow entries are removed when the page comes back or the file is
+ * truncated, at the latest when the inode is evicted.  A long-lived inode
+ * can still pile up shadows for a file many times the size of memory, so
+ * mappings holding shadows are kept on a list and a shrinker trims them
+ * under memory pressure.  Shadows are trimmed in index order from a
+ * per-mapping cursor, which empties whole radix tree nodes so that they
+ * are freed as well.  The number of shadows is nr_shadows in /proc/vmstat.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/pagemap.h>
+#include <linux/radix-tree.h>
+#include <linux/pagevec.h>
+#include <linux/module.h>
+#include <linux/init.h>
+
+/*
+ * A shadow entry is an exceptional radix tree entry holding the node and
+ * zone the page was evicted from and the zone's inactive_age at the time,
+ * truncated to what fits.
+ */
+#define EVICTION_SHIFT	(RADIX_TREE_EXCEPTIONAL_SHIFT + \
+			 NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK	((~0UL >> EVICTION_SHIFT) & ~0U)
+
+static void *pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone->zone_pgdat->node_id;
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << RADIX_TREE_EXCEPTIONAL_SHIFT);
+
+	return (void *)(eviction | RADIX_TREE_EXCEPTIONAL_ENTRY);
+}
+
+static void unpack_shadow(void *shadow, struct zone **zonep,
+			  unsigned long *distance)
+{
+	unsigned long entry = (unsigned long)shadow;
+	unsigned long eviction, refault;
+	int zid, nid;
+
+	entry >>= RADIX_TREE_EXCEPTIONAL_SHIFT;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+	eviction = entry & EVICTION_MASK;
+
+	*zonep = NODE_DATA(nid)->node_zones + zid;
+
+	refault = (unsigned int)atomic_read(&(*zonep)->inactive_age);
+	*distance = (refault - eviction) & EVICTION_MASK;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Returns a shadow entry to be stored in @mapping->page_tree in place of
+ * the evicted @page.  Called by reclaim under mapping->tree_lock.
+ */
+/**
+ * ҳʱãشҳڻеӰ
+ */
+void *workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction;
+
+	eviction = (unsigned int)atomic_inc_return(&zone->inactive_age);
+	return pack_shadow(eviction & EVICTION_MASK, zone);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @shadow: shadow entry of the evicted page
+ *
+ * Calculates how far the inactive list moved while the page was out of
+ * memory.  Returns 1 if the page should be activated right away because
+ * it would have stayed resident with an inactive list that much longer,
+ * 0 if it should start on the inactive list as usual.  Called under
+ * mapping->tree_lock, with interrupts disabled.
+ */
+/**
+ * յҳٴζʱáҳڴеʱǻƶľ벻
+ * ļҳĳȣ˵ҳڹ1ɵֱӽ伤
+ */
+int workingset_refault(void *shadow)
+{
+	unsigned long refault_distance;
+	struct zone *zone;
+
+	unpack_shadow(shadow, &zone, &refault_distance);
+	inc_page_state(workingset_refault);
+
+	spin_lock(&zone->lru_lock);
+	zone->recent_rotated[1]++;
+	spin_unlock(&zone->lru_lock);
+
+	if (refault_distance <= zone->nr_lru[LRU_ACTIVE_FILE]) {
+		inc_page_state(workingset_activate);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ *
+ * An activation frees a slot of the inactive list just like an eviction,
+ * so it advances the inactive list clock as well.  Called with
+ * zone->lru_lock held.
+ */
+void workingset_activation(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+
+	atomic_inc(&zone->inactive_age);
+	zone->recent_rotated[1]++;
+}
+
+/*
+ * Mappings that hold shadow entries, oldest first.  Lock order is
+ * mapping->tree_lock -> shadow_lock; the shrinker, which needs them the
+ * other way around, only trylocks tree_lock.
+ */
+static LIST_HEAD(shadow_mappings);
+static spinlock_t shadow_lock = SPIN_LOCK_UNLOCKED;
+
+/**
+ * workingset_add_shadow - account a shadow entry stored in @mapping
+ * @mapping: address space the shadow was stored in
+ *
+ * Called under mapping->tree_lock.
+ */
+void workingset_add_shadow(struct address_space *mapping)
+{
+	if (!mapping->nrshadows++) {
+		spin_lock(&shadow_lock);
+		list_add_tail(&mapping->shadow_list, &shadow_mappings);
+		spin_unlock(&shadow_lock);
+	}
+	inc_page_state(nr_shadows);
+}
+
+/**
+ * workingset_del_shadow - account a shadow entry removed from @mapping
+ * @mapping: address space the shadow was removed from
+ *
+ * Called under mapping->tree_lock.  Once the last shadow is gone the
+ * mapping leaves the shrinker's list, so it can be freed.
+ */
+void workingset_del_shadow(struct address_space *mapping)
+{
+	if (!--mapping->nrshadows) {
+		spin_lock(&shadow_lock);
+		list_del_init(&mapping->shadow_list);
+		spin_unlock(&shadow_lock);
+	}
+	dec_page_state(nr_shadows);
+}
+
+/*
+ * Remove up to one pagevec worth of shadows from @mapping, starting at its
+ * cursor.  Called with shadow_lock and mapping->tree_lock held.  Returns
+ * the number of radix tree entries looked at.
+ */
+static int trim_mapping_shadows(struct address_space *mapping)
+{
+	void *entries[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	unsigned int i, nr;
+
+	nr = radix_tree_gang_lookup_index(&mapping->page_tree, entries,
+				indices, mapping->shadow_cursor, PAGEVEC_SIZE);
+	if (!nr) {
+		mapping->shadow_cursor = 0;
+		return 1;
+	}
+	for (i = 0; i < nr; i++) {
+		if (!radix_tree_exceptional_entry(entries[i]))
+			continue;
+		radix_tree_delete(&mapping->page_tree, indices[i]);
+		mapping->nrshadows--;
+		dec_page_state(nr_shadows);
+		inc_page_state(workingset_shadow_reclaim);
+	}
+	mapping->shadow_cursor = indices[nr - 1] + 1;
+	if (!mapping->nrshadows)
+		list_del_init(&mapping->shadow_list);
+	return nr;
+}
+
+/*
+ * Shrinker callback: trims shadows round-robin over the mappings holding
+ * them and reports how many are left.
+ */
+/**
+ * ڴʱshrink_slabãӸַռɾӰ
+ */
+static int shrink_shadows(int nr_to_scan, unsigned int gfp_mask)
+{
+	struct address_space *mapping;
+	long nr;
+
+	if (nr_to_scan) {
+		spin_lock_irq(&shadow_lock);
+		while (nr_to_scan > 0 && !list_empty(&shadow_mappings)) {
+			mapping = list_entry(shadow_mappings.next,
+					struct address_space, shadow_list);
+			list_move_tail(&mapping->shadow_list, &shadow_mappings);
+			if (!spin_trylock(&mapping->tree_lock)) {
+				nr_to_scan -= PAGEVEC_SIZE;
+				continue;
+			}
+			nr_to_scan -= trim_mapping_shadows(mapping);
+			spin_unlock(&mapping->tree_lock);
+		}
+		spin_unlock_irq(&shadow_lock);
+	}
+
+	nr = (long)read_page_state(nr_shadows);
+	if (nr < 0)
+		nr = 0;
+	return nr > INT_MAX ? INT_MAX : nr;
+}
+
+static int __init workingset_init(void)
+{
+	set_shrinker(DEFAULT_SEEKS, shrink_shadows);
+	return 0;
+}
+
+module_init(workingset_init)
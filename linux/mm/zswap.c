@@ -0,0 +1,368 @@
+/*
+ * mm/zswap.c
+ *
+ * Compressed cache in front of the swap devices.
+ *
+ * swap_writepage() first offers each page to the pool here.  The page is
+ * deflated into a buffer of its own, indexed by its swap slot, and its
+ * swap cache page is freed without any I/O.  swap_readpage() inflates it
+ * again from the pool if it is there, and goes to the device only if not.
+ * Freeing the slot frees the compressed copy with it.
+ *
+ * The pool is limited to zswap_max_pool_percent of memory.  When a store
+ * finds it full, the oldest entries are written back to the swap device
+ * to make room: each is inflated into a new swap cache page, which goes
+ * out through the normal swap writeout path and is then reclaimed like
+ * any other.  Once that page is in the swap cache, the slot cannot be
+ * stored to or read from behind our back, so the entry can go at once.
+ *
+ * zswap_lock covers the per-device radix trees, the LRU list and the
+ * entry refcounts.  It nests inside swap_device_lock, as slots are freed
+ * under that, and is never held while calling back into the swap code.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/swapops.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/writeback.h>
+#include <linux/radix-tree.h>
+#include <linux/percpu.h>
+#include <linux/crypto.h>
+#include <linux/slab.h>
+#include <linux/zswap.h>
+#include <linux/init.h>
+
+int sysctl_zswap = 1;
+int zswap_max_pool_percent = 20;
+unsigned long zswap_stored_pages;
+unsigned long zswap_pool_pages;
+
+/* Bytes of kmalloc memory the compressed data takes up */
+static unsigned long zswap_pool_bytes;
+static int zswap_ready;
+
+/*
+ * The data goes into the kmalloc cache of the next power of two, so
+ * anything over half a page would take up a whole one and save nothing.
+ */
+#define ZSWAP_MAX_LENGTH	(PAGE_SIZE / 2)
+
+/* Allocations in the swap writeout path must neither wait nor warn */
+#define ZSWAP_GFP		(__GFP_NOWARN | __GFP_NORETRY)
+#define ZSWAP_WB_GFP		(GFP_NOIO | __GFP_HIGHMEM | __GFP_NOWARN | \
+				 __GFP_NORETRY)
+
+/**
+ * ѹеһ(type, offset)ҳѹݡ
+ */
+struct zswap_entry {
+	struct list_head lru;		/* on zswap_lru, oldest at the tail */
+	int type;
+	unsigned long offset;
+	unsigned int length;		/* of the compressed data */
+	int refcount;			/* the tree's, plus loads in progress */
+	u8 *data;
+};
+
+static struct radix_tree_root zswap_trees[MAX_SWAPFILES];
+static LIST_HEAD(zswap_lru);
+static DEFINE_SPINLOCK(zswap_lock);
+
+static kmem_cache_t *zswap_entry_cachep;
+
+/* The deflate transforms keep state: one for each CPU, with a buffer */
+static DEFINE_PER_CPU(struct crypto_tfm *, zswap_tfm);
+static DEFINE_PER_CPU(u8 *, zswap_dstmem);
+
+static inline struct zswap_entry *zswap_lookup(int type, unsigned long offset)
+{
+	return radix_tree_lookup(&zswap_trees[type], offset);
+}
+
+static inline int zswap_pool_full(void)
+{
+	return zswap_pool_pages * 100 >=
+		totalram_pages * zswap_max_pool_percent;
+}
+
+/* Drop a reference to @entry, and free it with the last.  zswap_lock held. */
+static void zswap_entry_put(struct zswap_entry *entry)
+{
+	if (--entry->refcount)
+		return;
+	zswap_pool_bytes -= ksize(entry->data);
+	zswap_pool_pages = (zswap_pool_bytes + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	zswap_stored_pages--;
+	kfree(entry->data);
+	kmem_cache_free(zswap_entry_cachep, entry);
+}
+
+/* Take @entry out of the pool.  zswap_lock held. */
+static void zswap_erase(struct zswap_entry *entry)
+{
+	radix_tree_delete(&zswap_trees[entry->type], entry->offset);
+	list_del_init(&entry->lru);
+	zswap_entry_put(entry);
+}
+
+static void zswap_decompress(struct zswap_entry *entry, struct page *page)
+{
+	unsigned int dlen = PAGE_SIZE;
+	u8 *dst;
+	int cpu, ret;
+
+	cpu = get_cpu();
+	dst = kmap_atomic(page, KM_USER0);
+	ret = crypto_comp_decompress(per_cpu(zswap_tfm, cpu), entry->data,
+				     entry->length, dst, &dlen);
+	kunmap_atomic(dst, KM_USER0);
+	put_cpu();
+	BUG_ON(ret || dlen != PAGE_SIZE);
+}
+
+/*
+ * Move the contents of @entry, on which the caller holds a reference, out
+ * to the swap device.
+ */
+static int zswap_writeback_entry(struct zswap_entry *entry)
+{
+	swp_entry_t swp = swp_entry(entry->type, entry->offset);
+	struct writeback_control wbc = {
+		.sync_mode = WB_SYNC_NONE,
+	};
+	struct zswap_entry *cur;
+	struct page *page;
+	int err;
+
+	page = alloc_page(ZSWAP_WB_GFP);
+	if (!page)
+		return -ENOMEM;
+	/*
+	 * Fails if the slot has been freed, or if its page is in the swap
+	 * cache already: then it is not the oldest page any more.
+	 */
+	err = add_to_swap_cache(page, swp, GFP_NOIO);
+	if (err) {
+		page_cache_release(page);
+		return err;
+	}
+	SetPageSwapBacked(page);
+	lru_cache_add(page);
+
+	spin_lock(&zswap_lock);
+	cur = zswap_lookup(entry->type, entry->offset);
+	if (cur) {
+		/* Freed and stored again meanwhile, if it is not @entry */
+		cur->refcount++;
+		zswap_erase(cur);
+	}
+	spin_unlock(&zswap_lock);
+	if (!cur) {
+		/* Freed and reused, with what is now on the device */
+		swap_readpage(NULL, page);
+		page_cache_release(page);
+		return -EAGAIN;
+	}
+
+	zswap_decompress(cur, page);
+	SetPageUptodate(page);
+	__swap_writepage(page, &wbc);
+	page_cache_release(page);
+
+	spin_lock(&zswap_lock);
+	zswap_entry_put(cur);
+	spin_unlock(&zswap_lock);
+	inc_page_state(zswpwriteback);
+	return 0;
+}
+
+/*
+ * Make room by writing the oldest entries back to the swap device.
+ * Returns 0 once the pool is below its limit.
+ */
+static int zswap_shrink(void)
+{
+	struct zswap_entry *entry;
+	int nr_tries = SWAP_CLUSTER_MAX;
+
+	while (zswap_pool_full()) {
+		if (!nr_tries--)
+			return -ENOMEM;
+		spin_lock(&zswap_lock);
+		if (list_empty(&zswap_lru)) {
+			spin_unlock(&zswap_lock);
+			return -ENOMEM;
+		}
+		entry = list_entry(zswap_lru.prev, struct zswap_entry, lru);
+		list_del_init(&entry->lru);
+		entry->refcount++;
+		spin_unlock(&zswap_lock);
+
+		zswap_writeback_entry(entry);
+
+		spin_lock(&zswap_lock);
+		/* Still in the pool if writeback failed: try again later */
+		if (list_empty(&entry->lru) &&
+		    zswap_lookup(entry->type, entry->offset) == entry)
+			list_add(&entry->lru, &zswap_lru);
+		zswap_entry_put(entry);
+		spin_unlock(&zswap_lock);
+	}
+	return 0;
+}
+
+/*
+ * Store the locked swap cache @page in the pool instead of writing it to
+ * the swap device.  Returns 0 if it is stored, and the caller does no I/O.
+ */
+int zswap_store(struct page *page)
+{
+	swp_entry_t swp = { .val = page->private };
+	struct zswap_entry *entry, *old;
+	unsigned int dlen = PAGE_SIZE;
+	u8 *src, *dst;
+	int cpu, ret;
+
+	if (!sysctl_zswap || !zswap_ready)
+		return -ENODEV;
+	if (zswap_pool_full() && zswap_shrink())
+		goto reject;
+
+	entry = kmem_cache_alloc(zswap_entry_cachep, ZSWAP_GFP);
+	if (!entry)
+		goto reject;
+	if (radix_tree_preload(GFP_NOIO))
+		goto free_entry;
+
+	cpu = get_cpu();
+	dst = per_cpu(zswap_dstmem, cpu);
+	src = kmap_atomic(page, KM_USER0);
+	ret = crypto_comp_compress(per_cpu(zswap_tfm, cpu), src, PAGE_SIZE,
+				   dst, &dlen);
+	kunmap_atomic(src, KM_USER0);
+	if (ret || dlen > ZSWAP_MAX_LENGTH) {
+		put_cpu();
+		goto preload_end;
+	}
+	entry->data = kmalloc(dlen, ZSWAP_GFP);
+	if (!entry->data) {
+		put_cpu();
+		goto preload_end;
+	}
+	memcpy(entry->data, dst, dlen);
+	put_cpu();
+
+	entry->type = swp_type(swp);
+	entry->offset = swp_offset(swp);
+	entry->length = dlen;
+	entry->refcount = 1;
+
+	spin_lock(&zswap_lock);
+	/* Written out before and dirtied since: the old copy is stale */
+	old = zswap_lookup(entry->type, entry->offset);
+	if (old)
+		zswap_erase(old);
+	radix_tree_insert(&zswap_trees[entry->type], entry->offset, entry);
+	list_add(&entry->lru, &zswap_lru);
+	zswap_stored_pages++;
+	zswap_pool_bytes += ksize(entry->data);
+	zswap_pool_pages = (zswap_pool_bytes + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	spin_unlock(&zswap_lock);
+	radix_tree_preload_end();
+
+	inc_page_state(zswpout);
+	return 0;
+
+preload_end:
+	radix_tree_preload_end();
+free_entry:
+	kmem_cache_free(zswap_entry_cachep, entry);
+reject:
+	inc_page_state(zswpreject);
+	return -ENOMEM;
+}
+
+/*
+ * Fill the locked swap cache @page from the pool.  Returns 0 if it was
+ * there, and the caller does no I/O.  The copy in the pool stays, as
+ * long as the slot does.
+ */
+int zswap_load(struct page *page)
+{
+	swp_entry_t swp = { .val = page->private };
+	struct zswap_entry *entry;
+
+	if (!zswap_ready)
+		return -ENODEV;
+	spin_lock(&zswap_lock);
+	entry = zswap_lookup(swp_type(swp), swp_offset(swp));
+	if (entry)
+		entry->refcount++;
+	spin_unlock(&zswap_lock);
+	if (!entry) {
+		inc_page_state(zswpmiss);
+		return -ENOENT;
+	}
+
+	zswap_decompress(entry, page);
+
+	spin_lock(&zswap_lock);
+	zswap_entry_put(entry);
+	spin_unlock(&zswap_lock);
+	inc_page_state(zswpin);
+	return 0;
+}
+
+/* The slot has been freed.  swap_device_lock held. */
+void zswap_invalidate(int type, unsigned long offset)
+{
+	struct zswap_entry *entry;
+
+	spin_lock(&zswap_lock);
+	entry = zswap_lookup(type, offset);
+	if (entry)
+		zswap_erase(entry);
+	spin_unlock(&zswap_lock);
+}
+
+/* swapoff: drop whatever is left of the device in the pool. */
+void zswap_invalidate_area(int type)
+{
+	struct zswap_entry *entries[16];
+	int i, nr;
+
+	spin_lock(&zswap_lock);
+	while ((nr = radix_tree_gang_lookup(&zswap_trees[type],
+				(void **)entries, 0, ARRAY_SIZE(entries)))) {
+		for (i = 0; i < nr; i++)
+			zswap_erase(entries[i]);
+	}
+	spin_unlock(&zswap_lock);
+}
+
+static int __init zswap_init(void)
+{
+	int cpu, i;
+
+	for (i = 0; i < MAX_SWAPFILES; i++)
+		INIT_RADIX_TREE(&zswap_trees[i], GFP_ATOMIC | __GFP_NOWARN);
+	zswap_entry_cachep = kmem_cache_create("zswap_entry",
+			sizeof(struct zswap_entry), 0, SLAB_PANIC, NULL, NULL);
+
+	for_each_cpu(cpu) {
+		per_cpu(zswap_tfm, cpu) = crypto_alloc_tfm("deflate", 0);
+		per_cpu(zswap_dstmem, cpu) = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		if (!per_cpu(zswap_tfm, cpu) || !per_cpu(zswap_dstmem, cpu)) {
+			printk(KERN_WARNING "zswap: no deflate compressor, "
+			       "swap compression disabled\n");
+			return 0;
+		}
+	}
+	zswap_ready = 1;
+	return 0;
+}
+
+/* After the deflate algorithm has registered with the crypto API */
+late_initcall(zswap_init);
@@ -3532,11 +3532,16 @@ void free_netdev(struct net_device *dev)
 #endif
 }
  
-/* Synchronize with packet receive processing. */
+/*
+ * Synchronize with packet receive processing.  Callers unregister
+ * hooks and handlers one at a time (netfilter module unload does
+ * dozens in a row), so don't make each of them wait out a full tick
+ * driven grace period.
+ */
 void synchronize_net(void) 
 {
 	might_sleep();
-	synchronize_kernel();
+	synchronize_kernel_expedited();
 }
 
 /**